@@ -0,0 +1,56 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The benchmarks replace the global allocation functions to count allocations. Only C++ allocations are seen,
+// memory SDL and the drivers get from malloc isn't counted.
+
+namespace {
+
+    std::atomic<size_t> allocation_count = 0;
+
+    void* allocate(size_t size)
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+        if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+        throw std::bad_alloc();
+    }
+
+}
+
+size_t isometric::benchmarks::get_allocation_count()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
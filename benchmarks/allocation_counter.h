@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+
+namespace isometric::benchmarks {
+
+    /// <returns>Every operator new call made by any thread since the benchmarks started</returns>
+    size_t get_allocation_count();
+
+}
@@ -0,0 +1,20 @@
+#include "suites.h"
+#include "../source/assets/image.h"
+#include "../source/assets/font.h"
+
+using namespace isometric;
+using namespace isometric::assets;
+using namespace isometric::benchmarks;
+
+void isometric::benchmarks::run_asset_benchmarks(benchmark_suite& suite)
+{
+    suite.run("assets/image_load", 50, [&](size_t) {
+        auto loaded = image::load("benchmark_image", "content/grassland_tiles.png");
+        if (!loaded) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Benchmark image failed to load");
+    });
+
+    suite.run("assets/font_load", 50, [&](size_t) {
+        auto loaded = font::load("benchmark_font", "content/roboto/RobotoMono-Bold.ttf", std::vector<int>{ 16, 21, 32 });
+        if (!loaded) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Benchmark font failed to load");
+    });
+}
@@ -0,0 +1,77 @@
+#include "benchmark.h"
+#include <fstream>
+
+using namespace isometric::benchmarks;
+
+benchmark_suite::benchmark_suite(std::string filter) : filter(std::move(filter))
+{
+
+}
+
+bool benchmark_suite::matches(const std::string& name) const
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void benchmark_suite::add_result(const std::string& name, size_t allocations)
+{
+    const double ticks_per_us = tools::stopwatch::get_frequency() / 1'000'000.0;
+
+    benchmark_result result;
+    result.name = name;
+    result.iterations = samples.size();
+    result.allocations_per_iteration = static_cast<double>(allocations) / samples.size();
+
+    double total = 0.0;
+    for (Uint64 sample : samples) total += static_cast<double>(sample);
+    result.mean_us = total / samples.size() / ticks_per_us;
+
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&](double fraction) {
+        const size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * (samples.size() - 1) + 0.5));
+        return samples[index] / ticks_per_us;
+    };
+
+    result.p50_us = percentile(0.50);
+    result.p95_us = percentile(0.95);
+    result.p99_us = percentile(0.99);
+    result.max_us = samples.back() / ticks_per_us;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Benchmark [%s] finished, %llu iterations", name.c_str(),
+        static_cast<unsigned long long>(result.iterations));
+
+    results.push_back(std::move(result));
+}
+
+void benchmark_suite::report() const
+{
+    SDL_Log("%-44s %8s %12s %12s %12s %12s %10s", "benchmark", "iters", "p50 us", "p95 us", "p99 us", "max us", "allocs/it");
+
+    for (const auto& result : results)
+    {
+        SDL_Log("%-44s %8llu %12.2f %12.2f %12.2f %12.2f %10.2f",
+            result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+            result.p50_us, result.p95_us, result.p99_us, result.max_us, result.allocations_per_iteration);
+    }
+}
+
+bool benchmark_suite::write_csv(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write benchmark results to [%s]", path.c_str());
+        return false;
+    }
+
+    file << "benchmark,iterations,p50_us,p95_us,p99_us,max_us,mean_us,allocations_per_iteration\n";
+    for (const auto& result : results)
+    {
+        file << result.name << ',' << result.iterations << ',' << result.p50_us << ',' << result.p95_us << ','
+            << result.p99_us << ',' << result.max_us << ',' << result.mean_us << ',' << result.allocations_per_iteration << '\n';
+    }
+
+    SDL_Log("Wrote %llu benchmark results to [%s]", static_cast<unsigned long long>(results.size()), path.c_str());
+    return static_cast<bool>(file);
+}
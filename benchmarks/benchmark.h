@@ -0,0 +1,84 @@
+#pragma once
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "allocation_counter.h"
+#include "../source/tools/stopwatch.h"
+
+namespace isometric::benchmarks {
+
+    struct benchmark_result
+    {
+        std::string name;
+        size_t iterations = 0;
+
+        // Time per iteration, in microseconds:
+        double p50_us = 0.0;
+        double p95_us = 0.0;
+        double p99_us = 0.0;
+        double max_us = 0.0;
+        double mean_us = 0.0;
+
+        double allocations_per_iteration = 0.0;
+    };
+
+    /// <summary>
+    /// Times benchmarks iteration by iteration, so the results are percentiles rather than just a mean
+    /// </summary>
+    class benchmark_suite
+    {
+    private:
+        std::string filter;
+        std::vector<benchmark_result> results;
+        std::vector<Uint64> samples;    // Reused by every benchmark
+
+        void add_result(const std::string& name, size_t allocations);
+
+    public:
+        /// <param name="filter">Only benchmarks whose name contains this are run, empty to run them all</param>
+        explicit benchmark_suite(std::string filter = std::string());
+
+        /// <returns>True if a benchmark with the name would run</returns>
+        bool matches(const std::string& name) const;
+
+        /// <summary>
+        /// Run body(iteration) a few times to warm caches up, then iterations times measuring each. Everything body
+        /// needs should be set up before calling run, so only the work being measured is timed and counted.
+        /// </summary>
+        template<class Body>
+        void run(const std::string& name, size_t iterations, Body&& body)
+        {
+            if (!matches(name) || iterations == 0) return;
+
+            const size_t warm_up = std::min<size_t>(iterations / 10 + 1, 50);
+            for (size_t i = 0; i < warm_up; i++) body(i);
+
+            samples.assign(iterations, 0);
+            const size_t allocations_before = get_allocation_count();
+
+            for (size_t i = 0; i < iterations; i++)
+            {
+                const Uint64 start = tools::stopwatch::get_tick();
+                body(i);
+                samples[i] = tools::stopwatch::get_tick() - start;
+            }
+
+            add_result(name, get_allocation_count() - allocations_before);
+        }
+
+        const std::vector<benchmark_result>& get_results() const { return results; }
+
+        /// <summary>
+        /// Log every result as a table
+        /// </summary>
+        void report() const;
+
+        /// <summary>
+        /// Write every result as CSV, for comparing runs
+        /// </summary>
+        /// <returns>False if the file couldn't be written</returns>
+        bool write_csv(const std::string& path) const;
+    };
+
+}
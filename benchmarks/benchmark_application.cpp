@@ -0,0 +1,37 @@
+#include "benchmark_application.h"
+#include "suites.h"
+
+using namespace isometric;
+using namespace isometric::assets;
+using namespace isometric::benchmarks;
+
+void benchmark_application::configure(const std::string& filter, const std::string& results_path)
+{
+    this->filter = filter;
+    this->results_path = results_path;
+}
+
+bool benchmark_application::on_start()
+{
+    benchmark_suite suite(filter);
+
+    auto tiles_image = image::load("grasslands", "content/grassland_tiles.png");
+    if (!tiles_image)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Benchmarks need content/grassland_tiles.png, run from the repository root");
+        shutdown();
+        return false;
+    }
+
+    run_core_benchmarks(suite, tiles_image->get_texture());
+    run_world_benchmarks(suite, *this, tiles_image->get_texture());
+    run_text_benchmarks(suite, *this);
+    run_asset_benchmarks(suite);
+
+    suite.report();
+    if (!results_path.empty()) suite.write_csv(results_path);
+
+    // Nothing is left to do, the main loop returns straight away:
+    shutdown();
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <isometric.h>
+#include <string>
+#include "benchmark.h"
+
+namespace isometric::benchmarks {
+
+    /// <summary>
+    /// Runs every benchmark from on_start and shuts down, so benchmarks that draw have the same renderer, graphics
+    /// and asset manager the game does
+    /// </summary>
+    class benchmark_application : public isometric::application
+    {
+    private:
+        std::string filter;
+        std::string results_path;
+
+    public:
+        /// <param name="filter">Only run benchmarks whose name contains this, empty to run them all</param>
+        /// <param name="results_path">Where to write the results as CSV, empty to only log them</param>
+        void configure(const std::string& filter, const std::string& results_path);
+
+    protected:
+        bool on_start() override;
+    };
+
+}
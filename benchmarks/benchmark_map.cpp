@@ -0,0 +1,41 @@
+#include "benchmark_map.h"
+#include <string>
+#include "../source/tools/random.h"
+
+using namespace isometric;
+
+std::shared_ptr<tile_map> isometric::benchmarks::create_benchmark_map(unsigned size, SDL_Texture* tiles_texture)
+{
+    constexpr uint64_t map_seed = 0x15014E7;
+    constexpr unsigned foliage_image = 99;
+
+    auto map = tile_map::create(size, size, benchmark_tile_width, benchmark_tile_height);
+
+    map->add_image(tile_image::create("selection", 0, tiles_texture, 960, 160, benchmark_tile_width, benchmark_tile_height));
+    map->set_selection_image(0);
+
+    map->add_layer("grass");
+    for (unsigned i = 1, source_x = 0; i < 16; i++, source_x += 64)
+    {
+        map->add_image(tile_image::create("grass" + std::to_string(i), i, tiles_texture, source_x, 0,
+            benchmark_tile_width, benchmark_tile_height));
+        map->add_layer_default_image("grass", i);
+    }
+
+    const unsigned foliage_layer_id = map->add_layer("foliage");
+    map->add_image(tile_image::create("bush1", foliage_image, tiles_texture, 512, 320,
+        benchmark_tile_width, benchmark_tile_height * 2));
+
+    map->generate_default_images(map_seed);
+
+    // Roughly one tile in sixteen has a bush, enough that tall images show up in every view:
+    for (unsigned y = 0; y < size; y++)
+    {
+        for (unsigned x = 0; x < size; x++)
+        {
+            if (tools::random::hash_index(16, map_seed, x, y) == 0) map->get_tile(x, y).set_image_id(foliage_layer_id, foliage_image);
+        }
+    }
+
+    return map;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include "../source/core/tile_map.h"
+
+namespace isometric::benchmarks {
+
+    constexpr unsigned benchmark_tile_width = 64;
+    constexpr unsigned benchmark_tile_height = 32;
+
+    /// <summary>
+    /// A square map laid out like the game's: a grass layer with random default images and a sparse foliage
+    /// layer of images twice a tile's height. The same size always produces the same map.
+    /// </summary>
+    /// <param name="tiles_texture">The grassland tiles texture, content/grassland_tiles.png</param>
+    std::shared_ptr<tile_map> create_benchmark_map(unsigned size, SDL_Texture* tiles_texture);
+
+}
@@ -0,0 +1,212 @@
+#include "suites.h"
+#include "benchmark_map.h"
+#include "../source/core/transform.h"
+#include "../source/core/path_finder.h"
+#include "../source/core/terrain_generator.h"
+#include "../source/tools/random.h"
+#include "../source/tools/frame_arena.h"
+
+using namespace isometric;
+using namespace isometric::benchmarks;
+
+namespace {
+
+    constexpr size_t points_per_iteration = 1024;
+    constexpr uint64_t point_seed = 0xBE7C4;
+
+    // Results are added here so the work being measured can't be optimized away:
+    volatile float float_sink = 0.0f;
+    volatile int int_sink = 0;
+
+}
+
+void isometric::benchmarks::run_core_benchmarks(benchmark_suite& suite, SDL_Texture* tiles_texture)
+{
+    constexpr unsigned map_size = 1024;
+
+    auto map = create_benchmark_map(map_size, tiles_texture);
+    auto camera = camera::create(0, 0, 1280, 720, 100.0f, 200.0f);
+    const transform transform(camera, map);
+
+    // The same points every run, spread over the view and a little beyond it:
+    std::vector<SDL_Point> tile_points(points_per_iteration);
+    std::vector<SDL_FPoint> viewport_points(points_per_iteration);
+    std::vector<SDL_Point> map_points(points_per_iteration);
+    for (size_t i = 0; i < points_per_iteration; i++)
+    {
+        tile_points[i] = SDL_Point{
+            static_cast<int>(100 + tools::random::hash_index(24, point_seed, i, 0)),
+            static_cast<int>(200 + tools::random::hash_index(48, point_seed, i, 1))
+        };
+        viewport_points[i] = SDL_FPoint{
+            static_cast<float>(tools::random::hash_index(1280, point_seed, i, 2)),
+            static_cast<float>(tools::random::hash_index(720, point_seed, i, 3))
+        };
+        map_points[i] = SDL_Point{
+            static_cast<int>(tools::random::hash_index(map_size, point_seed, i, 4)),
+            static_cast<int>(tools::random::hash_index(map_size, point_seed, i, 5))
+        };
+    }
+
+    suite.run("transform/world_tile_to_viewport_pixels", 2000, [&](size_t) {
+        float sum = 0.0f;
+        for (const auto& point : tile_points) sum += transform.world_tile_to_viewport_pixels(point).x;
+        float_sink = float_sink + sum;
+    });
+
+    suite.run("transform/world_pixels_to_world_tile", 2000, [&](size_t) {
+        int sum = 0;
+        for (const auto& point : viewport_points) sum += transform.viewport_pixels_to_world_tile(point).x;
+        int_sink = int_sink + sum;
+    });
+
+    const transform_snapshot view = transform.get_snapshot();
+    std::vector<SDL_FPoint> converted_points(points_per_iteration);
+    std::vector<SDL_Point> converted_tiles(points_per_iteration);
+
+    suite.run("transform_snapshot/world_tiles_to_viewport_pixels", 2000, [&](size_t) {
+        view.world_tiles_to_viewport_pixels(tile_points, converted_points);
+        float_sink = float_sink + converted_points.back().x;
+    });
+
+    suite.run("transform_snapshot/viewport_pixels_to_world_tiles", 2000, [&](size_t) {
+        view.viewport_pixels_to_world_tiles(viewport_points, converted_tiles);
+        int_sink = int_sink + converted_tiles.back().x;
+    });
+
+    suite.run("transform/tile_hittest", 2000, [&](size_t) {
+        int hits = 0;
+        for (size_t i = 0; i < points_per_iteration; i++) hits += transform.tile_hittest(tile_points[i], viewport_points[i]) ? 1 : 0;
+        int_sink = int_sink + hits;
+    });
+
+    suite.run("transform/get_visible_tile_span", 2000, [&](size_t i) {
+        camera->set_current_pos(100.0f + (i % 64) * 0.25f, 200.0f + (i % 32) * 0.5f);
+        int_sink = int_sink + transform.get_visible_tile_span().y_end;
+    });
+
+    const unsigned grass_layer = map->get_layer_id("grass");
+    const unsigned foliage_layer = map->get_layer_id("foliage");
+
+    suite.run("tile_map/get_tile", 2000, [&](size_t) {
+        int sum = 0;
+        for (const auto& point : map_points) sum += map->get_tile(point.x, point.y).get_image_id(grass_layer);
+        int_sink = int_sink + sum;
+    });
+
+    suite.run("tile_map/find_tile", 2000, [&](size_t) {
+        int sum = 0;
+        for (const auto& point : map_points) sum += map->find_tile(point.x, point.y).has_image(foliage_layer) ? 1 : 0;
+        int_sink = int_sink + sum;
+    });
+
+    suite.run("tile_map/set_image_id", 2000, [&](size_t i) {
+        for (const auto& point : map_points) map->get_tile(point.x, point.y).set_image_id(grass_layer, 1 + static_cast<unsigned>(i % 15));
+    });
+
+    suite.run("tile_map/is_layer_static", 2000, [&](size_t) {
+        int sum = 0;
+        for (size_t i = 0; i < points_per_iteration; i++) sum += map->is_layer_static(static_cast<unsigned>(i & 1)) ? 1 : 0;
+        int_sink = int_sink + sum;
+    });
+
+    suite.run("tile_map/get_layer_id", 2000, [&](size_t) {
+        unsigned sum = 0;
+        for (size_t i = 0; i < points_per_iteration; i++) sum += map->get_layer_id(i & 1 ? "foliage" : "grass");
+        int_sink = int_sink + static_cast<int>(sum);
+    });
+
+    tools::random_generator generator(point_seed);
+    std::vector<int> random_values(points_per_iteration);
+
+    suite.run("random/range", 2000, [&](size_t) {
+        int sum = 0;
+        for (size_t i = 0; i < points_per_iteration; i++) sum += generator.range(0, 15);
+        int_sink = int_sink + sum;
+    });
+
+    suite.run("random/fill_range", 2000, [&](size_t) {
+        generator.fill_range(random_values, 0, 15);
+        int_sink = int_sink + random_values.back();
+    });
+
+    suite.run("random/hash_index", 2000, [&](size_t i) {
+        unsigned sum = 0;
+        for (size_t x = 0; x < points_per_iteration; x++) sum += tools::random::hash_index(16, point_seed, x, i);
+        int_sink = int_sink + static_cast<int>(sum);
+    });
+
+    // A fifth of the tiles blocked, runs at the end as it changes the map:
+    for (unsigned y = 0; y < map_size; y++)
+    {
+        for (unsigned x = 0; x < map_size; x++)
+        {
+            if (tools::random::hash_index(5, point_seed, x, y, 6) == 0) map->get_tile(x, y).set_passable(false);
+        }
+    }
+
+    auto paths = path_finder::create(map);
+    std::vector<SDL_Point> path_tiles;
+
+    suite.run("path_finder/find_path_short", 200, [&](size_t i) {
+        const SDL_Point& start = map_points[i % points_per_iteration];
+        const SDL_Point goal{ std::min<int>(map_size - 1, start.x + 12), std::min<int>(map_size - 1, start.y + 24) };
+        int_sink = int_sink + (paths->find_path(start, goal, path_tiles) ? static_cast<int>(path_tiles.size()) : 0);
+    });
+
+    suite.run("path_finder/find_path_long", 100, [&](size_t i) {
+        const SDL_Point& start = map_points[i % points_per_iteration];
+        const SDL_Point& goal = map_points[(i + 1) % points_per_iteration];
+        int_sink = int_sink + (paths->find_path(start, goal, path_tiles) ? static_cast<int>(path_tiles.size()) : 0);
+    });
+
+    // Dropped on the next update, so every iteration integrates a new field:
+    paths->set_flow_field_lifetime(0);
+
+    suite.run("path_finder/get_flow_field", 20, [&](size_t i) {
+        int_sink = int_sink + static_cast<int>(paths->get_flow_field(map_points[i % points_per_iteration])->get_chunk_count());
+        paths->update();
+    });
+
+    const auto field = paths->get_flow_field(SDL_Point{ map_size / 2, map_size / 2 });
+
+    suite.run("flow_field/get_next_tile", 2000, [&](size_t) {
+        int sum = 0;
+        SDL_Point next;
+        for (const auto& point : map_points) sum += field->get_next_tile(point, next) ? next.x : 0;
+        int_sink = int_sink + sum;
+    });
+
+    suite.run("path_finder/update_after_edit", 200, [&](size_t i) {
+        const SDL_Point& point = map_points[i % points_per_iteration];
+        tile edited = map->get_tile(point.x, point.y);
+        edited.set_passable(!edited.is_passable());
+        paths->update();
+    });
+
+    // One biome covering everything, so the cost measured is the noise and the per tile rules:
+    auto terrain = terrain_generator::create(point_seed);
+    terrain_biome everywhere;
+    everywhere.layers.push_back({ 0, { 1, 2, 3, 4 } });
+    terrain->add_biome(everywhere);
+
+    suite.run("terrain_generator/fill_chunk", 200, [&](size_t i) {
+        tile_chunk chunk(static_cast<unsigned>(i % map->get_chunks_wide()), static_cast<unsigned>(i / map->get_chunks_wide() % map->get_chunks_high()), map->get_layers().size());
+        terrain->fill_chunk(*map, chunk);
+        int_sink = int_sink + static_cast<int>(chunk.get_planes().revision);
+    });
+
+    // A frame's worth of transient lists, from the heap and from the frame arena, the arena should count no allocations:
+    suite.run("transient_lists/heap", 2000, [&](size_t) {
+        std::vector<SDL_Point> points;
+        for (const auto& point : map_points) points.push_back(point);
+        int_sink = int_sink + static_cast<int>(points.size());
+    });
+
+    suite.run("transient_lists/frame_arena", 2000, [&](size_t) {
+        tools::frame_arena::next_frame();
+        std::pmr::vector<SDL_Point> points(tools::frame_arena::get());
+        for (const auto& point : map_points) points.push_back(point);
+        int_sink = int_sink + static_cast<int>(points.size());
+    });
+}
@@ -0,0 +1,43 @@
+#include <memory>
+#include <string>
+#include "benchmark_application.h"
+
+using namespace isometric;
+using namespace isometric::benchmarks;
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        application_setup setup;
+        setup.name = "Isometric Lab Benchmarks";
+        setup.vertical_sync = false;
+        setup.verbose_logging = false;
+
+        std::string filter;
+        std::string results_path;
+
+        // For example: --headless --filter world/render --results benchmarks.csv
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--headless") setup.headless = true;
+            else if (arg == "--filter" && has_value) filter = argv[++i];
+            else if (arg == "--results" && has_value) results_path = argv[++i];
+            else SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Ignoring unknown argument [%s]", arg.c_str());
+        }
+
+        auto app = application::create<benchmark_application>(setup);
+        app->configure(filter, results_path);
+
+        app->start();
+    }
+    catch (std::exception ex)
+    {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "suites.h"
+#include "benchmark_map.h"
+#include <cmath>
+#include <format>
+#include "../source/core/world.h"
+#include "../source/assets/font.h"
+#include "../source/rendering/simple_bitmap_font.h"
+
+using namespace isometric;
+using namespace isometric::assets;
+using namespace isometric::benchmarks;
+using namespace isometric::rendering;
+
+namespace {
+
+    constexpr double frame_time = 1.0 / 60.0;
+    constexpr size_t frames_per_path = 600;
+
+    /// <summary>
+    /// Where the camera is on a frame of the scripted path: a diagonal pan out and back with a slow sideways
+    /// sweep, so caches see both new and revisited areas like continuous scrolling does
+    /// </summary>
+    SDL_FPoint get_path_position(size_t frame, const SDL_FPoint& max_position)
+    {
+        const double t = static_cast<double>(frame % frames_per_path) / frames_per_path;
+        const double out_and_back = t < 0.5 ? t * 2.0 : 2.0 - t * 2.0;
+        const double sweep = 0.5 + 0.5 * std::sin(t * 6.283185307179586 * 2.0);
+
+        return SDL_FPoint{
+            static_cast<float>(max_position.x * std::min(1.0, 0.25 * out_and_back + 0.1 * sweep)),
+            static_cast<float>(max_position.y * std::min(1.0, 0.25 * out_and_back))
+        };
+    }
+
+}
+
+void isometric::benchmarks::run_world_benchmarks(benchmark_suite& suite, application& app, SDL_Texture* tiles_texture)
+{
+    auto graphics = app.get_graphics();
+    SDL_Renderer* renderer = app.get_renderer();
+    const SDL_Rect viewport = app.get_viewport();
+
+    for (unsigned map_size : { 128u, 512u, 2048u })
+    {
+        std::shared_ptr<tile_map> map = nullptr;
+
+        // Tiles only is the loop without any caching, cached is the game's configuration, split is the cached
+        // configuration with two side by side views and a zoomed out minimap:
+        for (const char* config : { "tiles", "cached", "split" })
+        {
+            const std::string name = std::format("world/render/{}/{}", map_size, config);
+            if (!suite.matches(name)) continue;
+
+            if (!map) map = create_benchmark_map(map_size, tiles_texture);
+
+            const bool split = std::string_view(config) == "split";
+            const unsigned view_width = split ? viewport.w / 2 : viewport.w;
+
+            auto camera = camera::create(0, 0, view_width, viewport.h);
+            world world(map, camera);
+
+            auto second_camera = camera::create(view_width, 0, viewport.w - view_width, viewport.h);
+            auto minimap_camera = camera::create(viewport.w - viewport.w / 4, 0, viewport.w / 4, viewport.h / 4);
+            minimap_camera->set_zoom(0.125f);
+            if (split)
+            {
+                world.add_camera(second_camera);
+                world.add_camera(minimap_camera);
+            }
+
+            const bool cached = split || std::string_view(config) == "cached";
+            world.set_geometry_batching_enabled(true);
+            world.set_chunk_cache_enabled(cached);
+            world.set_scroll_buffer_enabled(cached);
+            world.set_parallel_draw_lists_enabled(cached);
+            world.set_depth_sorting_enabled(cached);
+
+            const SDL_FPoint max_position = world.get_transform().get_max_camera_position();
+
+            suite.run(name, frames_per_path, [&](size_t frame) {
+                camera->set_current_pos(get_path_position(frame, max_position));
+                second_camera->set_current_pos(get_path_position(frame + frames_per_path / 2, max_position));
+                minimap_camera->set_current_pos(camera->get_current_x(), camera->get_current_y());
+
+                graphics->clear();
+                world.update(frame_time);
+                world.render(renderer, frame_time);
+                SDL_RenderPresent(renderer);
+            });
+        }
+    }
+}
+
+void isometric::benchmarks::run_text_benchmarks(benchmark_suite& suite, application& app)
+{
+    constexpr int point_size = 16;
+    constexpr const char* font_name = "benchmark_font";
+    const std::string text = "The quick brown fox jumps over the lazy dog 0123456789 FPS: 144.00 (6.94 ms)";
+
+    auto graphics = app.get_graphics();
+    auto asset_manager = app.get_asset_manager();
+    SDL_Renderer* renderer = app.get_renderer();
+
+    auto benchmark_font = font::load(font_name, "content/roboto/RobotoMono-Bold.ttf", point_size);
+    if (!benchmark_font)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Skipping text benchmarks, the font couldn't be loaded");
+        return;
+    }
+
+    TTF_Font* ttf_font = benchmark_font->get_font(point_size);
+    asset_manager->register_asset(std::move(benchmark_font));
+
+    {
+        simple_bitmap_font bitmap_font(renderer, ttf_font, static_cast<unsigned char>(0), static_cast<unsigned char>(255));
+        bitmap_text_run run(bitmap_font);
+        run.set_text(text);
+
+        std::vector<glyph_quad> quads;
+
+        suite.run("text/bitmap_font/layout", 5000, [&](size_t) {
+            bitmap_font.layout(text, quads);
+        });
+
+        suite.run("text/bitmap_font/draw", 5000, [&](size_t) {
+            bitmap_font.draw(text, SDL_Point{ 10, 10 });
+            SDL_RenderFlush(renderer);
+        });
+
+        suite.run("text/bitmap_font/draw_run", 5000, [&](size_t) {
+            bitmap_font.draw(run, SDL_Point{ 10, 10 });
+            SDL_RenderFlush(renderer);
+        });
+    }
+
+    const auto font_handle = asset_manager->get_handle<font>(font_name);
+
+    suite.run("text/draw_text/cached", 5000, [&](size_t) {
+        graphics->draw_text(font_handle, point_size, text, SDL_Point{ 10, 40 });
+        SDL_RenderFlush(renderer);
+    });
+
+    // A different string every iteration, so every draw renders and uploads a new texture:
+    std::string changing_text;
+    suite.run("text/draw_text/uncached", 1000, [&](size_t i) {
+        changing_text.assign(text);
+        changing_text += std::to_string(i);
+        graphics->draw_text(font_handle, point_size, changing_text, SDL_Point{ 10, 70 });
+        SDL_RenderFlush(renderer);
+    });
+
+    graphics->get_text_cache().clear();
+    asset_manager->unregister_asset(font_name);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <SDL.h>
+#include "benchmark.h"
+#include "../source/application/application.h"
+
+namespace isometric::benchmarks {
+
+    /// <summary>
+    /// transform conversions and hit tests, tile_map get/set and layer queries
+    /// </summary>
+    void run_core_benchmarks(benchmark_suite& suite, SDL_Texture* tiles_texture);
+
+    /// <summary>
+    /// world::update and render along scripted camera paths over maps of several sizes
+    /// </summary>
+    void run_world_benchmarks(benchmark_suite& suite, application& app, SDL_Texture* tiles_texture);
+
+    /// <summary>
+    /// simple_bitmap_font layout and drawing, graphics::draw_text with and without text texture cache hits
+    /// </summary>
+    void run_text_benchmarks(benchmark_suite& suite, application& app);
+
+    /// <summary>
+    /// Loading images and fonts from disk into textures
+    /// </summary>
+    void run_asset_benchmarks(benchmark_suite& suite);
+
+}
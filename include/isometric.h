@@ -2,7 +2,9 @@
 
 #include "../source/application/application.h"
 #include "../source/core/world.h"
+#include "../source/core/terrain_generator.h"
 #include "../source/assets/asset_management.h"
+#include "../source/assets/asset_bundle.h"
 #include "../source/tools/random.h"
 #include "../source/rendering/graphics.h"
 #include "../source/rendering/simple_bitmap_font.h"
\ No newline at end of file
@@ -1,8 +1,17 @@
 #include "application.h"
+#include "../tools/frame_arena.h"
+#include "../tools/memory_tracker.h"
+#include "../rendering/glyph_atlas_cache.h"
+#include "../tools/random.h"
 #include <sstream>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <iostream>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+#include <random>
 
 using namespace isometric;
 using namespace isometric::assets;
@@ -27,6 +36,13 @@ const application_setup& application::get_setup() const
 
 SDL_Rect application::get_viewport() const
 {
+    // The scaled target's viewport is only approximately the output's once it's divided by the scale:
+    if (graphics && graphics->is_render_scaled())
+    {
+        const SDL_Point size = graphics->get_output_size();
+        return SDL_Rect{ 0, 0, size.x, size.y };
+    }
+
     SDL_Rect viewport{ 0 };
     SDL_RenderGetViewport(renderer, &viewport);
     return viewport;
@@ -61,6 +77,7 @@ bool application::start()
         else
         {
             main_loop();
+            stop_simulation_thread();
         }
     }
 
@@ -69,17 +86,35 @@ bool application::start()
 
     if (setup.broadcast_fps)
     {
+        const tools::frame_time_summary frames = current_fps.get_overall_summary();
+
         SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Minimum FPS: %.02f, Maximum FPS: %0.2f, Average FPS: %0.2f",
             current_fps.get_minimum(), current_fps.get_maximum(), current_fps.get_overall_average());
+
+        SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION,
+            "Frame times over %llu frames: p50 %.02f ms, p95 %.02f ms, p99 %.02f ms, max %.02f ms, %llu over the %.02f ms budget",
+            static_cast<unsigned long long>(frames.frames), frames.p50_ms, frames.p95_ms, frames.p99_ms, frames.max_ms,
+            static_cast<unsigned long long>(frames.jank_frames), current_fps.get_frame_budget_ms());
     }
 
+    if (!setup.frame_times_path.empty()) write_frame_times();
+    if (recorder) recorder->save(setup.record_input_path);
+    if (!setup.profile_trace_path.empty()) tools::profiler::write_chrome_trace(setup.profile_trace_path);
+    if (setup.log_memory_report) tools::memory_tracker::log_report();
+
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Unregistering %llu modules", modules.size());
     unregister_all_modules();
 
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Stopping job system");
+    tools::job_system::set_current(nullptr);
+    jobs.reset();
+
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Destroying asset manager");
     asset_manager->shutdown();
 
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Destroying SDL renderer");
+    graphics->get_text_cache().clear();
+    graphics->release_scene_target();
     graphics->renderer = nullptr;
     if (renderer) SDL_DestroyRenderer(renderer);
 
@@ -112,15 +147,57 @@ void application::main_loop()
     frame_stopwatch.start(true);
     fixed_frame_stopwatch.start(true);
 
+    fixed_timestep = 1.0 / setup.fixed_update_fps;
+    fixed_update_accumulator = 0.0;
+    fixed_update_accumulator_ratio = 0.0;
+
+    current_fps.set_frame_budget_ms(setup.frame_budget_ms);
+
+    // Paced frames are over budget once they can't keep the target rate:
+    limiter.set_target_frame_rate(setup.target_frame_rate);
+    quality.set_budget_ms(setup.target_frame_rate > 0.0 ? 1000.0 / setup.target_frame_rate : setup.frame_budget_ms);
+    quality.set_min_render_scale(setup.min_render_scale);
+    quality.set_enabled(setup.dynamic_quality);
+
+    if (!start_input_recording()) return;
+    if (setup.threaded_fixed_update && !replay) start_simulation_thread();
+
+    tools::stopwatch idle_stopwatch;   // How long an idle frame took, the rest of its interval is slept
+    tools::stopwatch run_stopwatch;    // For application_setup::exit_after_seconds
+    run_stopwatch.start();
+
+    frame_count = 0;
+    frame_times.clear();
+    if (!setup.frame_times_path.empty() && setup.exit_after_frames > 0) frame_times.reserve(setup.exit_after_frames);
+
+    ISOMETRIC_PROFILE_THREAD("main");
+
     while (!should_exit)
     {
-        while (SDL_PollEvent(&e))
+        ISOMETRIC_PROFILE_ZONE("frame");
+
+        // Everything allocated from the frame arena two frames ago is given back:
+        tools::frame_arena::next_frame();
+
+        idle_stopwatch.restart();
+        redraw_requested = false;
+
         {
-            if (!on_event(e))
+            ISOMETRIC_PROFILE_ZONE("events");
+
+            while (SDL_PollEvent(&e))
             {
-                shutdown();
-                return;
+                redraw_requested = true;
+                input::process_event(e);
+                if (!on_event(e))
+                {
+                    shutdown();
+                    return;
+                }
             }
+
+            // Everything reading input this frame, on any thread, sees this one snapshot:
+            if (!replay) input::capture();
         }
 
         // Calculate delta time...
@@ -131,18 +208,101 @@ void application::main_loop()
         // Calculate framerate...
         // Fixed framerate is determined by try_call_fixed_udpate() later
         current_fps.set_from_delta(delta_time);
+        const double real_delta_time = delta_time;
+
+        // Frame times and pacing keep the real delta time, everything else sees the recorded one:
+        if (replay)
+        {
+            input_snapshot snapshot;
+            if (!replay->next(snapshot, delta_time))
+            {
+                SDL_Log("Input replay ended after %u of %u frames", replay->get_frame(), replay->get_frame_count());
+                shutdown();
+                return;
+            }
 
+            input::replay(snapshot);
+        }
+        else if (recorder)
+        {
+            recorder->add_frame(input::get_snapshot(), delta_time);
+        }
+
+        // Create textures for assets that finished loading in the background:
+        {
+            ISOMETRIC_PROFILE_ZONE("asset_loads");
+            asset_manager->process_loads(setup.asset_upload_budget_ms);
+        }
+
+        if (quality.is_enabled()) graphics->set_render_scale(quality.get_render_scale());
+        graphics->begin_frame();
         graphics->clear(setup.background_color);
 
-        try_call_fixed_update(delta_time);
-        on_update(delta_time);
+        if (is_fixed_update_threaded()) update_threaded_fixed_ratio();
+        else try_call_fixed_update(delta_time);
+
+        {
+            ISOMETRIC_PROFILE_ZONE("update");
+            on_update(delta_time);
+        }
 
         // If you get the following error in the log or console from SDL it means there wasn't enough drawn to enable
         // SDL's internal batching. This error can be ignored.
         // ERROR: SDL failed to get a vertex buffer for this Direct3D 9 rendering batch!
+        // With a vertical sync presenting waits for it, so the frame's work for dynamic quality ends before:
+        idle_stopwatch.stop();
+        double work_ms = idle_stopwatch.get_elapsed_ms();
+        idle_stopwatch.start();
+
         graphics->present();
 
-        if (setup.broadcast_fps) broadcast_fps(delta_time);
+        if (!setup.vertical_sync)
+        {
+            idle_stopwatch.stop();
+            work_ms = idle_stopwatch.get_elapsed_ms();
+            idle_stopwatch.start();
+        }
+
+        quality.add_frame(work_ms, real_delta_time);
+
+        if (setup.broadcast_fps) broadcast_fps(real_delta_time);
+
+        frame_count++;
+        if (!setup.frame_times_path.empty())
+        {
+            idle_stopwatch.stop();
+            frame_times.push_back(frame_time{ static_cast<float>(real_delta_time * 1000.0), static_cast<float>(idle_stopwatch.get_elapsed_ms()) });
+            idle_stopwatch.start();
+        }
+
+        // Automated runs end themselves, the frame that reaches the limit is the last one:
+        if (setup.exit_after_frames > 0 && frame_count >= setup.exit_after_frames) shutdown();
+        if (setup.exit_after_seconds > 0.0)
+        {
+            run_stopwatch.stop();
+            if (run_stopwatch.get_elapsed_sec() >= setup.exit_after_seconds) shutdown();
+            run_stopwatch.start();
+        }
+
+        // Nothing changed on screen, so there's no reason to spin until the next frame:
+        if (setup.idle_frame_rate > 0.0 && !redraw_requested)
+        {
+            idle_stopwatch.stop();
+            const double remaining_ms = 1000.0 / setup.idle_frame_rate - idle_stopwatch.get_elapsed_ms();
+            if (remaining_ms >= 1.0)
+            {
+                ISOMETRIC_PROFILE_ZONE("idle");
+                SDL_Delay(static_cast<Uint32>(remaining_ms));
+            }
+
+            // The idle sleep replaces pacing, which picks up on a new schedule once frames are drawn again:
+            limiter.reset();
+        }
+        else if (limiter.is_enabled())
+        {
+            ISOMETRIC_PROFILE_ZONE("frame_limiter");
+            limiter.wait();
+        }
     }
 }
 
@@ -155,20 +315,108 @@ void application::broadcast_fps(double delta_time) const
     {
         time_since_last_update = 0.0;
 
+        // The fixed framerate belongs to the simulation thread when it's running:
+        const bool threaded = is_fixed_update_threaded();
+        const double fixed_fps = threaded ? published_fixed_fps.load() : current_fixed_fps.get();
+        const double fixed_fps_average = threaded ? published_fixed_fps_average.load() : current_fixed_fps.get_average();
+
         SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Current FPS: %.02f, Current Fixed FPS: %0.2f",
-            current_fps.get(), current_fixed_fps.get());
+            current_fps.get(), fixed_fps);
 
         SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Average FPS: %.02f, Average Fixed FPS: %0.2f",
-            current_fps.get_average(), current_fixed_fps.get_average());
+            current_fps.get_average(), fixed_fps_average);
     }
 }
 
+bool application::write_frame_times() const
+{
+    std::ofstream file(setup.frame_times_path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write frame times to [%s]", setup.frame_times_path.c_str());
+        return false;
+    }
+
+    file << "frame,frame_ms,work_ms\n";
+    for (size_t i = 0; i < frame_times.size(); i++)
+    {
+        file << i << ',' << frame_times[i].frame_ms << ',' << frame_times[i].work_ms << '\n';
+    }
+
+    if (!frame_times.empty())
+    {
+        // The same summary a regression check would compute, for the log:
+        std::vector<float> sorted;
+        sorted.reserve(frame_times.size());
+        for (const auto& time : frame_times) sorted.push_back(time.frame_ms);
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](double fraction) {
+            return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5))];
+        };
+
+        SDL_Log("Wrote %llu frame times to [%s], p50 %.03f ms, p95 %.03f ms, p99 %.03f ms, max %.03f ms",
+            static_cast<unsigned long long>(frame_times.size()), setup.frame_times_path.c_str(),
+            percentile(0.50), percentile(0.95), percentile(0.99), sorted.back());
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool application::start_input_recording()
+{
+    recorder.reset();
+    replay.reset();
+
+    int width = setup.screen_width, height = setup.screen_height;
+    if (window) SDL_GetWindowSize(window, &width, &height);
+
+    if (!setup.replay_input_path.empty())
+    {
+        replay = input_replay::open(setup.replay_input_path);
+        if (!replay) return false;
+
+        const SDL_Point recorded = replay->get_screen_size();
+        if (recorded.x != width || recorded.y != height)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Input was recorded in a %dx%d window, replaying in %dx%d, mouse positions may not line up",
+                recorded.x, recorded.y, width, height);
+        }
+
+        if (setup.threaded_fixed_update)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Fixed updates run on the main loop while replaying, threaded steps aren't reproducible");
+        }
+
+        tools::random::set_seed(replay->get_random_seed());
+        SDL_Log("Replaying %u frames of input from [%s] with seed %llu", replay->get_frame_count(),
+            setup.replay_input_path.c_str(), static_cast<unsigned long long>(replay->get_random_seed()));
+        return true;
+    }
+
+    if (!setup.record_input_path.empty())
+    {
+        const uint64_t seed = setup.random_seed != 0 ? setup.random_seed :
+            (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+
+        if (setup.threaded_fixed_update)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Recording input with threaded fixed updates, the replay runs them on the main loop");
+        }
+
+        tools::random::set_seed(seed);
+        recorder = std::make_unique<input_recorder>(seed, SDL_Point{ width, height });
+        SDL_Log("Recording input to [%s] with seed %llu", setup.record_input_path.c_str(), static_cast<unsigned long long>(seed));
+        return true;
+    }
+
+    if (setup.random_seed != 0) tools::random::set_seed(setup.random_seed);
+    return true;
+}
+
 void application::try_call_fixed_update(double delta_time)
 {
     constexpr int max_steps = 5; // Maximum number of steps, to avoid degrading to an halt.
-    static double fixed_timestep = 1.0 / setup.fixed_update_fps;
-    static double fixed_update_accumulator = 0.0;
-    static double fixed_update_accumulator_ratio = 0.0;
 
     fixed_update_accumulator += delta_time;
     const int steps = static_cast<int>(std::floor(fixed_update_accumulator / fixed_timestep));
@@ -192,29 +440,263 @@ void application::try_call_fixed_update(double delta_time)
         double fixed_delta_time = fixed_frame_stopwatch.get_elapsed_sec();
         fixed_frame_stopwatch.restart();
 
+        // Steps of a replay only depend on the recorded delta times, not on when they happen to run:
+        if (replay) fixed_delta_time = fixed_timestep;
+
         current_fixed_fps.set_from_delta(fixed_delta_time);
         on_fixed_update(fixed_delta_time);
     }
 }
 
+void application::start_simulation_thread()
+{
+    if (simulation_thread.joinable()) return;
+
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Starting simulation thread at %.02f fixed updates per second", setup.fixed_update_fps);
+
+    last_fixed_update_tick = tools::stopwatch::get_tick();
+    simulation_running = true;
+    simulation_thread = std::thread(&application::simulation_main, this);
+}
+
+void application::stop_simulation_thread()
+{
+    if (!simulation_thread.joinable()) return;
+
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Stopping simulation thread");
+
+    simulation_running = false;
+    simulation_thread.join();
+}
+
+void application::simulation_main()
+{
+    constexpr int max_steps = 5; // Same as try_call_fixed_update, catch up at most this many steps at once
+    const Uint64 step_ticks = std::max<Uint64>(1, static_cast<Uint64>(fixed_timestep * tools::stopwatch::get_frequency()));
+    Uint64 next_tick = last_fixed_update_tick + step_ticks;
+
+    ISOMETRIC_PROFILE_THREAD("simulation");
+    fixed_frame_stopwatch.start(true);
+
+    while (simulation_running)
+    {
+        Uint64 now = tools::stopwatch::get_tick();
+
+        if (now < next_tick)
+        {
+            // Sleep for most of the wait and spin for the rest, SDL_Delay is only accurate to about a millisecond:
+            const double remaining_ms = static_cast<double>(next_tick - now) * 1000.0 / tools::stopwatch::get_frequency();
+            if (remaining_ms > 2.0) SDL_Delay(static_cast<Uint32>(remaining_ms - 1.0));
+            else std::this_thread::yield();
+            continue;
+        }
+
+        for (int step = 0; step < max_steps && now >= next_tick && simulation_running; step++)
+        {
+            fixed_frame_stopwatch.stop();
+            double fixed_delta_time = fixed_frame_stopwatch.get_elapsed_sec();
+            fixed_frame_stopwatch.restart();
+
+            current_fixed_fps.set_from_delta(fixed_delta_time);
+            on_fixed_update(fixed_delta_time);
+
+            last_fixed_update_tick = next_tick;
+            next_tick += step_ticks;
+            now = tools::stopwatch::get_tick();
+        }
+
+        // Too far behind, drop the missed steps rather than spiraling:
+        if (now >= next_tick) next_tick = now + step_ticks;
+
+        published_fixed_fps = current_fixed_fps.get();
+        published_fixed_fps_average = current_fixed_fps.get_average();
+    }
+}
+
+void application::update_threaded_fixed_ratio()
+{
+    const double since_last_step =
+        static_cast<double>(tools::stopwatch::get_tick() - last_fixed_update_tick.load()) / tools::stopwatch::get_frequency();
+
+    fixed_update_accumulator_ratio = std::clamp(since_last_step / fixed_timestep, 0.0, 1.0);
+}
+
 void application::on_fixed_update(double fixed_delta_time)
 {
-    for (auto& m : modules)
+    ISOMETRIC_PROFILE_ZONE("fixed_update");
+
+    // Modules registered or unregistered by a hook are picked up by the next dispatch:
+    const std::shared_ptr<const module_hook_table> table = module_hooks.load();
+
+    for (const auto& hook : table->fixed_update_hooks)
+    {
+        call_module_hook(hook, fixed_delta_time);
+    }
+}
+
+void application::call_module_hook(const module_hook& hook, double delta_time) const
+{
+    if (!hook.target->is_enabled()) return;
+
+    ISOMETRIC_PROFILE_ZONE(hook.zone_name);
+
+    if (!module_timing_enabled)
+    {
+        (hook.target->*hook.hook)(delta_time);
+        return;
+    }
+
+    tools::stopwatch hook_stopwatch;
+    hook_stopwatch.start();
+    (hook.target->*hook.hook)(delta_time);
+    hook_stopwatch.stop();
+
+    hook.target->timing.*hook.elapsed_ms = hook_stopwatch.get_elapsed_ms();
+}
+
+void application::rebuild_module_hooks()
+{
+    std::lock_guard<std::mutex> lock(modules_mutex);
+
+    // Read before the dependencies are, a change made while scheduling is picked up by the next rebuild:
+    auto table = std::make_shared<module_hook_table>();
+    table->dependency_revision = module::dependency_revision;
+    table->modules.assign(modules.begin(), modules.end());
+
+    for (const auto& m : table->modules)
+    {
+        if (!m) continue;
+
+        if (m->has_phase(module_phase::update))
+            table->update_hooks.push_back(module_hook{ m.get(), &module::on_update, &module_timing::update_ms,
+                tools::profiler::intern(m->name + "::on_update") });
+        if (m->has_phase(module_phase::late_update))
+            table->late_update_hooks.push_back(module_hook{ m.get(), &module::on_late_update, &module_timing::late_update_ms,
+                tools::profiler::intern(m->name + "::on_late_update") });
+        if (m->has_phase(module_phase::fixed_update))
+            table->fixed_update_hooks.push_back(module_hook{ m.get(), &module::on_fixed_update, &module_timing::fixed_update_ms,
+                tools::profiler::intern(m->name + "::on_fixed_update") });
+    }
+
+    table->update_waves_valid = schedule_module_updates(*table);
+    if (!table->update_waves_valid)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Module dependencies contain a cycle, updating modules serially in registration order");
+    }
+
+    module_hooks.store(std::move(table));
+}
+
+void application::set_module_timing_enabled(bool enable)
+{
+    module_timing_enabled = enable;
+}
+
+bool application::schedule_module_updates(module_hook_table& table) const
+{
+    // A module's wave is one after the latest wave of the registered modules it depends on, so every module in a
+    // wave only depends on modules from earlier waves:
+    std::unordered_map<const module*, size_t> module_wave;
+    std::unordered_map<const module*, bool> visiting;
+
+    std::function<bool(const std::shared_ptr<module>&, size_t&)> find_wave =
+        [&](const std::shared_ptr<module>& m, size_t& wave) -> bool
+    {
+        auto known = module_wave.find(m.get());
+        if (known != module_wave.end())
+        {
+            wave = known->second;
+            return true;
+        }
+
+        if (visiting[m.get()]) return false; // Cycle
+        visiting[m.get()] = true;
+
+        wave = 0;
+        for (const auto& weak_dependency : m->dependencies)
+        {
+            auto dependency = weak_dependency.lock();
+            if (!dependency || dependency->app == nullptr) continue; // Not registered
+
+            size_t dependency_wave = 0;
+            if (!find_wave(dependency, dependency_wave)) return false;
+            wave = std::max(wave, dependency_wave + 1);
+        }
+
+        visiting[m.get()] = false;
+        module_wave[m.get()] = wave;
+        return true;
+    };
+
+    // Modules without an update hook still count when ordering the modules that depend on them:
+    for (const auto& m : table.modules)
     {
-        if (m && m->is_enabled()) m->on_fixed_update(fixed_delta_time);
+        if (!m) continue;
+
+        size_t wave = 0;
+        if (!find_wave(m, wave)) return false;
+    }
+
+    std::vector<std::vector<module_hook>>& waves = table.update_waves;
+    for (const auto& hook : table.update_hooks)
+    {
+        const size_t wave = module_wave[hook.target];
+
+        if (waves.size() <= wave) waves.resize(wave + 1);
+        waves[wave].push_back(hook);
     }
+
+    // Waves left empty by modules without an update hook are dropped:
+    std::erase_if(waves, [](const std::vector<module_hook>& wave) { return wave.empty(); });
+
+    return true;
 }
 
 void application::on_update(double delta_time)
 {
-    for (auto& m : modules)
+    // The tables are rebuilt when modules are registered, and here when any module's dependencies changed:
+    std::shared_ptr<const module_hook_table> table = module_hooks.load();
+    if (table->dependency_revision != module::dependency_revision)
     {
-        if (m && m->is_enabled()) m->on_update(delta_time);
+        rebuild_module_hooks();
+        table = module_hooks.load();
     }
 
-    for (auto& m : modules)
+    if (!table->update_waves_valid)
     {
-        if (m && m->is_enabled()) m->on_late_update(delta_time);
+        for (const auto& hook : table->update_hooks)
+        {
+            call_module_hook(hook, delta_time);
+        }
+    }
+    else
+    {
+        // Modules that allow it update on the job system, the rest update here on the main thread. Each wave
+        // finishes before the next one starts:
+        for (const auto& wave : table->update_waves)
+        {
+            tools::job_group group;
+
+            for (const auto& hook : wave)
+            {
+                if (hook.target->is_enabled() && hook.target->is_concurrent_update())
+                {
+                    jobs->run(group, [this, hook, delta_time]() { call_module_hook(hook, delta_time); });
+                }
+            }
+
+            for (const auto& hook : wave)
+            {
+                if (!hook.target->is_concurrent_update()) call_module_hook(hook, delta_time);
+            }
+
+            jobs->wait(group);
+        }
+    }
+
+    for (const auto& hook : table->late_update_hooks)
+    {
+        call_module_hook(hook, delta_time);
     }
 }
 
@@ -233,6 +715,10 @@ bool application::on_event(const SDL_Event& e)
             return false; // Shutdown
         }
         break;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+        graphics->release_scene_target(); // Created again by the next scaled frame
+        break;
     }
 
     // Keep the game loop running by returning true
@@ -253,6 +739,9 @@ bool application::initialize()
 {
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Application initializing");
 
+    for (const auto& budget : setup.memory_budgets) tools::memory_tracker::set_budget(budget);
+    glyph_atlas_cache::set_directory(setup.glyph_cache_directory);
+
     SDL_Log("Current platform: %s", SDL_GetPlatform());
     SDL_Log("Application architecture: %d-Bit", is_64bit() ? 64 : 32);
 
@@ -271,6 +760,13 @@ bool application::initialize()
         // --------------------------------------------------------------------
         // SDL & EXTENSIONS INIT
 
+        // Headless runs don't need a display, the dummy driver's windows are only a framebuffer in memory:
+        if (setup.headless)
+        {
+            SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Running headless with the dummy video driver");
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        }
+
         SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "SDL initializing subsystems");
         if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
         {
@@ -307,7 +803,7 @@ bool application::initialize()
             SDL_WINDOWPOS_CENTERED,
             SDL_WINDOWPOS_CENTERED,
             setup.screen_width, setup.screen_height,
-            0
+            setup.headless ? SDL_WINDOW_HIDDEN : 0
         )) == 0)
         {
             error << "Failed to create a window: " << SDL_GetError();
@@ -319,21 +815,39 @@ bool application::initialize()
 
         SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Creating SDL renderer");
         Uint32 renderer_flags = setup.vertical_sync ? SDL_RENDERER_PRESENTVSYNC : 0;
+
+        // Without a display there's no GPU to render with, and nothing to wait for a vertical sync from:
+        if (setup.headless) renderer_flags = SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE;
+
         if ((renderer = SDL_CreateRenderer(window, -1, renderer_flags)) == 0)
         {
             error << "Failed to create the renderer: " << SDL_GetError();
             throw(std::exception(error.str().c_str()));
         }
 
+        // --------------------------------------------------------------------
+        // JOB SYSTEM
+
+        this->jobs = std::make_unique<tools::job_system>(setup.worker_threads);
+        tools::job_system::set_current(this->jobs.get());
+
         this->asset_manager = std::shared_ptr<asset_management>(new asset_management(renderer));
         this->graphics = std::shared_ptr<rendering::graphics>(new rendering::graphics(renderer));
 
+        // Text rasterized with a font that was hot reloaded is rasterized again with the new one:
+        asset_manager->set_hot_reload_enabled(setup.hot_reload_assets);
+        asset_manager->add_reload_listener([text_graphics = this->graphics](const asset_reload& reload)
+        {
+            for (const auto& [previous, current] : reload.fonts) text_graphics->get_text_cache().forget_font(previous);
+        });
+
     }
     catch (std::exception ex)
     {
         // This is a simple way to show a message box, if main_window failed to create this will still work since 
-        // main_window will be NULL (the message box will just not have a parent):
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, setup.name.c_str(), ex.what(), window);
+        // main_window will be NULL (the message box will just not have a parent). Headless runs have nobody to
+        // close it:
+        if (!setup.headless) SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, setup.name.c_str(), ex.what(), window);
 
         // Output the error to the console, if you have one
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, ex.what());
@@ -358,8 +872,14 @@ bool application::is_64bit()
 
 void application::register_module(std::shared_ptr<module> m)
 {
-    modules.push_back(m);
-    m->app = application::this_app;
+    {
+        // The scheduler reads app to tell which dependencies are registered:
+        std::lock_guard<std::mutex> lock(modules_mutex);
+        modules.push_back(m);
+        m->app = application::this_app;
+    }
+
+    rebuild_module_hooks();
 
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Module [%s] registered with application [%s]",
         m->name.c_str(), setup.name.c_str());
@@ -371,8 +891,14 @@ void application::unregister_module(std::shared_ptr<module> m)
 {
     m->on_unregister();
 
-    m->app = nullptr;
-    modules.remove(m);
+    {
+        std::lock_guard<std::mutex> lock(modules_mutex);
+        m->app = nullptr;
+        modules.remove(m);
+    }
+
+    // A dispatch already running finishes with the table it loaded, which keeps the module alive until then:
+    rebuild_module_hooks();
 
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Module [%s] unregistered with application [%s]",
         m->name.c_str(), setup.name.c_str());
@@ -380,7 +906,11 @@ void application::unregister_module(std::shared_ptr<module> m)
 
 void application::unregister_all_modules()
 {
-    auto currente_modules = std::list<std::shared_ptr<module>>(modules.begin(), modules.end());
+    std::list<std::shared_ptr<module>> currente_modules;
+    {
+        std::lock_guard<std::mutex> lock(modules_mutex);
+        currente_modules = modules;
+    }
 
     for (auto m : currente_modules)
     {
@@ -2,12 +2,21 @@
 #include <SDL.h>
 #include <memory>
 #include <list>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include "application_setup.h"
 #include "../source/rendering/graphics.h"
 #include "../source/core/input.h"
+#include "../source/core/input_recording.h"
 #include "../source/core/module.h"
 #include "../tools/stopwatch.h"
+#include "../source/tools/profiler.h"
 #include "../source/tools/framerate.h"
+#include "../source/tools/frame_limiter.h"
+#include "../source/tools/quality_controller.h"
+#include "../source/tools/job_system.h"
 #include "../source/assets/asset_management.h"
 
 namespace isometric {
@@ -20,6 +29,7 @@ namespace isometric {
 
         application_setup setup;
         bool should_exit = false;
+        bool redraw_requested = true;   // This frame, see request_redraw
 
         tools::stopwatch frame_stopwatch;          // Used to calculate delta time
         tools::stopwatch fixed_frame_stopwatch;    // Used to calculate fixed delta time
@@ -27,12 +37,68 @@ namespace isometric {
         tools::framerate current_fps;
         tools::framerate current_fixed_fps;
 
+        tools::frame_limiter limiter;       // See application_setup::target_frame_rate
+        tools::quality_controller quality;  // See application_setup::dynamic_quality
+
+        // Recorded for application_setup::frame_times_path, and counted for exit_after_frames/seconds:
+        struct frame_time
+        {
+            float frame_ms;     // Since the previous frame, including any idle sleep
+            float work_ms;      // Events, updates and presenting, excluding idle sleep
+        };
+
+        unsigned long long frame_count = 0;
+        std::vector<frame_time> frame_times;
+
+        // See application_setup::record_input_path and replay_input_path:
+        std::unique_ptr<input_recorder> recorder;
+        std::unique_ptr<input_replay> replay;
+
+        // Fixed update timing, see try_call_fixed_update:
+        double fixed_timestep = 0.0;
+        double fixed_update_accumulator = 0.0;
+        double fixed_update_accumulator_ratio = 0.0;
+
+        // Threaded fixed updates, see application_setup::threaded_fixed_update:
+        std::thread simulation_thread;
+        std::atomic<bool> simulation_running = false;
+        std::atomic<Uint64> last_fixed_update_tick = 0;
+        std::atomic<double> published_fixed_fps = 0.0;
+        std::atomic<double> published_fixed_fps_average = 0.0;
+
         SDL_Renderer* renderer = nullptr;
         SDL_Window* window = nullptr;
 
         std::shared_ptr<assets::asset_management> asset_manager = nullptr;
         std::shared_ptr<rendering::graphics> graphics = nullptr;
         std::list<std::shared_ptr<module>> modules;
+        std::unique_ptr<tools::job_system> jobs = nullptr;
+
+        // Flat dispatch tables, one per phase, holding only the modules that implement it:
+        struct module_hook
+        {
+            module* target;
+            void (module::*hook)(double);
+            double module_timing::*elapsed_ms;
+            const char* zone_name;  // The module's name and phase for the profiler
+        };
+
+        // Never changed once published. The main and simulation threads each load the table once per dispatch,
+        // so registering a module on either thread only affects the next dispatch:
+        struct module_hook_table
+        {
+            std::vector<std::shared_ptr<module>> modules;   // Keeps the modules alive while a dispatch uses them
+            std::vector<module_hook> update_hooks;
+            std::vector<module_hook> late_update_hooks;
+            std::vector<module_hook> fixed_update_hooks;
+            std::vector<std::vector<module_hook>> update_waves;  // update_hooks in dependency order, see schedule_module_updates
+            bool update_waves_valid = false;                    // False when the waves contain a cycle
+            size_t dependency_revision = 0;
+        };
+
+        std::mutex modules_mutex;   // Held while modules changes and while the table is rebuilt from it
+        std::atomic<std::shared_ptr<const module_hook_table>> module_hooks = std::make_shared<const module_hook_table>();
+        std::atomic<bool> module_timing_enabled = false;
 
     public:
         virtual ~application();
@@ -46,8 +112,19 @@ namespace isometric {
         void register_module(std::shared_ptr<module> m);
         void unregister_module(std::shared_ptr<module> m);
         void unregister_all_modules();
+
+        /// <summary>
+        /// The registered modules. Only read this on the main thread, and not while modules are registered on
+        /// another thread.
+        /// </summary>
         const std::list<std::shared_ptr<module>>& get_modules() const;
 
+        /// <summary>
+        /// Measure how long every module hook takes, see module::get_timing
+        /// </summary>
+        void set_module_timing_enabled(bool enable = true);
+        bool is_module_timing_enabled() const { return module_timing_enabled; }
+
         static std::shared_ptr<application> get_app() { return this_app; }
         const application_setup& get_setup() const;
         SDL_Rect get_viewport() const;
@@ -56,8 +133,45 @@ namespace isometric {
         std::shared_ptr<rendering::graphics> get_graphics() const;
         std::shared_ptr<assets::asset_management> get_asset_manager() const;
         const tools::framerate& get_framerate() const { return current_fps; }
+
+        /// <summary>
+        /// Paces frames to application_setup::target_frame_rate, the rate can be changed while running
+        /// </summary>
+        tools::frame_limiter& get_frame_limiter() { return limiter; }
+
+        /// <summary>
+        /// The quality level picked from frame times with application_setup::dynamic_quality. The application
+        /// applies its render scale, reducing detail is up to the game, for example by hiding optional layers
+        /// with world::set_optional_layers_visible.
+        /// </summary>
+        const tools::quality_controller& get_quality() const { return quality; }
+        tools::quality_controller& get_quality() { return quality; }
+
+        /// <summary>
+        /// Mark the current frame as changing what's on screen. With application_setup::idle_frame_rate, frames
+        /// without a redraw request or an event are idle and the main loop sleeps to hold them to that rate.
+        /// </summary>
+        void request_redraw() { redraw_requested = true; }
+
+        /// <summary>
+        /// How far the current frame is between the last fixed update and the next one, from 0 to 1. Use this to
+        /// interpolate between the previous and current simulation state, for example from a tools::triple_buffer.
+        /// </summary>
+        double get_fixed_update_ratio() const { return fixed_update_accumulator_ratio; }
+
+        /// <returns>True if on_fixed_update runs on its own thread, concurrently with on_update</returns>
+        bool is_fixed_update_threaded() const { return simulation_thread.joinable(); }
         bool is_initialized() const { return initialized; }
 
+        /// <returns>True while input and delta times come from application_setup::replay_input_path</returns>
+        bool is_replaying_input() const { return replay != nullptr; }
+
+        /// <summary>
+        /// The application's work-stealing job system, also used by tools::parallel_for. Jobs must not use the
+        /// SDL_Renderer, rendering stays on the main thread.
+        /// </summary>
+        tools::job_system& get_jobs() const { return *jobs; }
+
         static bool is_64bit();
 
     protected:
@@ -71,6 +185,9 @@ namespace isometric {
 
         /// <summary>
         /// This must be called by derived classes or modules will not have their fixed update functions called.
+        /// With application_setup::threaded_fixed_update this is called on the simulation thread, so anything it
+        /// shares with on_update must be synchronized or handed over through a tools::triple_buffer. Input is read
+        /// there with input::take_simulation_snapshot.
         /// </summary>
         virtual void on_fixed_update(double fixed_delta_time);
 
@@ -82,7 +199,21 @@ namespace isometric {
 
         bool initialize();
         void try_call_fixed_update(double delta_time);
+        void start_simulation_thread();
+        void stop_simulation_thread();
+        void simulation_main();
+        void update_threaded_fixed_ratio();
+        void rebuild_module_hooks();
+        bool schedule_module_updates(module_hook_table& table) const;
+        void call_module_hook(const module_hook& hook, double delta_time) const;
         void broadcast_fps(double delta_time) const;
+        bool write_frame_times() const;
+
+        /// <summary>
+        /// Open the replay or start the recording of the setup and seed tools::random for it
+        /// </summary>
+        /// <returns>False if the replay couldn't be opened</returns>
+        bool start_input_recording();
     };
 
     template<class T>
@@ -1,5 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "../tools/memory_tracker.h"
 
 namespace isometric {
 
@@ -15,11 +18,35 @@ namespace isometric {
         int screen_width = 1280;
         int screen_height = 720;
         bool vertical_sync = false;
+        double frame_budget_ms = 1000.0 / 60.0;    // Frames taking longer count as jank in the framerate statistics
+        double idle_frame_rate = 0.0;   // Limits frames where nothing requested a redraw to this rate, 0 to never limit
+        double target_frame_rate = 0.0; // Paces every frame to this rate by sleeping then spinning, 0 to not limit
+        bool dynamic_quality = false;   // Reduce detail, then the render scale, while frames are over budget
+        float min_render_scale = 0.5f;  // The lowest render scale dynamic quality goes down to
 
         double fixed_update_fps = 50.0;
+        bool threaded_fixed_update = false; // Run on_fixed_update on its own thread instead of the main loop
+
+        double asset_upload_budget_ms = 2.0;   // Render thread time spent finishing async asset loads per frame
+        bool hot_reload_assets = false;     // Reload images and fonts whose files change, see asset_management::set_hot_reload_enabled
+        std::string glyph_cache_directory = "cache/glyphs";    // Bitmap font atlases are saved here for the next run, empty for none
+        unsigned worker_threads = 0;    // Job system worker threads, 0 for one less than the hardware threads (at least one)
+
+        std::vector<tools::memory_budget> memory_budgets;  // A warning is logged when a category goes over its budget
+        bool log_memory_report = false;     // Every memory category and its peak is written to the log at shutdown
 
         bool broadcast_fps = false;
         float broadcast_fps_elapsed = 5.0F;
+
+        // Automated runs, such as performance regressions on machines without a display:
+        bool headless = false;              // SDL's dummy video driver, a hidden window and the software renderer
+        unsigned long long exit_after_frames = 0;   // Shut down after this many frames, 0 to run until asked to
+        double exit_after_seconds = 0.0;    // Shut down after running this long, 0 to run until asked to
+        std::string frame_times_path;       // Every frame's time is written here as CSV at shutdown, empty for none
+        std::string profile_trace_path;     // Profiler zones are written here as a Chrome trace at shutdown, empty for none
+        std::string record_input_path;      // Every frame's input and delta time is written here at shutdown, empty for none
+        std::string replay_input_path;      // Input and delta times are replayed from here instead, ending the run with it
+        uint64_t random_seed = 0;           // Seeds tools::random, 0 for a random seed (recordings store the one used)
     };
 
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ namespace isometric::assets {
     class asset {
     private:
         std::string name;
+        std::string path;   // The file the asset was loaded from, empty for assets made in memory
 
     public:
         asset(const std::string& name) : name(name) {}
@@ -16,6 +17,19 @@ namespace isometric::assets {
             return name;
         }
 
+        /// <summary>
+        /// Assets with a path are watched for changes by asset_management when hot reloading is enabled
+        /// </summary>
+        const std::string& get_path() const
+        {
+            return path;
+        }
+
+        void set_path(const std::string& path)
+        {
+            this->path = path;
+        }
+
         virtual void clear() = 0;
     };
 
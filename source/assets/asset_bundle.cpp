@@ -0,0 +1,504 @@
+#include "asset_bundle.h"
+#include "../rendering/glyph_atlas_cache.h"
+#include <SDL_image.h>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+using namespace isometric::assets;
+using isometric::rendering::glyph_atlas_cache;
+
+static_assert(std::endian::native == std::endian::little, "Asset bundles are read in place and require a little endian host");
+static_assert(sizeof(asset_bundle::header) == 48);
+static_assert(sizeof(asset_bundle::entry_record) == 72);
+static_assert(sizeof(asset_bundle::subimage_record) == 24);
+
+namespace {
+
+    uint64_t align_offset(uint64_t offset)
+    {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    bool read_file(const std::string& path, std::vector<uint8_t>& data)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+
+        const std::streamsize size = file.tellg();
+        if (size <= 0) return false;
+
+        data.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+    }
+
+    // The font file of a font entry starts after its point sizes:
+    uint64_t get_font_file_offset(uint32_t point_size_count)
+    {
+        return align_offset(sizeof(int32_t) * (static_cast<uint64_t>(point_size_count) + 1));
+    }
+
+}
+
+bool asset_bundle::validate()
+{
+    const size_t file_size = file.get_size();
+    if (file_size < sizeof(header)) return false;
+
+    std::memcpy(&file_header, file.get_data(), sizeof(header));
+
+    if (file_header.magic != file_magic || file_header.version != file_version)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Asset bundle '%s' has an unsupported header (version %u)",
+            path.c_str(), file_header.version);
+        return false;
+    }
+
+    auto fits = [&](uint64_t offset, uint64_t count, uint64_t element_size)
+    {
+        return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / element_size;
+    };
+
+    if (!fits(file_header.entry_table, file_header.entry_count, sizeof(entry_record)) ||
+        !fits(file_header.subimage_table, file_header.subimage_count, sizeof(subimage_record)) ||
+        !fits(file_header.string_table, file_header.string_table_size, 1))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Asset bundle '%s' is truncated or its tables are corrupt", path.c_str());
+        return false;
+    }
+
+    const uint8_t* data = file.get_data();
+    entry_table = reinterpret_cast<const entry_record*>(data + file_header.entry_table);
+    subimage_table = reinterpret_cast<const subimage_record*>(data + file_header.subimage_table);
+    string_table = reinterpret_cast<const char*>(data + file_header.string_table);
+
+    for (uint32_t i = 0; i < file_header.entry_count; i++)
+    {
+        const entry_record& entry = entry_table[i];
+        bool valid = entry.data_offset <= file_size && entry.data_size <= file_size - entry.data_offset &&
+            static_cast<uint64_t>(entry.name_offset) + entry.name_length <= file_header.string_table_size &&
+            static_cast<uint64_t>(entry.path_offset) + entry.path_length <= file_header.string_table_size;
+
+        if (entry.kind == entry_image || entry.kind == entry_atlas)
+        {
+            const uint64_t row_bytes = static_cast<uint64_t>(entry.width) * SDL_BYTESPERPIXEL(entry.pixel_format);
+            valid = valid && entry.width > 0 && entry.height > 0 && row_bytes > 0 && entry.pitch >= row_bytes &&
+                entry.data_size >= static_cast<uint64_t>(entry.pitch) * entry.height &&
+                static_cast<uint64_t>(entry.first_subimage) + entry.subimage_count <= file_header.subimage_count;
+        }
+        else if (entry.kind == entry_font)
+        {
+            int32_t point_size_count = -1;
+            if (valid && entry.data_size >= sizeof(int32_t))
+            {
+                std::memcpy(&point_size_count, data + entry.data_offset, sizeof(int32_t));
+            }
+
+            valid = valid && point_size_count >= 0 && get_font_file_offset(point_size_count) < entry.data_size;
+        }
+
+        if (!valid)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Asset bundle '%s' has a corrupt entry table", path.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string_view asset_bundle::get_string(uint32_t offset, uint32_t length) const
+{
+    if (static_cast<uint64_t>(offset) + length > file_header.string_table_size) return std::string_view();
+
+    return std::string_view(string_table + offset, length);
+}
+
+std::shared_ptr<asset_bundle> asset_bundle::open(const std::string& path)
+{
+    std::shared_ptr<asset_bundle> new_bundle = std::shared_ptr<asset_bundle>(new asset_bundle);
+    new_bundle->path = path;
+
+    // Nearly all of a bundle is read once at startup, front to back:
+    if (!new_bundle->file.open(path, true))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to open asset bundle '%s'", path.c_str());
+        return nullptr;
+    }
+
+    if (!new_bundle->validate()) return nullptr;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Opened asset bundle '%s' [ %u entries ], %zu bytes",
+        path.c_str(), new_bundle->file_header.entry_count, new_bundle->file.get_size());
+
+    return new_bundle;
+}
+
+const asset_bundle::entry_record* asset_bundle::find(std::string_view name) const
+{
+    for (uint32_t i = 0; i < file_header.entry_count; i++)
+    {
+        if (get_name(entry_table[i]) == name) return &entry_table[i];
+    }
+
+    return nullptr;
+}
+
+std::string_view asset_bundle::get_name(const entry_record& entry) const
+{
+    return get_string(entry.name_offset, entry.name_length);
+}
+
+std::string_view asset_bundle::get_source_path(const entry_record& entry) const
+{
+    return get_string(entry.path_offset, entry.path_length);
+}
+
+std::unique_ptr<image> asset_bundle::create_image(const entry_record& entry, SDL_Renderer* renderer, bool keep_surface) const
+{
+    if (entry.kind != entry_image && entry.kind != entry_atlas) return nullptr;
+
+    const std::string name(get_name(entry));
+    const uint8_t* pixels = file.get_data() + entry.data_offset;
+    const int width = static_cast<int>(entry.width), height = static_cast<int>(entry.height);
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, entry.pixel_format, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (!texture || SDL_UpdateTexture(texture, nullptr, pixels, static_cast<int>(entry.pitch)) != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture for bundled image [%s]: %s", name.c_str(), SDL_GetError());
+        if (texture) SDL_DestroyTexture(texture);
+        return nullptr;
+    }
+
+    // The blend mode SDL_CreateTextureFromSurface would have given it:
+    SDL_SetTextureBlendMode(texture, SDL_ISPIXELFORMAT_ALPHA(entry.pixel_format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+
+    SDL_Surface* surface = nullptr;
+    if (keep_surface)
+    {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, SDL_BITSPERPIXEL(entry.pixel_format), entry.pixel_format);
+        if (surface)
+        {
+            const size_t row_bytes = static_cast<size_t>(width) * SDL_BYTESPERPIXEL(entry.pixel_format);
+            for (int y = 0; y < height; y++)
+            {
+                std::memcpy(static_cast<uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch,
+                    pixels + static_cast<size_t>(y) * entry.pitch, row_bytes);
+            }
+        }
+    }
+
+    std::unique_ptr<image> created;
+    if (entry.kind == entry_atlas)
+    {
+        auto atlas = std::unique_ptr<image_atlas>(new image_atlas(name, surface, texture));
+        for (uint32_t i = 0; i < entry.subimage_count; i++)
+        {
+            const subimage_record& record = subimage_table[entry.first_subimage + i];
+            atlas->set_subimage(SDL_Rect{ record.x, record.y, record.w, record.h },
+                std::string(get_string(record.name_offset, record.name_length)));
+        }
+
+        created = std::move(atlas);
+    }
+    else
+    {
+        created = std::unique_ptr<image>(new image(name, surface, texture));
+    }
+
+    created->set_path(std::string(get_source_path(entry)));
+    return created;
+}
+
+std::unique_ptr<font> asset_bundle::create_font(const entry_record& entry) const
+{
+    if (entry.kind != entry_font) return nullptr;
+
+    const uint8_t* data = file.get_data() + entry.data_offset;
+    int32_t point_size_count = 0;
+    std::memcpy(&point_size_count, data, sizeof(int32_t));
+
+    std::vector<int> point_sizes(point_size_count);
+    std::memcpy(point_sizes.data(), data + sizeof(int32_t), point_sizes.size() * sizeof(int32_t));
+
+    const uint64_t font_offset = get_font_file_offset(point_size_count);
+    auto created = font::load(std::string(get_name(entry)), data + font_offset,
+        static_cast<size_t>(entry.data_size - font_offset), point_sizes, shared_from_this());
+
+    if (created) created->set_path(std::string(get_source_path(entry)));
+    return created;
+}
+
+size_t asset_bundle::add_glyph_atlases() const
+{
+    size_t added = 0;
+    for (uint32_t i = 0; i < file_header.entry_count; i++)
+    {
+        const entry_record& entry = entry_table[i];
+
+        if (entry.kind == entry_font && entry.path_length > 0)
+        {
+            glyph_atlas_cache::set_file_hash(std::string(get_source_path(entry)), entry.file_hash);
+        }
+        else if (entry.kind == entry_glyph_atlas)
+        {
+            glyph_atlas_cache::add_bundled_atlas(std::string(get_name(entry)), file.get_data() + entry.data_offset,
+                static_cast<size_t>(entry.data_size), shared_from_this());
+            added++;
+        }
+    }
+
+    return added;
+}
+
+void asset_bundle_builder::set_pixel_format(Uint32 format)
+{
+    pixel_format = format;
+}
+
+bool asset_bundle_builder::add_pixels(pending_entry& entry, SDL_Surface* surface)
+{
+    if (!surface) return false;
+
+    SDL_Surface* converted = surface->format->format == pixel_format ? surface : SDL_ConvertSurfaceFormat(surface, pixel_format, 0);
+    if (!converted)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to convert [%s] for an asset bundle: %s", entry.name.c_str(), SDL_GetError());
+        return false;
+    }
+
+    // Rows are stored without the surface's padding:
+    entry.width = static_cast<uint32_t>(converted->w);
+    entry.height = static_cast<uint32_t>(converted->h);
+    entry.pitch = static_cast<uint32_t>(converted->w) * SDL_BYTESPERPIXEL(pixel_format);
+    entry.pixel_format = pixel_format;
+    entry.data.resize(static_cast<size_t>(entry.pitch) * entry.height);
+
+    SDL_LockSurface(converted);
+    for (int y = 0; y < converted->h; y++)
+    {
+        std::memcpy(entry.data.data() + static_cast<size_t>(y) * entry.pitch,
+            static_cast<const uint8_t*>(converted->pixels) + static_cast<size_t>(y) * converted->pitch, entry.pitch);
+    }
+    SDL_UnlockSurface(converted);
+
+    if (converted != surface) SDL_FreeSurface(converted);
+    return true;
+}
+
+bool asset_bundle_builder::add_image(const std::string& name, const std::string& path)
+{
+    SDL_Surface* surface = IMG_Load(path.c_str());
+    if (!surface)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load image [%s] from '%s' for an asset bundle: %s", name.c_str(), path.c_str(), IMG_GetError());
+        return false;
+    }
+
+    const bool added = add_image(name, surface, path);
+    SDL_FreeSurface(surface);
+    return added;
+}
+
+bool asset_bundle_builder::add_image(const std::string& name, SDL_Surface* surface, const std::string& source_path)
+{
+    pending_entry entry;
+    entry.kind = asset_bundle::entry_image;
+    entry.name = name;
+    entry.source_path = source_path;
+    if (!add_pixels(entry, surface)) return false;
+
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+bool asset_bundle_builder::add_atlas(const image_atlas& atlas)
+{
+    pending_entry entry;
+    entry.kind = asset_bundle::entry_atlas;
+    entry.name = atlas.get_name();
+    entry.source_path = atlas.get_path();
+    if (!add_pixels(entry, atlas.get_surface())) return false;
+
+    // Unnamed subimages keep their index as long as every name is written in index order:
+    std::vector<std::string> names(atlas.subimages.size());
+    for (const auto& [subimage_name, index] : atlas.subimage_names)
+    {
+        if (index < names.size()) names[index] = subimage_name;
+    }
+
+    for (size_t index = 0; index < atlas.subimages.size(); index++)
+    {
+        entry.subimages.emplace_back(names[index], atlas.subimages[index]);
+    }
+
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+bool asset_bundle_builder::add_font(const std::string& name, const std::string& path, const std::vector<int>& point_sizes)
+{
+    std::vector<uint8_t> font_file;
+    if (!read_file(path, font_file))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read font [%s] from '%s' for an asset bundle", name.c_str(), path.c_str());
+        return false;
+    }
+
+    pending_entry entry;
+    entry.kind = asset_bundle::entry_font;
+    entry.name = name;
+    entry.source_path = path;
+    entry.file_hash = glyph_atlas_cache::hash_bytes(font_file.data(), font_file.size());
+
+    const int32_t point_size_count = static_cast<int32_t>(point_sizes.size());
+    const size_t font_offset = static_cast<size_t>(get_font_file_offset(point_size_count));
+    entry.data.resize(font_offset + font_file.size());
+    std::memcpy(entry.data.data(), &point_size_count, sizeof(int32_t));
+
+    for (size_t i = 0; i < point_sizes.size(); i++)
+    {
+        const int32_t point_size = point_sizes[i];
+        std::memcpy(entry.data.data() + sizeof(int32_t) * (i + 1), &point_size, sizeof(int32_t));
+    }
+
+    std::memcpy(entry.data.data() + font_offset, font_file.data(), font_file.size());
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+size_t asset_bundle_builder::add_glyph_atlases(const std::string& directory)
+{
+    std::error_code error;
+    size_t added = 0;
+
+    for (const auto& directory_entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!directory_entry.is_regular_file() || directory_entry.path().extension() != ".glyphs") continue;
+
+        pending_entry entry;
+        entry.kind = asset_bundle::entry_glyph_atlas;
+        entry.name = directory_entry.path().filename().string();
+        if (!read_file(directory_entry.path().string(), entry.data)) continue;
+
+        entries.push_back(std::move(entry));
+        added++;
+    }
+
+    return added;
+}
+
+bool asset_bundle_builder::write(const std::string& path) const
+{
+    asset_bundle::header file_header{};
+    file_header.magic = asset_bundle::file_magic;
+    file_header.version = asset_bundle::file_version;
+
+    std::string strings;
+    auto add_string = [&](const std::string& value, uint32_t& offset, uint32_t& length)
+    {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings += value;
+    };
+
+    std::vector<asset_bundle::entry_record> records;
+    std::vector<asset_bundle::subimage_record> subimages;
+    for (const pending_entry& entry : entries)
+    {
+        asset_bundle::entry_record record{};
+        record.kind = entry.kind;
+        add_string(entry.name, record.name_offset, record.name_length);
+        add_string(entry.source_path, record.path_offset, record.path_length);
+        record.width = entry.width;
+        record.height = entry.height;
+        record.pitch = entry.pitch;
+        record.pixel_format = entry.pixel_format;
+        record.first_subimage = static_cast<uint32_t>(subimages.size());
+        record.subimage_count = static_cast<uint32_t>(entry.subimages.size());
+        record.data_size = entry.data.size();
+        record.file_hash = entry.file_hash;
+
+        for (const auto& [subimage_name, rect] : entry.subimages)
+        {
+            asset_bundle::subimage_record subimage{};
+            add_string(subimage_name, subimage.name_offset, subimage.name_length);
+            subimage.x = rect.x;
+            subimage.y = rect.y;
+            subimage.w = rect.w;
+            subimage.h = rect.h;
+            subimages.push_back(subimage);
+        }
+
+        records.push_back(record);
+    }
+
+    file_header.entry_count = static_cast<uint32_t>(records.size());
+    file_header.subimage_count = static_cast<uint32_t>(subimages.size());
+    file_header.string_table_size = strings.size();
+
+    // The tables come first, then the data in the order entries were added, which is the order they're mounted in:
+    uint64_t offset = align_offset(sizeof(asset_bundle::header));
+    file_header.entry_table = offset;
+    offset = align_offset(offset + records.size() * sizeof(asset_bundle::entry_record));
+    file_header.subimage_table = offset;
+    offset = align_offset(offset + subimages.size() * sizeof(asset_bundle::subimage_record));
+    file_header.string_table = offset;
+    offset = align_offset(offset + strings.size());
+
+    for (auto& record : records)
+    {
+        record.data_offset = offset;
+        offset = align_offset(offset + record.data_size);
+    }
+
+    const std::string temporary_path = path + ".tmp";
+    uint64_t written = 0;
+
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create asset bundle '%s'", temporary_path.c_str());
+            return false;
+        }
+
+        auto write = [&](uint64_t at, const void* data, size_t size)
+        {
+            static const char padding[8]{};
+            stream.write(padding, static_cast<std::streamsize>(at - written));
+            stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written = at + size;
+        };
+
+        write(0, &file_header, sizeof(asset_bundle::header));
+        write(file_header.entry_table, records.data(), records.size() * sizeof(asset_bundle::entry_record));
+        write(file_header.subimage_table, subimages.data(), subimages.size() * sizeof(asset_bundle::subimage_record));
+        write(file_header.string_table, strings.data(), strings.size());
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            write(records[i].data_offset, entries[i].data.data(), entries[i].data.size());
+        }
+
+        if (!stream)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write asset bundle '%s'", temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace asset bundle '%s': %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Wrote asset bundle '%s' [ %zu entries ], %llu bytes",
+        path.c_str(), entries.size(), static_cast<unsigned long long>(written));
+    return true;
+}
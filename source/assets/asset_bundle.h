@@ -0,0 +1,207 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "image.h"
+#include "image_atlas.h"
+#include "font.h"
+#include "../tools/memory_mapped_file.h"
+
+namespace isometric::assets {
+
+    /// <summary>
+    /// Images, atlases, fonts and glyph atlases packed by asset_bundle_builder into a single file, read through a
+    /// memory mapping. Mounting a bundle with asset_management::mount_bundle replaces decoding every PNG with one
+    /// sequential read of pixels that are already in the texture format.
+    /// </summary>
+    /// <remarks>
+    /// The layout, all little endian and 8 byte aligned:
+    ///   header         - magic "IBDL", version, entry and subimage counts and the offset of every table below
+    ///   entry table    - one record per entry: kind, name, source path, the range of its data and, for images,
+    ///                    the size, pitch and pixel format of the pixels
+    ///   subimage table - named rectangles of the atlas entries, each atlas's back to back
+    ///   string table   - names and paths referenced by the tables, not null terminated
+    ///   entry data     - images and atlases: rows of pixels in the entry's pixel format, pitch bytes apart
+    ///                    fonts: int32 point size count and the point sizes, then the font file at the next 8 bytes
+    ///                    glyph atlases: a glyph_atlas_cache file as it was saved
+    /// Pixels aren't compressed. SDL_Renderer has no compressed texture formats, so compressing them on disk would
+    /// only add a decode, while uncompressed pixels go from the mapping to the texture with one SDL_UpdateTexture.
+    /// </remarks>
+    class asset_bundle : public std::enable_shared_from_this<asset_bundle>
+    {
+    public:
+        static constexpr uint32_t file_magic = 0x4C444249; // "IBDL"
+        static constexpr uint16_t file_version = 1;
+
+        static constexpr uint16_t entry_image = 1;
+        static constexpr uint16_t entry_atlas = 2;
+        static constexpr uint16_t entry_font = 3;
+        static constexpr uint16_t entry_glyph_atlas = 4;
+
+        struct header
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t flags;
+            uint32_t entry_count;
+            uint32_t subimage_count;
+            uint64_t entry_table;
+            uint64_t subimage_table;
+            uint64_t string_table;
+            uint64_t string_table_size;
+        };
+
+        struct entry_record
+        {
+            uint16_t kind;
+            uint16_t reserved;
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t path_offset;       // The file the entry was built from, so it can still be hot reloaded
+            uint32_t path_length;
+            uint32_t width;             // Images and atlases
+            uint32_t height;
+            uint32_t pitch;
+            uint32_t pixel_format;      // An SDL_PixelFormatEnum
+            uint32_t first_subimage;    // Atlases
+            uint32_t subimage_count;
+            uint32_t reserved2;
+            uint64_t data_offset;
+            uint64_t data_size;
+            uint64_t file_hash;         // Fonts, see glyph_atlas_cache::set_file_hash
+        };
+
+        struct subimage_record
+        {
+            uint32_t name_offset;
+            uint32_t name_length;
+            int32_t x;
+            int32_t y;
+            int32_t w;
+            int32_t h;
+        };
+
+    private:
+        tools::memory_mapped_file file;
+        std::string path;
+        header file_header{};
+
+        const entry_record* entry_table = nullptr;
+        const subimage_record* subimage_table = nullptr;
+        const char* string_table = nullptr;
+
+        asset_bundle() {}
+
+        bool validate();
+        std::string_view get_string(uint32_t offset, uint32_t length) const;
+
+    public:
+        /// <summary>
+        /// Map a bundle and check its header and tables, the OS starts reading the rest of it straight away
+        /// </summary>
+        /// <returns>The bundle, or nullptr if it doesn't exist or isn't a valid bundle</returns>
+        static std::shared_ptr<asset_bundle> open(const std::string& path);
+
+        size_t get_entry_count() const { return file_header.entry_count; }
+        const entry_record& get_entry(size_t index) const { return entry_table[index]; }
+
+        /// <returns>The entry with this name, or nullptr if there isn't one</returns>
+        const entry_record* find(std::string_view name) const;
+
+        std::string_view get_name(const entry_record& entry) const;
+        std::string_view get_source_path(const entry_record& entry) const;
+
+        /// <summary>
+        /// Create the texture of an image or atlas entry and fill it straight out of the mapping
+        /// </summary>
+        /// <param name="keep_surface">Also copy the pixels into a surface, for atlas_builder or patching atlas pages</param>
+        /// <returns>The image, an image_atlas for atlas entries, or nullptr if the entry isn't either or failed</returns>
+        std::unique_ptr<image> create_image(const entry_record& entry, SDL_Renderer* renderer, bool keep_surface = false) const;
+
+        /// <summary>
+        /// Open every point size of a font entry in place, the font keeps this bundle mapped while it's open
+        /// </summary>
+        std::unique_ptr<font> create_font(const entry_record& entry) const;
+
+        /// <summary>
+        /// Make the glyph atlases in this bundle available to glyph_atlas_cache, along with the hashes of its fonts
+        /// </summary>
+        /// <returns>How many glyph atlases were added</returns>
+        size_t add_glyph_atlases() const;
+
+        const std::string& get_path() const { return path; }
+        size_t get_size() const { return file.get_size(); }
+    };
+
+    /// <summary>
+    /// Builds an asset_bundle offline: images are decoded once and stored in the texture format, fonts and glyph
+    /// atlases are stored as they are on disk.
+    /// </summary>
+    class asset_bundle_builder
+    {
+    private:
+        struct pending_entry
+        {
+            uint16_t kind = 0;
+            std::string name;
+            std::string source_path;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t pitch = 0;
+            uint32_t pixel_format = 0;
+            uint64_t file_hash = 0;
+            std::vector<uint8_t> data;
+            std::vector<std::pair<std::string, SDL_Rect>> subimages;
+        };
+
+        std::vector<pending_entry> entries;
+        Uint32 pixel_format = SDL_PIXELFORMAT_ARGB8888;
+
+        bool add_pixels(pending_entry& entry, SDL_Surface* surface);
+
+    public:
+        /// <summary>
+        /// The format images are stored in, ARGB8888 by default, the first texture format of SDL's Direct3D, OpenGL
+        /// and software renderers. A renderer without it converts the pixels while uploading them.
+        /// </summary>
+        void set_pixel_format(Uint32 format);
+
+        /// <summary>
+        /// Decode an image file and add its pixels
+        /// </summary>
+        bool add_image(const std::string& name, const std::string& path);
+
+        /// <summary>
+        /// Add the pixels of a surface, the surface isn't kept or freed
+        /// </summary>
+        bool add_image(const std::string& name, SDL_Surface* surface, const std::string& source_path = "");
+
+        /// <summary>
+        /// Add an atlas's page with every subimage, the atlas needs its surface
+        /// </summary>
+        bool add_atlas(const image_atlas& atlas);
+
+        /// <summary>
+        /// Add a font file, opened at these point sizes when the bundle is mounted
+        /// </summary>
+        bool add_font(const std::string& name, const std::string& path, const std::vector<int>& point_sizes);
+
+        /// <summary>
+        /// Add every atlas glyph_atlas_cache saved to a directory
+        /// </summary>
+        /// <returns>How many were added</returns>
+        size_t add_glyph_atlases(const std::string& directory);
+
+        size_t get_entry_count() const { return entries.size(); }
+
+        /// <summary>
+        /// Write the bundle to path. The file is written next to path first and then moved over it, so an existing
+        /// bundle is never left half written.
+        /// </summary>
+        bool write(const std::string& path) const;
+    };
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include "asset.h"
+#include "../enumerations/asset_load_status.h"
+
+namespace isometric::assets {
+
+    /// <summary>
+    /// The slot asset_management keeps for every asset name, shared by every asset_handle to that name and by the
+    /// asynchronous loads that fill it in
+    /// </summary>
+    struct asset_load_state
+    {
+        std::string name;
+        std::atomic<asset_load_status> status = asset_load_status::loading;
+        asset* loaded = nullptr;                // Owned by asset_management, only set on the render thread
+        std::atomic<uint32_t> generation = 0;   // Incremented every time loaded changes
+
+        explicit asset_load_state(const std::string& name) : name(name) {}
+    };
+
+    /// <summary>
+    /// A typed reference to the asset registered under a name, from asset_management::get_handle or one of the
+    /// asynchronous loads. The name is looked up once, when the handle is created; after that get() is O(1) and
+    /// only re-checks the asset's type after it has been reloaded or unregistered. It never blocks, so a handle can
+    /// be queried each frame with a placeholder used until it's ready.
+    /// </summary>
+    /// <remarks>
+    /// A handle follows its name: registering another asset under the same name replaces what get() returns and
+    /// unregistering it makes get() return nullptr. Use get_generation() to notice either happening.
+    /// </remarks>
+    template<class T>
+    class asset_handle
+    {
+    private:
+        static constexpr uint32_t unresolved = std::numeric_limits<uint32_t>::max();
+
+        std::shared_ptr<asset_load_state> state = nullptr;
+        mutable T* resolved = nullptr;
+        mutable uint32_t resolved_generation = unresolved;
+
+    public:
+        asset_handle() {}
+        explicit asset_handle(std::shared_ptr<asset_load_state> state) : state(state) {}
+
+        /// <returns>False for a default constructed handle</returns>
+        bool is_valid() const { return state != nullptr; }
+        explicit operator bool() const { return is_valid(); }
+
+        /// <returns>The status of the latest load, or unloaded once the asset has been unregistered</returns>
+        asset_load_status get_status() const
+        {
+            return state ? state->status.load(std::memory_order_acquire) : asset_load_status::failed;
+        }
+
+        bool is_ready() const { return get_status() == asset_load_status::ready; }
+        bool is_failed() const { return get_status() == asset_load_status::failed; }
+        bool is_loading() const
+        {
+            const asset_load_status status = get_status();
+            return status == asset_load_status::loading || status == asset_load_status::uploading;
+        }
+
+        const std::string& get_name() const
+        {
+            static const std::string empty_string;
+            return state ? state->name : empty_string;
+        }
+
+        /// <returns>Changes whenever the asset behind the name is registered, replaced, hot reloaded or unregistered</returns>
+        uint32_t get_generation() const
+        {
+            return state ? state->generation.load(std::memory_order_acquire) : 0;
+        }
+
+        /// <returns>The asset, or nullptr if nothing of type T is registered under the name</returns>
+        T* get() const
+        {
+            if (!state) return nullptr;
+
+            const uint32_t generation = state->generation.load(std::memory_order_acquire);
+            if (generation != resolved_generation)
+            {
+                resolved = dynamic_cast<T*>(state->loaded);
+                resolved_generation = generation;
+            }
+
+            return resolved;
+        }
+
+        /// <returns>The asset once it's ready, otherwise the placeholder</returns>
+        T* get_or(T* placeholder) const
+        {
+            T* loaded = get();
+            return loaded ? loaded : placeholder;
+        }
+
+        T* operator->() const { return get(); }
+    };
+
+}
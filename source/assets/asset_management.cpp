@@ -1,10 +1,45 @@
 #include "asset_management.h"
+#include "image_atlas.h"
+#include "asset_bundle.h"
 #include "../application/application.h"
 #include <stdexcept>
 #include <format>
+#include "../tools/stopwatch.h"
+#include "../tools/profiler.h"
 
 using namespace isometric::assets;
 
+namespace {
+
+    // SDL_ttf shares one FreeType library between fonts, which isn't safe to use from several threads at once:
+    std::mutex ttf_mutex;
+
+    /// <returns>The image's pixels in the format most renderers use for textures, or nullptr if it failed</returns>
+    SDL_Surface* decode_image(const std::string& name, const std::string& path)
+    {
+        SDL_Surface* loaded_surface = IMG_Load(path.c_str());
+        if (loaded_surface == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load surface for image [%s] from '%s': %s",
+                name.c_str(), path.c_str(), IMG_GetError());
+            return nullptr;
+        }
+
+        // Converted here so creating the texture is a plain copy:
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded_surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(loaded_surface);
+
+        if (converted == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to convert surface for image [%s]: %s",
+                name.c_str(), SDL_GetError());
+        }
+
+        return converted;
+    }
+
+}
+
 asset_management::asset_management(SDL_Renderer* renderer)
     : renderer(renderer)
 {
@@ -30,11 +65,37 @@ const std::unique_ptr<asset>& asset_management::operator[](const std::string& na
     }
 }
 
+asset* asset_management::find(const std::string& name) const
+{
+    auto iter = asset_store.find(name);
+    return iter != asset_store.end() ? iter->second.get() : nullptr;
+}
+
+std::shared_ptr<asset_load_state> asset_management::get_slot(const std::string& name)
+{
+    auto& slot = asset_slots[name];
+    if (!slot)
+    {
+        slot = std::make_shared<asset_load_state>(name);
+        slot->loaded = find(name);
+        slot->status.store(slot->loaded ? asset_load_status::ready : asset_load_status::unloaded, std::memory_order_release);
+    }
+
+    return slot;
+}
+
 void asset_management::register_asset(std::unique_ptr<asset> new_asset)
 {
     if (new_asset != nullptr)
     {
-        asset_store[new_asset->get_name()] = std::move(new_asset);
+        const std::string name = new_asset->get_name();
+        auto slot = get_slot(name);
+
+        slot->loaded = new_asset.get();
+        asset_store[name] = std::move(new_asset);
+
+        slot->generation.fetch_add(1, std::memory_order_acq_rel);
+        slot->status.store(asset_load_status::ready, std::memory_order_release);
     }
 }
 
@@ -42,6 +103,11 @@ bool isometric::assets::asset_management::unregister_asset(const std::string& na
 {
     if (asset_store.contains(name))
     {
+        auto slot = get_slot(name);
+        slot->loaded = nullptr;
+        slot->generation.fetch_add(1, std::memory_order_acq_rel);
+        slot->status.store(asset_load_status::unloaded, std::memory_order_release);
+
         auto& asset = (*this)[name];
         asset->clear();
         asset_store.erase(name);
@@ -51,8 +117,411 @@ bool isometric::assets::asset_management::unregister_asset(const std::string& na
     return false;
 }
 
+size_t asset_management::mount_bundle(const std::string& path, bool keep_surfaces)
+{
+    ISOMETRIC_PROFILE_ZONE("asset_management::mount_bundle");
+    tools::stopwatch mount_stopwatch;
+    mount_stopwatch.start();
+
+    auto bundle = asset_bundle::open(path);
+    if (!bundle) return 0;
+
+    // Before fonts are used, so bitmap fonts find their glyph atlases:
+    const size_t glyph_atlases = bundle->add_glyph_atlases();
+    size_t mounted = 0;
+
+    for (size_t i = 0; i < bundle->get_entry_count(); i++)
+    {
+        const asset_bundle::entry_record& entry = bundle->get_entry(i);
+        std::unique_ptr<asset> created;
+
+        if (entry.kind == asset_bundle::entry_image || entry.kind == asset_bundle::entry_atlas)
+        {
+            created = bundle->create_image(entry, renderer, keep_surfaces);
+        }
+        else if (entry.kind == asset_bundle::entry_font)
+        {
+            created = bundle->create_font(entry);
+        }
+        else continue;
+
+        if (!created)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to mount [%.*s] from asset bundle '%s'",
+                static_cast<int>(bundle->get_name(entry).size()), bundle->get_name(entry).data(), path.c_str());
+            continue;
+        }
+
+        register_asset(std::move(created));
+        mounted++;
+    }
+
+    mount_stopwatch.stop();
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Mounted %zu assets and %zu glyph atlases from '%s' in %.2fms",
+        mounted, glyph_atlases, path.c_str(), mount_stopwatch.get_elapsed_ms());
+
+    return mounted;
+}
+
+asset_handle<image> asset_management::load_image_async(const std::string& name, const std::string& path)
+{
+    auto state = get_slot(name);
+    state->status.store(asset_load_status::loading, std::memory_order_release);
+    auto queue = pending;
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight++;
+    }
+
+    application::get_app()->get_jobs().run_background(load_jobs, [state, queue, path]()
+    {
+        ISOMETRIC_PROFILE_ZONE("assets::load_image");
+
+        pending_load load;
+        load.state = state;
+        load.path = path;
+        load.surface = decode_image(state->name, path);
+
+        state->status.store(load.surface ? asset_load_status::uploading : asset_load_status::failed, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight--;
+        if (load.surface) queue->loads.push_back(std::move(load));
+    });
+
+    return asset_handle<image>(state);
+}
+
+asset_handle<font> asset_management::load_font_async(const std::string& name, const std::string& path, const std::vector<int>& point_sizes)
+{
+    auto state = get_slot(name);
+    state->status.store(asset_load_status::loading, std::memory_order_release);
+    auto queue = pending;
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight++;
+    }
+
+    application::get_app()->get_jobs().run_background(load_jobs, [state, queue, path, point_sizes]()
+    {
+        ISOMETRIC_PROFILE_ZONE("assets::load_font");
+
+        pending_load load;
+        load.state = state;
+
+        {
+            std::lock_guard<std::mutex> ttf_lock(ttf_mutex);
+            load.finished = font::load(state->name, path, point_sizes);
+        }
+
+        state->status.store(load.finished ? asset_load_status::uploading : asset_load_status::failed, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight--;
+        if (load.finished) queue->loads.push_back(std::move(load));
+    });
+
+    return asset_handle<font>(state);
+}
+
+size_t asset_management::process_loads(double budget_ms)
+{
+    if (hot_reload) poll_watched_files();
+
+    tools::stopwatch budget_stopwatch;
+    budget_stopwatch.start();
+
+    size_t completed = 0;
+
+    while (true)
+    {
+        pending_load load;
+
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            if (pending->loads.empty()) break;
+
+            load = std::move(pending->loads.front());
+            pending->loads.pop_front();
+        }
+
+        complete_load(load);
+        completed++;
+
+        budget_stopwatch.stop();
+        if (budget_stopwatch.get_elapsed_ms() >= budget_ms) break;
+        budget_stopwatch.start();
+    }
+
+    return completed;
+}
+
+void asset_management::complete_load(pending_load& load)
+{
+    if (load.is_reload)
+    {
+        complete_reload(load);
+        return;
+    }
+
+    std::unique_ptr<asset> finished = std::move(load.finished);
+
+    if (load.surface)
+    {
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, load.surface);
+        if (texture == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture for image [%s]: %s",
+                load.state->name.c_str(), SDL_GetError());
+
+            SDL_FreeSurface(load.surface);
+            load.state->status.store(asset_load_status::failed, std::memory_order_release);
+            return;
+        }
+
+        finished = std::unique_ptr<image>(new image(load.state->name, load.surface, texture));
+        finished->set_path(load.path);
+        load.surface = nullptr;
+    }
+
+    // The load's state is the slot for its name, so this makes it ready:
+    register_asset(std::move(finished));
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Asset [%s] loaded asynchronously", load.state->name.c_str());
+}
+
+void asset_management::poll_watched_files()
+{
+    poll_stopwatch.stop();
+    if (poll_stopwatch.get_elapsed_ms() < poll_interval_ms)
+    {
+        poll_stopwatch.start();
+        return;
+    }
+
+    poll_stopwatch.restart();
+    ISOMETRIC_PROFILE_ZONE("asset_management::poll_watched_files");
+
+    std::erase_if(watched_files, [this](const auto& pair) { return !pair.second.reloading && !asset_store.contains(pair.first); });
+
+    for (const auto& [name, stored] : asset_store)
+    {
+        const std::string& path = stored->get_path();
+        if (path.empty() || (!dynamic_cast<const image*>(stored.get()) && !dynamic_cast<const font*>(stored.get()))) continue;
+
+        // Fails while some editors replace the file, it's tried again on the next poll:
+        std::error_code error;
+        const auto write_time = std::filesystem::last_write_time(path, error);
+        if (error) continue;
+
+        auto [iter, added] = watched_files.try_emplace(name);
+        watched_file& watched = iter->second;
+
+        if (added || watched.path != path)
+        {
+            // What's loaded is the version first seen:
+            watched.path = path;
+            watched.write_time = write_time;
+            watched.changed_time = write_time;
+            continue;
+        }
+
+        if (watched.reloading || write_time == watched.write_time) continue;
+
+        // Editors often save in several writes, so a change is only reloaded once a poll finds it unchanged:
+        if (write_time != watched.changed_time)
+        {
+            watched.changed_time = write_time;
+            continue;
+        }
+
+        watched.write_time = write_time;
+        start_reload(name, *stored, watched);
+    }
+}
+
+void asset_management::start_reload(const std::string& name, const asset& current, watched_file& watched)
+{
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Reloading asset [%s] from '%s'", name.c_str(), watched.path.c_str());
+
+    watched.reloading = true;
+    auto state = get_slot(name);
+    auto queue = pending;
+
+    const font* current_font = dynamic_cast<const font*>(&current);
+    const bool is_font = current_font != nullptr;
+    const std::vector<int> point_sizes = is_font ? current_font->get_point_sizes() : std::vector<int>();
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight++;
+    }
+
+    // The asset stays ready with its current version while the new one is decoded:
+    application::get_app()->get_jobs().run_background(load_jobs, [state, queue, path = watched.path, is_font, point_sizes]()
+    {
+        ISOMETRIC_PROFILE_ZONE("assets::reload");
+
+        pending_load load;
+        load.state = state;
+        load.path = path;
+        load.is_reload = true;
+
+        if (is_font)
+        {
+            std::lock_guard<std::mutex> ttf_lock(ttf_mutex);
+            load.finished = font::load(state->name, path, point_sizes);
+        }
+        else
+        {
+            load.surface = decode_image(state->name, path);
+        }
+
+        // Queued even when it failed, so the file is watched again:
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->in_flight--;
+        queue->loads.push_back(std::move(load));
+    });
+}
+
+void asset_management::complete_reload(pending_load& load)
+{
+    const std::string& name = load.state->name;
+
+    auto watched = watched_files.find(name);
+    if (watched != watched_files.end()) watched->second.reloading = false;
+
+    asset* current = find(name);
+    image* current_image = dynamic_cast<image*>(current);
+    font* current_font = dynamic_cast<font*>(current);
+    font* loaded_font = dynamic_cast<font*>(load.finished.get());
+
+    asset_reload reload;
+    reload.name = name;
+    reload.reloaded = current;
+
+    std::vector<asset_reload> patched_atlases;
+    SDL_Texture* replaced_texture = nullptr;
+
+    if (current_image && load.surface)
+    {
+        reload.previous_texture = current_image->get_texture();
+
+        const bool replaced = current_image->replace_pixels(renderer, load.surface, replaced_texture);
+        load.surface = nullptr;
+        if (!replaced) return;
+
+        reload.texture = current_image->get_texture();
+
+        // Atlas pages built from the image follow it, their textures are patched in place:
+        for (const auto& [atlas_name, stored] : asset_store)
+        {
+            image_atlas* atlas = dynamic_cast<image_atlas*>(stored.get());
+            if (!atlas || atlas == current || atlas->patch_source(name, current_image->get_surface()) == 0) continue;
+
+            asset_reload& patched = patched_atlases.emplace_back();
+            patched.name = atlas_name;
+            patched.reloaded = atlas;
+            patched.previous_texture = atlas->get_texture();
+            patched.texture = atlas->get_texture();
+        }
+    }
+    else if (current_font && loaded_font)
+    {
+        const std::vector<int> point_sizes = current_font->get_point_sizes();
+        std::vector<TTF_Font*> previous_fonts;
+        for (int point_size : point_sizes) previous_fonts.push_back(current_font->get_font(point_size));
+
+        // The loaded font now holds the old TTF_Fonts and closes them when it's destroyed below:
+        current_font->replace_fonts(*loaded_font);
+
+        for (size_t i = 0; i < point_sizes.size(); i++)
+        {
+            reload.fonts.emplace_back(previous_fonts[i], current_font->get_font(point_sizes[i]));
+        }
+    }
+    else
+    {
+        if (load.surface) SDL_FreeSurface(load.surface);
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Reloading asset [%s] failed, the loaded version is kept", name.c_str());
+        return;
+    }
+
+    load.state->generation.fetch_add(1, std::memory_order_acq_rel);
+
+    // A copy, so listeners may add or remove listeners:
+    const auto listeners = reload_listeners;
+    for (const auto& [id, listener] : listeners)
+    {
+        listener(reload);
+        for (const asset_reload& patched : patched_atlases) listener(patched);
+    }
+
+    if (replaced_texture) SDL_DestroyTexture(replaced_texture);
+    load.finished.reset();
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Asset [%s] reloaded%s", name.c_str(),
+        reload.is_texture_replaced() ? " with a new texture" : "");
+}
+
+void asset_management::set_hot_reload_enabled(bool enable, double poll_interval_ms)
+{
+    hot_reload = enable;
+    this->poll_interval_ms = poll_interval_ms;
+    poll_stopwatch.restart();
+    if (!enable) watched_files.clear();
+}
+
+bool asset_management::is_hot_reload_enabled() const
+{
+    return hot_reload;
+}
+
+size_t asset_management::add_reload_listener(reload_listener listener)
+{
+    const size_t id = next_listener_id++;
+    reload_listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void asset_management::remove_reload_listener(size_t id)
+{
+    std::erase_if(reload_listeners, [id](const auto& pair) { return pair.first == id; });
+}
+
+size_t asset_management::get_pending_load_count() const
+{
+    std::lock_guard<std::mutex> lock(pending->mutex);
+    return pending->loads.size() + pending->in_flight;
+}
+
 void asset_management::shutdown()
 {
+    // Discard loads that were never finished:
+    {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        for (auto& load : pending->loads)
+        {
+            if (load.surface) SDL_FreeSurface(load.surface);
+            load.state->status.store(asset_load_status::failed, std::memory_order_release);
+        }
+        pending->loads.clear();
+    }
+
+    // Handles can outlive asset management, leave them pointing at nothing:
+    for (auto& [name, slot] : asset_slots)
+    {
+        slot->loaded = nullptr;
+        slot->generation.fetch_add(1, std::memory_order_acq_rel);
+        if (slot->status.load(std::memory_order_acquire) == asset_load_status::ready)
+        {
+            slot->status.store(asset_load_status::unloaded, std::memory_order_release);
+        }
+    }
+    asset_slots.clear();
+
     asset_store.clear(); // The assets should all auto delete
     SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Asset management shutdown");
 }
@@ -5,7 +5,15 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <filesystem>
+#include <functional>
 #include "asset.h"
+#include "asset_handle.h"
+#include "../tools/job_system.h"
+#include "../tools/stopwatch.h"
 #include "image.h"
 #include "font.h"
 
@@ -15,20 +23,153 @@ namespace isometric {
 
 namespace isometric::assets {
 
+    /// <summary>
+    /// What a hot reload changed, given to every reload listener on the render thread
+    /// </summary>
+    struct asset_reload
+    {
+        std::string name;
+        asset* reloaded = nullptr;              // The same object as before the reload, patched in place
+        SDL_Texture* previous_texture = nullptr;    // Images: the texture before, destroyed once the listeners return
+        SDL_Texture* texture = nullptr;             // Images: the texture now, previous_texture if updated in place
+        std::vector<std::pair<TTF_Font*, TTF_Font*>> fonts; // Fonts: each point size before and after, the old ones are closed once the listeners return
+
+        bool is_texture_replaced() const { return previous_texture != texture; }
+    };
+
+    using reload_listener = std::function<void(const asset_reload&)>;
+
     class asset_management
     {
         friend class application;
     private:
         SDL_Renderer* renderer = nullptr;
         std::unordered_map<std::string, std::unique_ptr<asset>> asset_store;
+        std::unordered_map<std::string, std::shared_ptr<asset_load_state>> asset_slots; // Shared with handles
+
+        // A finished background load waiting for the render thread:
+        struct pending_load
+        {
+            std::shared_ptr<asset_load_state> state;
+            std::string path;
+            SDL_Surface* surface = nullptr;     // Images, decoded and converted, still needs a texture
+            std::unique_ptr<asset> finished;    // Assets that don't need the renderer, like fonts
+            bool is_reload = false;             // A hot reload of an asset that's already registered
+        };
+
+        // A file an asset was loaded from, polled for changes while hot reloading is enabled:
+        struct watched_file
+        {
+            std::string path;
+            std::filesystem::file_time_type write_time;     // Of the version that's loaded
+            std::filesystem::file_time_type changed_time;   // A change is only reloaded once the file stops changing
+            bool reloading = false;
+        };
+
+        // Shared with the load jobs so they can finish safely even if they outlive this object:
+        struct pending_queue
+        {
+            std::mutex mutex;
+            std::deque<pending_load> loads;
+            size_t in_flight = 0;   // Jobs that haven't reached loads yet
+        };
+
+        std::shared_ptr<pending_queue> pending = std::make_shared<pending_queue>();
+        tools::job_group load_jobs; // Never waited on, the application stops the job system before this is destroyed
+
+        bool hot_reload = false;
+        double poll_interval_ms = 500.0;
+        tools::stopwatch poll_stopwatch;
+        std::unordered_map<std::string, watched_file> watched_files;
+        std::vector<std::pair<size_t, reload_listener>> reload_listeners;
+        size_t next_listener_id = 1;
 
         asset_management(SDL_Renderer* renderer);
 
+        void complete_load(pending_load& load);
+
+        void poll_watched_files();
+        void start_reload(const std::string& name, const asset& current, watched_file& watched);
+        void complete_reload(pending_load& load);
+
+        /// <returns>The slot for a name, created unloaded if it doesn't exist yet</returns>
+        std::shared_ptr<asset_load_state> get_slot(const std::string& name);
+
     public:
 
         const std::unique_ptr<asset>& operator[](const std::string& name);
 
+        /// <returns>The asset registered under name, or nullptr without logging if there isn't one</returns>
+        asset* find(const std::string& name) const;
+
+        /// <summary>
+        /// Get a handle to the asset registered under name, resolved once here rather than on every use. The name
+        /// doesn't need to be registered yet, the handle picks the asset up once it is.
+        /// </summary>
+        template<class T>
+        asset_handle<T> get_handle(const std::string& name)
+        {
+            return asset_handle<T>(get_slot(name));
+        }
+
+        /// <summary>
+        /// Register an asset under its name, replacing any asset already registered under it. Handles to the name
+        /// follow the new asset.
+        /// </summary>
         void register_asset(std::unique_ptr<asset> new_asset);
+
+        /// <summary>
+        /// Register every image, atlas and font in an asset_bundle under its name, replacing assets already registered
+        /// under it, and make its glyph atlases available to bitmap fonts. Textures are filled straight from the
+        /// bundle's mapping on this thread, which must be the render thread. Bundled assets keep the path of the file
+        /// they were built from, so they're still hot reloaded while that file exists.
+        /// </summary>
+        /// <param name="keep_surfaces">Keep a surface of every image too, for atlas_builder and patching atlas pages</param>
+        /// <returns>How many assets were registered</returns>
+        size_t mount_bundle(const std::string& path, bool keep_surfaces = false);
+
+        /// <summary>
+        /// Start loading an image in the background. The file is read, decoded and converted to the texture format
+        /// on a job system worker, then its texture is created by process_loads() on the render thread and it's
+        /// registered under name.
+        /// </summary>
+        asset_handle<image> load_image_async(const std::string& name, const std::string& path);
+
+        /// <summary>
+        /// Start loading a font in the background, it's registered under name by process_loads() once every
+        /// point size has been opened.
+        /// </summary>
+        asset_handle<font> load_font_async(const std::string& name, const std::string& path, const std::vector<int>& point_sizes);
+
+        /// <summary>
+        /// Finish background loads on the render thread, creating textures until the time budget is used up. At
+        /// least one load is finished per call so loading always makes progress. Called by application every frame.
+        /// </summary>
+        /// <param name="budget_ms">CPU time to spend, in milliseconds</param>
+        /// <returns>How many loads were finished</returns>
+        size_t process_loads(double budget_ms);
+
+        /// <returns>Background loads that haven't been finished by process_loads() yet</returns>
+        size_t get_pending_load_count() const;
+
+        /// <summary>
+        /// Watch the files images and fonts were loaded from and reload the ones that change, while the
+        /// application runs. A changed file is decoded in the background like an asynchronous load, then
+        /// process_loads() patches the registered asset in place: an image of the same size only has its texture
+        /// updated, so tile_images, sprites and batches drawing it need nothing, and atlas pages built from it are
+        /// patched rectangle by rectangle. Reload listeners are told what changed, for everything that has to
+        /// follow a replaced texture or font.
+        /// </summary>
+        /// <param name="poll_interval_ms">How often the files' modification times are checked</param>
+        void set_hot_reload_enabled(bool enable, double poll_interval_ms = 500.0);
+        bool is_hot_reload_enabled() const;
+
+        /// <summary>
+        /// Call listener on the render thread after every hot reload
+        /// </summary>
+        /// <returns>An id for remove_reload_listener</returns>
+        size_t add_reload_listener(reload_listener listener);
+        void remove_reload_listener(size_t id);
         bool unregister_asset(const std::string& name);
 
         void shutdown();
@@ -0,0 +1,319 @@
+#include "atlas_builder.h"
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+using namespace isometric::assets;
+
+atlas_builder::atlas_builder(int page_width, int page_height)
+    : page_width(std::max(page_width, 1)), page_height(std::max(page_height, 1))
+{
+
+}
+
+void atlas_builder::set_padding(int pixels)
+{
+    padding = std::max(pixels, 0);
+}
+
+int atlas_builder::get_padding() const
+{
+    return padding;
+}
+
+void atlas_builder::set_extrude(bool extrude)
+{
+    this->extrude = extrude;
+}
+
+bool atlas_builder::is_extruding() const
+{
+    return extrude;
+}
+
+bool atlas_builder::add(const std::string& name, SDL_Surface* surface, const SDL_Rect& srcrect)
+{
+    if (!surface) return false;
+
+    const SDL_Rect bounds{ 0, 0, surface->w, surface->h };
+    SDL_Rect clipped{};
+    if (!SDL_IntersectRect(&bounds, &srcrect, &clipped)) return false;
+
+    auto iter = entry_names.find(name);
+    if (iter != entry_names.end())
+    {
+        entries[iter->second] = entry{ name, surface, clipped };
+    }
+    else
+    {
+        entry_names[name] = entries.size();
+        entries.push_back(entry{ name, surface, clipped });
+    }
+
+    return true;
+}
+
+bool atlas_builder::add(const std::string& name, SDL_Surface* surface)
+{
+    return surface && add(name, surface, SDL_Rect{ 0, 0, surface->w, surface->h });
+}
+
+bool atlas_builder::add(const std::string& name, const image& source, const SDL_Rect& srcrect)
+{
+    if (!add(name, source.get_surface(), srcrect)) return false;
+
+    // Remembered by the page, so it can be patched when the image is reloaded:
+    entries[entry_names.at(name)].source_name = source.get_name();
+    return true;
+}
+
+bool atlas_builder::add(const image& source)
+{
+    return source.get_surface() && add(source.get_name(), source, SDL_Rect{ 0, 0, source.get_surface()->w, source.get_surface()->h });
+}
+
+std::vector<std::unique_ptr<image_atlas>> atlas_builder::build(SDL_Renderer* renderer, const std::string& name)
+{
+    std::vector<std::unique_ptr<image_atlas>> atlases;
+    if (!renderer || !pack()) return atlases;
+
+    for (size_t page_index = 0; page_index < pages.size(); page_index++)
+    {
+        const page_layout& page = pages[page_index];
+        const std::string page_name = name + "." + std::to_string(page_index);
+
+        SDL_Surface* page_surface = SDL_CreateRGBSurfaceWithFormat(0, page.used_width, page.used_height, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!page_surface)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create surface for atlas page [%s]: %s", page_name.c_str(), SDL_GetError());
+            atlases.clear();
+            return atlases;
+        }
+
+        for (const auto& packed : entries)
+        {
+            if (packed.packed.page == page_index) blit(packed.surface, packed.srcrect, page_surface, packed.packed.rect, padding, extrude);
+        }
+
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, page_surface);
+        if (!texture)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture for atlas page [%s]: %s", page_name.c_str(), SDL_GetError());
+            SDL_FreeSurface(page_surface);
+            atlases.clear();
+            return atlases;
+        }
+
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+        auto atlas = std::unique_ptr<image_atlas>(new image_atlas(page_name, page_surface, texture));
+        for (const auto& packed : entries)
+        {
+            if (packed.packed.page != page_index) continue;
+
+            atlas->set_subimage(packed.packed.rect, packed.name);
+            if (!packed.source_name.empty())
+            {
+                atlas->add_source(atlas_source{ packed.source_name, packed.srcrect, packed.packed.rect, padding, extrude });
+            }
+        }
+
+        atlases.push_back(std::move(atlas));
+    }
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Atlas [%s] packed %llu images into %llu pages",
+        name.c_str(), static_cast<unsigned long long>(entries.size()), static_cast<unsigned long long>(pages.size()));
+
+    return atlases;
+}
+
+bool atlas_builder::pack()
+{
+    pages.clear();
+    for (auto& queued : entries) queued.packed = region{};
+
+    // Tallest first keeps the skyline flat, which wastes the least space:
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), size_t{ 0 });
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        const SDL_Rect& rect_a = entries[a].srcrect;
+        const SDL_Rect& rect_b = entries[b].srcrect;
+        return rect_a.h != rect_b.h ? rect_a.h > rect_b.h : rect_a.w > rect_b.w;
+    });
+
+    for (size_t entry_index : order)
+    {
+        entry& queued = entries[entry_index];
+        const int width = queued.srcrect.w + padding * 2;
+        const int height = queued.srcrect.h + padding * 2;
+
+        if (width > page_width || height > page_height)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Image [%s] (%d x %d) doesn't fit in an atlas page (%d x %d)",
+                queued.name.c_str(), queued.srcrect.w, queued.srcrect.h, page_width, page_height);
+            continue;
+        }
+
+        int x = 0, y = 0;
+        size_t node_index = 0;
+        size_t page_index = 0;
+
+        while (page_index < pages.size() && !find_position(pages[page_index], width, height, x, y, node_index))
+        {
+            page_index++;
+        }
+
+        if (page_index == pages.size())
+        {
+            page_layout& page = pages.emplace_back();
+            page.skyline.push_back(skyline_node{ 0, 0, page_width });
+            find_position(page, width, height, x, y, node_index);
+        }
+
+        place(pages[page_index], node_index, x, y, width, height);
+        queued.packed = region{ page_index, SDL_Rect{ x + padding, y + padding, queued.srcrect.w, queued.srcrect.h } };
+    }
+
+    return !pages.empty();
+}
+
+bool atlas_builder::find_position(const page_layout& page, int width, int height, int& x, int& y, size_t& node_index) const
+{
+    int best_y = std::numeric_limits<int>::max();
+
+    for (size_t i = 0; i < page.skyline.size(); i++)
+    {
+        const int node_x = page.skyline[i].x;
+        if (node_x + width > page_width) break; // Nodes are ordered by x, the rest are further right
+
+        // The rect rests on the highest node it spans:
+        int top = 0;
+        int width_left = width;
+        size_t j = i;
+        while (width_left > 0 && j < page.skyline.size())
+        {
+            top = std::max(top, page.skyline[j].y);
+            width_left -= page.skyline[j].width;
+            j++;
+        }
+
+        if (width_left > 0 || top + height > page_height) continue;
+
+        if (top < best_y)
+        {
+            best_y = top;
+            x = node_x;
+            y = top;
+            node_index = i;
+        }
+    }
+
+    return best_y != std::numeric_limits<int>::max();
+}
+
+void atlas_builder::place(page_layout& page, size_t node_index, int x, int y, int width, int height)
+{
+    auto& skyline = page.skyline;
+    skyline.insert(skyline.begin() + node_index, skyline_node{ x, y + height, width });
+
+    // Trim or remove the nodes the new one covers:
+    for (size_t i = node_index + 1; i < skyline.size();)
+    {
+        const int covered_to = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= covered_to) break;
+
+        const int shrink = covered_to - skyline[i].x;
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+
+        if (skyline[i].width > 0) break;
+        skyline.erase(skyline.begin() + i);
+    }
+
+    // Merge neighbours at the same height:
+    for (size_t i = 1; i < skyline.size();)
+    {
+        if (skyline[i - 1].y == skyline[i].y)
+        {
+            skyline[i - 1].width += skyline[i].width;
+            skyline.erase(skyline.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    page.used_width = std::max(page.used_width, x + width);
+    page.used_height = std::max(page.used_height, y + height);
+}
+
+void atlas_builder::blit(SDL_Surface* source, const SDL_Rect& srcrect, SDL_Surface* page, const SDL_Rect& dstrect, int padding, bool extrude)
+{
+    SDL_BlendMode previous_blend_mode = SDL_BLENDMODE_NONE;
+    SDL_GetSurfaceBlendMode(source, &previous_blend_mode);
+
+    // Copy the pixels as they are, blending would darken anti-aliased edges against the transparent page:
+    SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+
+    const SDL_Rect& src = srcrect;
+    const SDL_Rect& dst = dstrect;
+
+    // SDL_BlitSurface clips its destination rect, so every blit gets its own copy:
+    auto copy = [&](int src_x, int src_y, int w, int h, int dst_x, int dst_y)
+    {
+        SDL_Rect from{ src_x, src_y, w, h };
+        SDL_Rect to{ dst_x, dst_y, w, h };
+        SDL_BlitSurface(source, &from, page, &to);
+    };
+
+    copy(src.x, src.y, src.w, src.h, dst.x, dst.y);
+
+    if (extrude)
+    {
+        const int right = src.x + src.w - 1;
+        const int bottom = src.y + src.h - 1;
+
+        for (int i = 1; i <= padding; i++)
+        {
+            copy(src.x, src.y, 1, src.h, dst.x - i, dst.y);           // Left edge
+            copy(right, src.y, 1, src.h, dst.x + dst.w - 1 + i, dst.y); // Right edge
+            copy(src.x, src.y, src.w, 1, dst.x, dst.y - i);           // Top edge
+            copy(src.x, bottom, src.w, 1, dst.x, dst.y + dst.h - 1 + i); // Bottom edge
+
+            for (int j = 1; j <= padding; j++)
+            {
+                copy(src.x, src.y, 1, 1, dst.x - i, dst.y - j);
+                copy(right, src.y, 1, 1, dst.x + dst.w - 1 + i, dst.y - j);
+                copy(src.x, bottom, 1, 1, dst.x - i, dst.y + dst.h - 1 + j);
+                copy(right, bottom, 1, 1, dst.x + dst.w - 1 + i, dst.y + dst.h - 1 + j);
+            }
+        }
+    }
+
+    SDL_SetSurfaceBlendMode(source, previous_blend_mode);
+}
+
+const atlas_builder::region* atlas_builder::find(const std::string& name) const
+{
+    auto iter = entry_names.find(name);
+    return iter != entry_names.end() ? &entries[iter->second].packed : nullptr;
+}
+
+size_t atlas_builder::get_image_count() const
+{
+    return entries.size();
+}
+
+size_t atlas_builder::get_page_count() const
+{
+    return pages.size();
+}
+
+void atlas_builder::clear()
+{
+    entries.clear();
+    entry_names.clear();
+    pages.clear();
+}
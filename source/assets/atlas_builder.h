@@ -0,0 +1,129 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include "image.h"
+#include "image_atlas.h"
+
+namespace isometric::assets {
+
+    /// <summary>
+    /// Packs many images, or parts of images, into a few large atlas pages with a skyline packer so they share
+    /// textures and stop breaking sprite batches. Every packed image becomes a named subimage of its page.
+    /// </summary>
+    /// <remarks>
+    /// Each image is surrounded by padding, filled with copies of its edge pixels when extrusion is enabled, so
+    /// filtering or fractional positions never sample a neighbouring image. Source surfaces aren't owned and must
+    /// stay alive until build() returns.
+    /// </remarks>
+    class atlas_builder
+    {
+    public:
+        static constexpr size_t no_page = std::numeric_limits<size_t>::max();
+
+        /// <summary>
+        /// Where an added image was packed, rect excludes the padding
+        /// </summary>
+        struct region
+        {
+            size_t page = no_page;
+            SDL_Rect rect{ 0 };
+
+            bool is_packed() const { return page != no_page; }
+        };
+
+    private:
+        struct entry
+        {
+            std::string name;
+            SDL_Surface* surface;
+            SDL_Rect srcrect;
+            region packed;
+            std::string source_name;    // The image the surface belongs to, when added as one
+        };
+
+        struct skyline_node
+        {
+            int x;
+            int y;
+            int width;
+        };
+
+        struct page_layout
+        {
+            std::vector<skyline_node> skyline;
+            int used_width = 0;
+            int used_height = 0;
+        };
+
+        int page_width;
+        int page_height;
+        int padding = 1;
+        bool extrude = true;
+
+        std::vector<entry> entries;
+        std::unordered_map<std::string, size_t> entry_names;
+        std::vector<page_layout> pages;
+
+    public:
+        atlas_builder(int page_width = 2048, int page_height = 2048);
+
+        /// <summary>
+        /// Pixels left around every image, 0 packs them edge to edge
+        /// </summary>
+        void set_padding(int pixels);
+        int get_padding() const;
+
+        /// <summary>
+        /// Fill the padding with each image's edge pixels rather than leaving it transparent
+        /// </summary>
+        void set_extrude(bool extrude);
+        bool is_extruding() const;
+
+        /// <summary>
+        /// Queue part of a surface to be packed. Adding a name again replaces the earlier image.
+        /// </summary>
+        /// <returns>False if surface is null or srcrect is empty</returns>
+        bool add(const std::string& name, SDL_Surface* surface, const SDL_Rect& srcrect);
+        bool add(const std::string& name, SDL_Surface* surface);
+
+        /// <summary>
+        /// Queue a loaded image, or part of it, to be packed. The image must still have its surface.
+        /// </summary>
+        bool add(const std::string& name, const image& source, const SDL_Rect& srcrect);
+        bool add(const image& source);
+
+        /// <summary>
+        /// Pack every queued image and create a texture for each page. Pages are named name.0, name.1 and so on,
+        /// and are only as large as the images packed into them.
+        /// </summary>
+        /// <returns>The pages, ready to register with asset_management, or none if nothing could be packed</returns>
+        std::vector<std::unique_ptr<image_atlas>> build(SDL_Renderer* renderer, const std::string& name);
+
+        /// <returns>Where an image was packed by the last build, or nullptr if it wasn't added</returns>
+        const region* find(const std::string& name) const;
+
+        size_t get_image_count() const;
+        size_t get_page_count() const;
+
+        /// <summary>
+        /// Forget every queued image and the last build's layout
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Copy srcrect of source to dstrect of page, and with extrude fill the padding around it with its edge
+        /// pixels. Used by build and by image_atlas::patch_source.
+        /// </summary>
+        static void blit(SDL_Surface* source, const SDL_Rect& srcrect, SDL_Surface* page, const SDL_Rect& dstrect, int padding, bool extrude);
+
+    private:
+        bool pack();
+        bool find_position(const page_layout& page, int width, int height, int& x, int& y, size_t& node_index) const;
+        void place(page_layout& page, size_t node_index, int x, int y, int width, int height);
+    };
+
+}
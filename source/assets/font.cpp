@@ -2,7 +2,10 @@
 #include <SDL_ttf.h>
 #include "font.h"
 #include "../source/application/application.h"
+#include "../tools/memory_tracker.h"
 #include <algorithm>
+#include <filesystem>
+#include <climits>
 
 using namespace isometric::assets;
 
@@ -28,6 +31,11 @@ std::unique_ptr<font> font::load(const std::string& name, const std::string& pat
 
     auto new_font = std::unique_ptr<font>(new font(name));
 
+    std::error_code size_error;
+    const auto file_size = std::filesystem::file_size(path, size_error);
+    new_font->file_bytes = size_error ? 0 : static_cast<size_t>(file_size);
+    new_font->set_path(path);
+
     for (int point_size : point_sizes)
     {
         TTF_Font* sdl_font = TTF_OpenFont(path.c_str(), point_size);
@@ -40,6 +48,7 @@ std::unique_ptr<font> font::load(const std::string& name, const std::string& pat
 
         new_font->point_sizes.push_back(point_size);
         new_font->fonts[point_size] = sdl_font;
+        tools::memory_tracker::fonts().add(new_font->file_bytes);
     }
 
     return std::move(new_font);
@@ -59,6 +68,34 @@ int isometric::assets::font::get_closest_point_size(int point_size) const
     }
 }
 
+std::unique_ptr<font> font::load(const std::string& name, const uint8_t* data, size_t size,
+    const std::vector<int>& point_sizes, std::shared_ptr<const void> owner)
+{
+    if (!data || size == 0 || size > static_cast<size_t>(INT_MAX)) return nullptr;
+
+    auto new_font = std::unique_ptr<font>(new font(name));
+    new_font->file_bytes = size;
+    new_font->memory_owner = std::move(owner);
+
+    for (int point_size : point_sizes)
+    {
+        // Every point size reads through its own stream over the same bytes, closed with the font:
+        SDL_RWops* stream = SDL_RWFromConstMem(data, static_cast<int>(size));
+        TTF_Font* sdl_font = stream ? TTF_OpenFontRW(stream, 1, point_size) : nullptr;
+        if (sdl_font == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font named [%s] with point size [%d] from memory", name.c_str(), point_size);
+            return nullptr;
+        }
+
+        new_font->point_sizes.push_back(point_size);
+        new_font->fonts[point_size] = sdl_font;
+        tools::memory_tracker::fonts().add(new_font->file_bytes);
+    }
+
+    return new_font;
+}
+
 std::unique_ptr<font> font::load(const std::string& name, const std::string& path, int point_size)
 {
     auto sizes = std::vector<int>{ point_size };
@@ -83,6 +120,14 @@ TTF_Font* font::get_font(int point_size) const
     }
 }
 
+void font::replace_fonts(font& reloaded)
+{
+    std::swap(fonts, reloaded.fonts);
+    std::swap(point_sizes, reloaded.point_sizes);
+    std::swap(file_bytes, reloaded.file_bytes);
+    std::swap(memory_owner, reloaded.memory_owner);
+}
+
 void font::clear()
 {
     for (auto& pair : fonts)
@@ -92,6 +137,7 @@ void font::clear()
 
         if (sdl_font)
         {
+            tools::memory_tracker::fonts().remove(file_bytes);
             TTF_CloseFont(sdl_font);
             sdl_font = nullptr;
         }
@@ -99,4 +145,5 @@ void font::clear()
 
     point_sizes.clear();
     fonts.clear();
+    memory_owner.reset();
 }
@@ -13,16 +13,31 @@ namespace isometric::assets {
     private:
         std::unordered_map<int, TTF_Font*> fonts;
         std::vector<int> point_sizes;
+        size_t file_bytes = 0; // Counted per point size, FreeType keeps the face tables and a glyph cache for each
+        std::shared_ptr<const void> memory_owner;  // Of the file's bytes when opened from memory
         font(const std::string& name);
 
     public:
         static std::unique_ptr<font> load(const std::string& name, const std::string& path, int point_size);
         static std::unique_ptr<font> load(const std::string& name, const std::string& path, const std::vector<int>& point_sizes);
 
+        /// <summary>
+        /// Open a font file held in memory, such as one packed into an asset_bundle
+        /// </summary>
+        /// <param name="owner">Kept alive with the font, SDL_ttf reads glyphs out of data for as long as it's open</param>
+        static std::unique_ptr<font> load(const std::string& name, const uint8_t* data, size_t size,
+            const std::vector<int>& point_sizes, std::shared_ptr<const void> owner);
+
         const std::vector<int>& get_point_sizes() const;
         int get_closest_point_size(int point_size) const;
         TTF_Font* get_font(int point_size = 0) const;
 
+        /// <summary>
+        /// Take the point sizes of a reload of this font, giving it the fonts this one had. This object stays the
+        /// same, so handles and pointers to it keep working, and the old fonts are closed with reloaded.
+        /// </summary>
+        void replace_fonts(font& reloaded);
+
         void clear() override;
 
         virtual ~font();
@@ -3,6 +3,7 @@
 #include <format>
 #include "image.h"
 #include "../source/application/application.h"
+#include "../tools/memory_tracker.h"
 
 using namespace isometric::assets;
 
@@ -38,6 +39,17 @@ image::image(const std::string& name, const std::string& path)
 
     this->texture = texture;
     this->surface = surface;
+    set_path(path);
+
+    tools::memory_tracker::images().add_surface(surface);
+    tools::memory_tracker::images().add_texture(texture);
+}
+
+image::image(const std::string& name, SDL_Surface* surface, SDL_Texture* texture)
+    : asset(name), surface(surface), texture(texture)
+{
+    tools::memory_tracker::images().add_surface(surface);
+    tools::memory_tracker::images().add_texture(texture);
 }
 
 image::~image()
@@ -49,12 +61,14 @@ void isometric::assets::image::clear()
 {
     if (surface)
     {
+        tools::memory_tracker::images().remove_surface(surface);
         SDL_FreeSurface(surface);
         surface = nullptr;
     }
 
     if (texture)
     {
+        tools::memory_tracker::images().remove_texture(texture);
         SDL_DestroyTexture(texture);
         texture = nullptr;
     }
@@ -121,3 +135,60 @@ SDL_FRect image::get_frect() const
         static_cast<float>(rect.h)
     );
 }
+
+bool image::replace_pixels(SDL_Renderer* renderer, SDL_Surface* replacement, SDL_Texture*& previous_texture)
+{
+    previous_texture = nullptr;
+    if (!replacement) return false;
+
+    Uint32 format = 0;
+    int access = 0, width = 0, height = 0;
+    const bool queried = texture && SDL_QueryTexture(texture, &format, &access, &width, &height) == 0;
+    bool updated = false;
+
+    if (queried && access != SDL_TEXTUREACCESS_TARGET && width == replacement->w && height == replacement->h)
+    {
+        // SDL_UpdateTexture takes pixels in the texture's own format:
+        SDL_Surface* converted = replacement->format->format == format
+            ? replacement
+            : SDL_ConvertSurfaceFormat(replacement, format, 0);
+
+        updated = converted && SDL_UpdateTexture(texture, nullptr, converted->pixels, converted->pitch) == 0;
+        if (converted && converted != replacement) SDL_FreeSurface(converted);
+    }
+
+    if (!updated)
+    {
+        SDL_Texture* created = SDL_CreateTextureFromSurface(renderer, replacement);
+        if (!created)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture for reloaded image [%s]: %s", get_name().c_str(), SDL_GetError());
+            SDL_FreeSurface(replacement);
+            return false;
+        }
+
+        if (texture)
+        {
+            SDL_BlendMode blend_mode = SDL_BLENDMODE_BLEND;
+            SDL_GetTextureBlendMode(texture, &blend_mode);
+            SDL_SetTextureBlendMode(created, blend_mode);
+
+            // Counted as freed now, the caller destroys it:
+            tools::memory_tracker::images().remove_texture(texture);
+        }
+
+        previous_texture = texture;
+        texture = created;
+        tools::memory_tracker::images().add_texture(texture);
+    }
+
+    if (surface)
+    {
+        tools::memory_tracker::images().remove_surface(surface);
+        SDL_FreeSurface(surface);
+    }
+
+    surface = replacement;
+    tools::memory_tracker::images().add_surface(surface);
+    return true;
+}
@@ -5,13 +5,18 @@
 
 namespace isometric::assets {
 
+    class asset_management;
+
     class image : public asset
     {
+        friend class asset_management;
+        friend class asset_bundle;
     protected:
         SDL_Surface* surface = nullptr;
         SDL_Texture* texture = nullptr;
 
         image(const std::string& name, const std::string& path);
+        image(const std::string& name, SDL_Surface* surface, SDL_Texture* texture); // Takes ownership of both
 
     public:
         static std::unique_ptr<image> load(const std::string& name, const std::string& path);
@@ -25,6 +30,16 @@ namespace isometric::assets {
         SDL_Rect get_rect() const;
         SDL_FRect get_frect() const;
 
+        /// <summary>
+        /// Replace the pixels with a newly decoded surface, taking ownership of it. When the size is unchanged the
+        /// texture is updated in place, so everything drawing it shows the new pixels without being told. Any other
+        /// size gets a new texture and the old one is handed back, for the caller to destroy once nothing refers to
+        /// it anymore.
+        /// </summary>
+        /// <param name="previous_texture">Set to the replaced texture, or nullptr if it was updated in place</param>
+        /// <returns>False if the pixels couldn't be uploaded, the image is unchanged and the surface freed</returns>
+        bool replace_pixels(SDL_Renderer* renderer, SDL_Surface* replacement, SDL_Texture*& previous_texture);
+
         virtual void clear() override;
         virtual ~image();
     };
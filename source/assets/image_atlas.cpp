@@ -1,6 +1,8 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include "image_atlas.h"
+#include "atlas_builder.h"
+#include <algorithm>
 #include "../source/application/application.h"
 
 using namespace isometric::assets;
@@ -11,6 +13,12 @@ image_atlas::image_atlas(const std::string& name, const std::string& path)
 
 }
 
+image_atlas::image_atlas(const std::string& name, SDL_Surface* surface, SDL_Texture* texture)
+    : image(name, surface, texture)
+{
+
+}
+
 image_atlas::~image_atlas()
 {
     clear();
@@ -20,6 +28,7 @@ void image_atlas::clear()
 {
     subimage_names.clear();
     subimages.clear();
+    sources.clear();
     image::clear();
 }
 
@@ -39,7 +48,7 @@ std::unique_ptr<image_atlas> image_atlas::load(const std::string& name, const st
 void image_atlas::generate_subimages(unsigned width, unsigned height)
 {
     unsigned atlas_width = image::get_width();
-    unsigned atlas_height = image::get_width();
+    unsigned atlas_height = image::get_height();
 
     for (unsigned y = 0; y < atlas_height; y += height)
     {
@@ -118,3 +127,64 @@ size_t image_atlas::subimage_count() const
 {
     return subimages.size();
 }
+
+void image_atlas::add_source(const atlas_source& source)
+{
+    sources.push_back(source);
+}
+
+const std::vector<atlas_source>& image_atlas::get_sources() const
+{
+    return sources;
+}
+
+bool image_atlas::has_source(const std::string& image_name) const
+{
+    return std::any_of(sources.begin(), sources.end(), [&](const atlas_source& source) { return source.image_name == image_name; });
+}
+
+size_t image_atlas::patch_source(const std::string& image_name, SDL_Surface* source)
+{
+    if (!source || !surface || !texture) return 0;
+
+    const SDL_Rect page_bounds{ 0, 0, surface->w, surface->h };
+    std::vector<SDL_Rect> patched;
+
+    for (const atlas_source& packed : sources)
+    {
+        if (packed.image_name != image_name) continue;
+
+        const SDL_Rect& from = packed.srcrect;
+        if (from.x < 0 || from.y < 0 || from.x + from.w > source->w || from.y + from.h > source->h)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Image [%s] shrank, part of it in atlas [%s] is kept until the atlas is built again",
+                image_name.c_str(), get_name().c_str());
+            continue;
+        }
+
+        atlas_builder::blit(source, packed.srcrect, surface, packed.rect, packed.padding, packed.extrude);
+
+        // The padding was written too:
+        SDL_Rect padded{ packed.rect.x - packed.padding, packed.rect.y - packed.padding, packed.rect.w + packed.padding * 2, packed.rect.h + packed.padding * 2 };
+        SDL_Rect uploaded{};
+        if (SDL_IntersectRect(&page_bounds, &padded, &uploaded)) patched.push_back(uploaded);
+    }
+
+    if (patched.empty()) return 0;
+
+    // SDL_UpdateTexture takes pixels in the texture's own format:
+    Uint32 format = 0;
+    SDL_QueryTexture(texture, &format, nullptr, nullptr, nullptr);
+    SDL_Surface* converted = surface->format->format == format ? surface : SDL_ConvertSurfaceFormat(surface, format, 0);
+    if (!converted) return 0;
+
+    const int bytes_per_pixel = converted->format->BytesPerPixel;
+    for (const SDL_Rect& rect : patched)
+    {
+        const uint8_t* pixels = static_cast<const uint8_t*>(converted->pixels) + rect.y * converted->pitch + rect.x * bytes_per_pixel;
+        SDL_UpdateTexture(texture, &rect, pixels, converted->pitch);
+    }
+
+    if (converted != surface) SDL_FreeSurface(converted);
+    return patched.size();
+}
@@ -7,14 +7,34 @@
 
 namespace isometric::assets {
 
+    class atlas_builder;
+
+    /// <summary>
+    /// Part of another image that atlas_builder packed into an atlas page, kept so the page can follow that image
+    /// when it's reloaded
+    /// </summary>
+    struct atlas_source
+    {
+        std::string image_name;
+        SDL_Rect srcrect{ 0 };  // In the source image
+        SDL_Rect rect{ 0 };     // In the page, without padding
+        int padding = 0;
+        bool extrude = false;
+    };
+
     class image_atlas : public image
     {
+        friend class atlas_builder;
+        friend class asset_bundle;
+        friend class asset_bundle_builder;
     private:
         std::unordered_map<std::string, size_t> subimage_names;
         std::vector<SDL_Rect> subimages;
+        std::vector<atlas_source> sources;
         static constexpr SDL_Rect empty_rect{};
 
         image_atlas(const std::string& name, const std::string& path);
+        image_atlas(const std::string& name, SDL_Surface* surface, SDL_Texture* texture); // Takes ownership of both
 
     public:
         static std::unique_ptr<image_atlas> load(const std::string& name, const std::string& path);
@@ -27,6 +47,18 @@ namespace isometric::assets {
         const SDL_Rect& get_subimage(size_t index) const;
         size_t subimage_count() const;
 
+        void add_source(const atlas_source& source);
+        const std::vector<atlas_source>& get_sources() const;
+        bool has_source(const std::string& image_name) const;
+
+        /// <summary>
+        /// Copy the packed parts of a reloaded source image into the page and upload only those rectangles of its
+        /// texture, the texture and every subimage stay where they are. Parts that no longer fit in the reloaded
+        /// image are left as they were, until the atlas is built again.
+        /// </summary>
+        /// <returns>How many parts were patched</returns>
+        size_t patch_source(const std::string& image_name, SDL_Surface* source);
+
         void clear() override;
         virtual ~image_atlas();
     };
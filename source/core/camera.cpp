@@ -87,4 +87,24 @@ void camera::set_current_x(float tile_x)
 void camera::set_current_y(float tile_y)
 {
     current_tile_y = std::max(tile_y, 0.0f);
-}
\ No newline at end of file
+}
+
+float camera::get_zoom() const
+{
+    return zoom;
+}
+
+void camera::set_zoom(float scale)
+{
+    zoom = std::clamp(scale, min_zoom, max_zoom);
+}
+
+const SDL_FPoint& camera::get_velocity() const
+{
+    return velocity;
+}
+
+void camera::set_velocity(const SDL_FPoint& tiles_per_second)
+{
+    velocity = tiles_per_second;
+}
@@ -13,11 +13,16 @@ namespace isometric {
         unsigned viewport_y = 0;
         float current_tile_x = 0;
         float current_tile_y = 0;
+        float zoom = 1.0f;
+        SDL_FPoint velocity{ 0, 0 };
         bool enabled = true;
 
         camera() {}
 
     public:
+        static constexpr float min_zoom = 1.0f / 32.0f;
+        static constexpr float max_zoom = 4.0f;
+
         static std::shared_ptr<camera> create(unsigned viewport_x, unsigned viewport_y, unsigned width, unsigned height, float start_tile_x = 0, float start_tile_y = 0);
 
         void enable(bool enable = true);
@@ -39,5 +44,18 @@ namespace isometric {
 
         float get_current_y() const;
         void set_current_y(float tile_y);
+
+        /// <summary>
+        /// Screen pixels per world pixel, below 1 the camera sees more of the map. The camera position stays the
+        /// top left of the view, see camera_module for zooming around the center of the viewport.
+        /// </summary>
+        float get_zoom() const;
+        void set_zoom(float scale);
+
+        /// <summary>
+        /// How fast the camera is moving, in tiles (x) and rows (y) per second. Used to load what's ahead of it.
+        /// </summary>
+        const SDL_FPoint& get_velocity() const;
+        void set_velocity(const SDL_FPoint& tiles_per_second);
     };
 }
\ No newline at end of file
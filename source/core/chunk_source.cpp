@@ -0,0 +1,145 @@
+#include "chunk_source.h"
+#include <SDL.h>
+#include <fstream>
+#include <filesystem>
+#include <format>
+
+using namespace isometric;
+
+namespace {
+
+    constexpr uint32_t chunk_magic = 0x4B484349; // "ICHK"
+    constexpr uint16_t chunk_version = 1;
+
+    struct chunk_header
+    {
+        uint32_t magic = chunk_magic;
+        uint16_t version = chunk_version;
+        uint16_t layer_count = 0;
+        uint32_t tile_count = 0;
+        uint32_t reserved = 0;
+    };
+
+    template<class T>
+    bool write_values(std::ostream& stream, const T* values, size_t count)
+    {
+        stream.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(stream);
+    }
+
+    template<class T>
+    bool read_values(std::istream& stream, T* values, size_t count)
+    {
+        stream.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(stream);
+    }
+
+}
+
+bool isometric::write_chunk(std::ostream& stream, const tile_chunk& chunk)
+{
+    const tile_planes& planes = chunk.get_planes();
+
+    chunk_header header;
+    header.layer_count = static_cast<uint16_t>(planes.layers.size());
+    header.tile_count = static_cast<uint32_t>(planes.tile_count);
+
+    if (!write_values(stream, &header, 1)) return false;
+
+    for (const auto& layer : planes.layers)
+    {
+        if (!write_values(stream, layer.data(), layer.size())) return false;
+    }
+
+    return
+        write_values(stream, planes.enabled.get_words().data(), planes.enabled.get_words().size()) &&
+        write_values(stream, planes.passable.get_words().data(), planes.passable.get_words().size()) &&
+        write_values(stream, planes.occupied.get_words().data(), planes.occupied.get_words().size());
+}
+
+std::unique_ptr<tile_chunk> isometric::read_chunk(std::istream& stream, unsigned chunk_x, unsigned chunk_y, size_t layer_count)
+{
+    chunk_header header;
+    if (!read_values(stream, &header, 1)) return nullptr;
+
+    if (header.magic != chunk_magic || header.version != chunk_version || header.tile_count != tile_chunk::tile_count)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Chunk [ %u, %u ] has an unsupported header (version %u, %u tiles)",
+            chunk_x, chunk_y, header.version, header.tile_count);
+        return nullptr;
+    }
+
+    auto chunk = std::make_unique<tile_chunk>(chunk_x, chunk_y, layer_count);
+    tile_planes& planes = chunk->get_planes();
+
+    std::vector<tile_image_id> skipped_layer;
+    for (size_t layer_id = 0; layer_id < header.layer_count; layer_id++)
+    {
+        std::vector<tile_image_id>& layer = layer_id < planes.layers.size() ? planes.layers[layer_id] : skipped_layer;
+        layer.resize(planes.tile_count);
+
+        if (!read_values(stream, layer.data(), layer.size())) return nullptr;
+    }
+
+    const bool read_flags =
+        read_values(stream, planes.enabled.get_words().data(), planes.enabled.get_words().size()) &&
+        read_values(stream, planes.passable.get_words().data(), planes.passable.get_words().size()) &&
+        read_values(stream, planes.occupied.get_words().data(), planes.occupied.get_words().size());
+
+    return read_flags ? std::move(chunk) : nullptr;
+}
+
+chunk_directory_source::chunk_directory_source(const std::string& directory)
+    : directory(directory)
+{
+
+}
+
+std::string chunk_directory_source::get_chunk_path(unsigned chunk_x, unsigned chunk_y) const
+{
+    return (std::filesystem::path(directory) / std::format("chunk_{}_{}.bin", chunk_x, chunk_y)).string();
+}
+
+std::unique_ptr<tile_chunk> chunk_directory_source::load(unsigned chunk_x, unsigned chunk_y, size_t layer_count)
+{
+    std::ifstream file(get_chunk_path(chunk_x, chunk_y), std::ios::binary);
+    if (!file) return nullptr; // Never saved
+
+    auto chunk = read_chunk(file, chunk_x, chunk_y, layer_count);
+    if (!chunk)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read chunk [ %u, %u ] from '%s'",
+            chunk_x, chunk_y, get_chunk_path(chunk_x, chunk_y).c_str());
+    }
+
+    return chunk;
+}
+
+bool chunk_directory_source::save(const tile_chunk& chunk)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Write to a temporary file first so a crash mid-write never leaves a truncated chunk behind:
+    const std::string path = get_chunk_path(chunk.get_chunk_x(), chunk.get_chunk_y());
+    const std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file || !write_chunk(file, chunk))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write chunk [ %u, %u ] to '%s'",
+                chunk.get_chunk_x(), chunk.get_chunk_y(), temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace chunk file '%s': %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <iosfwd>
+#include "tile_chunk.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// Writes a chunk's planes in the binary chunk layout: a small header followed by every layer plane and the
+    /// enabled, passable and occupied bit planes, all little endian.
+    /// </summary>
+    /// <returns>False if the stream failed</returns>
+    bool write_chunk(std::ostream& stream, const tile_chunk& chunk);
+
+    /// <summary>
+    /// Reads a chunk written by write_chunk. Layers missing from the stream are left empty and extra layers
+    /// beyond layer_count are skipped.
+    /// </summary>
+    /// <returns>The chunk, or nullptr if the stream is not a valid chunk</returns>
+    std::unique_ptr<tile_chunk> read_chunk(std::istream& stream, unsigned chunk_x, unsigned chunk_y, size_t layer_count);
+
+    /// <summary>
+    /// Persistent storage for the chunks of a tile_map, used by chunk_streamer. Implementations must be safe to
+    /// call from several worker threads at once.
+    /// </summary>
+    class chunk_source
+    {
+    public:
+        virtual ~chunk_source() {}
+
+        /// <returns>The stored chunk, or nullptr if it has never been stored or can't be read</returns>
+        virtual std::unique_ptr<tile_chunk> load(unsigned chunk_x, unsigned chunk_y, size_t layer_count) = 0;
+
+        /// <returns>False if the chunk couldn't be stored</returns>
+        virtual bool save(const tile_chunk& chunk) = 0;
+    };
+
+    /// <summary>
+    /// Stores every chunk in its own file within a directory, named chunk_[x]_[y].bin
+    /// </summary>
+    class chunk_directory_source : public chunk_source
+    {
+    private:
+        std::string directory;
+
+        std::string get_chunk_path(unsigned chunk_x, unsigned chunk_y) const;
+
+    public:
+        explicit chunk_directory_source(const std::string& directory);
+
+        const std::string& get_directory() const { return directory; }
+
+        std::unique_ptr<tile_chunk> load(unsigned chunk_x, unsigned chunk_y, size_t layer_count) override;
+        bool save(const tile_chunk& chunk) override;
+    };
+
+}
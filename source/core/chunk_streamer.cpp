@@ -0,0 +1,325 @@
+#include "chunk_streamer.h"
+#include "../tools/frame_arena.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace isometric;
+
+static bool rect_contains(const SDL_Rect& rect, int x, int y)
+{
+    return x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h;
+}
+
+chunk_streamer::chunk_streamer(std::shared_ptr<tile_map> map, std::shared_ptr<chunk_source> source)
+    : map(map), source(source)
+{
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Chunk streamer constructed");
+}
+
+chunk_streamer::~chunk_streamer()
+{
+    // Jobs hold on to the source and completed queue themselves, but they mustn't outlive the group:
+    if (auto job_system = tools::job_system::get_current()) job_system->wait(jobs);
+}
+
+size_t chunk_streamer::get_chunk_index(unsigned chunk_x, unsigned chunk_y) const
+{
+    return chunk_x + static_cast<size_t>(chunk_y) * map->get_chunks_wide();
+}
+
+SDL_Rect chunk_streamer::to_chunk_rect(const SDL_Rect& tile_rect) const
+{
+    const int size = static_cast<int>(tile_chunk::size);
+    const int first_x = static_cast<int>(std::floor(tile_rect.x / static_cast<float>(size)));
+    const int first_y = static_cast<int>(std::floor(tile_rect.y / static_cast<float>(size)));
+    const int last_x = static_cast<int>(std::floor((tile_rect.x + std::max(tile_rect.w, 1) - 1) / static_cast<float>(size)));
+    const int last_y = static_cast<int>(std::floor((tile_rect.y + std::max(tile_rect.h, 1) - 1) / static_cast<float>(size)));
+
+    return SDL_Rect{ first_x, first_y, last_x - first_x + 1, last_y - first_y + 1 };
+}
+
+void chunk_streamer::update(const SDL_Rect& visible_tiles, const SDL_FPoint& velocity)
+{
+    const view single{ visible_tiles, velocity };
+    update(std::span<const view>(&single, 1));
+}
+
+void chunk_streamer::update(std::span<const view> views)
+{
+    if (!map || !source) return;
+
+    frame++;
+
+    install_completed();
+    adopt_allocated();
+
+    std::pmr::vector<SDL_Rect> needed(tools::frame_arena::get());
+    std::pmr::vector<SDL_Rect> prefetch(tools::frame_arena::get());
+
+    for (const view& current : views)
+    {
+        // Chunks that must be resident: the visible ones and a margin around them:
+        SDL_Rect rect = to_chunk_rect(current.visible_tiles);
+        rect.x -= static_cast<int>(margin_chunks);
+        rect.y -= static_cast<int>(margin_chunks);
+        rect.w += static_cast<int>(margin_chunks) * 2;
+        rect.h += static_cast<int>(margin_chunks) * 2;
+        needed.push_back(rect);
+
+        // Chunks wanted soon: the visible rectangle moved to where the camera will be:
+        SDL_Rect ahead = current.visible_tiles;
+        ahead.x += static_cast<int>(std::round(current.velocity.x * prefetch_seconds));
+        ahead.y += static_cast<int>(std::round(current.velocity.y * prefetch_seconds));
+        prefetch.push_back(to_chunk_rect(ahead));
+    }
+
+    const int chunks_wide = static_cast<int>(map->get_chunks_wide());
+    const int chunks_high = static_cast<int>(map->get_chunks_high());
+
+    auto visit = [&](const SDL_Rect& rect)
+    {
+        const int first_x = std::max(0, rect.x), last_x = std::min(chunks_wide, rect.x + rect.w);
+        const int first_y = std::max(0, rect.y), last_y = std::min(chunks_high, rect.y + rect.h);
+
+        for (int chunk_y = first_y; chunk_y < last_y; chunk_y++)
+        {
+            for (int chunk_x = first_x; chunk_x < last_x; chunk_x++)
+            {
+                const size_t chunk_index = get_chunk_index(chunk_x, chunk_y);
+                auto iter = resident.find(chunk_index);
+
+                if (iter != resident.end()) iter->second.last_needed_frame = frame;
+                else request(chunk_x, chunk_y);
+            }
+        }
+    };
+
+    // The needed chunks of every view are requested first so they're first in line on the job system:
+    for (const SDL_Rect& rect : needed) visit(rect);
+    for (const SDL_Rect& rect : prefetch) visit(rect);
+
+    needed.insert(needed.end(), prefetch.begin(), prefetch.end());
+    evict(needed);
+}
+
+void chunk_streamer::install_completed()
+{
+    std::vector<std::unique_ptr<tile_chunk>> loaded;
+    std::vector<size_t> saved;
+
+    {
+        std::lock_guard<std::mutex> lock(completed->mutex);
+        loaded.swap(completed->loaded);
+        saved.swap(completed->saved);
+    }
+
+    for (size_t chunk_index : saved)
+    {
+        saving.erase(chunk_index);
+    }
+
+    for (auto& chunk : loaded)
+    {
+        const size_t chunk_index = get_chunk_index(chunk->get_chunk_x(), chunk->get_chunk_y());
+        loading.erase(chunk_index);
+
+        // The chunk may have been allocated by a write while it was loading, the map's version wins:
+        if (map->find_chunk(chunk->get_chunk_x(), chunk->get_chunk_y())) continue;
+
+        resident_chunk info;
+        info.last_needed_frame = frame;
+        info.loaded_revision = chunk->get_planes().revision;
+        info.byte_size = chunk->get_planes().get_byte_size();
+
+        if (map->install_chunk(std::move(chunk)))
+        {
+            resident[chunk_index] = info;
+            resident_bytes += info.byte_size;
+            total_loaded++;
+        }
+    }
+}
+
+void chunk_streamer::adopt_allocated()
+{
+    // Chunks allocated by writes or get_chunk rather than by a load, they're saved when evicted since the source
+    // may not have them. Only checked when the counts disagree, which is rare:
+    if (map->get_allocated_chunk_count() == resident.size()) return;
+
+    for (unsigned chunk_y = 0; chunk_y < map->get_chunks_high(); chunk_y++)
+    {
+        for (unsigned chunk_x = 0; chunk_x < map->get_chunks_wide(); chunk_x++)
+        {
+            const tile_chunk* chunk = map->find_chunk(chunk_x, chunk_y);
+            const size_t chunk_index = get_chunk_index(chunk_x, chunk_y);
+
+            if (chunk && !resident.contains(chunk_index))
+            {
+                resident_chunk info;
+                info.last_needed_frame = frame;
+                info.loaded_revision = chunk->get_planes().revision;
+                info.always_save = true;
+                info.byte_size = chunk->get_planes().get_byte_size();
+
+                resident[chunk_index] = info;
+                resident_bytes += info.byte_size;
+            }
+        }
+    }
+}
+
+void chunk_streamer::request(unsigned chunk_x, unsigned chunk_y)
+{
+    const size_t chunk_index = get_chunk_index(chunk_x, chunk_y);
+
+    // Wait for a pending save so the load doesn't read the old file:
+    if (loading.contains(chunk_index) || saving.contains(chunk_index)) return;
+
+    loading.insert(chunk_index);
+
+    auto load = [map = this->map, source = this->source, queue = this->completed,
+        chunk_x, chunk_y, layer_count = map->get_layers().size(),
+        generate = generate_missing, seed = generation_seed, generator = this->generator]()
+    {
+        std::unique_ptr<tile_chunk> chunk = source->load(chunk_x, chunk_y, layer_count);
+
+        if (!chunk)
+        {
+            chunk = std::make_unique<tile_chunk>(chunk_x, chunk_y, layer_count);
+            if (generator) generator->fill_chunk(*map, *chunk);
+            else if (generate) map->fill_default_images(*chunk, seed);
+        }
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->loaded.push_back(std::move(chunk));
+    };
+
+    if (auto job_system = tools::job_system::get_current()) job_system->run_background(jobs, load);
+    else load(); // Without a job system loads happen here, still outside of rendering
+}
+
+bool chunk_streamer::is_dirty(size_t chunk_index, const resident_chunk& info) const
+{
+    if (info.always_save) return true;
+
+    const tile_chunk* chunk = map->find_chunk(
+        static_cast<unsigned>(chunk_index % map->get_chunks_wide()),
+        static_cast<unsigned>(chunk_index / map->get_chunks_wide()));
+
+    return chunk && chunk->get_planes().revision != info.loaded_revision;
+}
+
+void chunk_streamer::evict(std::span<const SDL_Rect> kept)
+{
+    if (resident_bytes <= memory_budget) return;
+
+    // Least recently needed first, chunks needed or prefetched this frame are never evicted:
+    std::pmr::vector<std::pair<unsigned long long, size_t>> candidates(tools::frame_arena::get());
+    for (const auto& [chunk_index, info] : resident)
+    {
+        const int chunk_x = static_cast<int>(chunk_index % map->get_chunks_wide());
+        const int chunk_y = static_cast<int>(chunk_index / map->get_chunks_wide());
+
+        const bool is_kept = std::any_of(kept.begin(), kept.end(), [&](const SDL_Rect& rect)
+        {
+            return rect_contains(rect, chunk_x, chunk_y);
+        });
+
+        if (!is_kept)
+        {
+            candidates.emplace_back(info.last_needed_frame, chunk_index);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates)
+    {
+        if (resident_bytes <= memory_budget) break;
+
+        const size_t chunk_index = candidate.second;
+        const resident_chunk info = resident[chunk_index];
+        const bool dirty = is_dirty(chunk_index, info);
+
+        std::shared_ptr<tile_chunk> chunk = map->release_chunk(
+            static_cast<unsigned>(chunk_index % map->get_chunks_wide()),
+            static_cast<unsigned>(chunk_index / map->get_chunks_wide()));
+
+        resident.erase(chunk_index);
+        resident_bytes -= std::min(resident_bytes, info.byte_size);
+        total_evicted++;
+
+        if (!chunk || !dirty) continue;
+
+        saving.insert(chunk_index);
+
+        auto save = [source = this->source, queue = this->completed, chunk, chunk_index]()
+        {
+            source->save(*chunk);
+
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->saved.push_back(chunk_index);
+        };
+
+        if (auto job_system = tools::job_system::get_current()) job_system->run_background(jobs, save);
+        else save();
+    }
+}
+
+void chunk_streamer::save_all()
+{
+    if (!map || !source) return;
+
+    for (auto& [chunk_index, info] : resident)
+    {
+        if (!is_dirty(chunk_index, info)) continue;
+
+        const tile_chunk* chunk = map->find_chunk(
+            static_cast<unsigned>(chunk_index % map->get_chunks_wide()),
+            static_cast<unsigned>(chunk_index / map->get_chunks_wide()));
+
+        if (chunk && source->save(*chunk))
+        {
+            info.loaded_revision = chunk->get_planes().revision;
+            info.always_save = false;
+        }
+    }
+
+    if (auto job_system = tools::job_system::get_current()) job_system->wait(jobs);
+}
+
+void chunk_streamer::set_memory_budget(size_t bytes)
+{
+    memory_budget = bytes;
+}
+
+size_t chunk_streamer::get_memory_budget() const
+{
+    return memory_budget;
+}
+
+size_t chunk_streamer::get_resident_bytes() const
+{
+    return resident_bytes;
+}
+
+void chunk_streamer::set_margin_chunks(unsigned chunks)
+{
+    margin_chunks = chunks;
+}
+
+void chunk_streamer::set_prefetch_seconds(float seconds)
+{
+    prefetch_seconds = std::max(0.0f, seconds);
+}
+
+void chunk_streamer::set_generate_missing(bool generate, uint64_t seed)
+{
+    generate_missing = generate;
+    generation_seed = seed;
+}
+
+void chunk_streamer::set_generator(std::shared_ptr<const terrain_generator> generator)
+{
+    this->generator = generator;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "tile_map.h"
+#include "chunk_source.h"
+#include "terrain_generator.h"
+#include "../tools/job_system.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// Keeps the chunks around the camera resident in a tile_map and streams the rest in and out of a chunk_source.
+    /// Chunks are loaded on the current job system and installed by update(), so rendering never waits on I/O.
+    /// Chunks in the direction the camera is moving are requested ahead of time. Once resident chunks use more
+    /// memory than the budget, the least recently needed ones are saved (if they changed) and released.
+    /// </summary>
+    class chunk_streamer
+    {
+    private:
+        struct resident_chunk
+        {
+            unsigned long long last_needed_frame = 0;
+            uint32_t loaded_revision = 0;   // The revision when loaded, a different revision needs saving
+            bool always_save = false;       // Allocated outside of the streamer, its stored state is unknown
+            size_t byte_size = 0;
+        };
+
+        // Filled by load jobs, emptied by update():
+        struct completed_queue
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<tile_chunk>> loaded;
+            std::vector<size_t> saved;  // Chunk indices whose save finished
+        };
+
+        std::shared_ptr<tile_map> map;
+        std::shared_ptr<chunk_source> source;
+        std::shared_ptr<completed_queue> completed = std::make_shared<completed_queue>();
+        tools::job_group jobs;
+
+        std::unordered_map<size_t, resident_chunk> resident;   // By chunk index
+        std::unordered_set<size_t> loading;
+        std::unordered_set<size_t> saving;
+
+        size_t memory_budget = 64 * 1024 * 1024;
+        size_t resident_bytes = 0;
+        unsigned margin_chunks = 1;
+        float prefetch_seconds = 0.75f;
+        bool generate_missing = false;
+        uint64_t generation_seed = 0;
+        std::shared_ptr<const terrain_generator> generator;
+        unsigned long long frame = 0;
+        size_t total_loaded = 0;
+        size_t total_evicted = 0;
+
+    public:
+        /// <summary>
+        /// What one camera sees, see update
+        /// </summary>
+        struct view
+        {
+            SDL_Rect visible_tiles;     // The tile rectangle that is visible, see transform::get_visible_tile_span
+            SDL_FPoint velocity;        // The camera velocity in tiles per second
+        };
+
+        chunk_streamer(std::shared_ptr<tile_map> map, std::shared_ptr<chunk_source> source);
+        ~chunk_streamer();
+
+        chunk_streamer(const chunk_streamer&) = delete;
+        chunk_streamer& operator=(const chunk_streamer&) = delete;
+
+        /// <summary>
+        /// Install chunks that finished loading, request chunks needed for the view and prefetch, and evict chunks
+        /// over the memory budget. Call once per frame, before rendering, on the thread that owns the map.
+        /// </summary>
+        /// <param name="visible_tiles">The tile rectangle that is visible, see transform::get_visible_tile_span</param>
+        /// <param name="velocity">The camera velocity in tiles per second</param>
+        void update(const SDL_Rect& visible_tiles, const SDL_FPoint& velocity);
+
+        /// <summary>
+        /// Same as update for a single view, but keeps the chunks of every view resident, for several cameras
+        /// </summary>
+        void update(std::span<const view> views);
+
+        /// <summary>
+        /// Save every resident chunk that changed since it was loaded, blocking until the saves are done
+        /// </summary>
+        void save_all();
+
+        /// <summary>
+        /// Resident chunks are only evicted once they use more than this many bytes
+        /// </summary>
+        void set_memory_budget(size_t bytes);
+        size_t get_memory_budget() const;
+        size_t get_resident_bytes() const;
+
+        /// <summary>
+        /// Chunks within this many chunks of the visible ones are kept resident in every direction
+        /// </summary>
+        void set_margin_chunks(unsigned chunks);
+
+        /// <summary>
+        /// How far ahead, in seconds of camera movement, chunks are requested before they're visible
+        /// </summary>
+        void set_prefetch_seconds(float seconds);
+
+        /// <summary>
+        /// Chunks that aren't in the source are filled with tile_map::fill_default_images using seed, otherwise
+        /// they start out empty
+        /// </summary>
+        void set_generate_missing(bool generate, uint64_t seed = 0);
+
+        /// <summary>
+        /// Chunks that aren't in the source are generated on the loading worker instead, taking precedence over
+        /// set_generate_missing. Pass nullptr to stop generating.
+        /// </summary>
+        void set_generator(std::shared_ptr<const terrain_generator> generator);
+
+        size_t get_resident_count() const { return resident.size(); }
+        size_t get_loading_count() const { return loading.size(); }
+        size_t get_total_loaded() const { return total_loaded; }
+        size_t get_total_evicted() const { return total_evicted; }
+
+    private:
+        size_t get_chunk_index(unsigned chunk_x, unsigned chunk_y) const;
+        SDL_Rect to_chunk_rect(const SDL_Rect& tile_rect) const;
+        void install_completed();
+        void adopt_allocated();
+        void request(unsigned chunk_x, unsigned chunk_y);
+        void evict(std::span<const SDL_Rect> kept);
+        bool is_dirty(size_t chunk_index, const resident_chunk& info) const;
+    };
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <SDL.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include "tile_chunk.h"
+#include "tile_geometry.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// One chunk of a flow field, along with the entrance costs it was integrated from so an update can tell
+    /// whether it still holds
+    /// </summary>
+    struct flow_chunk
+    {
+        struct seed
+        {
+            SDL_Point tile;
+            float cost;
+            uint8_t direction;
+
+            bool operator==(const seed& other) const
+            {
+                return tile.x == other.tile.x && tile.y == other.tile.y && cost == other.cost && direction == other.direction;
+            }
+        };
+
+        std::array<float, tile_chunk::tile_count> costs;
+        std::array<uint8_t, tile_chunk::tile_count> directions;
+        std::vector<seed> seeds;
+    };
+
+    /// <summary>
+    /// The way to one goal from every tile that can reach it: an integration field with the cost to the goal and a
+    /// direction field with the step to take, so any number of agents heading to the goal steer with one lookup per
+    /// tick. Created and kept current by path_finder::get_flow_field and immutable once created, use the newest one
+    /// the path finder returns.
+    /// </summary>
+    class flow_field
+    {
+        friend class path_finder;
+    private:
+        SDL_Point goal;
+        int map_width = 0;
+        int map_height = 0;
+        int chunks_wide = 0;
+        std::vector<std::shared_ptr<const flow_chunk>> chunks;     // nullptr for chunks the goal can't be reached from
+
+        const flow_chunk* find_chunk(const SDL_Point& tile, size_t& index) const
+        {
+            if (tile.x < 0 || tile.y < 0 || tile.x >= map_width || tile.y >= map_height) return nullptr;
+
+            constexpr int size = static_cast<int>(tile_chunk::size);
+            index = tile_chunk::local_index(tile.x % size, tile.y % size);
+            return chunks[tile.x / size + static_cast<size_t>(tile.y / size) * chunks_wide].get();
+        }
+
+    public:
+        static constexpr uint8_t no_direction = 0xFF;   // At the goal, or where the goal can't be reached from
+
+        flow_field(const SDL_Point& goal, int map_width, int map_height, int chunks_wide, int chunks_high)
+            : goal(goal), map_width(map_width), map_height(map_height), chunks_wide(chunks_wide),
+            chunks(static_cast<size_t>(chunks_wide) * chunks_high) {}
+
+        const SDL_Point& get_goal() const { return goal; }
+
+        /// <returns>The cost from the tile to the goal, infinity if it can't reach the goal</returns>
+        float get_cost(const SDL_Point& tile) const
+        {
+            size_t index = 0;
+            const flow_chunk* chunk = find_chunk(tile, index);
+            return chunk ? chunk->costs[index] : std::numeric_limits<float>::infinity();
+        }
+
+        /// <returns>One of the geometry::diamond_directions, or no_direction</returns>
+        uint8_t get_direction(const SDL_Point& tile) const
+        {
+            size_t index = 0;
+            const flow_chunk* chunk = find_chunk(tile, index);
+            return chunk ? chunk->directions[index] : no_direction;
+        }
+
+        /// <summary>
+        /// The tile to step to from a tile on the way to the goal
+        /// </summary>
+        /// <returns>False at the goal and on tiles that can't reach it</returns>
+        bool get_next_tile(const SDL_Point& tile, SDL_Point& next) const
+        {
+            const uint8_t direction = get_direction(tile);
+            if (direction == no_direction) return false;
+
+            next = geometry::step_world_tile(tile, direction);
+            return true;
+        }
+
+        bool is_reachable(const SDL_Point& tile) const
+        {
+            return get_cost(tile) != std::numeric_limits<float>::infinity();
+        }
+
+        /// <returns>The number of chunks with tiles that can reach the goal</returns>
+        size_t get_chunk_count() const
+        {
+            size_t count = 0;
+            for (const auto& chunk : chunks) count += chunk ? 1 : 0;
+            return count;
+        }
+    };
+
+}
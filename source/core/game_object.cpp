@@ -1,5 +1,6 @@
 #include "game_object.h"
 #include "world.h"
+#include "object_grid.h"
 
 using namespace isometric;
 
@@ -8,7 +9,22 @@ game_object::game_object()
 
 }
 
-void game_object::setup_transform(std::shared_ptr<camera> camera, std::shared_ptr<tile_map> map)
+void game_object::set_transform(const isometric::transform* world_transform)
 {
-    transform.reset(new isometric::transform(camera, map));
+    transform = world_transform;
+}
+
+void game_object::set_position(const SDL_FPoint& tile_position)
+{
+    position = tile_position;
+    positioned = true;
+
+    if (grid) grid->update(*this);
+}
+
+void game_object::clear_position()
+{
+    positioned = false;
+
+    if (grid) grid->update(*this);
 }
@@ -5,21 +5,54 @@
 
 namespace isometric {
 
+    class object_grid;
+
     class game_object
     {
+        friend class object_grid;
+        friend class world;
+
+    private:
+        SDL_FPoint position{ 0, 0 };
+        bool positioned = false;
+
+        // Maintained by the object_grid the object is in:
+        object_grid* grid = nullptr;
+        size_t grid_cell = 0;
+        size_t grid_slot = 0;
+
+        // Maintained by world while depth sorting:
+        unsigned long long depth_frame = 0;
+        bool depth_listed = false;
+
     protected:
-        std::unique_ptr<transform> transform = nullptr;
+        const isometric::transform* transform = nullptr;   // The world's, shared by every object in it
 
     public:
         game_object();
         virtual ~game_object() {}
 
         /// <summary>
-        /// Generally, only used by the world class to configure the transform
+        /// Generally, only used by the world class to share its transform with the object
+        /// </summary>
+        /// <param name="world_transform">The world's transform, or nullptr when the object leaves the world</param>
+        void set_transform(const isometric::transform* world_transform);
+
+        /// <summary>
+        /// Place the object on the map, in world tile coordinates (x is the column, y is the row). Objects without
+        /// a position are never culled by the world.
+        /// </summary>
+        void set_position(const SDL_FPoint& tile_position);
+        void clear_position();
+        const SDL_FPoint& get_position() const { return position; }
+        bool has_position() const { return positioned; }
+
+        /// <summary>
+        /// Used by the world to skip rendering objects that are off screen. Objects that can't tell where they are
+        /// are always rendered.
         /// </summary>
-        /// <param name="camera"></param>
-        /// <param name="map"></param>
-        void setup_transform(std::shared_ptr<camera> camera, std::shared_ptr<tile_map> map);
+        /// <param name="visible_span">The tiles visible this frame</param>
+        virtual bool is_visible(const tile_span& visible_span) const { return true; }
 
         virtual void on_render(SDL_Renderer* renderer, double delta_time) = 0;
     };
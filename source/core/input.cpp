@@ -1,41 +1,150 @@
 #include <SDL.h>
 #include "input.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 
 using namespace isometric;
 
+namespace {
+
+    input_snapshot current;             // Read by get_snapshot, replaced by capture
+    input_snapshot pending;             // Edges of the events polled since the last capture
+
+    std::mutex simulation_mutex;
+    input_snapshot simulation;          // The newest snapshot plus the edges take_simulation_snapshot hasn't returned yet
+
+    void clear_edges(input_snapshot& snapshot)
+    {
+        snapshot.keys_pressed.fill(0);
+        snapshot.keys_released.fill(0);
+        snapshot.mouse_buttons_pressed = 0;
+        snapshot.mouse_buttons_released = 0;
+        snapshot.mouse_delta = SDL_FPoint{ 0.0F, 0.0F };
+        snapshot.wheel_delta = SDL_Point{ 0, 0 };
+    }
+
+}
+
+void input_snapshot::merge_edges(const input_snapshot& older)
+{
+    for (size_t i = 0; i < keys_pressed.size(); i++)
+    {
+        keys_pressed[i] |= older.keys_pressed[i];
+        keys_released[i] |= older.keys_released[i];
+    }
+
+    mouse_buttons_pressed |= older.mouse_buttons_pressed;
+    mouse_buttons_released |= older.mouse_buttons_released;
+    mouse_delta.x += older.mouse_delta.x;
+    mouse_delta.y += older.mouse_delta.y;
+    wheel_delta.x += older.wheel_delta.x;
+    wheel_delta.y += older.wheel_delta.y;
+}
+
+void input::process_event(const SDL_Event& e)
+{
+    switch (e.type)
+    {
+    case SDL_KEYDOWN:
+        // Held keys repeat their key down events, only the first one is an edge:
+        if (!e.key.repeat && e.key.keysym.scancode < SDL_NUM_SCANCODES) pending.keys_pressed[e.key.keysym.scancode] = 1;
+        break;
+    case SDL_KEYUP:
+        if (e.key.keysym.scancode < SDL_NUM_SCANCODES) pending.keys_released[e.key.keysym.scancode] = 1;
+        break;
+    case SDL_MOUSEBUTTONDOWN:
+        pending.mouse_buttons_pressed |= SDL_BUTTON(e.button.button);
+        break;
+    case SDL_MOUSEBUTTONUP:
+        pending.mouse_buttons_released |= SDL_BUTTON(e.button.button);
+        break;
+    case SDL_MOUSEWHEEL:
+        pending.wheel_delta.x += e.wheel.x;
+        pending.wheel_delta.y += e.wheel.y;
+        break;
+    }
+}
+
+void input::capture()
+{
+    input_snapshot& next = pending;
+    next.frame = current.frame + 1;
+
+    int key_count = 0;
+    const Uint8* keys = SDL_GetKeyboardState(&key_count);
+    std::memcpy(next.keys_down.data(), keys, std::min<size_t>(static_cast<size_t>(key_count), next.keys_down.size()));
+
+    int mouse_x = 0, mouse_y = 0;
+    next.mouse_buttons = SDL_GetMouseState(&mouse_x, &mouse_y);
+    next.mouse_position = SDL_FPoint{ static_cast<float>(mouse_x), static_cast<float>(mouse_y) };
+
+    int delta_x = 0, delta_y = 0;
+    SDL_GetRelativeMouseState(&delta_x, &delta_y);
+    next.mouse_delta = SDL_FPoint{ static_cast<float>(delta_x), static_cast<float>(delta_y) };
+
+    current = next;
+    clear_edges(pending);
+
+    // The simulation keeps the edges of the snapshots it hasn't taken yet:
+    std::lock_guard<std::mutex> lock(simulation_mutex);
+    input_snapshot handed = current;
+    handed.merge_edges(simulation);
+    simulation = handed;
+}
+
+void input::replay(const input_snapshot& snapshot)
+{
+    const uint64_t frame = current.frame + 1;
+    current = snapshot;
+    current.frame = frame;
+    clear_edges(pending);
+
+    std::lock_guard<std::mutex> lock(simulation_mutex);
+    input_snapshot handed = current;
+    handed.merge_edges(simulation);
+    simulation = handed;
+}
+
+const input_snapshot& input::get_snapshot()
+{
+    return current;
+}
+
+input_snapshot input::take_simulation_snapshot()
+{
+    std::lock_guard<std::mutex> lock(simulation_mutex);
+    input_snapshot taken = simulation;
+    clear_edges(simulation);
+    return taken;
+}
+
 const uint8_t* input::keyboard_state()
 {
-    return SDL_GetKeyboardState(NULL);
+    return current.keys_down.data();
 }
 
 bool isometric::input::scancode_down(SDL_Scancode scancode)
 {
-    return keyboard_state()[scancode];
+    return current.scancode_down(scancode);
 }
 
 bool isometric::input::keycode_down(SDL_Keycode key)
 {
-    return scancode_down(SDL_GetScancodeFromKey(key));
+    return current.scancode_down(SDL_GetScancodeFromKey(key));
 }
 
 SDL_FPoint input::mouse_position()
 {
-    int mouse_x = 0, mouse_y = 0;
-    SDL_GetMouseState(&mouse_x, &mouse_y);
-
-    return
-    {
-        static_cast<float>(mouse_x),
-        static_cast<float>(mouse_y),
-    };
+    return current.mouse_position;
 }
 
 uint32_t input::mouse_buttons()
 {
-    return SDL_GetMouseState(NULL, NULL);
+    return current.mouse_buttons;
 }
 
 bool isometric::input::mouse_down(int button)
 {
-    return mouse_buttons() & SDL_BUTTON(button);
+    return current.mouse_down(button);
 }
@@ -1,16 +1,86 @@
 #pragma once
+#include <SDL.h>
+#include <array>
+#include <cstdint>
 
 namespace isometric {
 
     class application;
 
+    /// <summary>
+    /// The keyboard and mouse as they were at the start of a frame. Pressed and released are the edges since the
+    /// previous snapshot, taken from events so a key tapped within one frame still counts as pressed and released.
+    /// Queries only read the snapshot, so it can be copied and read from any thread.
+    /// </summary>
+    struct input_snapshot
+    {
+        uint64_t frame = 0;     // Counts captures, 0 before the first one
+
+        std::array<uint8_t, SDL_NUM_SCANCODES> keys_down{};
+        std::array<uint8_t, SDL_NUM_SCANCODES> keys_pressed{};
+        std::array<uint8_t, SDL_NUM_SCANCODES> keys_released{};
+
+        SDL_FPoint mouse_position{ 0.0F, 0.0F };
+        SDL_FPoint mouse_delta{ 0.0F, 0.0F };   // Relative motion since the previous snapshot, also in relative mouse mode
+        SDL_Point wheel_delta{ 0, 0 };
+        uint32_t mouse_buttons = 0;             // SDL_BUTTON masks
+        uint32_t mouse_buttons_pressed = 0;
+        uint32_t mouse_buttons_released = 0;
+
+        bool scancode_down(SDL_Scancode scancode) const { return is_valid(scancode) && keys_down[scancode]; }
+        bool scancode_pressed(SDL_Scancode scancode) const { return is_valid(scancode) && keys_pressed[scancode]; }
+        bool scancode_released(SDL_Scancode scancode) const { return is_valid(scancode) && keys_released[scancode]; }
+
+        bool mouse_down(int button) const { return mouse_buttons & SDL_BUTTON(button); }
+        bool mouse_pressed(int button) const { return mouse_buttons_pressed & SDL_BUTTON(button); }
+        bool mouse_released(int button) const { return mouse_buttons_released & SDL_BUTTON(button); }
+
+        /// <summary>
+        /// Keep the edges of an older snapshot that was never seen, used to hand edges to a slower consumer
+        /// </summary>
+        void merge_edges(const input_snapshot& older);
+
+    private:
+        static bool is_valid(SDL_Scancode scancode) { return scancode > SDL_SCANCODE_UNKNOWN && scancode < SDL_NUM_SCANCODES; }
+    };
+
     class input
     {
+        friend class application;
     private:
         input() {} // Force static class
 
+        /// <summary>
+        /// Main thread only, called by the application for every event it polls
+        /// </summary>
+        static void process_event(const SDL_Event& e);
+
+        /// <summary>
+        /// Main thread only, called by the application once the events of a frame were polled. Replaces the
+        /// snapshot and hands it to the simulation thread.
+        /// </summary>
+        static void capture();
+
+        /// <summary>
+        /// Main thread only, used instead of capture while a recording is replayed. Events polled since the last
+        /// capture are dropped, the recorded snapshot replaces them.
+        /// </summary>
+        static void replay(const input_snapshot& snapshot);
+
     public:
 
+        /// <summary>
+        /// The snapshot of the current frame. It's replaced only between frames on the main thread, so jobs started
+        /// during a frame may read it too. The simulation thread runs across frames and uses take_simulation_snapshot.
+        /// </summary>
+        static const input_snapshot& get_snapshot();
+
+        /// <summary>
+        /// The newest snapshot, with the edges of every snapshot captured since the last call. For the simulation
+        /// thread, or anything else that runs at its own rate and must not miss a press.
+        /// </summary>
+        static input_snapshot take_simulation_snapshot();
+
         static const uint8_t* keyboard_state();
         static bool scancode_down(SDL_Scancode scancode);
         static bool keycode_down(SDL_Keycode key);
@@ -20,4 +90,4 @@ namespace isometric {
         static bool mouse_down(int button);
     };
 
-}
\ No newline at end of file
+}
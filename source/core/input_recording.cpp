@@ -0,0 +1,293 @@
+#include "input_recording.h"
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace isometric;
+
+static_assert(std::endian::native == std::endian::little, "Input recordings are written in place and require a little endian host");
+static_assert(sizeof(input_recording_format::header) == 40);
+
+namespace {
+
+    using format = input_recording_format;
+
+    void write_varint(std::vector<uint8_t>& data, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(value));
+    }
+
+    template<class T>
+    void write_raw(std::vector<uint8_t>& data, const T& value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+    int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+    /// <summary>
+    /// The scancodes where two key arrays differ, or where one is set when compared against nothing
+    /// </summary>
+    void write_scancodes(std::vector<uint8_t>& data, const std::array<uint8_t, SDL_NUM_SCANCODES>& keys,
+        const std::array<uint8_t, SDL_NUM_SCANCODES>* previous)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < keys.size(); i++) count += previous ? (keys[i] != 0) != ((*previous)[i] != 0) : keys[i] != 0;
+
+        write_varint(data, count);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (previous ? (keys[i] != 0) != ((*previous)[i] != 0) : keys[i] != 0) write_varint(data, i);
+        }
+    }
+
+    bool any_key(const std::array<uint8_t, SDL_NUM_SCANCODES>& keys)
+    {
+        for (uint8_t key : keys)
+        {
+            if (key) return true;
+        }
+
+        return false;
+    }
+
+    bool same_point(const SDL_FPoint& a, const SDL_FPoint& b)
+    {
+        return std::memcmp(&a, &b, sizeof(SDL_FPoint)) == 0;
+    }
+
+    struct replay_reader
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t& offset;
+        bool failed = false;
+
+        uint64_t read_varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (offset >= size) break;
+
+                const uint8_t byte = data[offset++];
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+
+            failed = true;
+            return 0;
+        }
+
+        template<class T>
+        T read_raw()
+        {
+            T value{};
+            if (sizeof(T) > size - offset)
+            {
+                failed = true;
+                return value;
+            }
+
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        /// <param name="toggle">Flip the keys read instead of setting them</param>
+        void read_scancodes(std::array<uint8_t, SDL_NUM_SCANCODES>& keys, bool toggle)
+        {
+            const uint64_t count = read_varint();
+            for (uint64_t i = 0; i < count && !failed; i++)
+            {
+                const uint64_t scancode = read_varint();
+                if (scancode >= keys.size())
+                {
+                    failed = true;
+                    return;
+                }
+
+                keys[scancode] = toggle ? !keys[scancode] : 1;
+            }
+        }
+    };
+
+}
+
+input_recorder::input_recorder(uint64_t random_seed, const SDL_Point& screen_size)
+    : random_seed(random_seed), screen_size(screen_size)
+{
+    // About an hour at 60 frames per second without a reallocation, when nothing is pressed:
+    data.reserve(9 * 60 * 60 * 60);
+}
+
+void input_recorder::add_frame(const input_snapshot& snapshot, double delta_time)
+{
+    uint8_t changes = 0;
+    if (snapshot.keys_down != previous.keys_down) changes |= format::change_keys_down;
+    if (any_key(snapshot.keys_pressed)) changes |= format::change_keys_pressed;
+    if (any_key(snapshot.keys_released)) changes |= format::change_keys_released;
+    if (!same_point(snapshot.mouse_position, previous.mouse_position)) changes |= format::change_mouse_position;
+    if (snapshot.mouse_delta.x != 0.0F || snapshot.mouse_delta.y != 0.0F) changes |= format::change_mouse_delta;
+    if (snapshot.wheel_delta.x != 0 || snapshot.wheel_delta.y != 0) changes |= format::change_wheel;
+    if (snapshot.mouse_buttons != previous.mouse_buttons) changes |= format::change_buttons;
+    if (snapshot.mouse_buttons_pressed || snapshot.mouse_buttons_released) changes |= format::change_button_edges;
+
+    write_raw(data, delta_time);
+    data.push_back(changes);
+
+    if (changes & format::change_keys_down) write_scancodes(data, snapshot.keys_down, &previous.keys_down);
+    if (changes & format::change_keys_pressed) write_scancodes(data, snapshot.keys_pressed, nullptr);
+    if (changes & format::change_keys_released) write_scancodes(data, snapshot.keys_released, nullptr);
+    if (changes & format::change_mouse_position) write_raw(data, snapshot.mouse_position);
+    if (changes & format::change_mouse_delta) write_raw(data, snapshot.mouse_delta);
+
+    if (changes & format::change_wheel)
+    {
+        write_varint(data, zigzag(snapshot.wheel_delta.x));
+        write_varint(data, zigzag(snapshot.wheel_delta.y));
+    }
+
+    if (changes & format::change_buttons) write_varint(data, snapshot.mouse_buttons);
+    if (changes & format::change_button_edges)
+    {
+        write_varint(data, snapshot.mouse_buttons_pressed);
+        write_varint(data, snapshot.mouse_buttons_released);
+    }
+
+    previous = snapshot;
+    frame_count++;
+}
+
+bool input_recorder::save(const std::string& path) const
+{
+    // Write to a temporary file first so a crash mid-write never leaves a truncated recording behind:
+    const std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create input recording [%s]", temporary_path.c_str());
+            return false;
+        }
+
+        const format::header header{
+            format::file_magic, format::file_version, 0, frame_count,
+            static_cast<uint32_t>(screen_size.x), static_cast<uint32_t>(screen_size.y), 0,
+            random_seed, data.size()
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!file)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write input recording [%s]", temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace input recording [%s]: %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    SDL_Log("Wrote %u frames of input to [%s], %zu bytes with seed %llu", frame_count, path.c_str(), get_size(),
+        static_cast<unsigned long long>(random_seed));
+    return true;
+}
+
+std::unique_ptr<input_replay> input_replay::open(const std::string& path)
+{
+    std::unique_ptr<input_replay> replay(new input_replay());
+    if (!replay->file.open(path, true))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to open input recording [%s]", path.c_str());
+        return nullptr;
+    }
+
+    const size_t size = replay->file.get_size();
+    if (size < sizeof(format::header))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Input recording [%s] is too small", path.c_str());
+        return nullptr;
+    }
+
+    std::memcpy(&replay->file_header, replay->file.get_data(), sizeof(format::header));
+    const format::header& header = replay->file_header;
+
+    if (header.magic != format::file_magic || header.version != format::file_version ||
+        header.data_size > size - sizeof(format::header))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Input recording [%s] isn't a valid recording or is truncated", path.c_str());
+        return nullptr;
+    }
+
+    replay->data = replay->file.get_data() + sizeof(format::header);
+    return replay;
+}
+
+SDL_Point input_replay::get_screen_size() const
+{
+    return SDL_Point{ static_cast<int>(file_header.screen_width), static_cast<int>(file_header.screen_height) };
+}
+
+bool input_replay::next(input_snapshot& snapshot, double& delta_time)
+{
+    if (failed || frame >= file_header.frame_count) return false;
+
+    replay_reader reader{ data, static_cast<size_t>(file_header.data_size), offset };
+
+    delta_time = reader.read_raw<double>();
+    const uint8_t changes = reader.read_raw<uint8_t>();
+
+    // Held keys, the mouse position and buttons carry over, edges and deltas only last their frame:
+    current.keys_pressed.fill(0);
+    current.keys_released.fill(0);
+    current.mouse_delta = SDL_FPoint{ 0.0F, 0.0F };
+    current.wheel_delta = SDL_Point{ 0, 0 };
+    current.mouse_buttons_pressed = 0;
+    current.mouse_buttons_released = 0;
+
+    if (changes & format::change_keys_down) reader.read_scancodes(current.keys_down, true);
+    if (changes & format::change_keys_pressed) reader.read_scancodes(current.keys_pressed, false);
+    if (changes & format::change_keys_released) reader.read_scancodes(current.keys_released, false);
+    if (changes & format::change_mouse_position) current.mouse_position = reader.read_raw<SDL_FPoint>();
+    if (changes & format::change_mouse_delta) current.mouse_delta = reader.read_raw<SDL_FPoint>();
+
+    if (changes & format::change_wheel)
+    {
+        current.wheel_delta.x = static_cast<int>(unzigzag(reader.read_varint()));
+        current.wheel_delta.y = static_cast<int>(unzigzag(reader.read_varint()));
+    }
+
+    if (changes & format::change_buttons) current.mouse_buttons = static_cast<uint32_t>(reader.read_varint());
+    if (changes & format::change_button_edges)
+    {
+        current.mouse_buttons_pressed = static_cast<uint32_t>(reader.read_varint());
+        current.mouse_buttons_released = static_cast<uint32_t>(reader.read_varint());
+    }
+
+    if (reader.failed)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Input recording is damaged at frame %u of %u", frame, file_header.frame_count);
+        failed = true;
+        return false;
+    }
+
+    frame++;
+    snapshot = current;
+    return true;
+}
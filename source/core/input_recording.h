@@ -0,0 +1,118 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "input.h"
+#include "../tools/memory_mapped_file.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// The layout of an input recording, written by input_recorder and read by input_replay
+    /// </summary>
+    /// <remarks>
+    /// A header, then one record per frame, all little endian:
+    ///   delta time - the frame's delta time as a raw double, so a replay sees exactly the same values
+    ///   changes    - a byte of change_* bits, then only what those bits say changed since the previous frame:
+    ///                keys that went down or up and the pressed and released edges, each a varint count and
+    ///                varint scancodes, the mouse position and delta as raw floats, the wheel as zigzag varints,
+    ///                and the buttons and their edges as varints
+    /// A frame where nothing happened is 9 bytes.
+    /// </remarks>
+    struct input_recording_format
+    {
+        static constexpr uint32_t file_magic = 0x43455249; // "IREC"
+        static constexpr uint16_t file_version = 1;
+
+        struct header
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t flags;
+            uint32_t frame_count;
+            uint32_t screen_width;      // Mouse positions are in this window's coordinates
+            uint32_t screen_height;
+            uint32_t reserved;
+            uint64_t random_seed;       // Given to tools::random::set_seed before the first frame
+            uint64_t data_size;
+        };
+
+        static constexpr uint8_t change_keys_down = 1;
+        static constexpr uint8_t change_keys_pressed = 2;
+        static constexpr uint8_t change_keys_released = 4;
+        static constexpr uint8_t change_mouse_position = 8;
+        static constexpr uint8_t change_mouse_delta = 16;
+        static constexpr uint8_t change_wheel = 32;
+        static constexpr uint8_t change_buttons = 64;
+        static constexpr uint8_t change_button_edges = 128;
+    };
+
+    /// <summary>
+    /// Records every frame's input snapshot and delta time, encoded as changes from the previous frame, for
+    /// input_replay to play back. application records with application_setup::record_input_path.
+    /// </summary>
+    class input_recorder
+    {
+    private:
+        uint64_t random_seed = 0;
+        SDL_Point screen_size{ 0, 0 };
+        uint32_t frame_count = 0;
+        input_snapshot previous;
+        std::vector<uint8_t> data;
+
+    public:
+        input_recorder(uint64_t random_seed, const SDL_Point& screen_size);
+
+        /// <summary>
+        /// Add a frame, after its input was captured
+        /// </summary>
+        void add_frame(const input_snapshot& snapshot, double delta_time);
+
+        uint32_t get_frame_count() const { return frame_count; }
+        size_t get_size() const { return data.size() + sizeof(input_recording_format::header); }
+
+        /// <summary>
+        /// Write the recording to path. The file is written next to path first and then moved over it, so an
+        /// existing recording is never left half written.
+        /// </summary>
+        bool save(const std::string& path) const;
+    };
+
+    /// <summary>
+    /// Plays a recording back one frame at a time, straight out of a memory mapping
+    /// </summary>
+    class input_replay
+    {
+    private:
+        tools::memory_mapped_file file;
+        input_recording_format::header file_header{};
+        const uint8_t* data = nullptr;
+        size_t offset = 0;
+        uint32_t frame = 0;
+        bool failed = false;
+        input_snapshot current;
+
+        input_replay() {}
+
+    public:
+        /// <returns>The replay, or nullptr if the file doesn't exist or isn't a valid recording</returns>
+        static std::unique_ptr<input_replay> open(const std::string& path);
+
+        /// <summary>
+        /// Decode the next frame
+        /// </summary>
+        /// <returns>False once every frame was read, or if the recording is truncated or damaged</returns>
+        bool next(input_snapshot& snapshot, double& delta_time);
+
+        uint64_t get_random_seed() const { return file_header.random_seed; }
+        uint32_t get_frame_count() const { return file_header.frame_count; }
+        uint32_t get_frame() const { return frame; }
+        SDL_Point get_screen_size() const;
+
+        /// <returns>True if the recording ended early because its data is malformed</returns>
+        bool has_failed() const { return failed; }
+    };
+
+}
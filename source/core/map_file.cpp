@@ -0,0 +1,478 @@
+#include "map_file.h"
+#include "../tools/parallel.h"
+#include "../tools/run_length.h"
+#include "../tools/stopwatch.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+
+using namespace isometric;
+
+static_assert(std::endian::native == std::endian::little, "Map files are read in place and require a little endian host");
+static_assert(sizeof(map_file::header) == 104);
+static_assert(sizeof(map_file::layer_record) == 24);
+static_assert(sizeof(map_file::image_record) == 40);
+static_assert(sizeof(map_file::chunk_record) == 16);
+
+namespace {
+
+    constexpr size_t flag_plane_words = (tile_chunk::tile_count + tools::dynamic_bitset::bits_per_word - 1) / tools::dynamic_bitset::bits_per_word;
+
+    size_t get_chunk_data_size(size_t layer_count)
+    {
+        return layer_count * tile_chunk::tile_count * sizeof(tile_image_id) + 3 * flag_plane_words * sizeof(tools::dynamic_bitset::word_type);
+    }
+
+    uint64_t align_offset(uint64_t offset)
+    {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    void append_bytes(std::vector<uint8_t>& data, const void* source, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(source);
+        data.insert(data.end(), bytes, bytes + size);
+    }
+
+    /// <summary>
+    /// The data of one chunk as stored in the file, before compression
+    /// </summary>
+    void encode_chunk(const tile_chunk& chunk, std::vector<uint8_t>& data)
+    {
+        const tile_planes& planes = chunk.get_planes();
+
+        data.clear();
+        data.reserve(get_chunk_data_size(planes.layers.size()));
+
+        for (const auto& layer : planes.layers)
+        {
+            append_bytes(data, layer.data(), layer.size() * sizeof(tile_image_id));
+        }
+
+        for (const auto* flags : { &planes.enabled, &planes.passable, &planes.occupied })
+        {
+            append_bytes(data, flags->get_words().data(), flags->get_words().size() * sizeof(tools::dynamic_bitset::word_type));
+        }
+    }
+
+}
+
+bool map_file::validate()
+{
+    const size_t file_size = file.get_size();
+    if (file_size < sizeof(header)) return false;
+
+    std::memcpy(&file_header, file.get_data(), sizeof(header));
+
+    if (file_header.magic != file_magic || file_header.version != file_version || file_header.chunk_size != tile_chunk::size)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' has an unsupported header (version %u, chunk size %u)",
+            path.c_str(), file_header.version, file_header.chunk_size);
+        return false;
+    }
+
+    const uint64_t chunk_count = static_cast<uint64_t>(file_header.chunks_wide) * file_header.chunks_high;
+    const bool sizes_match =
+        file_header.chunks_wide == (file_header.map_width + tile_chunk::size - 1) / tile_chunk::size &&
+        file_header.chunks_high == (file_header.map_height + tile_chunk::size - 1) / tile_chunk::size;
+
+    auto fits = [&](uint64_t offset, uint64_t count, uint64_t element_size)
+    {
+        return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / element_size;
+    };
+
+    if (!sizes_match ||
+        !fits(file_header.layer_table, file_header.layer_count, sizeof(layer_record)) ||
+        !fits(file_header.default_table, file_header.default_image_count, sizeof(uint32_t)) ||
+        !fits(file_header.image_table, file_header.image_count, sizeof(image_record)) ||
+        !fits(file_header.string_table, file_header.string_table_size, 1) ||
+        !fits(file_header.chunk_table, chunk_count, sizeof(chunk_record)))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' is truncated or its tables are corrupt", path.c_str());
+        return false;
+    }
+
+    const uint8_t* data = file.get_data();
+    layer_table = reinterpret_cast<const layer_record*>(data + file_header.layer_table);
+    default_table = reinterpret_cast<const uint32_t*>(data + file_header.default_table);
+    image_table = reinterpret_cast<const image_record*>(data + file_header.image_table);
+    string_table = reinterpret_cast<const char*>(data + file_header.string_table);
+    chunk_table = reinterpret_cast<const chunk_record*>(data + file_header.chunk_table);
+
+    for (uint32_t i = 0; i < file_header.layer_count; i++)
+    {
+        const layer_record& layer = layer_table[i];
+        if (static_cast<uint64_t>(layer.first_default) + layer.default_count > file_header.default_image_count)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' has a corrupt layer table", path.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string_view map_file::get_string(uint32_t offset, uint32_t length) const
+{
+    if (static_cast<uint64_t>(offset) + length > file_header.string_table_size) return std::string_view();
+
+    return std::string_view(string_table + offset, length);
+}
+
+std::shared_ptr<map_file> map_file::open(const std::string& path)
+{
+    std::shared_ptr<map_file> new_file = std::shared_ptr<map_file>(new map_file);
+    new_file->path = path;
+
+    if (!new_file->file.open(path))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to open map file '%s'", path.c_str());
+        return nullptr;
+    }
+
+    if (!new_file->validate()) return nullptr;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Opened map file '%s' [ %u x %u tiles ], %zu bytes",
+        path.c_str(), new_file->file_header.map_width, new_file->file_header.map_height, new_file->file.get_size());
+
+    return new_file;
+}
+
+std::shared_ptr<tile_map> map_file::load(const std::string& path, const texture_lookup_func& find_texture)
+{
+    tools::stopwatch load_stopwatch;
+    load_stopwatch.start();
+
+    auto file = open(path);
+    if (!file) return nullptr;
+
+    auto map = file->create_map(find_texture);
+    const size_t chunk_count = file->load_chunks(*map);
+
+    load_stopwatch.stop();
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loaded map '%s', %zu chunks in %.2f ms", path.c_str(), chunk_count, load_stopwatch.get_elapsed_ms());
+
+    return map;
+}
+
+std::shared_ptr<tile_map> map_file::create_map(const texture_lookup_func& find_texture) const
+{
+    auto map = tile_map::create(file_header.map_width, file_header.map_height, file_header.tile_width, file_header.tile_height);
+
+    for (uint32_t i = 0; i < file_header.layer_count; i++)
+    {
+        const layer_record& layer = layer_table[i];
+        const std::string name(get_string(layer.name_offset, layer.name_length));
+
+        const unsigned layer_id = map->add_layer(name);
+        map->set_layer_static(layer_id, (layer.flags & layer_static) != 0);
+        map->set_layer_optional(layer_id, (layer.flags & layer_optional) != 0);
+
+        for (uint32_t j = 0; j < layer.default_count; j++)
+        {
+            map->add_layer_default_image(name, default_table[layer.first_default + j]);
+        }
+    }
+
+    for (uint32_t i = 0; i < file_header.image_count; i++)
+    {
+        const image_record& record = image_table[i];
+        const std::string texture_name(get_string(record.texture_offset, record.texture_length));
+
+        SDL_Texture* texture = find_texture ? find_texture(texture_name) : nullptr;
+        if (!texture)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' image %u uses texture '%s', which wasn't found",
+                path.c_str(), record.image_id, texture_name.c_str());
+            continue;
+        }
+
+        map->add_image(tile_image::create(
+            std::string(get_string(record.name_offset, record.name_length)), record.image_id, texture,
+            record.source_x, record.source_y, record.source_w, record.source_h));
+    }
+
+    map->set_selection_image(file_header.selection_image);
+    map->set_placeholder_image(file_header.placeholder_image);
+
+    return map;
+}
+
+bool map_file::has_chunk(unsigned chunk_x, unsigned chunk_y) const
+{
+    if (chunk_x >= file_header.chunks_wide || chunk_y >= file_header.chunks_high) return false;
+
+    return chunk_table[chunk_x + static_cast<size_t>(chunk_y) * file_header.chunks_wide].stored_size > 0;
+}
+
+std::unique_ptr<tile_chunk> map_file::read_chunk(unsigned chunk_x, unsigned chunk_y, size_t layer_count) const
+{
+    if (!has_chunk(chunk_x, chunk_y)) return nullptr;
+
+    const chunk_record& record = chunk_table[chunk_x + static_cast<size_t>(chunk_y) * file_header.chunks_wide];
+    const size_t data_size = get_chunk_data_size(record.layer_count);
+
+    if (record.offset > file.get_size() || record.stored_size > file.get_size() - record.offset)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' chunk [ %u, %u ] is outside of the file", path.c_str(), chunk_x, chunk_y);
+        return nullptr;
+    }
+
+    const uint8_t* stored = file.get_data() + record.offset;
+    std::vector<uint8_t> decompressed;
+
+    if (record.compression == chunk_run_length)
+    {
+        decompressed.resize(data_size);
+        if (!tools::run_length_decode(stored, record.stored_size, reinterpret_cast<uint16_t*>(decompressed.data()), data_size / sizeof(uint16_t)))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' chunk [ %u, %u ] failed to decompress", path.c_str(), chunk_x, chunk_y);
+            return nullptr;
+        }
+        stored = decompressed.data();
+    }
+    else if (record.compression != chunk_uncompressed || record.stored_size != data_size)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Map file '%s' chunk [ %u, %u ] has an unsupported encoding", path.c_str(), chunk_x, chunk_y);
+        return nullptr;
+    }
+
+    // Uncompressed data is the planes as they are in memory, so each plane is a single copy out of the mapping:
+    auto chunk = std::make_unique<tile_chunk>(chunk_x, chunk_y, layer_count);
+    tile_planes& planes = chunk->get_planes();
+
+    const size_t layer_bytes = tile_chunk::tile_count * sizeof(tile_image_id);
+    for (size_t layer_id = 0; layer_id < std::min<size_t>(record.layer_count, planes.layers.size()); layer_id++)
+    {
+        std::memcpy(planes.layers[layer_id].data(), stored + layer_id * layer_bytes, layer_bytes);
+    }
+
+    const uint8_t* flags = stored + record.layer_count * layer_bytes;
+    for (auto* plane : { &planes.enabled, &planes.passable, &planes.occupied })
+    {
+        const size_t flag_bytes = plane->get_words().size() * sizeof(tools::dynamic_bitset::word_type);
+        std::memcpy(plane->get_words().data(), flags, flag_bytes);
+        flags += flag_bytes;
+    }
+
+    return chunk;
+}
+
+size_t map_file::load_chunks(tile_map& map) const
+{
+    const size_t chunk_count = static_cast<size_t>(file_header.chunks_wide) * file_header.chunks_high;
+    const size_t layer_count = map.get_layers().size();
+
+    std::vector<std::unique_ptr<tile_chunk>> loaded(chunk_count);
+    tools::parallel_for(chunk_count, [&](size_t chunk_index)
+    {
+        loaded[chunk_index] = read_chunk(
+            static_cast<unsigned>(chunk_index % file_header.chunks_wide),
+            static_cast<unsigned>(chunk_index / file_header.chunks_wide),
+            layer_count);
+    }, 16);
+
+    size_t installed = 0;
+    for (auto& chunk : loaded)
+    {
+        if (chunk && map.install_chunk(std::move(chunk))) installed++;
+    }
+
+    return installed;
+}
+
+bool map_file::save(const tile_map& map, const std::string& path, const texture_name_func& get_texture_name, bool compress_chunks)
+{
+    header file_header{};
+    file_header.magic = file_magic;
+    file_header.version = file_version;
+    file_header.map_width = map.get_map_width();
+    file_header.map_height = map.get_map_height();
+    file_header.tile_width = map.get_tile_width();
+    file_header.tile_height = map.get_tile_height();
+    file_header.chunk_size = tile_chunk::size;
+    file_header.chunks_wide = map.get_chunks_wide();
+    file_header.chunks_high = map.get_chunks_high();
+    file_header.selection_image = map.get_selection_image_id();
+    file_header.placeholder_image = map.get_placeholder_image_id();
+
+    std::string strings;
+    auto add_string = [&](const std::string& value, uint32_t& offset, uint32_t& length)
+    {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings += value;
+    };
+
+    std::vector<layer_record> layers;
+    std::vector<uint32_t> defaults;
+    for (unsigned layer_id = 0; layer_id < map.get_layers().size(); layer_id++)
+    {
+        const std::string& name = map.get_layer_name(layer_id);
+
+        layer_record layer{};
+        add_string(name, layer.name_offset, layer.name_length);
+        layer.flags = (map.is_layer_static(layer_id) ? layer_static : 0) | (map.is_layer_optional(layer_id) ? layer_optional : 0);
+        layer.first_default = static_cast<uint32_t>(defaults.size());
+
+        if (map.layer_has_default_images(name))
+        {
+            for (unsigned image_id : map.get_layer_default_images(name)) defaults.push_back(image_id);
+        }
+
+        layer.default_count = static_cast<uint32_t>(defaults.size()) - layer.first_default;
+        layers.push_back(layer);
+    }
+
+    std::vector<image_record> images;
+    std::unordered_map<SDL_Texture*, std::string> texture_names;
+    for (unsigned image_id = 0; image_id < map.get_image_count(); image_id++)
+    {
+        const tile_image* image = map.get_image(image_id);
+        if (!image) continue;
+
+        auto texture_name = texture_names.find(image->get_texture());
+        if (texture_name == texture_names.end())
+        {
+            texture_name = texture_names.emplace(image->get_texture(), get_texture_name ? get_texture_name(image->get_texture()) : std::string()).first;
+        }
+
+        image_record record{};
+        record.image_id = image_id;
+        add_string(image->get_name(), record.name_offset, record.name_length);
+        add_string(texture_name->second, record.texture_offset, record.texture_length);
+        record.source_x = image->get_source_x();
+        record.source_y = image->get_source_y();
+        record.source_w = image->get_source_w();
+        record.source_h = image->get_source_h();
+        images.push_back(record);
+    }
+
+    file_header.layer_count = static_cast<uint32_t>(layers.size());
+    file_header.default_image_count = static_cast<uint32_t>(defaults.size());
+    file_header.image_count = static_cast<uint32_t>(images.size());
+    file_header.string_table_size = strings.size();
+
+    // Encode (and compress) every allocated chunk in parallel, then lay them out in chunk order:
+    const size_t chunk_count = static_cast<size_t>(file_header.chunks_wide) * file_header.chunks_high;
+    std::vector<std::vector<uint8_t>> chunk_data(chunk_count);
+    std::vector<chunk_record> chunks(chunk_count, chunk_record{});
+
+    tools::parallel_for(chunk_count, [&](size_t chunk_index)
+    {
+        const tile_chunk* chunk = map.find_chunk(
+            static_cast<unsigned>(chunk_index % file_header.chunks_wide),
+            static_cast<unsigned>(chunk_index / file_header.chunks_wide));
+        if (!chunk) return;
+
+        std::vector<uint8_t>& data = chunk_data[chunk_index];
+        encode_chunk(*chunk, data);
+
+        chunks[chunk_index].layer_count = static_cast<uint16_t>(chunk->get_planes().layers.size());
+        chunks[chunk_index].compression = chunk_uncompressed;
+
+        if (compress_chunks)
+        {
+            std::vector<uint16_t> encoded;
+            tools::run_length_encode(reinterpret_cast<const uint16_t*>(data.data()), data.size() / sizeof(uint16_t), encoded);
+
+            // Chunks that don't compress (noisy ones) are stored as they are so they can still be read in place:
+            if (encoded.size() * sizeof(uint16_t) < data.size())
+            {
+                data.assign(reinterpret_cast<const uint8_t*>(encoded.data()), reinterpret_cast<const uint8_t*>(encoded.data() + encoded.size()));
+                chunks[chunk_index].compression = chunk_run_length;
+            }
+        }
+
+        chunks[chunk_index].stored_size = static_cast<uint32_t>(data.size());
+    }, 16);
+
+    uint64_t offset = align_offset(sizeof(header));
+    file_header.layer_table = offset;
+    offset = align_offset(offset + layers.size() * sizeof(layer_record));
+    file_header.default_table = offset;
+    offset = align_offset(offset + defaults.size() * sizeof(uint32_t));
+    file_header.image_table = offset;
+    offset = align_offset(offset + images.size() * sizeof(image_record));
+    file_header.string_table = offset;
+    offset = align_offset(offset + strings.size());
+    file_header.chunk_table = offset;
+    offset = align_offset(offset + chunks.size() * sizeof(chunk_record));
+
+    for (size_t chunk_index = 0; chunk_index < chunk_count; chunk_index++)
+    {
+        if (chunks[chunk_index].stored_size == 0) continue;
+
+        chunks[chunk_index].offset = offset;
+        offset = align_offset(offset + chunks[chunk_index].stored_size);
+    }
+
+    const std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create map file '%s'", temporary_path.c_str());
+            return false;
+        }
+
+        uint64_t written = 0;
+        auto write = [&](uint64_t at, const void* data, size_t size)
+        {
+            static const char padding[8]{};
+            stream.write(padding, static_cast<std::streamsize>(at - written));
+            stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written = at + size;
+        };
+
+        write(0, &file_header, sizeof(header));
+        write(file_header.layer_table, layers.data(), layers.size() * sizeof(layer_record));
+        write(file_header.default_table, defaults.data(), defaults.size() * sizeof(uint32_t));
+        write(file_header.image_table, images.data(), images.size() * sizeof(image_record));
+        write(file_header.string_table, strings.data(), strings.size());
+        write(file_header.chunk_table, chunks.data(), chunks.size() * sizeof(chunk_record));
+
+        for (size_t chunk_index = 0; chunk_index < chunk_count; chunk_index++)
+        {
+            if (chunks[chunk_index].stored_size > 0) write(chunks[chunk_index].offset, chunk_data[chunk_index].data(), chunk_data[chunk_index].size());
+        }
+
+        if (!stream)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write map file '%s'", temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace map file '%s': %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Saved map '%s', %llu bytes", path.c_str(), static_cast<unsigned long long>(offset));
+    return true;
+}
+
+map_file_source::map_file_source(std::shared_ptr<map_file> file)
+    : file(file)
+{
+
+}
+
+std::unique_ptr<tile_chunk> map_file_source::load(unsigned chunk_x, unsigned chunk_y, size_t layer_count)
+{
+    return file ? file->read_chunk(chunk_x, chunk_y, layer_count) : nullptr;
+}
+
+bool map_file_source::save(const tile_chunk& chunk)
+{
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Chunk [ %u, %u ] wasn't saved, map files are read only while streaming",
+        chunk.get_chunk_x(), chunk.get_chunk_y());
+    return false;
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstdint>
+#include "tile_map.h"
+#include "chunk_source.h"
+#include "../tools/memory_mapped_file.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// A tile_map stored in a single binary file, read through a memory mapping.
+    /// </summary>
+    /// <remarks>
+    /// The layout, all little endian and 8 byte aligned:
+    ///   header        - magic "IMAP", version, map and tile sizes and the offset of every table below
+    ///   layer table   - one record per layer: name, static flag and its range in the default image table
+    ///   default table - uint32 image ids, the default images of every layer back to back
+    ///   image table   - one record per image: id, name, texture name and source rectangle
+    ///   string table  - names referenced by the layer and image tables, not null terminated
+    ///   chunk table   - one record per chunk (chunks_wide * chunks_high, row major): offset, size and compression
+    ///   chunk data    - each allocated chunk's planes: every layer's image ids, then the enabled, passable and
+    ///                   occupied bit words. Unallocated chunks have no data.
+    /// Uncompressed chunk data has exactly the layout of tile_planes, so loading a chunk is one copy per plane
+    /// straight out of the mapping. Compressed chunks are run length encoded in 16 bit units.
+    /// </remarks>
+    class map_file
+    {
+    public:
+        /// <summary>
+        /// Maps a texture to the name stored in the image table, so it can be found again when loading
+        /// </summary>
+        using texture_name_func = std::function<std::string(SDL_Texture*)>;
+
+        /// <summary>
+        /// Finds the texture for a name stored in the image table, returning nullptr if there isn't one
+        /// </summary>
+        using texture_lookup_func = std::function<SDL_Texture*(const std::string&)>;
+
+        static constexpr uint32_t file_magic = 0x50414D49; // "IMAP"
+        static constexpr uint16_t file_version = 1;
+
+        struct header
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t flags;
+            uint32_t map_width;
+            uint32_t map_height;
+            uint32_t tile_width;
+            uint32_t tile_height;
+            uint32_t chunk_size;
+            uint32_t chunks_wide;
+            uint32_t chunks_high;
+            uint32_t layer_count;
+            uint32_t image_count;
+            uint32_t default_image_count;
+            uint32_t selection_image;
+            uint32_t placeholder_image;
+            uint64_t layer_table;
+            uint64_t default_table;
+            uint64_t image_table;
+            uint64_t string_table;
+            uint64_t string_table_size;
+            uint64_t chunk_table;
+        };
+
+        struct layer_record
+        {
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t flags;             // layer_static, layer_optional
+            uint32_t first_default;
+            uint32_t default_count;
+            uint32_t reserved;
+        };
+
+        struct image_record
+        {
+            uint32_t image_id;
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t texture_offset;
+            uint32_t texture_length;
+            uint32_t source_x;
+            uint32_t source_y;
+            uint32_t source_w;
+            uint32_t source_h;
+            uint32_t reserved;
+        };
+
+        struct chunk_record
+        {
+            uint64_t offset;
+            uint32_t stored_size;       // 0 when the chunk isn't allocated
+            uint16_t compression;       // chunk_uncompressed or chunk_run_length
+            uint16_t layer_count;
+        };
+
+        static constexpr uint32_t layer_static = 1;
+        static constexpr uint32_t layer_optional = 2;
+        static constexpr uint16_t chunk_uncompressed = 0;
+        static constexpr uint16_t chunk_run_length = 1;
+
+    private:
+        tools::memory_mapped_file file;
+        std::string path;
+        header file_header{};
+
+        const layer_record* layer_table = nullptr;
+        const uint32_t* default_table = nullptr;
+        const image_record* image_table = nullptr;
+        const char* string_table = nullptr;
+        const chunk_record* chunk_table = nullptr;
+
+        map_file() {}
+
+        bool validate();
+        std::string_view get_string(uint32_t offset, uint32_t length) const;
+
+    public:
+        /// <summary>
+        /// Map a map file and check its header and tables, chunk data isn't read until it's needed
+        /// </summary>
+        /// <returns>The map file, or nullptr if it doesn't exist or isn't a valid map file</returns>
+        static std::shared_ptr<map_file> open(const std::string& path);
+
+        /// <summary>
+        /// Write a map, with every allocated chunk, to path. The file is written next to path first and then
+        /// moved over it, so an existing file is never left half written.
+        /// </summary>
+        /// <param name="get_texture_name">Names the texture of every image, see texture_name_func</param>
+        /// <param name="compress_chunks">Run length encode chunks that get smaller doing so, for cold storage</param>
+        /// <returns>False if the file couldn't be written</returns>
+        static bool save(const tile_map& map, const std::string& path, const texture_name_func& get_texture_name, bool compress_chunks = false);
+
+        /// <summary>
+        /// Open a map file and load all of it, equivalent to open, create_map and load_chunks
+        /// </summary>
+        /// <returns>The map, or nullptr if the file couldn't be opened</returns>
+        static std::shared_ptr<tile_map> load(const std::string& path, const texture_lookup_func& find_texture);
+
+        /// <summary>
+        /// Create a map with the file's size, layers and images, but without any chunks. Chunks can then be loaded
+        /// all at once with load_chunks or streamed in through a map_file_source.
+        /// </summary>
+        std::shared_ptr<tile_map> create_map(const texture_lookup_func& find_texture) const;
+
+        /// <summary>
+        /// Read every chunk stored in the file, in parallel, and install the ones the map doesn't have yet
+        /// </summary>
+        /// <returns>The number of chunks installed</returns>
+        size_t load_chunks(tile_map& map) const;
+
+        /// <returns>True if the file has data for the chunk</returns>
+        bool has_chunk(unsigned chunk_x, unsigned chunk_y) const;
+
+        /// <summary>
+        /// Read one chunk from the mapping, safe to call from several threads at once
+        /// </summary>
+        /// <returns>The chunk, or nullptr if the file has no data for it or its data is corrupt</returns>
+        std::unique_ptr<tile_chunk> read_chunk(unsigned chunk_x, unsigned chunk_y, size_t layer_count) const;
+
+        const std::string& get_path() const { return path; }
+        const header& get_header() const { return file_header; }
+    };
+
+    /// <summary>
+    /// Streams chunks out of a map_file for chunk_streamer. Map files are written whole, so this source is read
+    /// only: save() fails and changes to evicted chunks are lost unless the map is saved before they're evicted.
+    /// </summary>
+    class map_file_source : public chunk_source
+    {
+    private:
+        std::shared_ptr<map_file> file;
+
+    public:
+        explicit map_file_source(std::shared_ptr<map_file> file);
+
+        std::unique_ptr<tile_chunk> load(unsigned chunk_x, unsigned chunk_y, size_t layer_count) override;
+        bool save(const tile_chunk& chunk) override;
+    };
+
+}
@@ -4,6 +4,7 @@
 using namespace::isometric;
 
 size_t module::module_count = 0;
+std::atomic<size_t> module::dependency_revision = 0;
 
 module::module()
 {
@@ -29,4 +30,28 @@ bool module::set_enabled(bool enable)
     enabled = enable;
 
     return original_enabled_value;
-}
\ No newline at end of file
+}
+
+void module::add_dependency(std::shared_ptr<module> dependency)
+{
+    if (!dependency || dependency.get() == this) return;
+
+    remove_dependency(dependency);
+    dependencies.push_back(dependency);
+    dependency_revision++;
+}
+
+void module::remove_dependency(std::shared_ptr<module> dependency)
+{
+    std::erase_if(dependencies, [&](const std::weak_ptr<module>& existing)
+    {
+        auto locked = existing.lock();
+        return !locked || locked == dependency;
+    });
+    dependency_revision++;
+}
+
+void module::set_concurrent_update(bool concurrent)
+{
+    concurrent_update = concurrent;
+}
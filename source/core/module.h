@@ -3,11 +3,24 @@
 #include <string>
 #include <memory>
 #include <type_traits>
+#include <vector>
+#include <atomic>
+#include "../enumerations/module_phase.h"
 
 namespace isometric {
 
     class application;
 
+    /// <summary>
+    /// How long a module's hooks took the last time they ran, collected when application module timing is enabled
+    /// </summary>
+    struct module_timing
+    {
+        double update_ms = 0.0;
+        double late_update_ms = 0.0;
+        double fixed_update_ms = 0.0;
+    };
+
     class module
     {
         friend application;
@@ -16,6 +29,14 @@ namespace isometric {
         static size_t module_count;
         std::string name;
         bool enabled = true;
+        bool concurrent_update = false;
+        std::vector<std::weak_ptr<module>> dependencies;
+        module_phase phases = module_phase::all;    // Hooks the module overrides, found by create()
+        module_timing timing;
+
+        static std::atomic<size_t> dependency_revision; // Changed whenever any module's dependencies change
+
+        template<class T> static module_phase find_overridden_phases();
 
     public:
         virtual ~module();
@@ -26,6 +47,25 @@ namespace isometric {
         bool is_enabled() const { return enabled; }
         bool set_enabled(bool enable = true);
 
+        /// <summary>
+        /// Make this module's on_update run after another module's on_update. Modules that don't depend on each
+        /// other (directly or indirectly) may update at the same time when both allow concurrent updates.
+        /// </summary>
+        void add_dependency(std::shared_ptr<module> dependency);
+        void remove_dependency(std::shared_ptr<module> dependency);
+
+        /// <summary>
+        /// Allow on_update to run on a job system worker instead of the main thread. on_late_update and
+        /// on_fixed_update always run on the main thread, so anything that renders belongs there.
+        /// </summary>
+        void set_concurrent_update(bool concurrent = true);
+        bool is_concurrent_update() const { return concurrent_update; }
+
+        /// <returns>True if the application calls this phase's hook, modules that don't override a hook are skipped</returns>
+        bool has_phase(module_phase phase) const { return (phases & phase) != module_phase::none; }
+
+        const module_timing& get_timing() const { return timing; }
+
     protected:
         module();
 
@@ -37,6 +77,23 @@ namespace isometric {
         virtual void on_fixed_update(double fixed_delta_time) {}
     };
 
+    template<class T>
+    inline module_phase module::find_overridden_phases()
+    {
+        // A hook that isn't overridden is found as module's own, with a module member pointer type. Overrides, or
+        // hooks that can't be inspected from here, count as implemented:
+        constexpr bool inherits_update = requires { requires std::is_same_v<decltype(&T::on_update), void (module::*)(double)>; };
+        constexpr bool inherits_late_update = requires { requires std::is_same_v<decltype(&T::on_late_update), void (module::*)(double)>; };
+        constexpr bool inherits_fixed_update = requires { requires std::is_same_v<decltype(&T::on_fixed_update), void (module::*)(double)>; };
+
+        module_phase found = module_phase::none;
+        if (!inherits_update) found = found | module_phase::update;
+        if (!inherits_late_update) found = found | module_phase::late_update;
+        if (!inherits_fixed_update) found = found | module_phase::fixed_update;
+
+        return found;
+    }
+
     template<class T>
     static std::shared_ptr<T> module::create(const std::string& name, bool enabled)
     {
@@ -46,6 +103,7 @@ namespace isometric {
             module_count++;
             new_module->enabled = true;
             new_module->name = name.empty() ? "Unnamed Module " + std::to_string(module_count) : name;
+            new_module->phases = find_overridden_phases<T>();
 
             SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Module [%s] created", new_module->name.c_str());
 
@@ -0,0 +1,106 @@
+#include "object_grid.h"
+
+using namespace isometric;
+
+object_grid::object_grid(unsigned map_width, unsigned map_height, unsigned cell_size)
+    : cell_size(std::max(cell_size, 1U))
+{
+    cells_wide = std::max(1U, (map_width + this->cell_size - 1) / this->cell_size);
+    cells_high = std::max(1U, (map_height + this->cell_size - 1) / this->cell_size);
+    cells.resize(static_cast<size_t>(cells_wide) * cells_high + 1);
+}
+
+object_grid::~object_grid()
+{
+    clear();
+}
+
+size_t object_grid::get_cell_index(const game_object& obj) const
+{
+    if (!obj.has_position()) return get_unpositioned_cell();
+
+    // Objects off the map are kept in the nearest edge cell:
+    const SDL_FPoint& position = obj.get_position();
+    const long long cell_x = std::clamp(static_cast<long long>(std::floor(position.x / cell_size)), 0LL, cells_wide - 1LL);
+    const long long cell_y = std::clamp(static_cast<long long>(std::floor(position.y / cell_size)), 0LL, cells_high - 1LL);
+
+    return static_cast<size_t>(cell_x + cell_y * cells_wide);
+}
+
+void object_grid::insert_into_cell(std::shared_ptr<game_object> obj, size_t cell_index)
+{
+    auto& cell = cells[cell_index];
+
+    obj->grid_cell = cell_index;
+    obj->grid_slot = cell.size();
+    cell.push_back(std::move(obj));
+}
+
+std::shared_ptr<game_object> object_grid::remove_from_cell(game_object& obj)
+{
+    auto& cell = cells[obj.grid_cell];
+
+    std::shared_ptr<game_object> removed = std::move(cell[obj.grid_slot]);
+    if (obj.grid_slot != cell.size() - 1)
+    {
+        cell[obj.grid_slot] = std::move(cell.back());
+        cell[obj.grid_slot]->grid_slot = obj.grid_slot;
+    }
+    cell.pop_back();
+
+    return removed;
+}
+
+bool object_grid::insert(std::shared_ptr<game_object> obj)
+{
+    if (!obj || obj->grid) return false;
+
+    obj->grid = this;
+    const size_t cell_index = get_cell_index(*obj);
+    insert_into_cell(std::move(obj), cell_index);
+    object_count++;
+    revision++;
+
+    return true;
+}
+
+bool object_grid::remove(game_object& obj)
+{
+    if (obj.grid != this) return false;
+
+    // Keep the object alive until its bookkeeping is reset, the grid may hold the last reference:
+    std::shared_ptr<game_object> removed = remove_from_cell(obj);
+    obj.grid = nullptr;
+    object_count--;
+    revision++;
+
+    return true;
+}
+
+void object_grid::update(game_object& obj)
+{
+    if (obj.grid != this) return;
+    revision++;
+
+    const size_t cell_index = get_cell_index(obj);
+    if (cell_index == obj.grid_cell) return;
+
+    insert_into_cell(remove_from_cell(obj), cell_index);
+}
+
+void object_grid::clear()
+{
+    for (auto& cell : cells)
+    {
+        for (auto& obj : cell) obj->grid = nullptr;
+        cell.clear();
+    }
+
+    object_count = 0;
+    revision++;
+}
+
+bool object_grid::contains(const game_object& obj) const
+{
+    return obj.grid == this;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "tile_span.h"
+
+namespace isometric {
+
+    class game_object;
+
+    /// <summary>
+    /// A uniform grid over the map that buckets game objects by their tile position. Inserting, moving and removing
+    /// an object is O(1): objects remember their cell and slot, and cells are unordered so removal swaps the last
+    /// object into the hole. Objects without a position are kept in a separate bucket and match every query.
+    /// </summary>
+    /// <remarks>
+    /// Not thread safe, objects in a grid must only be added, moved or removed by one thread at a time, and never
+    /// from inside one of the for_each queries.
+    /// </remarks>
+    class object_grid
+    {
+    private:
+        unsigned cell_size = 8;     // by tiles
+        unsigned cells_wide = 0;
+        unsigned cells_high = 0;
+        std::vector<std::vector<std::shared_ptr<game_object>>> cells;   // Row major, the last cell holds unpositioned objects
+        size_t object_count = 0;
+        uint64_t revision = 0;      // Incremented whenever an object is added, moved or removed
+
+        size_t get_cell_index(const game_object& obj) const;
+        size_t get_unpositioned_cell() const { return cells.size() - 1; }
+        void insert_into_cell(std::shared_ptr<game_object> obj, size_t cell_index);
+        std::shared_ptr<game_object> remove_from_cell(game_object& obj);
+
+    public:
+        /// <param name="map_width">The map width in tiles</param>
+        /// <param name="map_height">The map height in tiles</param>
+        /// <param name="cell_size">The width and height of a cell in tiles</param>
+        object_grid(unsigned map_width, unsigned map_height, unsigned cell_size = 8);
+        ~object_grid();
+
+        object_grid(const object_grid&) = delete;
+        object_grid& operator=(const object_grid&) = delete;
+
+        /// <returns>False if the object is null or already in a grid</returns>
+        bool insert(std::shared_ptr<game_object> obj);
+
+        /// <returns>False if the object isn't in this grid</returns>
+        bool remove(game_object& obj);
+
+        /// <summary>
+        /// Move an object to the cell of its current position, called by game_object::set_position
+        /// </summary>
+        void update(game_object& obj);
+
+        void clear();
+
+        bool contains(const game_object& obj) const;
+        size_t size() const { return object_count; }
+        unsigned get_cell_size() const { return cell_size; }
+
+        /// <returns>Changes whenever an object is added, moved or removed, compare it to notice changes</returns>
+        uint64_t get_revision() const { return revision; }
+
+        /// <summary>
+        /// Call func(const std::shared_ptr&lt;game_object&gt;&amp;) for every object in a cell overlapping the
+        /// tile rectangle, expanded by margin tiles in every direction, and every unpositioned object. Objects near
+        /// the rectangle's edge may be outside of it, callers that need an exact answer test positions themselves.
+        /// </summary>
+        template<class F> void for_each_in_rect(const SDL_FRect& tile_rect, float margin, F&& func) const;
+
+        /// <summary>
+        /// Same as for_each_in_rect for the cells overlapping every row of a tile_span
+        /// </summary>
+        template<class F> void for_each_in_span(const tile_span& span, float margin, F&& func) const;
+
+        /// <summary>
+        /// Call func for every positioned object within radius of center, distances are in tiles with rows half a
+        /// tile apart. Unlike the rectangle queries this is exact and skips unpositioned objects.
+        /// </summary>
+        template<class F> void for_each_in_radius(const SDL_FPoint& center, float radius, F&& func) const;
+
+        /// <summary>
+        /// Call func for every object, in no particular order
+        /// </summary>
+        template<class F> void for_each(F&& func) const;
+    };
+
+}
+
+#include "game_object.h"
+
+namespace isometric {
+
+    template<class F>
+    inline void object_grid::for_each_in_rect(const SDL_FRect& tile_rect, float margin, F&& func) const
+    {
+        const int first_x = std::max(0, static_cast<int>(std::floor((tile_rect.x - margin) / cell_size)));
+        const int first_y = std::max(0, static_cast<int>(std::floor((tile_rect.y - margin) / cell_size)));
+        const int last_x = std::min(static_cast<int>(cells_wide) - 1, static_cast<int>(std::floor((tile_rect.x + tile_rect.w + margin) / cell_size)));
+        const int last_y = std::min(static_cast<int>(cells_high) - 1, static_cast<int>(std::floor((tile_rect.y + tile_rect.h + margin) / cell_size)));
+
+        for (int cell_y = first_y; cell_y <= last_y; cell_y++)
+        {
+            for (int cell_x = first_x; cell_x <= last_x; cell_x++)
+            {
+                for (const auto& obj : cells[cell_x + static_cast<size_t>(cell_y) * cells_wide]) func(obj);
+            }
+        }
+
+        for (const auto& obj : cells[get_unpositioned_cell()]) func(obj);
+    }
+
+    template<class F>
+    inline void object_grid::for_each_in_span(const tile_span& span, float margin, F&& func) const
+    {
+        if (span.is_empty())
+        {
+            for (const auto& obj : cells[get_unpositioned_cell()]) func(obj);
+            return;
+        }
+
+        const int x_begin = std::min(span.x_begin[0], span.x_begin[1]);
+        const int x_end = std::max(span.x_end[0], span.x_end[1]);
+
+        for_each_in_rect(SDL_FRect{
+            static_cast<float>(x_begin), static_cast<float>(span.y_begin),
+            static_cast<float>(x_end - x_begin), static_cast<float>(span.y_end - span.y_begin) }, margin, func);
+    }
+
+    template<class F>
+    inline void object_grid::for_each_in_radius(const SDL_FPoint& center, float radius, F&& func) const
+    {
+        // Rows are half a tile apart, so the radius covers twice as many rows as columns:
+        const SDL_FRect bounds{ center.x - radius, center.y - radius * 2, radius * 2, radius * 4 };
+        const float radius_squared = radius * radius;
+
+        auto test = [&](const std::shared_ptr<game_object>& obj)
+        {
+            if (!obj->has_position()) return;
+
+            const float dx = obj->get_position().x - center.x;
+            const float dy = (obj->get_position().y - center.y) * 0.5f;
+            if (dx * dx + dy * dy <= radius_squared) func(obj);
+        };
+
+        for_each_in_rect(bounds, 0, test);
+    }
+
+    template<class F>
+    inline void object_grid::for_each(F&& func) const
+    {
+        for (const auto& cell : cells)
+        {
+            for (const auto& obj : cell) func(obj);
+        }
+    }
+
+}
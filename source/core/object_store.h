@@ -0,0 +1,185 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <vector>
+#include <span>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "transform.h"
+#include "tile_span.h"
+#include "../tools/slot_map.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// A handle to an object of type T in an object_store, see tools::slot_handle
+    /// </summary>
+    template<class T>
+    struct object_handle : tools::slot_handle
+    {
+        object_handle() {}
+        explicit object_handle(const tools::slot_handle& handle) : tools::slot_handle(handle) {}
+    };
+
+    /// <summary>
+    /// Draws every object of one type in a single call. The objects are packed, so a renderer can cull and draw
+    /// them in one linear pass. The transform is the world's, shared by every batch.
+    /// </summary>
+    template<class T>
+    using object_batch_renderer = std::function<void(SDL_Renderer* renderer, const transform& transform,
+        const tile_span& visible_span, std::span<const T> objects, double delta_time)>;
+
+    class object_batch_base
+    {
+    public:
+        virtual ~object_batch_base() {}
+
+        virtual void render(SDL_Renderer* renderer, const transform& transform, const tile_span& visible_span, double delta_time) const = 0;
+        virtual size_t size() const = 0;
+        virtual void clear() = 0;
+    };
+
+    /// <summary>
+    /// The objects of one type, stored contiguously by value
+    /// </summary>
+    template<class T>
+    class object_batch : public object_batch_base
+    {
+    private:
+        tools::slot_map<T> objects;
+        object_batch_renderer<T> renderer;
+
+    public:
+        tools::slot_map<T>& get_objects() { return objects; }
+        const tools::slot_map<T>& get_objects() const { return objects; }
+
+        void set_renderer(object_batch_renderer<T> batch_renderer) { renderer = std::move(batch_renderer); }
+
+        void render(SDL_Renderer* sdl_renderer, const transform& transform, const tile_span& visible_span, double delta_time) const override
+        {
+            if (renderer && !objects.empty()) renderer(sdl_renderer, transform, visible_span, objects.get_values(), delta_time);
+        }
+
+        size_t size() const override { return objects.size(); }
+        void clear() override { objects.clear(); }
+    };
+
+    /// <summary>
+    /// Pooled storage for plain object types. Each type gets its own contiguous batch, objects are referred to by
+    /// handles rather than shared_ptrs, and each batch is drawn by one object_batch_renderer. Use this for large
+    /// numbers of simple objects; game_object remains the way to add objects with their own behaviour.
+    /// </summary>
+    /// <remarks>
+    /// Batches are drawn after tiles and game objects, in the order their types were first used. Objects in a
+    /// batch aren't interleaved with tile rows by world's depth sorting.
+    /// </remarks>
+    class object_store
+    {
+    private:
+        std::vector<std::unique_ptr<object_batch_base>> batches;    // By type id, null for types never used
+        std::vector<object_batch_base*> batch_order;                // In the order types were first used
+        uint64_t revision = 0;                                      // See get_revision
+
+        static size_t next_type_id()
+        {
+            static std::atomic<size_t> counter = 0;
+            return counter++;
+        }
+
+        template<class T>
+        static size_t get_type_id()
+        {
+            static const size_t id = next_type_id();
+            return id;
+        }
+
+    public:
+        object_store() {}
+
+        object_store(const object_store&) = delete;
+        object_store& operator=(const object_store&) = delete;
+
+        /// <returns>The batch holding every object of type T, created the first time it's used</returns>
+        template<class T>
+        object_batch<T>& get_batch()
+        {
+            const size_t type_id = get_type_id<T>();
+            if (type_id >= batches.size()) batches.resize(type_id + 1);
+
+            if (!batches[type_id])
+            {
+                batches[type_id] = std::make_unique<object_batch<T>>();
+                batch_order.push_back(batches[type_id].get());
+            }
+
+            return static_cast<object_batch<T>&>(*batches[type_id]);
+        }
+
+        template<class T>
+        object_handle<T> create(T object)
+        {
+            revision++;
+            return object_handle<T>(get_batch<T>().get_objects().insert(std::move(object)));
+        }
+
+        /// <returns>False if the handle doesn't refer to an object</returns>
+        template<class T>
+        bool destroy(const object_handle<T>& handle)
+        {
+            const bool removed = get_batch<T>().get_objects().remove(handle);
+            if (removed) revision++;
+            return removed;
+        }
+
+        /// <returns>The object, or nullptr if it has been destroyed. Invalidated by create and destroy.</returns>
+        template<class T>
+        T* get(const object_handle<T>& handle)
+        {
+            return get_batch<T>().get_objects().get(handle);
+        }
+
+        /// <returns>Every object of type T, packed and in no particular order</returns>
+        template<class T>
+        std::span<T> get_objects()
+        {
+            return get_batch<T>().get_objects().get_values();
+        }
+
+        template<class T>
+        void set_renderer(object_batch_renderer<T> renderer)
+        {
+            revision++;
+            get_batch<T>().set_renderer(std::move(renderer));
+        }
+
+        /// <summary>
+        /// Draw every batch with its renderer
+        /// </summary>
+        void render(SDL_Renderer* renderer, const transform& transform, const tile_span& visible_span, double delta_time) const
+        {
+            for (const auto* batch : batch_order) batch->render(renderer, transform, visible_span, delta_time);
+        }
+
+        /// <returns>The number of objects of every type</returns>
+        size_t size() const
+        {
+            size_t count = 0;
+            for (const auto* batch : batch_order) count += batch->size();
+            return count;
+        }
+
+        void clear()
+        {
+            revision++;
+            for (auto* batch : batch_order) batch->clear();
+        }
+
+        /// <summary>
+        /// Changes whenever objects are created or destroyed or a renderer is set. Changes made to objects through
+        /// get or get_objects aren't seen, so anything relying on this (like world's frame reuse) must be told.
+        /// </summary>
+        uint64_t get_revision() const { return revision; }
+    };
+
+}
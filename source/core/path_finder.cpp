@@ -0,0 +1,1244 @@
+#include "path_finder.h"
+#include "tile_geometry.h"
+#include "../tools/parallel.h"
+#include "../tools/profiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+using namespace isometric;
+
+namespace isometric {
+
+    struct navigation_edge
+    {
+        uint32_t node;      // Index of the target among the nodes of the same chunk
+        float cost;
+    };
+
+    // An entrance into a chunk: a tile on its border and the tile of the adjacent chunk it steps to
+    struct navigation_node
+    {
+        SDL_Point tile;
+        SDL_Point across;
+        float across_cost = 1.0f;
+        std::vector<navigation_edge> edges;     // Through the chunk to its other nodes
+    };
+
+    struct navigation_chunk
+    {
+        std::array<uint64_t, tile_chunk::tile_count / 64> passable{};
+
+        // Nodes by the side of the adjacent chunk they lead to, see side_offsets. Node i of a side steps to node i of
+        // the opposite side of the adjacent chunk, so rebuilding one pair of chunks doesn't renumber any other side.
+        std::array<std::vector<navigation_node>, 8> sides;
+        std::array<uint32_t, 9> side_base{};    // Index of the first node of every side among all of the chunk's nodes
+
+        uint32_t get_node_count() const { return side_base[8]; }
+
+        const navigation_node& get_node(uint32_t index) const
+        {
+            int side = 0;
+            while (index >= side_base[side + 1]) side++;
+            return sides[side][index - side_base[side]];
+        }
+
+        navigation_node& get_node(uint32_t index)
+        {
+            return const_cast<navigation_node&>(static_cast<const navigation_chunk&>(*this).get_node(index));
+        }
+    };
+
+    struct navigation_snapshot
+    {
+        int map_width = 0;
+        int map_height = 0;
+        int chunks_wide = 0;
+        int chunks_high = 0;
+        std::vector<std::shared_ptr<const navigation_chunk>> chunks;   // nullptr for chunks that aren't resident
+        std::vector<uint32_t> node_base;                            // Index of the first node of every chunk
+        uint32_t node_count = 0;
+
+        bool is_passable(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= map_width || y >= map_height) return false;
+
+            constexpr int size = static_cast<int>(tile_chunk::size);
+            const auto& chunk = chunks[x / size + static_cast<size_t>(y / size) * chunks_wide];
+            if (!chunk) return false;
+
+            const size_t index = tile_chunk::local_index(x % size, y % size);
+            return (chunk->passable[index / 64] >> (index % 64)) & 1;
+        }
+
+        size_t get_chunk_index(const SDL_Point& tile) const
+        {
+            constexpr int size = static_cast<int>(tile_chunk::size);
+            return tile.x / size + static_cast<size_t>(tile.y / size) * chunks_wide;
+        }
+
+        SDL_Rect get_chunk_rect(size_t chunk_index) const
+        {
+            constexpr int size = static_cast<int>(tile_chunk::size);
+            const int x = static_cast<int>(chunk_index % chunks_wide) * size;
+            const int y = static_cast<int>(chunk_index / chunks_wide) * size;
+            return SDL_Rect{ x, y, std::min(size, map_width - x), std::min(size, map_height - y) };
+        }
+    };
+
+}
+
+namespace {
+
+    constexpr float diagonal_cost = 1.41421356f;
+    constexpr float infinite_cost = std::numeric_limits<float>::infinity();
+    constexpr size_t long_run = 8;     // Steps across a border, see find_entrances
+    constexpr size_t direct_search_cells = tile_chunk::tile_count * 6;     // See find_path_in
+
+    // The adjacent chunks, in chunks. Opposite sides add up to 7.
+    constexpr SDL_Point side_offsets[8] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    constexpr int opposite_side(int side) { return 7 - side; }
+
+    constexpr const SDL_Point (&directions)[8] = geometry::diamond_directions;
+
+    int sign(int value) { return (value > 0) - (value < 0); }
+
+    // Admissible for 8 way movement with these step costs
+    float octile_distance(const SDL_Point& from, const SDL_Point& to)
+    {
+        const int da = std::abs(to.x - from.x);
+        const int db = std::abs(to.y - from.y);
+        return std::max(da, db) + (diagonal_cost - 1.0f) * std::min(da, db);
+    }
+
+    bool rect_contains(const SDL_Rect& rect, const SDL_Point& point)
+    {
+        return point.x >= rect.x && point.x < rect.x + rect.w && point.y >= rect.y && point.y < rect.y + rect.h;
+    }
+
+    // The passable tiles within a rectangle of the map, addressed by diamond coordinates
+    struct grid_view
+    {
+        const navigation_snapshot& snapshot;
+        SDL_Rect window;
+
+        bool is_open(int a, int b) const
+        {
+            const SDL_Point tile = geometry::diamond_to_world_tile(SDL_Point{ a, b });
+            return rect_contains(window, tile) && snapshot.is_passable(tile.x, tile.y);
+        }
+
+        // A corner step must not cut past a blocked tile on either side of it:
+        bool can_step(int a, int b, int da, int db) const
+        {
+            if (!is_open(a + da, b + db)) return false;
+            return da == 0 || db == 0 || (is_open(a + da, b) && is_open(a, b + db));
+        }
+
+        size_t get_cell_count() const { return static_cast<size_t>(window.w) * window.h; }
+
+        uint32_t to_cell(const SDL_Point& tile) const
+        {
+            return static_cast<uint32_t>((tile.x - window.x) + (tile.y - window.y) * window.w);
+        }
+
+        SDL_Point to_tile(uint32_t cell) const
+        {
+            return SDL_Point{ window.x + static_cast<int>(cell % window.w), window.y + static_cast<int>(cell / window.w) };
+        }
+    };
+
+    struct open_entry
+    {
+        float priority;
+        float cost;
+        uint32_t cell;
+
+        bool operator<(const open_entry& other) const { return priority > other.priority; }   // Min heap
+    };
+
+    // Search state reused by every search on a thread. Cells are only valid when stamped with the current search,
+    // so starting a search doesn't clear anything.
+    struct search_scratch
+    {
+        std::vector<float> costs;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> stamps;
+        std::vector<uint32_t> closed_stamps;
+        std::vector<open_entry> open;
+        uint32_t current = 0;
+
+        void begin(size_t cell_count)
+        {
+            if (stamps.size() < cell_count)
+            {
+                costs.resize(cell_count);
+                parents.resize(cell_count);
+                stamps.resize(cell_count, 0);
+                closed_stamps.resize(cell_count, 0);
+            }
+
+            if (++current == 0)
+            {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                std::fill(closed_stamps.begin(), closed_stamps.end(), 0);
+                current = 1;
+            }
+
+            open.clear();
+        }
+
+        float get_cost(uint32_t cell) const { return stamps[cell] == current ? costs[cell] : infinite_cost; }
+
+        bool close(uint32_t cell)
+        {
+            if (closed_stamps[cell] == current) return false;
+            closed_stamps[cell] = current;
+            return true;
+        }
+
+        // Returns false if the cell already has a cheaper cost
+        bool relax(uint32_t cell, uint32_t parent, float cost, float priority)
+        {
+            if (cost >= get_cost(cell)) return false;
+
+            stamps[cell] = current;
+            costs[cell] = cost;
+            parents[cell] = parent;
+            push(open_entry{ priority, cost, cell });
+            return true;
+        }
+
+        void push(const open_entry& entry)
+        {
+            open.push_back(entry);
+            std::push_heap(open.begin(), open.end());
+        }
+
+        open_entry pop()
+        {
+            std::pop_heap(open.begin(), open.end());
+            const open_entry entry = open.back();
+            open.pop_back();
+            return entry;
+        }
+    };
+
+    search_scratch& get_tile_scratch()
+    {
+        thread_local search_scratch scratch;
+        return scratch;
+    }
+
+    search_scratch& get_node_scratch()
+    {
+        thread_local search_scratch scratch;
+        return scratch;
+    }
+
+    /// <summary>
+    /// Dijkstra from every seed over the window, each starting at its own cost. The cost to any tile is then
+    /// scratch.get_cost(grid.to_cell(tile)), and its parent cell leads back toward the closest seed.
+    /// </summary>
+    void flood_costs(const grid_view& grid, const std::vector<flow_chunk::seed>& seeds, search_scratch& scratch)
+    {
+        scratch.begin(grid.get_cell_count());
+
+        for (const flow_chunk::seed& seed : seeds)
+        {
+            const SDL_Point diamond = geometry::world_tile_to_diamond(seed.tile);
+            if (!grid.is_open(diamond.x, diamond.y)) continue;
+
+            const uint32_t cell = grid.to_cell(seed.tile);
+            scratch.relax(cell, cell, seed.cost, seed.cost);
+        }
+
+        while (!scratch.open.empty())
+        {
+            const open_entry entry = scratch.pop();
+            if (!scratch.close(entry.cell)) continue;
+
+            const SDL_Point diamond = geometry::world_tile_to_diamond(grid.to_tile(entry.cell));
+            for (int i = 0; i < 8; i++)
+            {
+                const SDL_Point& direction = directions[i];
+                if (!grid.can_step(diamond.x, diamond.y, direction.x, direction.y)) continue;
+
+                const float cost = entry.cost + (i < 4 ? 1.0f : diagonal_cost);
+                const uint32_t cell = grid.to_cell(geometry::diamond_to_world_tile(SDL_Point{ diamond.x + direction.x, diamond.y + direction.y }));
+                scratch.relax(cell, entry.cell, cost, cost);
+            }
+        }
+    }
+
+    void flood_costs(const grid_view& grid, const SDL_Point& source, search_scratch& scratch)
+    {
+        flood_costs(grid, std::vector<flow_chunk::seed>{ flow_chunk::seed{ source, 0.0f, flow_field::no_direction } }, scratch);
+    }
+
+    /// <returns>The index of a step in directions</returns>
+    uint8_t get_direction_index(const SDL_Point& from, const SDL_Point& to)
+    {
+        const SDL_Point a = geometry::world_tile_to_diamond(from);
+        const SDL_Point b = geometry::world_tile_to_diamond(to);
+
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            if (directions[i].x == b.x - a.x && directions[i].y == b.y - a.y) return i;
+        }
+        return flow_field::no_direction;
+    }
+
+    /// <summary>
+    /// Follow a direction from a tile until reaching the goal or a jump point, a tile where the best path may turn
+    /// because an obstacle beside the line ends. Corner steps never cut past blocked tiles, so they only stop where
+    /// one of their two edge directions finds a jump point.
+    /// </summary>
+    bool jump(const grid_view& grid, int a, int b, int da, int db, const SDL_Point& goal, SDL_Point& found)
+    {
+        while (true)
+        {
+            if (!grid.is_open(a, b)) return false;
+
+            if (a == goal.x && b == goal.y)
+            {
+                found = SDL_Point{ a, b };
+                return true;
+            }
+
+            if (da != 0 && db != 0)
+            {
+                SDL_Point ignored;
+                if (jump(grid, a + da, b, da, 0, goal, ignored) || jump(grid, a, b + db, 0, db, goal, ignored))
+                {
+                    found = SDL_Point{ a, b };
+                    return true;
+                }
+
+                if (!grid.is_open(a + da, b) || !grid.is_open(a, b + db)) return false;
+            }
+            else if (da != 0)
+            {
+                if ((grid.is_open(a, b - 1) && !grid.is_open(a - da, b - 1)) ||
+                    (grid.is_open(a, b + 1) && !grid.is_open(a - da, b + 1)))
+                {
+                    found = SDL_Point{ a, b };
+                    return true;
+                }
+            }
+            else
+            {
+                if ((grid.is_open(a - 1, b) && !grid.is_open(a - 1, b - db)) ||
+                    (grid.is_open(a + 1, b) && !grid.is_open(a + 1, b - db)))
+                {
+                    found = SDL_Point{ a, b };
+                    return true;
+                }
+            }
+
+            a += da;
+            b += db;
+        }
+    }
+
+    /// <summary>
+    /// The directions worth following from a tile reached from parent, all of them for the start tile
+    /// </summary>
+    int get_pruned_directions(const grid_view& grid, const SDL_Point& diamond, const SDL_Point* parent, SDL_Point (&result)[8])
+    {
+        const int a = diamond.x;
+        const int b = diamond.y;
+        int count = 0;
+
+        if (!parent)
+        {
+            for (const SDL_Point& direction : directions)
+            {
+                if (grid.can_step(a, b, direction.x, direction.y)) result[count++] = direction;
+            }
+            return count;
+        }
+
+        const int da = sign(a - parent->x);
+        const int db = sign(b - parent->y);
+
+        if (da != 0 && db != 0)
+        {
+            const bool along_b = grid.is_open(a, b + db);
+            const bool along_a = grid.is_open(a + da, b);
+            if (along_b) result[count++] = SDL_Point{ 0, db };
+            if (along_a) result[count++] = SDL_Point{ da, 0 };
+            if (along_a && along_b && grid.is_open(a + da, b + db)) result[count++] = SDL_Point{ da, db };
+        }
+        else if (da != 0)
+        {
+            const bool next = grid.is_open(a + da, b);
+            const bool above = grid.is_open(a, b + 1);
+            const bool below = grid.is_open(a, b - 1);
+            if (next)
+            {
+                result[count++] = SDL_Point{ da, 0 };
+                if (above && grid.is_open(a + da, b + 1)) result[count++] = SDL_Point{ da, 1 };
+                if (below && grid.is_open(a + da, b - 1)) result[count++] = SDL_Point{ da, -1 };
+            }
+            if (above) result[count++] = SDL_Point{ 0, 1 };
+            if (below) result[count++] = SDL_Point{ 0, -1 };
+        }
+        else
+        {
+            const bool next = grid.is_open(a, b + db);
+            const bool right = grid.is_open(a + 1, b);
+            const bool left = grid.is_open(a - 1, b);
+            if (next)
+            {
+                result[count++] = SDL_Point{ 0, db };
+                if (right && grid.is_open(a + 1, b + db)) result[count++] = SDL_Point{ 1, db };
+                if (left && grid.is_open(a - 1, b + db)) result[count++] = SDL_Point{ -1, db };
+            }
+            if (right) result[count++] = SDL_Point{ 1, 0 };
+            if (left) result[count++] = SDL_Point{ -1, 0 };
+        }
+
+        return count;
+    }
+
+    /// <summary>
+    /// Jump point search from start to goal without leaving the window, appending every tile of the path after
+    /// start
+    /// </summary>
+    bool find_jump_path(const grid_view& grid, const SDL_Point& start, const SDL_Point& goal, std::vector<SDL_Point>& tiles, float& cost)
+    {
+        const SDL_Point start_diamond = geometry::world_tile_to_diamond(start);
+        const SDL_Point goal_diamond = geometry::world_tile_to_diamond(goal);
+        if (!grid.is_open(start_diamond.x, start_diamond.y) || !grid.is_open(goal_diamond.x, goal_diamond.y)) return false;
+
+        search_scratch& scratch = get_tile_scratch();
+        scratch.begin(grid.get_cell_count());
+
+        const uint32_t start_cell = grid.to_cell(start);
+        const uint32_t goal_cell = grid.to_cell(goal);
+        scratch.relax(start_cell, start_cell, 0.0f, octile_distance(start_diamond, goal_diamond));
+
+        while (!scratch.open.empty())
+        {
+            const open_entry entry = scratch.pop();
+            if (!scratch.close(entry.cell)) continue;
+
+            if (entry.cell == goal_cell)
+            {
+                // Walk the jump points back to the start, then fill in the straight lines between them:
+                std::vector<SDL_Point> jump_points;
+                for (uint32_t cell = goal_cell; cell != start_cell; cell = scratch.parents[cell])
+                {
+                    jump_points.push_back(geometry::world_tile_to_diamond(grid.to_tile(cell)));
+                }
+
+                SDL_Point at = start_diamond;
+                for (auto point = jump_points.rbegin(); point != jump_points.rend(); ++point)
+                {
+                    const int da = sign(point->x - at.x);
+                    const int db = sign(point->y - at.y);
+                    while (at.x != point->x || at.y != point->y)
+                    {
+                        at.x += da;
+                        at.y += db;
+                        tiles.push_back(geometry::diamond_to_world_tile(at));
+                    }
+                }
+
+                cost = entry.cost;
+                return true;
+            }
+
+            const SDL_Point diamond = geometry::world_tile_to_diamond(grid.to_tile(entry.cell));
+            const SDL_Point parent = geometry::world_tile_to_diamond(grid.to_tile(scratch.parents[entry.cell]));
+
+            SDL_Point pruned[8];
+            const int count = get_pruned_directions(grid, diamond, entry.cell == start_cell ? nullptr : &parent, pruned);
+
+            for (int i = 0; i < count; i++)
+            {
+                SDL_Point found;
+                if (!jump(grid, diamond.x + pruned[i].x, diamond.y + pruned[i].y, pruned[i].x, pruned[i].y, goal_diamond, found)) continue;
+
+                const float found_cost = entry.cost + octile_distance(diamond, found);
+                scratch.relax(grid.to_cell(geometry::diamond_to_world_tile(found)), entry.cell, found_cost,
+                    found_cost + octile_distance(found, goal_diamond));
+            }
+        }
+
+        return false;
+    }
+
+    struct crossing
+    {
+        SDL_Point from;
+        SDL_Point to;
+        float cost;
+    };
+
+    /// <summary>
+    /// The entrances between a chunk and the adjacent chunk on one of its sides. Steps across the border are grouped
+    /// into connected runs and the middle step of every run represents it. Always called for the chunk with the
+    /// lower index, so both chunks of a pair agree on the order.
+    /// </summary>
+    void find_entrances(const navigation_snapshot& snapshot, size_t first_index, int side, std::vector<crossing>& entrances)
+    {
+        entrances.clear();
+
+        const SDL_Rect rect = snapshot.get_chunk_rect(first_index);
+        const size_t second_index = first_index + side_offsets[side].x + static_cast<ptrdiff_t>(side_offsets[side].y) * snapshot.chunks_wide;
+        if (!snapshot.chunks[first_index] || !snapshot.chunks[second_index]) return;
+
+        const grid_view grid{ snapshot, SDL_Rect{ 0, 0, snapshot.map_width, snapshot.map_height } };
+        std::vector<crossing> crossings;
+
+        for (int local_y = 0; local_y < rect.h; local_y++)
+        {
+            for (int local_x = 0; local_x < rect.w; local_x++)
+            {
+                // Neighbours are at most one column or two rows away, so tiles further in can't cross:
+                if (local_x > 0 && local_x < rect.w - 1 && local_y > 1 && local_y < rect.h - 2) continue;
+
+                const SDL_Point tile{ rect.x + local_x, rect.y + local_y };
+                if (!snapshot.is_passable(tile.x, tile.y)) continue;
+
+                const SDL_Point diamond = geometry::world_tile_to_diamond(tile);
+                for (int i = 0; i < 8; i++)
+                {
+                    const SDL_Point& direction = directions[i];
+                    if (!grid.can_step(diamond.x, diamond.y, direction.x, direction.y)) continue;
+
+                    const SDL_Point to = geometry::diamond_to_world_tile(SDL_Point{ diamond.x + direction.x, diamond.y + direction.y });
+                    if (snapshot.get_chunk_index(to) != second_index) continue;
+
+                    crossings.push_back(crossing{ tile, to, i < 4 ? 1.0f : diagonal_cost });
+                }
+            }
+        }
+
+        // Union steps whose tiles touch on either side of the border:
+        std::vector<size_t> groups(crossings.size());
+        std::iota(groups.begin(), groups.end(), 0);
+
+        auto find_group = [&](size_t index)
+        {
+            while (groups[index] != index) index = groups[index] = groups[groups[index]];
+            return index;
+        };
+
+        // Only a step between the tiles joins two steps, so every step of a run connects to the others on both sides:
+        auto connected = [&](const SDL_Point& first, const SDL_Point& second)
+        {
+            if (first.x == second.x && first.y == second.y) return true;
+
+            const SDL_Point a = geometry::world_tile_to_diamond(first);
+            const SDL_Point b = geometry::world_tile_to_diamond(second);
+            const int da = b.x - a.x;
+            const int db = b.y - a.y;
+            return std::abs(da) <= 1 && std::abs(db) <= 1 && grid.can_step(a.x, a.y, da, db);
+        };
+
+        for (size_t i = 0; i < crossings.size(); i++)
+        {
+            for (size_t j = i + 1; j < crossings.size(); j++)
+            {
+                if (connected(crossings[i].from, crossings[j].from) && connected(crossings[i].to, crossings[j].to))
+                {
+                    groups[find_group(j)] = find_group(i);
+                }
+            }
+        }
+
+        std::vector<std::vector<size_t>> runs;
+        std::unordered_map<size_t, size_t> run_of_group;
+        for (size_t i = 0; i < crossings.size(); i++)
+        {
+            auto [run, inserted] = run_of_group.emplace(find_group(i), runs.size());
+            if (inserted) runs.emplace_back();
+            runs[run->second].push_back(i);
+        }
+
+        // Long runs get an entrance at both ends instead, paths along the border shouldn't detour through the middle:
+        for (const auto& run : runs)
+        {
+            if (run.size() < long_run)
+            {
+                entrances.push_back(crossings[run[run.size() / 2]]);
+                continue;
+            }
+
+            entrances.push_back(crossings[run.front()]);
+            entrances.push_back(crossings[run.back()]);
+        }
+    }
+
+    /// <summary>
+    /// The costs between every pair of a chunk's nodes without leaving the chunk
+    /// </summary>
+    void build_chunk_edges(const navigation_snapshot& snapshot, size_t chunk_index, navigation_chunk& chunk)
+    {
+        for (int side = 0; side < 8; side++)
+        {
+            chunk.side_base[side + 1] = chunk.side_base[side] + static_cast<uint32_t>(chunk.sides[side].size());
+        }
+
+        const uint32_t node_count = chunk.get_node_count();
+        for (auto& side : chunk.sides)
+        {
+            for (auto& node : side) node.edges.clear();
+        }
+
+        const grid_view grid{ snapshot, snapshot.get_chunk_rect(chunk_index) };
+        search_scratch& scratch = get_tile_scratch();
+
+        // Costs are symmetric, so each flood fills in the edges both ways to the nodes after it:
+        for (uint32_t i = 0; i < node_count; i++)
+        {
+            navigation_node& from = chunk.get_node(i);
+            flood_costs(grid, from.tile, scratch);
+
+            for (uint32_t j = i + 1; j < node_count; j++)
+            {
+                navigation_node& to = chunk.get_node(j);
+
+                const float cost = scratch.get_cost(grid.to_cell(to.tile));
+                if (cost == infinite_cost) continue;
+
+                from.edges.push_back(navigation_edge{ j, cost });
+                to.edges.push_back(navigation_edge{ i, cost });
+            }
+        }
+    }
+
+    // The start or goal of a query, linked to the nodes of its chunk
+    struct path_end
+    {
+        SDL_Point tile;
+        size_t chunk_index;
+        std::vector<float> costs;   // By node of the chunk, infinite_cost if unreachable within it
+        float other_end_cost = infinite_cost;       // Straight to the other end, if both are in the same chunk
+    };
+
+    void link_path_end(const navigation_snapshot& snapshot, path_end& end, const SDL_Point& other_end)
+    {
+        end.chunk_index = snapshot.get_chunk_index(end.tile);
+
+        const navigation_chunk& chunk = *snapshot.chunks[end.chunk_index];
+        const grid_view grid{ snapshot, snapshot.get_chunk_rect(end.chunk_index) };
+
+        search_scratch& scratch = get_tile_scratch();
+        flood_costs(grid, end.tile, scratch);
+
+        end.costs.resize(chunk.get_node_count());
+        for (uint32_t i = 0; i < chunk.get_node_count(); i++)
+        {
+            end.costs[i] = scratch.get_cost(grid.to_cell(chunk.get_node(i).tile));
+        }
+
+        if (rect_contains(grid.window, other_end)) end.other_end_cost = scratch.get_cost(grid.to_cell(other_end));
+    }
+
+    size_t find_node_chunk(const navigation_snapshot& snapshot, uint32_t id)
+    {
+        return static_cast<size_t>(std::upper_bound(snapshot.node_base.begin(), snapshot.node_base.end(), id) - snapshot.node_base.begin()) - 1;
+    }
+
+    /// <summary>
+    /// Call func(id, cost) for the nodes a node links to: the other nodes of its chunk, and the node it steps to in
+    /// the adjacent chunk
+    /// </summary>
+    template<class F>
+    void for_each_linked_node(const navigation_snapshot& snapshot, size_t chunk_index, uint32_t local, F&& func)
+    {
+        const navigation_chunk& chunk = *snapshot.chunks[chunk_index];
+        const uint32_t base = snapshot.node_base[chunk_index];
+        const navigation_node& node = chunk.get_node(local);
+
+        for (const navigation_edge& edge : node.edges)
+        {
+            func(base + edge.node, edge.cost);
+        }
+
+        // Onto the node with the same index on the opposite side of the adjacent chunk:
+        int side = 0;
+        while (local >= chunk.side_base[side + 1]) side++;
+
+        const size_t across_index = chunk_index + side_offsets[side].x + static_cast<ptrdiff_t>(side_offsets[side].y) * snapshot.chunks_wide;
+        const navigation_chunk& across = *snapshot.chunks[across_index];
+        func(snapshot.node_base[across_index] + across.side_base[opposite_side(side)] + (local - chunk.side_base[side]), node.across_cost);
+    }
+
+    /// <summary>
+    /// A* over the chunk nodes, then every step between nodes in the same chunk is refined with jump point search
+    /// inside that chunk
+    /// </summary>
+    bool find_abstract_path(const navigation_snapshot& snapshot, const SDL_Point& start, const SDL_Point& goal, std::vector<SDL_Point>& tiles, float& cost)
+    {
+        path_end start_end{ start };
+        path_end goal_end{ goal };
+        link_path_end(snapshot, start_end, goal);
+        link_path_end(snapshot, goal_end, start);
+
+        const uint32_t start_id = snapshot.node_count;
+        const uint32_t goal_id = snapshot.node_count + 1;
+        const SDL_Point goal_diamond = geometry::world_tile_to_diamond(goal);
+
+        auto get_tile = [&](uint32_t id)
+        {
+            if (id == start_id) return start;
+            if (id == goal_id) return goal;
+
+            const size_t chunk_index = find_node_chunk(snapshot, id);
+            return snapshot.chunks[chunk_index]->get_node(id - snapshot.node_base[chunk_index]).tile;
+        };
+
+        search_scratch& scratch = get_node_scratch();
+        scratch.begin(static_cast<size_t>(snapshot.node_count) + 2);
+
+        auto relax = [&](uint32_t id, uint32_t parent, float node_cost)
+        {
+            const float heuristic = id == goal_id ? 0.0f : octile_distance(geometry::world_tile_to_diamond(get_tile(id)), goal_diamond);
+            scratch.relax(id, parent, node_cost, node_cost + heuristic);
+        };
+
+        scratch.relax(start_id, start_id, 0.0f, 0.0f);
+        bool found = false;
+
+        while (!scratch.open.empty())
+        {
+            const open_entry entry = scratch.pop();
+            if (!scratch.close(entry.cell)) continue;
+
+            if (entry.cell == goal_id)
+            {
+                found = true;
+                break;
+            }
+
+            if (entry.cell == start_id)
+            {
+                const uint32_t base = snapshot.node_base[start_end.chunk_index];
+                for (uint32_t i = 0; i < start_end.costs.size(); i++)
+                {
+                    if (start_end.costs[i] != infinite_cost) relax(base + i, start_id, start_end.costs[i]);
+                }
+
+                if (start_end.other_end_cost != infinite_cost) relax(goal_id, start_id, start_end.other_end_cost);
+                continue;
+            }
+
+            const size_t chunk_index = find_node_chunk(snapshot, entry.cell);
+            const uint32_t local = entry.cell - snapshot.node_base[chunk_index];
+
+            for_each_linked_node(snapshot, chunk_index, local, [&](uint32_t id, float step_cost)
+            {
+                relax(id, entry.cell, entry.cost + step_cost);
+            });
+
+            if (chunk_index == goal_end.chunk_index && goal_end.costs[local] != infinite_cost)
+            {
+                relax(goal_id, entry.cell, entry.cost + goal_end.costs[local]);
+            }
+        }
+
+        if (!found) return false;
+
+        std::vector<uint32_t> nodes;
+        for (uint32_t id = goal_id; id != start_id; id = scratch.parents[id])
+        {
+            nodes.push_back(id);
+        }
+        nodes.push_back(start_id);
+        std::reverse(nodes.begin(), nodes.end());
+
+        cost = 0.0f;
+        for (size_t i = 1; i < nodes.size(); i++)
+        {
+            const SDL_Point from = get_tile(nodes[i - 1]);
+            const SDL_Point to = get_tile(nodes[i]);
+            if (from.x == to.x && from.y == to.y) continue;     // Nodes of two sides can share a corner tile
+
+            const size_t from_chunk = snapshot.get_chunk_index(from);
+            if (from_chunk != snapshot.get_chunk_index(to))
+            {
+                // A single step across a border:
+                tiles.push_back(to);
+                cost += scratch.costs[nodes[i]] - scratch.costs[nodes[i - 1]];
+                continue;
+            }
+
+            float segment_cost = 0.0f;
+            if (!find_jump_path(grid_view{ snapshot, snapshot.get_chunk_rect(from_chunk) }, from, to, tiles, segment_cost)) return false;
+            cost += segment_cost;
+        }
+
+        return true;
+    }
+
+    bool find_path_in(const navigation_snapshot& snapshot, const SDL_Point& start, const SDL_Point& goal, std::vector<SDL_Point>& tiles, float& cost)
+    {
+        tiles.clear();
+        cost = 0.0f;
+
+        if (!snapshot.is_passable(start.x, start.y) || !snapshot.is_passable(goal.x, goal.y)) return false;
+
+        tiles.push_back(start);
+        if (start.x == goal.x && start.y == goal.y) return true;
+
+        // Nearby tiles are searched directly, with a chunk of room around them to go around obstacles:
+        constexpr int margin = static_cast<int>(tile_chunk::size);
+        const int left = std::max(0, std::min(start.x, goal.x) - margin / 2);
+        const int top = std::max(0, std::min(start.y, goal.y) - margin);
+        const int right = std::min(snapshot.map_width, std::max(start.x, goal.x) + margin / 2 + 1);
+        const int bottom = std::min(snapshot.map_height, std::max(start.y, goal.y) + margin + 1);
+
+        const SDL_Rect window{ left, top, right - left, bottom - top };
+        if (static_cast<size_t>(window.w) * window.h <= direct_search_cells)
+        {
+            if (find_jump_path(grid_view{ snapshot, window }, start, goal, tiles, cost)) return true;
+        }
+
+        return find_abstract_path(snapshot, start, goal, tiles, cost);
+    }
+
+}
+
+path_finder::path_finder(std::shared_ptr<tile_map> map) : map(map)
+{
+    auto empty = std::make_shared<navigation_snapshot>();
+    empty->map_width = static_cast<int>(map->get_map_width());
+    empty->map_height = static_cast<int>(map->get_map_height());
+    empty->chunks_wide = static_cast<int>(map->get_chunks_wide());
+    empty->chunks_high = static_cast<int>(map->get_chunks_high());
+    empty->chunks.resize(static_cast<size_t>(empty->chunks_wide) * empty->chunks_high);
+    empty->node_base.resize(empty->chunks.size(), 0);
+
+    snapshot = empty;
+    versions.resize(empty->chunks.size());
+}
+
+std::shared_ptr<path_finder> path_finder::create(std::shared_ptr<tile_map> map)
+{
+    if (!map)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create path finder: no map");
+        return nullptr;
+    }
+
+    auto finder = std::shared_ptr<path_finder>(new path_finder(map));
+    finder->refresh_snapshot();
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Path finder constructed, %zu chunks summarized", finder->rebuilt_chunks);
+    return finder;
+}
+
+path_finder::~path_finder()
+{
+    // Jobs hold on to their snapshot and requests themselves, but they mustn't outlive the group:
+    wait();
+}
+
+path_handle path_finder::request_path(const SDL_Point& start, const SDL_Point& goal)
+{
+    auto request = std::make_shared<path_request>(start, goal);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.push_back(request);
+    return path_handle(request);
+}
+
+bool path_finder::find_path(const SDL_Point& start, const SDL_Point& goal, std::vector<SDL_Point>& tiles, float* cost) const
+{
+    float path_cost = 0.0f;
+    const bool found = find_path_in(*get_current_snapshot(), start, goal, tiles, path_cost);
+    if (cost) *cost = path_cost;
+    return found;
+}
+
+void path_finder::update()
+{
+    ISOMETRIC_PROFILE_ZONE("path_finder::update");
+
+    update_count++;
+    const std::vector<size_t> rebuilt = refresh_snapshot();
+
+    std::vector<std::shared_ptr<path_request>> starting;
+    std::shared_ptr<const navigation_snapshot> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        starting.swap(queued);
+        current = snapshot;
+    }
+
+    for (auto cached = flow_fields.begin(); cached != flow_fields.end();)
+    {
+        if (update_count - cached->second.last_used_update > flow_field_lifetime) cached = flow_fields.erase(cached);
+        else ++cached;
+    }
+
+    if (!rebuilt.empty() && !flow_fields.empty())
+    {
+        ISOMETRIC_PROFILE_ZONE("path_finder::update_flow_fields");
+
+        std::vector<uint8_t> rebuilt_flags(current->chunks.size(), 0);
+        for (size_t index : rebuilt) rebuilt_flags[index] = 1;
+
+        for (auto& [key, cached] : flow_fields)
+        {
+            cached.field = integrate_flow_field(*current, cached.field->get_goal(), cached.field.get(), rebuilt_flags);
+        }
+    }
+
+    tools::job_system* job_system = tools::job_system::get_current();
+    for (size_t first = 0; first < starting.size(); first += batch_size)
+    {
+        const size_t last = std::min(starting.size(), first + batch_size);
+        std::vector<std::shared_ptr<path_request>> batch(starting.begin() + first, starting.begin() + last);
+
+        auto search_batch = [this, current, batch]()
+        {
+            ISOMETRIC_PROFILE_ZONE("path_finder::search");
+
+            for (const auto& request : batch)
+            {
+                path_status expected = path_status::queued;
+                if (!request->status.compare_exchange_strong(expected, path_status::searching)) continue;
+
+                search(*current, *request);
+                completed_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        if (job_system) job_system->run(jobs, search_batch);
+        else search_batch();
+    }
+}
+
+std::shared_ptr<const flow_field> path_finder::get_flow_field(const SDL_Point& goal)
+{
+    const uint64_t key = get_flow_key(goal);
+
+    auto cached = flow_fields.find(key);
+    if (cached == flow_fields.end())
+    {
+        ISOMETRIC_PROFILE_ZONE("path_finder::get_flow_field");
+
+        const std::vector<uint8_t> nothing_rebuilt;
+        cached = flow_fields.emplace(key, cached_flow_field{ integrate_flow_field(*get_current_snapshot(), goal, nullptr, nothing_rebuilt) }).first;
+    }
+
+    cached->second.last_used_update = update_count;
+    return cached->second.field;
+}
+
+void path_finder::set_flow_field_lifetime(size_t updates)
+{
+    flow_field_lifetime = updates;
+}
+
+size_t path_finder::get_flow_field_lifetime() const
+{
+    return flow_field_lifetime;
+}
+
+uint64_t path_finder::get_flow_key(const SDL_Point& goal)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(goal.x)) << 32) | static_cast<uint32_t>(goal.y);
+}
+
+std::shared_ptr<const flow_field> path_finder::integrate_flow_field(const navigation_snapshot& snapshot, const SDL_Point& goal,
+    const flow_field* previous, const std::vector<uint8_t>& rebuilt)
+{
+    auto field = std::make_shared<flow_field>(goal, snapshot.map_width, snapshot.map_height, snapshot.chunks_wide, snapshot.chunks_high);
+    if (!snapshot.is_passable(goal.x, goal.y)) return field;
+
+    // Costs from the goal to every chunk node first, over the summary:
+    path_end goal_end{ goal };
+    link_path_end(snapshot, goal_end, goal);
+
+    const uint32_t goal_id = snapshot.node_count;
+    search_scratch& scratch = get_node_scratch();
+    scratch.begin(static_cast<size_t>(snapshot.node_count) + 1);
+    scratch.relax(goal_id, goal_id, 0.0f, 0.0f);
+
+    while (!scratch.open.empty())
+    {
+        const open_entry entry = scratch.pop();
+        if (!scratch.close(entry.cell)) continue;
+
+        if (entry.cell == goal_id)
+        {
+            const uint32_t base = snapshot.node_base[goal_end.chunk_index];
+            for (uint32_t i = 0; i < goal_end.costs.size(); i++)
+            {
+                if (goal_end.costs[i] != infinite_cost) scratch.relax(base + i, goal_id, goal_end.costs[i], goal_end.costs[i]);
+            }
+            continue;
+        }
+
+        const size_t chunk_index = find_node_chunk(snapshot, entry.cell);
+        for_each_linked_node(snapshot, chunk_index, entry.cell - snapshot.node_base[chunk_index], [&](uint32_t id, float step_cost)
+        {
+            scratch.relax(id, entry.cell, entry.cost + step_cost, entry.cost + step_cost);
+        });
+    }
+
+    // Every chunk is seeded by the goal and the nodes whose way to the goal leaves through the adjacent chunk. Nodes
+    // that lead on through their own chunk are covered by integrating the chunk, and the costs only ever drop along
+    // the directions, so they can't loop.
+    std::vector<std::vector<flow_chunk::seed>> seeds(snapshot.chunks.size());
+    for (size_t chunk_index = 0; chunk_index < snapshot.chunks.size(); chunk_index++)
+    {
+        const navigation_chunk* chunk = snapshot.chunks[chunk_index].get();
+        if (!chunk) continue;
+
+        const uint32_t base = snapshot.node_base[chunk_index];
+        for (uint32_t local = 0; local < chunk->get_node_count(); local++)
+        {
+            const float cost = scratch.get_cost(base + local);
+            if (cost == infinite_cost) continue;
+
+            const uint32_t parent = scratch.parents[base + local];
+            if (parent == goal_id || find_node_chunk(snapshot, parent) == chunk_index) continue;
+
+            const navigation_node& node = chunk->get_node(local);
+            seeds[chunk_index].push_back(flow_chunk::seed{ node.tile, cost, get_direction_index(node.tile, node.across) });
+        }
+
+        if (chunk_index == goal_end.chunk_index) seeds[chunk_index].push_back(flow_chunk::seed{ goal, 0.0f, flow_field::no_direction });
+    }
+
+    std::vector<uint8_t> integrated(snapshot.chunks.size(), 0);
+    tools::parallel_for(snapshot.chunks.size(), [&](size_t chunk_index)
+    {
+        const auto& chunk_seeds = seeds[chunk_index];
+        if (chunk_seeds.empty()) return;
+
+        if (previous && !rebuilt.empty() && !rebuilt[chunk_index] && previous->chunks[chunk_index] &&
+            previous->chunks[chunk_index]->seeds == chunk_seeds)
+        {
+            field->chunks[chunk_index] = previous->chunks[chunk_index];
+            return;
+        }
+
+        const grid_view grid{ snapshot, snapshot.get_chunk_rect(chunk_index) };
+        search_scratch& tile_scratch = get_tile_scratch();
+        flood_costs(grid, chunk_seeds, tile_scratch);
+
+        auto flow = std::make_shared<flow_chunk>();
+        flow->costs.fill(infinite_cost);
+        flow->directions.fill(flow_field::no_direction);
+        flow->seeds = chunk_seeds;
+
+        for (uint32_t cell = 0; cell < grid.get_cell_count(); cell++)
+        {
+            const float cost = tile_scratch.get_cost(cell);
+            if (cost == infinite_cost) continue;
+
+            const SDL_Point tile = grid.to_tile(cell);
+            const size_t index = tile_chunk::local_index(tile.x - grid.window.x, tile.y - grid.window.y);
+            flow->costs[index] = cost;
+
+            const uint32_t parent = tile_scratch.parents[cell];
+            if (parent != cell)
+            {
+                flow->directions[index] = get_direction_index(tile, grid.to_tile(parent));
+                continue;
+            }
+
+            // A seed that kept its own cost leads where its node does:
+            for (const flow_chunk::seed& seed : chunk_seeds)
+            {
+                if (seed.tile.x == tile.x && seed.tile.y == tile.y && seed.cost == cost) flow->directions[index] = seed.direction;
+            }
+        }
+
+        field->chunks[chunk_index] = flow;
+        integrated[chunk_index] = 1;
+    }, 4);
+
+    integrated_flow_chunks += std::count(integrated.begin(), integrated.end(), 1);
+    return field;
+}
+
+void path_finder::wait()
+{
+    if (auto job_system = tools::job_system::get_current()) job_system->wait(jobs);
+}
+
+void path_finder::set_batch_size(size_t size)
+{
+    batch_size = std::max<size_t>(size, 1);
+}
+
+size_t path_finder::get_batch_size() const
+{
+    return batch_size;
+}
+
+size_t path_finder::get_queued_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued.size();
+}
+
+std::shared_ptr<const navigation_snapshot> path_finder::get_current_snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return snapshot;
+}
+
+void path_finder::search(const navigation_snapshot& snapshot, path_request& request)
+{
+    const bool found = find_path_in(snapshot, request.start, request.goal, request.tiles, request.cost);
+    if (!found) request.tiles.clear();
+
+    request.status.store(found ? path_status::found : path_status::not_found, std::memory_order_release);
+}
+
+std::vector<size_t> path_finder::refresh_snapshot()
+{
+    const std::shared_ptr<const navigation_snapshot> current = get_current_snapshot();
+    const int chunks_wide = current->chunks_wide;
+    const int chunks_high = current->chunks_high;
+
+    // Chunks whose passability changed, with their new summary or nullptr once they're no longer resident:
+    std::unordered_map<size_t, std::shared_ptr<navigation_chunk>> writable;
+    std::vector<size_t> changed;
+
+    for (int chunk_y = 0; chunk_y < chunks_high; chunk_y++)
+    {
+        for (int chunk_x = 0; chunk_x < chunks_wide; chunk_x++)
+        {
+            const size_t index = chunk_x + static_cast<size_t>(chunk_y) * chunks_wide;
+            const tile_chunk* chunk = static_cast<const tile_map&>(*map).find_chunk(chunk_x, chunk_y);
+            chunk_version& version = versions[index];
+
+            if (!chunk)
+            {
+                if (version.resident)
+                {
+                    version = chunk_version();
+                    writable[index] = nullptr;
+                    changed.push_back(index);
+                }
+                continue;
+            }
+
+            const tile_planes& planes = chunk->get_planes();
+            if (version.resident && version.instance_id == chunk->get_instance_id() && version.revision == planes.revision) continue;
+
+            version = chunk_version{ true, chunk->get_instance_id(), planes.revision };
+
+            // The planes already pack passability 64 tiles to a word, in the same order:
+            auto built = std::make_shared<navigation_chunk>();
+            const auto& words = planes.passable.get_words();
+            std::copy_n(words.begin(), std::min(words.size(), built->passable.size()), built->passable.begin());
+
+            // Most edits only change images, which don't need a rebuild:
+            if (current->chunks[index] && current->chunks[index]->passable == built->passable) continue;
+
+            writable[index] = built;
+            changed.push_back(index);
+        }
+    }
+
+    if (changed.empty()) return changed;
+
+    auto next = std::make_shared<navigation_snapshot>(*current);
+    for (size_t index : changed) next->chunks[index] = writable[index];
+
+    auto get_neighbour = [&](size_t index, int side, size_t& neighbour)
+    {
+        const int x = static_cast<int>(index % chunks_wide) + side_offsets[side].x;
+        const int y = static_cast<int>(index / chunks_wide) + side_offsets[side].y;
+        if (x < 0 || y < 0 || x >= chunks_wide || y >= chunks_high) return false;
+
+        neighbour = x + static_cast<size_t>(y) * chunks_wide;
+        return true;
+    };
+
+    // Neighbours keep their other sides, only the sides toward changed chunks are found again:
+    std::vector<size_t> touched;
+    for (size_t index : changed)
+    {
+        if (writable[index]) touched.push_back(index);
+    }
+
+    for (size_t index : changed)
+    {
+        for (int side = 0; side < 8; side++)
+        {
+            size_t neighbour = 0;
+            if (!get_neighbour(index, side, neighbour) || writable.count(neighbour) || !next->chunks[neighbour]) continue;
+
+            auto copy = std::make_shared<navigation_chunk>(*next->chunks[neighbour]);
+            writable[neighbour] = copy;
+            next->chunks[neighbour] = copy;
+            touched.push_back(neighbour);
+        }
+    }
+
+    auto find_writable = [&](size_t index) -> navigation_chunk*
+    {
+        auto found = writable.find(index);
+        return found != writable.end() ? found->second.get() : nullptr;
+    };
+
+    std::vector<crossing> entrances;
+    for (size_t index : changed)
+    {
+        for (int side = 0; side < 8; side++)
+        {
+            size_t neighbour = 0;
+            if (!get_neighbour(index, side, neighbour)) continue;
+
+            // Pairs of changed chunks are only found once, from the lower index:
+            const bool neighbour_changed = std::find(changed.begin(), changed.end(), neighbour) != changed.end();
+            if (neighbour_changed && neighbour < index) continue;
+
+            const size_t first = std::min(index, neighbour);
+            const size_t second = std::max(index, neighbour);
+            const int first_side = first == index ? side : opposite_side(side);
+
+            find_entrances(*next, first, first_side, entrances);
+
+            if (navigation_chunk* chunk = find_writable(first))
+            {
+                auto& nodes = chunk->sides[first_side];
+                nodes.clear();
+                for (const crossing& entrance : entrances) nodes.push_back(navigation_node{ entrance.from, entrance.to, entrance.cost });
+            }
+
+            if (navigation_chunk* chunk = find_writable(second))
+            {
+                auto& nodes = chunk->sides[opposite_side(first_side)];
+                nodes.clear();
+                for (const crossing& entrance : entrances) nodes.push_back(navigation_node{ entrance.to, entrance.from, entrance.cost });
+            }
+        }
+    }
+
+    tools::parallel_for(touched.size(), [&](size_t i)
+    {
+        build_chunk_edges(*next, touched[i], *writable[touched[i]]);
+    });
+
+    next->node_count = 0;
+    for (size_t index = 0; index < next->chunks.size(); index++)
+    {
+        next->node_base[index] = next->node_count;
+        if (next->chunks[index]) next->node_count += next->chunks[index]->get_node_count();
+    }
+
+    rebuilt_chunks += touched.size();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    snapshot = next;
+    return touched;
+}
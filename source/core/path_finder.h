@@ -0,0 +1,210 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "tile_map.h"
+#include "flow_field.h"
+#include "../enumerations/path_status.h"
+#include "../tools/job_system.h"
+
+namespace isometric {
+
+    struct navigation_snapshot;
+
+    /// <summary>
+    /// One query of a path_finder, shared by the path_handle returned for it and the job that searches it
+    /// </summary>
+    struct path_request
+    {
+        SDL_Point start;
+        SDL_Point goal;
+        std::atomic<path_status> status = path_status::queued;
+        std::vector<SDL_Point> tiles;   // Written before status becomes found, read only after
+        float cost = 0.0f;              // In tiles, an edge step costs 1 and a corner step the square root of 2
+
+        path_request(const SDL_Point& start, const SDL_Point& goal) : start(start), goal(goal) {}
+    };
+
+    /// <summary>
+    /// The result of path_finder::request_path, filled in by a worker thread in one of the next updates. Like an
+    /// asset_handle it never blocks, poll it each frame until is_done().
+    /// </summary>
+    class path_handle
+    {
+    private:
+        std::shared_ptr<path_request> request = nullptr;
+
+    public:
+        path_handle() {}
+        explicit path_handle(std::shared_ptr<path_request> request) : request(request) {}
+
+        /// <returns>False for a default constructed handle</returns>
+        bool is_valid() const { return request != nullptr; }
+        explicit operator bool() const { return is_valid(); }
+
+        path_status get_status() const
+        {
+            return request ? request->status.load(std::memory_order_acquire) : path_status::cancelled;
+        }
+
+        bool is_found() const { return get_status() == path_status::found; }
+        bool is_done() const
+        {
+            const path_status status = get_status();
+            return status != path_status::queued && status != path_status::searching;
+        }
+
+        /// <returns>The tiles from start to goal, both included, or nothing unless is_found()</returns>
+        const std::vector<SDL_Point>& get_tiles() const
+        {
+            static const std::vector<SDL_Point> no_tiles;
+            return is_found() ? request->tiles : no_tiles;
+        }
+
+        float get_cost() const { return is_found() ? request->cost : 0.0f; }
+
+        /// <summary>
+        /// Stop waiting for the path, a search that already started still finishes but its result is dropped
+        /// </summary>
+        void cancel()
+        {
+            path_status queued = path_status::queued;
+            if (request) request->status.compare_exchange_strong(queued, path_status::cancelled);
+        }
+    };
+
+    /// <summary>
+    /// Finds paths over the passable tiles of a tile_map. Tiles connect to the 8 tiles around their diamond, the 4
+    /// that share an edge and the 4 that only share a corner, but a corner step needs both tiles beside it to be
+    /// passable. Chunks that aren't allocated are impassable.
+    /// </summary>
+    /// <remarks>
+    /// Every chunk is summarized by the entrances on its borders and the costs between them. Long paths are planned
+    /// over that graph and only refined tile by tile inside the chunks they cross, short ones are searched directly;
+    /// both use jump point search on the tiles. When passability changes, update() rebuilds the summary of just the
+    /// changed chunks and their neighbours. Searches run on the job system against an immutable copy of the summary,
+    /// so the map can be edited while they run.
+    ///
+    /// Many agents with the same destination should share a flow field from get_flow_field instead of each
+    /// requesting a path.
+    /// </remarks>
+    class path_finder
+    {
+    private:
+        struct chunk_version
+        {
+            bool resident = false;
+            uint64_t instance_id = 0;
+            uint32_t revision = 0;
+        };
+
+        std::shared_ptr<tile_map> map;
+        std::vector<chunk_version> versions;            // By chunk index, what the current snapshot was built from
+
+        struct cached_flow_field
+        {
+            std::shared_ptr<const flow_field> field;
+            size_t last_used_update = 0;
+        };
+
+        std::unordered_map<uint64_t, cached_flow_field> flow_fields;   // By goal, see get_flow_key
+        size_t update_count = 0;
+        size_t flow_field_lifetime = 600;
+        size_t integrated_flow_chunks = 0;
+
+        mutable std::mutex mutex;                       // Guards snapshot and queued
+        std::shared_ptr<const navigation_snapshot> snapshot;
+        std::vector<std::shared_ptr<path_request>> queued;
+        tools::job_group jobs;
+
+        size_t batch_size = 16;
+        size_t rebuilt_chunks = 0;
+        std::atomic<size_t> completed_count = 0;
+
+        explicit path_finder(std::shared_ptr<tile_map> map);
+
+    public:
+        /// <summary>
+        /// Create a path finder for the map and summarize its resident chunks. Returns nullptr without a map.
+        /// </summary>
+        static std::shared_ptr<path_finder> create(std::shared_ptr<tile_map> map);
+        ~path_finder();
+
+        path_finder(const path_finder&) = delete;
+        path_finder& operator=(const path_finder&) = delete;
+
+        /// <summary>
+        /// Queue a path from start to goal, it's searched in batches on the job system once update() runs. Safe to
+        /// call from any thread.
+        /// </summary>
+        path_handle request_path(const SDL_Point& start, const SDL_Point& goal);
+
+        /// <summary>
+        /// Search a path on the calling thread against the current state of the summary
+        /// </summary>
+        /// <param name="tiles">Receives the tiles from start to goal, both included</param>
+        /// <returns>False if there's no path</returns>
+        bool find_path(const SDL_Point& start, const SDL_Point& goal, std::vector<SDL_Point>& tiles, float* cost = nullptr) const;
+
+        /// <summary>
+        /// Rebuild the summary of chunks whose passability changed, then start the queued requests. Call once per
+        /// frame on the thread that owns the map, world::update does when it has a path finder.
+        /// </summary>
+        void update();
+
+        /// <summary>
+        /// Block until every request started by update() is done
+        /// </summary>
+        void wait();
+
+        /// <summary>
+        /// How many requests a single job searches, more amortizes the job overhead, fewer spreads a burst of
+        /// requests across more workers
+        /// </summary>
+        void set_batch_size(size_t size);
+        size_t get_batch_size() const;
+
+        size_t get_queued_count() const;
+        size_t get_completed_count() const { return completed_count.load(std::memory_order_relaxed); }
+
+        /// <returns>How many chunk summaries were built since creation, including neighbours of changed chunks</returns>
+        size_t get_rebuilt_chunk_count() const { return rebuilt_chunks; }
+
+        /// <summary>
+        /// The flow field toward a goal, shared by everyone asking for the same goal. It's integrated chunk by chunk
+        /// across the job system the first time, then update() replaces it whenever passability changes, integrating
+        /// only the chunks that changed or whose entrances got a different cost. Fields that aren't asked for within
+        /// the lifetime are dropped, so agents should ask again every tick rather than keep the pointer. Call on the
+        /// thread that calls update().
+        /// </summary>
+        std::shared_ptr<const flow_field> get_flow_field(const SDL_Point& goal);
+
+        /// <summary>
+        /// Cached flow fields are dropped after this many updates without a get_flow_field for their goal
+        /// </summary>
+        void set_flow_field_lifetime(size_t updates);
+        size_t get_flow_field_lifetime() const;
+
+        size_t get_flow_field_count() const { return flow_fields.size(); }
+
+        /// <returns>How many flow field chunks were integrated since creation, reused chunks don't count</returns>
+        size_t get_integrated_flow_chunk_count() const { return integrated_flow_chunks; }
+
+    private:
+        std::shared_ptr<const navigation_snapshot> get_current_snapshot() const;
+        std::vector<size_t> refresh_snapshot();
+        static void search(const navigation_snapshot& snapshot, path_request& request);
+
+        static uint64_t get_flow_key(const SDL_Point& goal);
+
+        /// <param name="previous">The field to goal before passability changed, its chunks are reused where possible</param>
+        /// <param name="rebuilt">By chunk index, true for the chunks whose summary was rebuilt since previous</param>
+        std::shared_ptr<const flow_field> integrate_flow_field(const navigation_snapshot& snapshot, const SDL_Point& goal,
+            const flow_field* previous, const std::vector<uint8_t>& rebuilt);
+    };
+
+}
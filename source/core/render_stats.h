@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace isometric {
+
+    /// <summary>
+    /// Counters and CPU timings collected by world for a single frame
+    /// </summary>
+    struct render_stats
+    {
+        unsigned long long frame = 0;
+        size_t viewports_rendered = 0;          // One per enabled camera, reused frames included
+
+        unsigned long long tiles_iterated = 0;  // Tiles visited inside the visible span
+        unsigned long long tiles_drawn = 0;     // Tile images submitted, excluding layers drawn from the chunk cache
+        unsigned long long animated_tiles_drawn = 0;    // Of tiles_drawn, those drawn because they're animated
+        size_t draw_calls = 0;                  // Calls into the SDL_Renderer that draw something
+        size_t texture_switches = 0;            // Changes of texture between consecutive draw calls
+        size_t alpha_mod_changes = 0;           // SDL_SetTextureAlphaMod calls
+        size_t chunks_drawn = 0;                // Chunk textures copied from the chunk render cache
+        size_t chunks_baked = 0;                // Chunks re-baked by the chunk render cache
+        size_t scroll_tiles_drawn = 0;          // Tile images drawn into the scroll buffer's exposed strips
+        size_t imposters_drawn = 0;             // Chunk imposters copied when zoomed out past the LOD threshold
+        size_t imposters_baked = 0;
+        size_t objects_rendered = 0;
+        size_t objects_culled = 0;              // Near a viewport's span but not visible in it, summed over viewports
+        size_t frames_reused = 0;               // Viewports copied from their frame cache, the total in get_average
+
+        // CPU time per phase, in milliseconds:
+        double update_ms = 0.0;         // world::update, visible span and picking
+        double chunk_cache_ms = 0.0;    // Baking and copying cached chunks, or updating the scroll buffer
+        double tiles_ms = 0.0;          // Visiting the visible span and generating tile draws
+        double submit_ms = 0.0;         // Flushing batched geometry to the renderer
+        double objects_ms = 0.0;        // Rendering game objects
+
+        double get_total_ms() const
+        {
+            return update_ms + chunk_cache_ms + tiles_ms + submit_ms + objects_ms;
+        }
+    };
+
+    /// <summary>
+    /// A fixed size rolling history of render_stats, the oldest frame is overwritten once it's full
+    /// </summary>
+    class render_stats_history
+    {
+    private:
+        size_t max_history = 300;
+        size_t history_cursor = 0;  // Where the next frame is written
+        std::vector<render_stats> history;
+
+    public:
+        void push(const render_stats& stats)
+        {
+            if (history.size() < max_history)
+            {
+                history.push_back(stats);
+            }
+            else
+            {
+                history[history_cursor] = stats;
+            }
+
+            history_cursor = history_cursor < max_history - 1 ? history_cursor + 1 : 0;
+        }
+
+        /// <returns>The number of frames currently in the history</returns>
+        size_t size() const
+        {
+            return history.size();
+        }
+
+        size_t get_max_history() const
+        {
+            return max_history;
+        }
+
+        /// <summary>
+        /// Change how many frames are kept, this clears the history
+        /// </summary>
+        void set_max_history(size_t frames)
+        {
+            max_history = frames > 0 ? frames : 1;
+            history_cursor = 0;
+            history.clear();
+        }
+
+        /// <summary>
+        /// Get a frame by age, 0 is the most recent frame and size() - 1 is the oldest
+        /// </summary>
+        const render_stats& get(size_t age) const
+        {
+            const size_t newest = history_cursor > 0 ? history_cursor - 1 : history.size() - 1;
+            return history[(newest + history.size() - age % history.size()) % history.size()];
+        }
+
+        /// <returns>The mean of every frame in the history, except frames_reused which is summed</returns>
+        render_stats get_average() const
+        {
+            render_stats average;
+            if (history.empty()) return average;
+
+            for (const auto& stats : history)
+            {
+                average.viewports_rendered += stats.viewports_rendered;
+                average.tiles_iterated += stats.tiles_iterated;
+                average.tiles_drawn += stats.tiles_drawn;
+                average.animated_tiles_drawn += stats.animated_tiles_drawn;
+                average.draw_calls += stats.draw_calls;
+                average.texture_switches += stats.texture_switches;
+                average.alpha_mod_changes += stats.alpha_mod_changes;
+                average.chunks_drawn += stats.chunks_drawn;
+                average.chunks_baked += stats.chunks_baked;
+                average.scroll_tiles_drawn += stats.scroll_tiles_drawn;
+                average.imposters_drawn += stats.imposters_drawn;
+                average.imposters_baked += stats.imposters_baked;
+                average.objects_rendered += stats.objects_rendered;
+                average.objects_culled += stats.objects_culled;
+                average.frames_reused += stats.frames_reused;
+                average.update_ms += stats.update_ms;
+                average.chunk_cache_ms += stats.chunk_cache_ms;
+                average.tiles_ms += stats.tiles_ms;
+                average.submit_ms += stats.submit_ms;
+                average.objects_ms += stats.objects_ms;
+            }
+
+            const size_t count = history.size();
+            average.frame = get(0).frame;
+            average.viewports_rendered /= count;
+            average.tiles_iterated /= count;
+            average.tiles_drawn /= count;
+            average.animated_tiles_drawn /= count;
+            average.draw_calls /= count;
+            average.texture_switches /= count;
+            average.alpha_mod_changes /= count;
+            average.chunks_drawn /= count;
+            average.chunks_baked /= count;
+            average.scroll_tiles_drawn /= count;
+            average.imposters_drawn /= count;
+            average.imposters_baked /= count;
+            average.objects_rendered /= count;
+            average.objects_culled /= count;
+            average.update_ms /= count;
+            average.chunk_cache_ms /= count;
+            average.tiles_ms /= count;
+            average.submit_ms /= count;
+            average.objects_ms /= count;
+
+            return average;
+        }
+
+        void clear()
+        {
+            history_cursor = 0;
+            history.clear();
+        }
+    };
+
+}
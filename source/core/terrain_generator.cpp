@@ -0,0 +1,160 @@
+#include "terrain_generator.h"
+#include "../tools/parallel.h"
+#include "../tools/profiler.h"
+#include "../tools/random.h"
+#include "../tools/stopwatch.h"
+#include <array>
+
+using namespace isometric;
+using namespace isometric::tools;
+
+namespace {
+
+    // Every use of the seed gets its own stream of hashes:
+    constexpr uint64_t elevation_stream = 1;
+    constexpr uint64_t moisture_stream = 2;
+    constexpr uint64_t image_stream = 3;
+
+}
+
+terrain_generator::terrain_generator(uint64_t seed)
+    : seed(seed)
+{
+    moisture_noise.frequency = 1.0f / 96.0f;
+    moisture_noise.octaves = 3;
+}
+
+std::shared_ptr<terrain_generator> terrain_generator::create(uint64_t seed)
+{
+    return std::shared_ptr<terrain_generator>(new terrain_generator(seed));
+}
+
+void terrain_generator::set_elevation_noise(const fractal_noise& settings)
+{
+    elevation_noise = settings;
+}
+
+void terrain_generator::set_moisture_noise(const fractal_noise& settings)
+{
+    moisture_noise = settings;
+}
+
+void terrain_generator::add_biome(const terrain_biome& biome)
+{
+    biomes.push_back(biome);
+}
+
+const terrain_biome* terrain_generator::find_biome(int x, int y) const
+{
+    return find_biome(
+        noise::fractal(get_elevation_seed(), elevation_noise, x, y),
+        noise::fractal(get_moisture_seed(), moisture_noise, x, y));
+}
+
+const terrain_biome* terrain_generator::find_biome(float elevation, float moisture) const
+{
+    for (const terrain_biome& biome : biomes)
+    {
+        if (biome.contains(elevation, moisture)) return &biome;
+    }
+
+    return nullptr;
+}
+
+uint64_t terrain_generator::get_elevation_seed() const
+{
+    return random::hash(seed, elevation_stream);
+}
+
+uint64_t terrain_generator::get_moisture_seed() const
+{
+    return random::hash(seed, moisture_stream);
+}
+
+void terrain_generator::fill_chunk(const tile_map& map, tile_chunk& chunk) const
+{
+    ISOMETRIC_PROFILE_ZONE("terrain_generator::fill_chunk");
+
+    if (chunk.get_tile_x() >= map.get_map_width() || chunk.get_tile_y() >= map.get_map_height()) return;
+
+    const unsigned width = std::min(tile_chunk::size, map.get_map_width() - chunk.get_tile_x());
+    const unsigned height = std::min(tile_chunk::size, map.get_map_height() - chunk.get_tile_y());
+
+    tile_planes& planes = chunk.get_planes();
+    const uint64_t elevation_seed = get_elevation_seed();
+    const uint64_t moisture_seed = get_moisture_seed();
+    const uint64_t image_seed = random::hash(seed, image_stream);
+
+    std::array<float, tile_chunk::size> elevation;
+    std::array<float, tile_chunk::size> moisture;
+    std::array<const terrain_biome*, tile_chunk::size> row_biomes;
+    std::vector<std::array<uint64_t, tile_chunk::size>> layer_hashes(planes.layers.size());
+
+    for (unsigned local_y = 0; local_y < height; local_y++)
+    {
+        const int y = static_cast<int>(chunk.get_tile_y() + local_y);
+        const int x_begin = static_cast<int>(chunk.get_tile_x());
+
+        // The noise is computed a row at a time, the biome rules then only look values up:
+        noise::fractal_row(std::span<float>(elevation.data(), width), elevation_seed, elevation_noise, x_begin, y);
+        noise::fractal_row(std::span<float>(moisture.data(), width), moisture_seed, moisture_noise, x_begin, y);
+
+        for (unsigned local_x = 0; local_x < width; local_x++)
+        {
+            row_biomes[local_x] = find_biome(elevation[local_x], moisture[local_x]);
+        }
+
+        for (size_t layer_id = 0; layer_id < layer_hashes.size(); layer_id++)
+        {
+            random::hash_row(std::span<uint64_t>(layer_hashes[layer_id].data(), width), image_seed, x_begin, y, layer_id);
+        }
+
+        for (unsigned local_x = 0; local_x < width; local_x++)
+        {
+            const terrain_biome* biome = row_biomes[local_x];
+            if (!biome) continue;
+
+            const size_t index = tile_chunk::local_index(local_x, local_y);
+            for (const terrain_layer_rule& rule : biome->layers)
+            {
+                if (rule.layer_id >= planes.layers.size() || rule.image_ids.empty()) continue;
+
+                tile_image_id& image = planes.layers[rule.layer_id][index];
+                if (image != no_tile_image) continue;
+
+                // The low bits decide whether there's an image and the high bits which one:
+                const uint64_t hash = layer_hashes[rule.layer_id][local_x];
+                if (static_cast<float>(hash & 0xFFFFFF) * 0x1.0p-24F >= rule.density) continue;
+
+                const size_t choice = static_cast<size_t>(((hash >> 32) * rule.image_ids.size()) >> 32);
+                image = static_cast<tile_image_id>(rule.image_ids[choice]);
+                planes.occupied.set(index);
+                if (rule.blocks_passage) planes.passable.reset(index);
+            }
+        }
+    }
+
+    planes.mark_all_changed();
+}
+
+void terrain_generator::generate(tile_map& map) const
+{
+    stopwatch generate_stopwatch;
+    generate_stopwatch.start();
+
+    // Allocation changes the chunk table, so do it before any workers start:
+    map.allocate_all_chunks();
+
+    const unsigned chunks_wide = map.get_chunks_wide();
+    const size_t chunk_count = static_cast<size_t>(chunks_wide) * map.get_chunks_high();
+
+    parallel_for(chunk_count, [&](size_t chunk_index)
+    {
+        tile_chunk* chunk = map.find_chunk(static_cast<unsigned>(chunk_index % chunks_wide), static_cast<unsigned>(chunk_index / chunks_wide));
+        if (chunk) fill_chunk(map, *chunk);
+    });
+
+    generate_stopwatch.stop();
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Generated terrain for %zu chunks (%u x %u tiles) in %.2f ms",
+        chunk_count, map.get_map_width(), map.get_map_height(), generate_stopwatch.get_elapsed_ms());
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include "tile_map.h"
+#include "../tools/noise.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// The images a terrain_biome puts in one layer
+    /// </summary>
+    struct terrain_layer_rule
+    {
+        unsigned layer_id = 0;
+        std::vector<unsigned> image_ids;    // One is picked per tile by a hash of the seed and position
+        float density = 1.0f;               // The chance a tile gets an image in this layer at all, for scatter
+        bool blocks_passage = false;        // Tiles given an image in this layer become impassable
+    };
+
+    /// <summary>
+    /// A region of the terrain, chosen where the elevation and moisture noise fall within its ranges
+    /// </summary>
+    struct terrain_biome
+    {
+        static constexpr float unbounded = std::numeric_limits<float>::infinity();
+
+        std::string name;
+        float min_elevation = -unbounded;
+        float max_elevation = unbounded;
+        float min_moisture = -unbounded;
+        float max_moisture = unbounded;
+        std::vector<terrain_layer_rule> layers;
+
+        bool contains(float elevation, float moisture) const
+        {
+            return
+                elevation >= min_elevation && elevation < max_elevation &&
+                moisture >= min_moisture && moisture < max_moisture;
+        }
+    };
+
+    /// <summary>
+    /// Procedural terrain for a tile_map. Two fractal noise fields, elevation and moisture, pick a biome for every
+    /// tile and the biome's rules pick its images. Every tile only depends on the seed and its position, so chunks
+    /// can be generated in any order on any thread, on demand through chunk_streamer::set_generator or all at once
+    /// with generate() and then saved to a map_file.
+    /// </summary>
+    class terrain_generator
+    {
+    private:
+        uint64_t seed = 0;
+        tools::fractal_noise elevation_noise;
+        tools::fractal_noise moisture_noise;
+        std::vector<terrain_biome> biomes;
+
+        explicit terrain_generator(uint64_t seed);
+
+    public:
+        static std::shared_ptr<terrain_generator> create(uint64_t seed);
+
+        uint64_t get_seed() const { return seed; }
+
+        void set_elevation_noise(const tools::fractal_noise& settings);
+        const tools::fractal_noise& get_elevation_noise() const { return elevation_noise; }
+
+        void set_moisture_noise(const tools::fractal_noise& settings);
+        const tools::fractal_noise& get_moisture_noise() const { return moisture_noise; }
+
+        /// <summary>
+        /// Biomes are tested in the order they were added and the first one that contains a tile's elevation and
+        /// moisture is used, tiles no biome contains are left as they are. Configure the generator before
+        /// generating, it's read by several threads at once while generating.
+        /// </summary>
+        void add_biome(const terrain_biome& biome);
+        const std::vector<terrain_biome>& get_biomes() const { return biomes; }
+
+        /// <returns>The biome at a tile, or nullptr if no biome contains it</returns>
+        const terrain_biome* find_biome(int x, int y) const;
+
+        /// <summary>
+        /// Generate the tiles of one chunk of the map. Tiles that already have an image in a layer keep it, so
+        /// hand placed content survives. Safe to call from several threads at once for different chunks.
+        /// </summary>
+        void fill_chunk(const tile_map& map, tile_chunk& chunk) const;
+
+        /// <summary>
+        /// Allocate every chunk of the map and generate them in parallel on the job system
+        /// </summary>
+        void generate(tile_map& map) const;
+
+    private:
+        const terrain_biome* find_biome(float elevation, float moisture) const;
+        uint64_t get_elevation_seed() const;
+        uint64_t get_moisture_seed() const;
+    };
+
+}
@@ -1,63 +1,102 @@
 #pragma once
-#include <unordered_map>
+#include <SDL.h>
+#include "tile_planes.h"
 
 namespace isometric {
 
+    /// <summary>
+    /// A lightweight view of a single tile inside of a tile_map's planes. Tiles are not stored as objects, copying
+    /// a tile only copies the view. A default constructed tile is invalid and refers to nothing.
+    /// </summary>
     class tile
     {
     private:
-        bool enabled = true;
-        bool passable = true;
-        bool empty = true;
-        std::unordered_map<unsigned, unsigned> image_ids;
+        tile_planes* planes = nullptr;
+        size_t index = 0;
 
     public:
-        tile(bool passable = true, bool enabled = true) : passable(passable), enabled(enabled),
-            empty(false)
-        {}
+        tile() {}
+        tile(tile_planes* planes, size_t index) : planes(planes), index(index) {}
+
+        bool is_valid() const
+        {
+            return planes != nullptr;
+        }
+
+        explicit operator bool() const
+        {
+            return is_valid();
+        }
 
         bool is_empty() const
         {
-            return empty;
+            return !planes->occupied.test(index);
         }
 
         bool is_passable() const
         {
-            return passable;
+            return planes->passable.test(index);
+        }
+
+        void set_passable(bool passable = true)
+        {
+            planes->passable.set(index, passable);
+            planes->mark_changed(index);
         }
 
         bool is_enabled() const
         {
-            return enabled;
+            return planes->enabled.test(index);
+        }
+
+        void set_enabled(bool enabled = true)
+        {
+            planes->enabled.set(index, enabled);
+            planes->mark_changed(index);
         }
 
         bool has_image(unsigned layer_id) const
         {
-            return image_ids.contains(layer_id);
+            return layer_id < planes->layers.size() && planes->layers[layer_id][index] != no_tile_image;
         }
 
         void set_image_id(unsigned layer_id, unsigned image_id)
         {
-            image_ids[layer_id] = image_id;
-            this->empty = false;
+            if (layer_id >= planes->layers.size()) return;
+
+            // Ids this large don't fit a plane and would wrap to another image, tile_map::add_image rejects them too:
+            if (image_id >= no_tile_image)
+            {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Tile image id (%u) is too large, the maximum is %u",
+                    image_id, no_tile_image - 1U);
+                clear_image(layer_id);
+                return;
+            }
+
+            planes->layers[layer_id][index] = static_cast<tile_image_id>(image_id);
+            planes->occupied.set(index);
+            planes->mark_changed(index);
+        }
+
+        void clear_image(unsigned layer_id)
+        {
+            if (layer_id >= planes->layers.size()) return;
+
+            planes->layers[layer_id][index] = no_tile_image;
+            planes->mark_changed(index);
         }
 
         unsigned get_image_id(unsigned layer_id) const
         {
-            if (image_ids.contains(layer_id))
+            if (has_image(layer_id))
             {
-                return image_ids.at(layer_id);
+                return planes->layers[layer_id][index];
             }
             else
             {
                 return 0;
             }
         }
-
-        const std::unordered_map<unsigned, unsigned>& get_image_ids() const
-        {
-            return image_ids;
-        }
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,50 @@
+#include "tile_animation.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace isometric;
+
+tile_animation tile_animation::create(std::string name, unsigned image_id, const std::vector<tile_animation_frame>& frames)
+{
+    tile_animation animation;
+    animation.name = name;
+    animation.image_id = image_id;
+
+    for (const tile_animation_frame& frame : frames)
+    {
+        if (!(frame.duration > 0.0f)) continue;
+
+        animation.frames.push_back(frame);
+        animation.duration += frame.duration;
+        animation.frame_ends.push_back(animation.duration);
+    }
+
+    // Most animations are evenly timed, their frame is found with a division instead of a search:
+    const bool uniform = !animation.frames.empty() && std::all_of(animation.frames.begin(), animation.frames.end(),
+        [&animation](const tile_animation_frame& frame) { return frame.duration == animation.frames.front().duration; });
+    animation.uniform_duration = uniform ? animation.frames.front().duration : 0.0;
+
+    return animation;
+}
+
+tile_animation tile_animation::create(std::string name, unsigned image_id, unsigned first_frame_id, unsigned frame_count, float frame_duration)
+{
+    std::vector<tile_animation_frame> frames;
+    frames.reserve(frame_count);
+    for (unsigned i = 0; i < frame_count; i++) frames.push_back(tile_animation_frame{ first_frame_id + i, frame_duration });
+
+    return create(name, image_id, frames);
+}
+
+size_t tile_animation::get_frame_index(double time) const
+{
+    if (frames.size() <= 1) return 0;
+
+    double loop_time = std::fmod(time, duration);
+    if (loop_time < 0.0) loop_time += duration;
+
+    if (uniform_duration > 0.0) return std::min(static_cast<size_t>(loop_time / uniform_duration), frames.size() - 1);
+
+    const auto end = std::upper_bound(frame_ends.begin(), frame_ends.end(), loop_time);
+    return std::min(static_cast<size_t>(end - frame_ends.begin()), frames.size() - 1);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace isometric {
+
+    /// <summary>
+    /// One frame of a tile_animation, an image of the map shown for a duration
+    /// </summary>
+    struct tile_animation_frame
+    {
+        unsigned image_id = 0;
+        float duration = 0.1f;  // Seconds
+    };
+
+    /// <summary>
+    /// A looping sequence of tile images, like water or foliage swaying. Tiles use the animation's image id like any
+    /// other image, and tile_map resolves it to the current frame from one clock for every tile at once, so tiles
+    /// are never updated to animate them. See tile_map::add_animation.
+    /// </summary>
+    class tile_animation
+    {
+    private:
+        unsigned image_id = 0;
+        std::string name;
+        std::vector<tile_animation_frame> frames;
+        std::vector<double> frame_ends;     // When each frame ends, in seconds into the loop
+        double duration = 0.0;
+        double uniform_duration = 0.0;      // Every frame's duration when they're all the same, 0 otherwise
+
+    public:
+        tile_animation() {}
+
+        /// <param name="image_id">The id tiles use to show the animation</param>
+        /// <param name="frames">Frames without a positive duration are left out</param>
+        static tile_animation create(std::string name, unsigned image_id, const std::vector<tile_animation_frame>& frames);
+
+        /// <summary>
+        /// The same number of frames, each shown for the same time, from consecutive image ids
+        /// </summary>
+        static tile_animation create(std::string name, unsigned image_id, unsigned first_frame_id, unsigned frame_count, float frame_duration);
+
+        unsigned get_image_id() const { return image_id; }
+        const std::string& get_name() const { return name; }
+        const std::vector<tile_animation_frame>& get_frames() const { return frames; }
+
+        /// <returns>Seconds until the animation loops</returns>
+        double get_duration() const { return duration; }
+
+        bool is_empty() const { return frames.empty(); }
+
+        /// <returns>The index of the frame shown at time, in seconds on the animation clock</returns>
+        size_t get_frame_index(double time) const;
+
+        /// <returns>The image id of the frame shown at time, the animation's own id if it has no frames</returns>
+        unsigned get_frame_image_id(double time) const
+        {
+            return frames.empty() ? image_id : frames[get_frame_index(time)].image_id;
+        }
+    };
+
+}
@@ -0,0 +1,145 @@
+#include "tile_change_journal.h"
+#include "tile_planes.h"
+#include <algorithm>
+#include <map>
+
+using namespace isometric;
+
+namespace {
+
+    void reset_journal_state(tile_planes& planes)
+    {
+        planes.journal_pending = false;
+        planes.journal_whole = false;
+        planes.journal_tiles.fill(false);
+    }
+
+    /// <summary>
+    /// Fold a later change of the same chunk into an earlier one
+    /// </summary>
+    void merge_change(tile_chunk_change& merged, const tile_chunk_change& later)
+    {
+        if (later.change != tile_chunk_change::kind::tiles || merged.change == tile_chunk_change::kind::released)
+        {
+            // Released and then installed again is as good as a whole new chunk:
+            merged.change = later.change == tile_chunk_change::kind::tiles ? tile_chunk_change::kind::whole : later.change;
+            merged.tiles.clear();
+            return;
+        }
+
+        if (merged.change == tile_chunk_change::kind::whole) return;
+
+        std::vector<uint16_t> tiles;
+        tiles.reserve(merged.tiles.size() + later.tiles.size());
+        std::set_union(merged.tiles.begin(), merged.tiles.end(), later.tiles.begin(), later.tiles.end(), std::back_inserter(tiles));
+        merged.tiles.swap(tiles);
+    }
+
+}
+
+void tile_change_journal::open_chunk(tile_planes& planes)
+{
+    if (planes.journal_tiles.size() != planes.tile_count) planes.journal_tiles.resize(planes.tile_count);
+    planes.journal_pending = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(pending_chunk{ planes.chunk_index, &planes });
+}
+
+void tile_change_journal::release_chunk(uint32_t chunk_index, tile_planes& planes)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& chunk : pending)
+        {
+            if (chunk.planes == &planes) chunk.planes = nullptr;
+        }
+        pending.push_back(pending_chunk{ chunk_index, nullptr });
+    }
+
+    reset_journal_state(planes);
+    planes.journal = nullptr;
+}
+
+uint64_t tile_change_journal::commit()
+{
+    std::vector<pending_chunk> closing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing.swap(pending);
+    }
+
+    if (closing.empty()) return version;
+
+    // A chunk can be listed more than once when it was released and installed again within the frame:
+    std::map<uint32_t, tile_chunk_change> changes;
+    for (const pending_chunk& chunk : closing)
+    {
+        tile_chunk_change change;
+        change.chunk_index = chunk.chunk_index;
+
+        if (!chunk.planes)
+        {
+            change.change = tile_chunk_change::kind::released;
+        }
+        else if (chunk.planes->journal_whole)
+        {
+            change.change = tile_chunk_change::kind::whole;
+        }
+        else
+        {
+            const tools::dynamic_bitset& tiles = chunk.planes->journal_tiles;
+            for (size_t index = 0; index < tiles.size(); index++)
+            {
+                if (tiles.test(index)) change.tiles.push_back(static_cast<uint16_t>(index));
+            }
+        }
+
+        if (chunk.planes) reset_journal_state(*chunk.planes);
+
+        auto [existing, inserted] = changes.emplace(chunk.chunk_index, change);
+        if (!inserted) merge_change(existing->second, change);
+    }
+
+    frame closed{ ++version };
+    closed.chunks.reserve(changes.size());
+    for (auto& [chunk_index, change] : changes) closed.chunks.push_back(std::move(change));
+
+    history.push_back(std::move(closed));
+    while (history.size() > history_limit) history.pop_front();
+
+    return version;
+}
+
+bool tile_change_journal::get_changes_since(uint64_t since_version, tile_map_delta& delta) const
+{
+    delta.from_version = since_version;
+    delta.to_version = version;
+    delta.chunks.clear();
+
+    if (since_version >= version) return true;
+    if (since_version < get_oldest_version()) return false;
+
+    std::map<uint32_t, tile_chunk_change> changes;
+    for (const frame& committed : history)
+    {
+        if (committed.version <= since_version) continue;
+
+        for (const tile_chunk_change& change : committed.chunks)
+        {
+            auto [existing, inserted] = changes.emplace(change.chunk_index, change);
+            if (!inserted) merge_change(existing->second, change);
+        }
+    }
+
+    delta.chunks.reserve(changes.size());
+    for (auto& [chunk_index, change] : changes) delta.chunks.push_back(std::move(change));
+
+    return true;
+}
+
+void tile_change_journal::set_history_limit(size_t versions)
+{
+    history_limit = std::max<size_t>(versions, 1);
+    while (history.size() > history_limit) history.pop_front();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace isometric {
+
+    struct tile_planes;
+
+    /// <summary>
+    /// What changed in one chunk between two versions of a tile_map
+    /// </summary>
+    struct tile_chunk_change
+    {
+        enum class kind : uint8_t {
+            tiles,      // Only the listed tiles changed
+            whole,      // Allocated, installed or given a layer, any tile may differ
+            released    // No longer resident
+        };
+
+        uint32_t chunk_index = 0;   // chunk_x + chunk_y * chunks_wide
+        kind change = kind::tiles;
+        std::vector<uint16_t> tiles;    // Sorted tile indices within the chunk, see tile_chunk::local_index
+    };
+
+    /// <summary>
+    /// The chunks and tiles that changed from one version of a tile_map to another, see tile_map::get_changes_since
+    /// </summary>
+    struct tile_map_delta
+    {
+        uint64_t from_version = 0;
+        uint64_t to_version = 0;
+        std::vector<tile_chunk_change> chunks;  // Sorted by chunk index
+
+        bool is_empty() const { return chunks.empty(); }
+
+        size_t get_tile_count() const
+        {
+            size_t count = 0;
+            for (const auto& chunk : chunks) count += chunk.tiles.size();
+            return count;
+        }
+    };
+
+    /// <summary>
+    /// Records which tiles of a tile_map change, frame by frame. Tile edits only set a bit in their chunk's planes;
+    /// a chunk's first edit of a frame lists the chunk here, under a lock, so chunks may be edited in parallel as long
+    /// as each is edited by one thread at a time. commit() closes the frame into the history under the next version.
+    /// </summary>
+    class tile_change_journal
+    {
+    private:
+        struct pending_chunk
+        {
+            uint32_t chunk_index;
+            tile_planes* planes;    // nullptr once the chunk was released
+        };
+
+        struct frame
+        {
+            uint64_t version;
+            std::vector<tile_chunk_change> chunks;
+        };
+
+        std::mutex mutex;                   // Guards pending
+        std::vector<pending_chunk> pending;
+
+        std::deque<frame> history;
+        size_t history_limit = 600;
+        uint64_t version = 0;
+
+    public:
+        tile_change_journal() {}
+
+        tile_change_journal(const tile_change_journal&) = delete;
+        tile_change_journal& operator=(const tile_change_journal&) = delete;
+
+        /// <summary>
+        /// Called by tile_planes the first time they change after a commit
+        /// </summary>
+        void open_chunk(tile_planes& planes);
+
+        /// <summary>
+        /// Called by tile_map when a chunk stops being resident, the planes stop being journaled
+        /// </summary>
+        void release_chunk(uint32_t chunk_index, tile_planes& planes);
+
+        /// <summary>
+        /// Close the changes made since the last commit into a new version. Must not run while tiles are edited.
+        /// </summary>
+        /// <returns>The new version, or the current one if nothing changed</returns>
+        uint64_t commit();
+
+        /// <returns>The version of the last commit that had changes, 0 before the first</returns>
+        uint64_t get_version() const { return version; }
+
+        /// <returns>The oldest version get_changes_since still has the changes after</returns>
+        uint64_t get_oldest_version() const { return history.empty() ? version : history.front().version - 1; }
+
+        /// <summary>
+        /// The changes committed after a version, merged per chunk
+        /// </summary>
+        /// <returns>False if the version is older than the history kept, everything has to be sent again</returns>
+        bool get_changes_since(uint64_t since_version, tile_map_delta& delta) const;
+
+        /// <summary>
+        /// How many committed versions are kept for get_changes_since
+        /// </summary>
+        void set_history_limit(size_t versions);
+        size_t get_history_limit() const { return history_limit; }
+    };
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "tile_planes.h"
+#include "tile.h"
+#include "../tools/memory_tracker.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// A fixed size square block of tiles. A tile_map only allocates chunks when they are first written to or
+    /// viewed, so regions of the map that are never touched cost a single null pointer.
+    /// </summary>
+    class tile_chunk
+    {
+    public:
+        static constexpr unsigned size = 32; // Width and height in tiles
+        static constexpr unsigned tile_count = size * size;
+
+    private:
+        unsigned chunk_x = 0;   // by chunks
+        unsigned chunk_y = 0;   // by chunks
+        uint64_t instance_id = 0;
+        tile_planes planes;
+        size_t tracked_bytes = 0;   // Counted in memory_tracker::tiles while the chunk lives
+
+    public:
+        tile_chunk(unsigned chunk_x, unsigned chunk_y, size_t layer_count) : chunk_x(chunk_x), chunk_y(chunk_y)
+        {
+            planes.resize(tile_count, layer_count);
+            tracked_bytes = sizeof(tile_chunk) + planes.get_byte_size();
+            tools::memory_tracker::tiles().add(tracked_bytes);
+        }
+
+        ~tile_chunk()
+        {
+            tools::memory_tracker::tiles().remove(tracked_bytes);
+        }
+
+        tile_chunk(const tile_chunk&) = delete;
+        tile_chunk& operator=(const tile_chunk&) = delete;
+
+        unsigned get_chunk_x() const { return chunk_x; }
+        unsigned get_chunk_y() const { return chunk_y; }
+
+        /// <summary>
+        /// Unique per map for every chunk allocated or installed, so caches can tell a reloaded chunk from the one
+        /// it replaced even when their revisions match
+        /// </summary>
+        uint64_t get_instance_id() const { return instance_id; }
+        void set_instance_id(uint64_t id) { instance_id = id; }
+
+        /// <returns>The x coordinate of the chunk's top left tile, in tiles</returns>
+        unsigned get_tile_x() const { return chunk_x * size; }
+
+        /// <returns>The y coordinate of the chunk's top left tile, in tiles</returns>
+        unsigned get_tile_y() const { return chunk_y * size; }
+
+        /// <summary>
+        /// Converts a tile position local to this chunk into an index within the chunk's planes
+        /// </summary>
+        static size_t local_index(unsigned local_x, unsigned local_y)
+        {
+            return local_x + static_cast<size_t>(local_y) * size;
+        }
+
+        /// <param name="local_x">Tile x relative to the chunk, 0 to size - 1</param>
+        /// <param name="local_y">Tile y relative to the chunk, 0 to size - 1</param>
+        tile get_tile(unsigned local_x, unsigned local_y)
+        {
+            return tile(&planes, local_index(local_x, local_y));
+        }
+
+        tile_planes& get_planes() { return planes; }
+        const tile_planes& get_planes() const { return planes; }
+    };
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <SDL.h>
+#include <cmath>
+
+namespace isometric {
+
+    /// <summary>
+    /// The size of the tiles of a map fixed at compile time. Conversions instantiated with it divide by constants, which
+    /// the compiler folds into multiplications (exact for powers of two, so the results don't change).
+    /// </summary>
+    template<unsigned TileWidth, unsigned TileHeight>
+    struct iso_geometry
+    {
+        static_assert(TileWidth >= 2 && TileHeight >= 2 && TileWidth % 2 == 0 && TileHeight % 2 == 0,
+            "Tiles are positioned by their halves, their size must be even");
+
+        static constexpr unsigned width = TileWidth;
+        static constexpr unsigned height = TileHeight;
+
+        static constexpr bool matches(unsigned tile_width, unsigned tile_height)
+        {
+            return tile_width == TileWidth && tile_height == TileHeight;
+        }
+
+        constexpr float get_tile_width() const { return static_cast<float>(TileWidth); }
+        constexpr float get_tile_height() const { return static_cast<float>(TileHeight); }
+        constexpr float get_half_tile_width() const { return TileWidth / 2.0f; }
+        constexpr float get_half_tile_height() const { return TileHeight / 2.0f; }
+    };
+
+    /// <summary>
+    /// The 64x32 tiles every map in this project uses, transform takes a constant path for them
+    /// </summary>
+    using standard_iso_geometry = iso_geometry<64, 32>;
+
+    /// <summary>
+    /// The fallback for tile sizes only known at runtime, with the same interface as iso_geometry
+    /// </summary>
+    struct runtime_iso_geometry
+    {
+        float tile_width = 0.0f;
+        float tile_height = 0.0f;
+
+        runtime_iso_geometry(unsigned tile_width, unsigned tile_height)
+            : tile_width(static_cast<float>(tile_width)), tile_height(static_cast<float>(tile_height)) {}
+
+        float get_tile_width() const { return tile_width; }
+        float get_tile_height() const { return tile_height; }
+        float get_half_tile_width() const { return tile_width / 2.0f; }
+        float get_half_tile_height() const { return tile_height / 2.0f; }
+    };
+
+    namespace geometry {
+
+        /// <summary>
+        /// See transform::world_tile_to_world_pixels
+        /// </summary>
+        template<class Geometry>
+        SDL_FPoint world_tile_to_world_pixels(const Geometry& geometry, const SDL_Point& tile_point)
+        {
+            // Even rows are offset half a tile to the left, and the world is shifted up half a tile to cover the
+            // empty space above the first row:
+            return SDL_FPoint{
+                tile_point.x * geometry.get_tile_width() + ((tile_point.y & 1) == 0 ? -geometry.get_half_tile_width() : 0.0f),
+                tile_point.y * geometry.get_half_tile_height() - geometry.get_half_tile_height()
+            };
+        }
+
+        /// <summary>
+        /// See transform::world_pixels_to_world_tile
+        /// </summary>
+        template<class Geometry>
+        SDL_Point world_pixels_to_world_tile(const Geometry& geometry, const SDL_FPoint& point)
+        {
+            // Measured in half tiles, the center of every tile diamond lands on a whole number u, v where u + v is
+            // even. Rotating by 45 degrees turns the diamonds into squares, so the closest center on each of the
+            // rotated axes can be found independently by rounding down:
+            const float u = point.x / geometry.get_half_tile_width();
+            const float v = point.y / geometry.get_half_tile_height();
+
+            const int a = static_cast<int>(std::floor((u + v + 1.0f) / 2.0f));
+            const int b = static_cast<int>(std::floor((u - v + 1.0f) / 2.0f));
+
+            // The rotated back center is (a + b, a - b), its column is half of u rounded down:
+            return SDL_Point{ (a + b) >> 1, a - b };
+        }
+
+        /// <summary>
+        /// See transform::tile_hittest_by_viewport
+        /// </summary>
+        /// <param name="offset">The point relative to the top left of the tile, in unscaled pixels</param>
+        template<class Geometry>
+        bool tile_hittest(const Geometry& geometry, const SDL_FPoint& offset)
+        {
+            // The width of the diamond's pixel rows grows by 4 per row from 2 at the top, and shrinks again in the
+            // lower half:
+            const float row_width = offset.y < geometry.get_half_tile_height()
+                ? 2.0f + offset.y * 4.0f
+                : 2.0f + ((geometry.get_tile_height() - offset.y) - 1) * 4.0f;
+
+            const float row_start = geometry.get_half_tile_width() - row_width / 2.0f;
+            const float row_end = row_start + row_width;
+
+            return offset.x >= row_start - 1 && offset.x < row_end - 1;
+        }
+
+        /// <summary>
+        /// The tile grid rotated by 45 degrees, in which the diamonds become squares: tiles that share an edge differ
+        /// by one in either x or y, tiles that only share a corner differ by one in both. This is the same rotation
+        /// world_pixels_to_world_tile rounds in.
+        /// </summary>
+        inline SDL_Point world_tile_to_diamond(const SDL_Point& tile_point)
+        {
+            // The center in half tiles is (2x + 1 for odd rows, y), u + v is always even:
+            const int u = tile_point.x * 2 + (tile_point.y & 1);
+            return SDL_Point{ (u + tile_point.y) >> 1, (u - tile_point.y) >> 1 };
+        }
+
+        inline SDL_Point diamond_to_world_tile(const SDL_Point& diamond_point)
+        {
+            const int u = diamond_point.x + diamond_point.y;
+            const int y = diamond_point.x - diamond_point.y;
+            return SDL_Point{ (u - (y & 1)) >> 1, y };
+        }
+
+        /// <summary>
+        /// The steps to the 8 neighbours of a tile in diamond coordinates, the first 4 cross an edge of the diamond
+        /// and the others only touch a corner
+        /// </summary>
+        inline constexpr SDL_Point diamond_directions[8] = {
+            { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }
+        };
+
+        /// <returns>The neighbour of a tile in one of the diamond_directions</returns>
+        inline SDL_Point step_world_tile(const SDL_Point& tile_point, unsigned direction)
+        {
+            const SDL_Point diamond = world_tile_to_diamond(tile_point);
+            const SDL_Point& step = diamond_directions[direction];
+            return diamond_to_world_tile(SDL_Point{ diamond.x + step.x, diamond.y + step.y });
+        }
+
+    }
+
+}
@@ -5,6 +5,10 @@
 
 namespace isometric {
 
+    /// <summary>
+    /// A plain record describing where a tile's image is in a texture and how it's drawn. tile_map stores these by
+    /// value in a table indexed by image id. A default constructed tile_image is empty.
+    /// </summary>
     class tile_image
     {
     private:
@@ -17,39 +21,62 @@ namespace isometric {
         unsigned source_y = 0;
         unsigned source_w = 0;
         unsigned source_h = 0;
-
-        tile_image() {}
+        SDL_Rect source_rect{ 0 };
+        float offset_y = 0.0f;      // Added to the tile position when drawn, negative for images taller than a tile
 
     public:
+        tile_image() {}
 
-        static std::shared_ptr<tile_image> create(unsigned image_id, SDL_Texture* texture, unsigned source_x, unsigned source_y, unsigned source_w, unsigned source_h)
+        static tile_image create(unsigned image_id, SDL_Texture* texture, unsigned source_x, unsigned source_y, unsigned source_w, unsigned source_h)
         {
             return create(std::string(), image_id, texture, source_x, source_y, source_w, source_h);
         }
 
-        static std::shared_ptr<tile_image> create(std::string name, unsigned image_id, SDL_Texture* texture, unsigned source_x, unsigned source_y, unsigned source_w, unsigned source_h)
+        static tile_image create(std::string name, unsigned image_id, SDL_Texture* texture, unsigned source_x, unsigned source_y, unsigned source_w, unsigned source_h)
         {
-            auto image = std::shared_ptr<tile_image>(new tile_image);
+            tile_image image;
 
-            image->name = name;
-            image->image_id = image_id;
+            image.name = name;
+            image.image_id = image_id;
 
-            image->texture = texture;
+            image.texture = texture;
 
-            image->source_x = source_x;
-            image->source_y = source_y;
+            image.source_x = source_x;
+            image.source_y = source_y;
 
-            image->source_w = source_w;
-            image->source_h = source_h;
+            image.source_w = source_w;
+            image.source_h = source_h;
+
+            image.source_rect = SDL_Rect{
+                static_cast<int>(source_x),
+                static_cast<int>(source_y),
+                static_cast<int>(source_w),
+                static_cast<int>(source_h)
+            };
 
             return image;
         }
 
+        /// <summary>
+        /// Create an image from a rectangle of a texture, such as a subimage of an atlas page from atlas_builder
+        /// </summary>
+        static tile_image create(std::string name, unsigned image_id, SDL_Texture* texture, const SDL_Rect& source_rect)
+        {
+            return create(name, image_id, texture,
+                static_cast<unsigned>(source_rect.x), static_cast<unsigned>(source_rect.y),
+                static_cast<unsigned>(source_rect.w), static_cast<unsigned>(source_rect.h));
+        }
+
         unsigned get_image_id() const
         {
             return image_id;
         }
 
+        const std::string& get_name() const
+        {
+            return name;
+        }
+
         SDL_Texture* get_texture() const
         {
             return texture;
@@ -60,6 +87,11 @@ namespace isometric {
             return texture != nullptr;
         }
 
+        void set_texture(SDL_Texture* texture)
+        {
+            this->texture = texture;
+        }
+
         unsigned get_source_x() const
         {
             return source_x;
@@ -80,9 +112,33 @@ namespace isometric {
             return source_h;
         }
 
-        const SDL_Rect* get_source_rect() const;
+        /// <returns>Where the tile is in the source texture</returns>
+        const SDL_Rect& get_source_rect() const
+        {
+            return source_rect;
+        }
+
+        /// <summary>
+        /// Precompute the offset used by get_dest_rect, images taller than tile_height are bottom aligned so they
+        /// extend upwards from the tile. tile_map::add_image does this with the map's tile height.
+        /// </summary>
+        void align_to_tile_height(unsigned tile_height);
 
-        const SDL_FRect* get_dest_rect(float x, float y, unsigned tile_height = 0) const;
+        /// <summary>
+        /// Where to draw the tile image for a tile positioned at x, y
+        /// </summary>
+        SDL_FRect get_dest_rect(float x, float y) const
+        {
+            return SDL_FRect{ x, y + offset_y, static_cast<float>(source_w), static_cast<float>(source_h) };
+        }
+
+        /// <summary>
+        /// Same as get_dest_rect, for tiles drawn scaled, like by a zoomed camera
+        /// </summary>
+        SDL_FRect get_dest_rect(float x, float y, float scale) const
+        {
+            return SDL_FRect{ x, y + offset_y * scale, source_w * scale, source_h * scale };
+        }
 
         bool is_empty() const
         {
@@ -1,10 +1,104 @@
 #include "tile_map.h"
 #include "../source/tools/random.h"
+#include "../source/tools/parallel.h"
+#include "../source/tools/stopwatch.h"
+#include "../source/tools/run_length.h"
 #include <limits>
+#include <utility>
+#include <cstring>
 
 using namespace isometric;
 using namespace isometric::tools;
 
+namespace {
+
+    constexpr uint32_t delta_magic = 0x544C4449;   // "IDLT"
+
+    constexpr uint8_t tile_enabled_bit = 1;
+    constexpr uint8_t tile_passable_bit = 2;
+    constexpr uint8_t tile_occupied_bit = 4;
+
+    // Flag plane words are stored as 16 bit units so whole chunks can be run length encoded in one stream:
+    constexpr size_t units_per_word = sizeof(dynamic_bitset::word_type) / sizeof(uint16_t);
+    constexpr size_t flag_plane_units = tile_chunk::tile_count / dynamic_bitset::bits_per_word * units_per_word;
+
+    void write_varint(std::vector<uint8_t>& data, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(value));
+    }
+
+    struct delta_reader
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t offset = 0;
+        bool failed = false;
+
+        uint8_t read_byte()
+        {
+            if (offset >= size)
+            {
+                failed = true;
+                return 0;
+            }
+            return data[offset++];
+        }
+
+        uint64_t read_varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                const uint8_t byte = read_byte();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+
+            failed = true;
+            return 0;
+        }
+    };
+
+    void write_chunk_units(const tile_planes& planes, std::vector<uint16_t>& units)
+    {
+        units.clear();
+        for (const auto& layer : planes.layers) units.insert(units.end(), layer.begin(), layer.end());
+
+        for (const auto* flags : { &planes.enabled, &planes.passable, &planes.occupied })
+        {
+            for (dynamic_bitset::word_type word : flags->get_words())
+            {
+                for (size_t i = 0; i < units_per_word; i++) units.push_back(static_cast<uint16_t>(word >> (i * 16)));
+            }
+        }
+    }
+
+    void read_chunk_units(tile_planes& planes, const std::vector<uint16_t>& units)
+    {
+        size_t unit = 0;
+        for (auto& layer : planes.layers)
+        {
+            std::copy_n(units.begin() + unit, layer.size(), layer.begin());
+            unit += layer.size();
+        }
+
+        for (auto* flags : { &planes.enabled, &planes.passable, &planes.occupied })
+        {
+            for (dynamic_bitset::word_type& word : flags->get_words())
+            {
+                word = 0;
+                for (size_t i = 0; i < units_per_word; i++) word |= static_cast<dynamic_bitset::word_type>(units[unit++]) << (i * 16);
+            }
+        }
+    }
+
+}
+
 std::shared_ptr<tile_map> tile_map::create(unsigned map_width, unsigned map_height, unsigned tile_width, unsigned tile_height)
 {
     std::shared_ptr<tile_map> new_tile_map = std::shared_ptr<tile_map>(new tile_map);
@@ -13,35 +107,173 @@ std::shared_ptr<tile_map> tile_map::create(unsigned map_width, unsigned map_heig
     new_tile_map->map_height = map_height;
     new_tile_map->tile_width = tile_width;
     new_tile_map->tile_height = tile_height;
-    new_tile_map->tiles.resize(static_cast<size_t>(map_width * map_height));
+    new_tile_map->chunks_wide = (map_width + tile_chunk::size - 1) / tile_chunk::size;
+    new_tile_map->chunks_high = (map_height + tile_chunk::size - 1) / tile_chunk::size;
+    new_tile_map->chunks.resize(static_cast<size_t>(new_tile_map->chunks_wide) * new_tile_map->chunks_high);
 
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Created tile map [ %u x %u / %llu tiles ], [ %u x %u tile size]",
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Created tile map [ %u x %u / %llu tiles ], [ %u x %u tile size], [ %u x %u chunks ]",
         new_tile_map->map_width, new_tile_map->map_height,
-        new_tile_map->tiles.size(),
-        new_tile_map->tile_width, new_tile_map->tile_height
+        static_cast<unsigned long long>(map_width) * map_height,
+        new_tile_map->tile_width, new_tile_map->tile_height,
+        new_tile_map->chunks_wide, new_tile_map->chunks_high
     );
 
     return new_tile_map;
 }
 
-unsigned tile_map::add_image(std::shared_ptr<tile_image> image)
+size_t tile_map::retarget_texture(SDL_Texture* previous, SDL_Texture* replacement)
 {
-    tile_images[image->get_image_id()] = image;
-    return image->get_image_id();
+    if (!previous) return 0;
+
+    size_t count = 0;
+    for (tile_image& image : tile_images)
+    {
+        if (image.get_texture() != previous) continue;
+
+        image.set_texture(replacement);
+        count++;
+    }
+
+    return count;
 }
 
-std::shared_ptr<tile_image> tile_map::get_image(unsigned id) const
+unsigned tile_map::add_image(const tile_image& image)
 {
-    if (tile_images.contains(id))
+    const unsigned image_id = image.get_image_id();
+
+    if (image_id >= no_tile_image)
     {
-        return tile_images.at(id);
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Tile image [%s] has an id (%u) that is too large, the maximum is %u",
+            image.get_name().c_str(), image_id, no_tile_image - 1U);
+        return image_id;
     }
-    else
+
+    max_image_width = std::max(max_image_width, image.get_source_w());
+    max_image_height = std::max(max_image_height, image.get_source_h());
+
+    if (image_id >= tile_images.size()) tile_images.resize(image_id + 1);
+
+    tile_images[image_id] = image;
+    tile_images[image_id].align_to_tile_height(tile_height);
+
+    return image_id;
+}
+
+unsigned tile_map::get_image_count() const
+{
+    return static_cast<unsigned>(tile_images.size());
+}
+
+bool tile_map::add_animation(const tile_animation& animation)
+{
+    const unsigned image_id = animation.get_image_id();
+
+    if (animation.is_empty() || image_id >= no_tile_image)
     {
-        return nullptr;
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Tile animation [%s] has no frames or an id (%u) that is too large",
+            animation.get_name().c_str(), image_id);
+        return false;
+    }
+
+    for (const tile_animation_frame& frame : animation.get_frames())
+    {
+        if (!get_image(frame.image_id))
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Tile animation [%s] has a frame without an image (%u), it's drawn empty",
+                animation.get_name().c_str(), frame.image_id);
+        }
+    }
+
+    // A still of the animation, for whatever draws the id without resolving its frame:
+    const tile_image* first_frame = get_image(animation.get_frames().front().image_id);
+    if (!get_image(image_id) && first_frame)
+    {
+        add_image(tile_image::create(animation.get_name(), image_id, first_frame->get_texture(), first_frame->get_source_rect()));
+    }
+
+    remove_animation(image_id);
+    animations.push_back(animation);
+
+    if (image_id >= animation_frames.size()) animation_frames.resize(image_id + 1, no_tile_image);
+    animation_frames[image_id] = animation.get_frame_image_id(animation_time);
+    animation_revision++;
+    animation_set_revision++;
+
+    return true;
+}
+
+void tile_map::remove_animation(unsigned image_id)
+{
+    const auto found = std::find_if(animations.begin(), animations.end(),
+        [image_id](const tile_animation& animation) { return animation.get_image_id() == image_id; });
+    if (found == animations.end()) return;
+
+    animations.erase(found);
+    animation_frames[image_id] = no_tile_image;
+    animation_revision++;
+    animation_set_revision++;
+}
+
+const std::vector<tile_animation>& tile_map::get_animations() const
+{
+    return animations;
+}
+
+void tile_map::set_animation_time(double seconds)
+{
+    animation_time = seconds;
+
+    for (const tile_animation& animation : animations)
+    {
+        unsigned& current = animation_frames[animation.get_image_id()];
+        const unsigned frame = animation.get_frame_image_id(seconds);
+        if (frame == current) continue;
+
+        current = frame;
+        animation_revision++;
     }
 }
 
+double tile_map::get_animation_time() const
+{
+    return animation_time;
+}
+
+uint64_t tile_map::get_animation_revision() const
+{
+    return animation_revision;
+}
+
+uint64_t tile_map::get_animation_set_revision() const
+{
+    return animation_set_revision;
+}
+
+unsigned tile_map::get_max_image_width() const
+{
+    return max_image_width;
+}
+
+unsigned tile_map::get_max_image_height() const
+{
+    return max_image_height;
+}
+
+void tile_map::set_placeholder_image(unsigned id)
+{
+    placeholder_tile_image = id;
+}
+
+const tile_image* tile_map::get_placeholder_image() const
+{
+    return get_image(placeholder_tile_image);
+}
+
+unsigned tile_map::get_placeholder_image_id() const
+{
+    return placeholder_tile_image;
+}
+
 void tile_map::set_selection_image(unsigned id)
 {
     selection_tile_image = id;
@@ -49,19 +281,17 @@ void tile_map::set_selection_image(unsigned id)
 
 bool tile_map::has_selection_image() const
 {
-    return tile_images.contains(selection_tile_image);
+    return get_image(selection_tile_image) != nullptr;
 }
 
-std::shared_ptr<tile_image> tile_map::get_selection_image() const
+const tile_image* tile_map::get_selection_image() const
 {
-    if (has_selection_image())
-    {
-        return tile_images.at(selection_tile_image);
-    }
-    else
-    {
-        return nullptr;
-    }
+    return get_image(selection_tile_image);
+}
+
+unsigned tile_map::get_selection_image_id() const
+{
+    return selection_tile_image;
 }
 
 unsigned tile_map::add_layer(const std::string& layer_name)
@@ -69,6 +299,10 @@ unsigned tile_map::add_layer(const std::string& layer_name)
     if (std::find(layers.begin(), layers.end(), layer_name) == layers.end() /* Not found */)
     {
         layers.push_back(layer_name);
+        static_layers.push_back(true);
+        optional_layers.push_back(false);
+        hidden_layers.push_back(false);
+        for_each_chunk([](tile_chunk& chunk) { chunk.get_planes().add_layer(); });
         return static_cast<unsigned>(layers.size() - 1);
     }
     else
@@ -106,9 +340,136 @@ const std::string& tile_map::get_layer_name(unsigned layer_id) const
     }
 }
 
-const std::vector<tile>& tile_map::get_tiles() const
+void tile_map::set_layer_static(unsigned layer_id, bool is_static)
+{
+    if (layer_id < static_layers.size()) static_layers[layer_id] = is_static;
+}
+
+bool tile_map::is_layer_static(unsigned layer_id) const
+{
+    return layer_id < static_layers.size() && static_layers[layer_id];
+}
+
+void tile_map::set_layer_optional(unsigned layer_id, bool is_optional)
+{
+    if (layer_id < optional_layers.size()) optional_layers[layer_id] = is_optional;
+}
+
+bool tile_map::is_layer_optional(unsigned layer_id) const
+{
+    return layer_id < optional_layers.size() && optional_layers[layer_id];
+}
+
+void tile_map::set_layer_visible(unsigned layer_id, bool is_visible)
+{
+    if (layer_id < hidden_layers.size()) hidden_layers[layer_id] = !is_visible;
+}
+
+bool tile_map::is_layer_visible(unsigned layer_id) const
+{
+    return layer_id < hidden_layers.size() && !hidden_layers[layer_id];
+}
+
+unsigned tile_map::get_chunks_wide() const
+{
+    return chunks_wide;
+}
+
+unsigned tile_map::get_chunks_high() const
+{
+    return chunks_high;
+}
+
+size_t tile_map::get_allocated_chunk_count() const
+{
+    return allocated_chunk_count;
+}
+
+tile_chunk* tile_map::allocate_chunk(size_t chunk_index)
+{
+    auto& chunk = chunks[chunk_index];
+
+    if (!chunk)
+    {
+        unsigned chunk_x = static_cast<unsigned>(chunk_index % chunks_wide);
+        unsigned chunk_y = static_cast<unsigned>(chunk_index / chunks_wide);
+
+        chunk = std::make_unique<tile_chunk>(chunk_x, chunk_y, layers.size());
+        chunk->set_instance_id(++chunk_instance_counter);
+        allocated_chunk_count++;
+        attach_chunk(*chunk, chunk_index);
+    }
+
+    return chunk.get();
+}
+
+void tile_map::attach_chunk(tile_chunk& chunk, size_t chunk_index)
+{
+    tile_planes& planes = chunk.get_planes();
+    planes.journal = &journal;
+    planes.chunk_index = static_cast<uint32_t>(chunk_index);
+    planes.mark_all_changed();
+}
+
+tile_chunk* tile_map::get_chunk(unsigned chunk_x, unsigned chunk_y)
+{
+    if (chunk_x >= chunks_wide || chunk_y >= chunks_high) return nullptr;
+
+    return allocate_chunk(chunk_x + static_cast<size_t>(chunk_y) * chunks_wide);
+}
+
+const tile_chunk* tile_map::find_chunk(unsigned chunk_x, unsigned chunk_y) const
+{
+    if (chunk_x >= chunks_wide || chunk_y >= chunks_high) return nullptr;
+
+    return chunks[chunk_x + static_cast<size_t>(chunk_y) * chunks_wide].get();
+}
+
+tile_chunk* tile_map::find_chunk(unsigned chunk_x, unsigned chunk_y)
+{
+    return const_cast<tile_chunk*>(std::as_const(*this).find_chunk(chunk_x, chunk_y));
+}
+
+bool tile_map::install_chunk(std::unique_ptr<tile_chunk> chunk)
+{
+    if (!chunk || chunk->get_chunk_x() >= chunks_wide || chunk->get_chunk_y() >= chunks_high) return false;
+
+    const size_t chunk_index = chunk->get_chunk_x() + static_cast<size_t>(chunk->get_chunk_y()) * chunks_wide;
+    auto& slot = chunks[chunk_index];
+    if (slot) return false;
+
+    // Layers may have been added since the chunk was created:
+    while (chunk->get_planes().layers.size() < layers.size()) chunk->get_planes().add_layer();
+
+    chunk->set_instance_id(++chunk_instance_counter);
+    attach_chunk(*chunk, chunk_index);
+    slot = std::move(chunk);
+    allocated_chunk_count++;
+
+    return true;
+}
+
+std::unique_ptr<tile_chunk> tile_map::release_chunk(unsigned chunk_x, unsigned chunk_y)
 {
-    return tiles;
+    if (chunk_x >= chunks_wide || chunk_y >= chunks_high) return nullptr;
+
+    const size_t chunk_index = chunk_x + static_cast<size_t>(chunk_y) * chunks_wide;
+    auto& slot = chunks[chunk_index];
+    if (slot)
+    {
+        journal.release_chunk(static_cast<uint32_t>(chunk_index), slot->get_planes());
+        allocated_chunk_count--;
+    }
+
+    return std::move(slot);
+}
+
+void tile_map::allocate_all_chunks()
+{
+    for (size_t chunk_index = 0; chunk_index < chunks.size(); chunk_index++)
+    {
+        allocate_chunk(chunk_index);
+    }
 }
 
 unsigned tile_map::get_tile_width() const
@@ -131,31 +492,33 @@ unsigned tile_map::get_map_height() const
     return map_height;
 }
 
-tile* tile_map::get_tile(unsigned x, unsigned y)
+tile tile_map::get_tile(unsigned x, unsigned y)
 {
-    unsigned tile_index = x + y * get_map_width();
+    if (x >= map_width || y >= map_height) return tile();
 
-    if (tile_index >= 0 && tile_index < tiles.size())
-    {
-        return &tiles[tile_index];
-    }
+    tile_chunk* chunk = get_chunk(x / tile_chunk::size, y / tile_chunk::size);
+    return chunk->get_tile(x % tile_chunk::size, y % tile_chunk::size);
+}
+
+tile tile_map::find_tile(unsigned x, unsigned y)
+{
+    if (x >= map_width || y >= map_height) return tile();
+
+    tile_chunk* chunk = find_chunk(x / tile_chunk::size, y / tile_chunk::size);
+    if (!chunk) return tile();
 
-    return nullptr;
+    return chunk->get_tile(x % tile_chunk::size, y % tile_chunk::size);
 }
 
-tile* tile_map::set_tile(unsigned x, unsigned y, const tile& tile_source)
+tile tile_map::set_tile(unsigned x, unsigned y, bool passable, bool enabled)
 {
-    unsigned tile_index = x + y * get_map_width();
+    if (x >= map_width || y >= map_height) return tile();
 
-    if (tile_index >= 0 && tile_index < tiles.size())
-    {
-        tiles[tile_index] = tile_source;
-        return &tiles[tile_index];
-    }
-    else
-    {
-        return nullptr;
-    }
+    tile_chunk* chunk = get_chunk(x / tile_chunk::size, y / tile_chunk::size);
+    size_t tile_index = tile_chunk::local_index(x % tile_chunk::size, y % tile_chunk::size);
+    chunk->get_planes().reset_tile(tile_index, passable, enabled);
+
+    return tile(&chunk->get_planes(), tile_index);
 }
 
 void tile_map::add_layer_default_image(const std::string& layer_name, unsigned image_id)
@@ -186,6 +549,68 @@ unsigned tile_map::get_random_layer_default_image(unsigned layer_id) const
     return get_random_layer_default_image(get_layer_name(layer_id));
 }
 
+unsigned tile_map::get_layer_default_image(unsigned layer_id, unsigned x, unsigned y, uint64_t seed) const
+{
+    if (!layer_has_default_images(layer_id)) return 0;
+
+    const auto& defaults = layer_default_images.at(layers[layer_id]);
+    return defaults[random::hash_index(static_cast<unsigned>(defaults.size()), seed, x, y, layer_id)];
+}
+
+void tile_map::fill_default_images(tile_chunk& chunk, uint64_t seed) const
+{
+    // Look the defaults up once per chunk rather than once per tile:
+    std::vector<const std::vector<unsigned>*> defaults(layers.size(), nullptr);
+    for (unsigned layer_id = 0; layer_id < layers.size(); layer_id++)
+    {
+        if (layer_has_default_images(layer_id)) defaults[layer_id] = &layer_default_images.at(layers[layer_id]);
+    }
+
+    const unsigned layer_count = static_cast<unsigned>(std::min(defaults.size(), chunk.get_planes().layers.size()));
+
+    for (unsigned local_y = 0; local_y < tile_chunk::size; local_y++)
+    {
+        const unsigned y = chunk.get_tile_y() + local_y;
+        if (y >= map_height) break;
+
+        for (unsigned local_x = 0; local_x < tile_chunk::size; local_x++)
+        {
+            const unsigned x = chunk.get_tile_x() + local_x;
+            if (x >= map_width) break;
+
+            tile current_tile = chunk.get_tile(local_x, local_y);
+
+            for (unsigned layer_id = 0; layer_id < layer_count; layer_id++)
+            {
+                if (!defaults[layer_id] || current_tile.has_image(layer_id)) continue;
+
+                const auto& layer_defaults = *defaults[layer_id];
+                unsigned index = random::hash_index(static_cast<unsigned>(layer_defaults.size()), seed, x, y, layer_id);
+                current_tile.set_image_id(layer_id, layer_defaults[index]);
+            }
+        }
+    }
+}
+
+void tile_map::generate_default_images(uint64_t seed)
+{
+    stopwatch generate_stopwatch;
+    generate_stopwatch.start();
+
+    // Allocation changes the chunk table, so do it before any workers start:
+    allocate_all_chunks();
+
+    // Each chunk owns its planes, so chunks can be filled independently:
+    parallel_for(chunks.size(), [&](size_t chunk_index)
+    {
+        fill_default_images(*chunks[chunk_index], seed);
+    });
+
+    generate_stopwatch.stop();
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Generated default tile images for %zu chunks in %.2f ms",
+        chunks.size(), generate_stopwatch.get_elapsed_ms());
+}
+
 bool tile_map::layer_has_default_images(const std::string& layer_name) const
 {
     return
@@ -201,4 +626,198 @@ bool tile_map::layer_has_default_images(unsigned layer_id) const
         auto& layer_name = layers[layer_id];
         return layer_has_default_images(layer_name);
     }
-}
\ No newline at end of file
+}
+
+uint64_t tile_map::commit_changes()
+{
+    return journal.commit();
+}
+
+uint64_t tile_map::get_version() const
+{
+    return journal.get_version();
+}
+
+bool tile_map::get_changes_since(uint64_t version, tile_map_delta& delta) const
+{
+    return journal.get_changes_since(version, delta);
+}
+
+tile_change_journal& tile_map::get_journal()
+{
+    return journal;
+}
+
+void tile_map::encode_delta(const tile_map_delta& delta, std::vector<uint8_t>& data) const
+{
+    data.clear();
+    for (int shift = 0; shift < 32; shift += 8) data.push_back(static_cast<uint8_t>(delta_magic >> shift));
+
+    write_varint(data, delta.from_version);
+    write_varint(data, delta.to_version);
+    write_varint(data, layers.size());
+    write_varint(data, delta.chunks.size());
+
+    std::vector<uint16_t> units;
+    std::vector<uint16_t> encoded;
+
+    for (const tile_chunk_change& change : delta.chunks)
+    {
+        const tile_chunk* chunk = change.chunk_index < chunks.size() ? chunks[change.chunk_index].get() : nullptr;
+
+        // The tiles are read now, a chunk released after the delta was taken is sent as released:
+        const tile_chunk_change::kind kind = chunk ? change.change : tile_chunk_change::kind::released;
+        write_varint(data, change.chunk_index);
+        data.push_back(static_cast<uint8_t>(kind));
+
+        if (kind == tile_chunk_change::kind::tiles)
+        {
+            const tile_planes& planes = chunk->get_planes();
+            write_varint(data, change.tiles.size());
+
+            size_t next_index = 0;
+            for (uint16_t index : change.tiles)
+            {
+                write_varint(data, index - next_index);
+                next_index = static_cast<size_t>(index) + 1;
+
+                data.push_back(static_cast<uint8_t>(
+                    (planes.enabled.test(index) ? tile_enabled_bit : 0) |
+                    (planes.passable.test(index) ? tile_passable_bit : 0) |
+                    (planes.occupied.test(index) ? tile_occupied_bit : 0)));
+
+                // Ids are sent one higher, so an empty layer is a single zero byte:
+                for (const auto& layer : planes.layers)
+                {
+                    write_varint(data, layer[index] == no_tile_image ? 0 : layer[index] + 1ULL);
+                }
+            }
+        }
+        else if (kind == tile_chunk_change::kind::whole)
+        {
+            write_chunk_units(chunk->get_planes(), units);
+
+            encoded.clear();
+            run_length_encode(units.data(), units.size(), encoded);
+
+            write_varint(data, encoded.size());
+            for (uint16_t unit : encoded)
+            {
+                data.push_back(static_cast<uint8_t>(unit));
+                data.push_back(static_cast<uint8_t>(unit >> 8));
+            }
+        }
+    }
+}
+
+bool tile_map::apply_delta(const uint8_t* data, size_t size, uint64_t* version)
+{
+    delta_reader reader{ data, size };
+
+    uint32_t magic = 0;
+    for (int shift = 0; shift < 32; shift += 8) magic |= static_cast<uint32_t>(reader.read_byte()) << shift;
+
+    if (reader.failed || magic != delta_magic)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to apply tile map delta: not a delta");
+        return false;
+    }
+
+    reader.read_varint();   // The version it starts from, only a hint for the receiver
+    const uint64_t to_version = reader.read_varint();
+    const uint64_t layer_count = reader.read_varint();
+    const uint64_t chunk_count = reader.read_varint();
+
+    if (reader.failed || layer_count != layers.size())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to apply tile map delta: it has %llu layers, the map %zu",
+            static_cast<unsigned long long>(layer_count), layers.size());
+        return false;
+    }
+
+    const size_t chunk_units = layers.size() * tile_chunk::tile_count + 3 * flag_plane_units;
+    std::vector<uint16_t> encoded;
+    std::vector<uint16_t> units;
+
+    for (uint64_t i = 0; i < chunk_count && !reader.failed; i++)
+    {
+        const uint64_t chunk_index = reader.read_varint();
+        const uint8_t kind = reader.read_byte();
+        if (reader.failed || chunk_index >= chunks.size()) break;
+
+        const unsigned chunk_x = static_cast<unsigned>(chunk_index % chunks_wide);
+        const unsigned chunk_y = static_cast<unsigned>(chunk_index / chunks_wide);
+
+        if (kind == static_cast<uint8_t>(tile_chunk_change::kind::released))
+        {
+            release_chunk(chunk_x, chunk_y);
+        }
+        else if (kind == static_cast<uint8_t>(tile_chunk_change::kind::tiles))
+        {
+            tile_planes& planes = allocate_chunk(chunk_index)->get_planes();
+            const uint64_t tile_count = reader.read_varint();
+
+            uint64_t index = 0;
+            for (uint64_t tile = 0; tile < tile_count && !reader.failed; tile++)
+            {
+                index += reader.read_varint();
+                const uint8_t flags = reader.read_byte();
+                if (index >= planes.tile_count)
+                {
+                    reader.failed = true;
+                    break;
+                }
+
+                planes.enabled.set(index, flags & tile_enabled_bit);
+                planes.passable.set(index, flags & tile_passable_bit);
+                planes.occupied.set(index, flags & tile_occupied_bit);
+
+                for (auto& layer : planes.layers)
+                {
+                    const uint64_t id = reader.read_varint();
+                    layer[index] = id == 0 || id > no_tile_image ? no_tile_image : static_cast<tile_image_id>(id - 1);
+                }
+
+                planes.mark_changed(index);
+                index++;
+            }
+        }
+        else if (kind == static_cast<uint8_t>(tile_chunk_change::kind::whole))
+        {
+            const uint64_t encoded_count = reader.read_varint();
+            if (reader.failed || encoded_count > (size - reader.offset) / sizeof(uint16_t))
+            {
+                reader.failed = true;
+                break;
+            }
+
+            encoded.resize(encoded_count);
+            std::memcpy(encoded.data(), data + reader.offset, encoded_count * sizeof(uint16_t));
+            reader.offset += encoded_count * sizeof(uint16_t);
+
+            units.resize(chunk_units);
+            if (!run_length_decode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded_count * sizeof(uint16_t), units.data(), units.size()))
+            {
+                reader.failed = true;
+                break;
+            }
+
+            tile_planes& planes = allocate_chunk(chunk_index)->get_planes();
+            read_chunk_units(planes, units);
+            planes.mark_all_changed();
+        }
+        else
+        {
+            reader.failed = true;
+        }
+    }
+
+    if (reader.failed)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to apply tile map delta: the data is malformed");
+        return false;
+    }
+
+    if (version) *version = to_version;
+    return true;
+}
@@ -3,8 +3,15 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <SDL.h>
 #include "tile_image.h"
+#include "tile_animation.h"
 #include "tile.h"
+#include "tile_chunk.h"
+#include "tile_change_journal.h"
 
 namespace isometric {
 
@@ -16,14 +23,33 @@ namespace isometric {
         unsigned tile_width = 0;    // by pixels
         unsigned tile_height = 0;   // by pixels
 
-        std::unordered_map<unsigned, std::shared_ptr<tile_image>> tile_images;
+        std::vector<tile_image> tile_images; // Indexed by image id, ids without an image hold an empty tile_image
+        std::vector<tile_animation> animations;
+        std::vector<unsigned> animation_frames; // Indexed by image id, the image an animated id shows now, or no_tile_image
+        double animation_time = 0.0;        // Seconds, see set_animation_time
+        uint64_t animation_revision = 0;    // Bumped whenever an animation moves to another frame
+        uint64_t animation_set_revision = 0;    // Bumped when animations are added or removed
         unsigned selection_tile_image = std::numeric_limits<unsigned>::max();
-        std::vector<tile> tiles;
+        unsigned placeholder_tile_image = std::numeric_limits<unsigned>::max();
+        unsigned max_image_width = 0;   // by pixels, the widest tile image added
+        unsigned max_image_height = 0;  // by pixels, the tallest tile image added
+        unsigned chunks_wide = 0;   // by chunks
+        unsigned chunks_high = 0;   // by chunks
+        std::vector<std::unique_ptr<tile_chunk>> chunks; // Sparse, null until first written or viewed
+        size_t allocated_chunk_count = 0;
+        uint64_t chunk_instance_counter = 0;
         std::unordered_map<std::string, std::vector<unsigned>> layer_default_images;
         std::vector<std::string> layers;
+        std::vector<bool> static_layers;
+        std::vector<bool> optional_layers;
+        std::vector<bool> hidden_layers;
+        tile_change_journal journal;
 
         tile_map() {}
 
+        tile_chunk* allocate_chunk(size_t chunk_index);
+        void attach_chunk(tile_chunk& chunk, size_t chunk_index);
+
     public:
         static std::shared_ptr<tile_map> create(unsigned map_width, unsigned map_height, unsigned tile_width, unsigned tile_height);
 
@@ -48,21 +74,92 @@ namespace isometric {
         unsigned get_tile_height() const;
 
         /// <summary>
-        /// Add an image that this map can use for tiles
+        /// Add an image that this map can use for tiles. The image is copied into the map's image table at the
+        /// index of its id, replacing any image already using that id.
         /// </summary>
-        /// <param name="image">A valid tile image within a shared_ptr</param>
-        unsigned add_image(std::shared_ptr<tile_image> image);
+        /// <param name="image">A valid tile image</param>
+        /// <returns>The id of the image</returns>
+        unsigned add_image(const tile_image& image);
 
         /// <summary>
         /// Get an image that this map uses for tiles
         /// </summary>
         /// <param name="id">The id of the image to return</param>
-        /// <returns>A valid tile image within a shared_ptr</returns>
-        std::shared_ptr<tile_image> get_image(unsigned id) const;
+        /// <returns>The image, or nullptr if no image uses this id. Invalidated by add_image.</returns>
+        const tile_image* get_image(unsigned id) const
+        {
+            return id < tile_images.size() && !tile_images[id].is_empty() ? &tile_images[id] : nullptr;
+        }
+
+        /// <returns>The size of the image table, one more than the highest image id added</returns>
+        unsigned get_image_count() const;
+
+        /// <summary>
+        /// Animate an image id: tiles using it show the animation's frames, resolved by get_current_image from the
+        /// map's animation clock when they're drawn. If no image uses the id yet, the first frame's image is copied
+        /// to it, so what doesn't resolve animations (like imposters or map_file) still draws a still of it. Adding
+        /// an animation with the id of another replaces it.
+        /// </summary>
+        /// <returns>False if the animation has no frames or its id is too large</returns>
+        bool add_animation(const tile_animation& animation);
+        void remove_animation(unsigned image_id);
+        const std::vector<tile_animation>& get_animations() const;
+
+        /// <returns>True if tiles using this id are animated, their layer is then drawn every frame rather than cached</returns>
+        bool is_image_animated(unsigned id) const
+        {
+            return id < animation_frames.size() && animation_frames[id] != no_tile_image;
+        }
+
+        /// <summary>
+        /// Get the image to draw for an id at the current animation time, the same as get_image for ids that
+        /// aren't animated
+        /// </summary>
+        const tile_image* get_current_image(unsigned id) const
+        {
+            return get_image(is_image_animated(id) ? animation_frames[id] : id);
+        }
+
+        /// <summary>
+        /// Move every animation to its frame at this time on the shared animation clock, world::update does this
+        /// each frame. Costs one lookup per animation, however many tiles use them.
+        /// </summary>
+        void set_animation_time(double seconds);
+        double get_animation_time() const;
+
+        /// <returns>A count that changes whenever any animation shows a different frame</returns>
+        uint64_t get_animation_revision() const;
+
+        /// <returns>A count that changes when animations are added or removed, which tiles are cached changes then</returns>
+        uint64_t get_animation_set_revision() const;
+
+        /// <summary>
+        /// Point every image drawn from previous at replacement instead, for a texture replaced by a hot reload.
+        /// The image table is patched in place, ids and tiles are untouched.
+        /// </summary>
+        /// <returns>How many images use the texture, also when previous and replacement are the same</returns>
+        size_t retarget_texture(SDL_Texture* previous, SDL_Texture* replacement);
+
+        /// <returns>The width in pixels of the widest tile image added to this map</returns>
+        unsigned get_max_image_width() const;
+
+        /// <returns>
+        /// The height in pixels of the tallest tile image added to this map. Images taller than a tile are bottom
+        /// aligned, so they draw above their tile by up to get_max_image_height() - get_tile_height() pixels.
+        /// </returns>
+        unsigned get_max_image_height() const;
+
+        /// <summary>
+        /// An image drawn in place of tiles whose chunk isn't resident, for example while it's being streamed in
+        /// </summary>
+        void set_placeholder_image(unsigned id);
+        const tile_image* get_placeholder_image() const;
+        unsigned get_placeholder_image_id() const;
 
         void set_selection_image(unsigned id);
         bool has_selection_image() const;
-        std::shared_ptr<tile_image> get_selection_image() const;
+        const tile_image* get_selection_image() const;
+        unsigned get_selection_image_id() const;
 
         /// <summary>
         /// Set the image id used as the default for tiles that do not have an image in this layer
@@ -87,6 +184,26 @@ namespace isometric {
         unsigned get_random_layer_default_image(const std::string& layer_name) const;
         unsigned get_random_layer_default_image(unsigned layer_id) const;
 
+        /// <summary>
+        /// Pick a default image for a tile deterministically, the same seed and position always give the same image
+        /// </summary>
+        /// <returns>The id of the image to use as the default tile image, or 0 if the layer has no defaults</returns>
+        unsigned get_layer_default_image(unsigned layer_id, unsigned x, unsigned y, uint64_t seed) const;
+
+        /// <summary>
+        /// Fill every tile that has no image in a layer with one of that layer's default images, chosen by
+        /// get_layer_default_image. Every chunk is allocated and chunks are filled in parallel. Running this again
+        /// with the same seed on the same map produces the same tiles.
+        /// </summary>
+        /// <param name="seed">The seed for the per-tile hash</param>
+        void generate_default_images(uint64_t seed);
+
+        /// <summary>
+        /// Same as generate_default_images for a single chunk, which doesn't need to be part of the map yet. Only
+        /// reads the map, so it can run on a worker thread while the layer defaults aren't being changed.
+        /// </summary>
+        void fill_default_images(tile_chunk& chunk, uint64_t seed) const;
+
         /// <summary>
         /// Determine if the layer has any default tile images
         /// </summary>
@@ -100,9 +217,166 @@ namespace isometric {
         unsigned get_layer_id(const std::string& layer_name) const;
         const std::string& get_layer_name(unsigned layer_id) const;
 
-        tile* set_tile(unsigned x, unsigned y, const tile& tile_source);
-        tile* get_tile(unsigned x, unsigned y);
-        const std::vector<tile>& get_tiles() const;
+        /// <summary>
+        /// Static layers (the default) only change through set_tile or tile::set_image_id and may be baked into
+        /// cached chunk textures. Non-static layers are always drawn tile by tile.
+        /// </summary>
+        void set_layer_static(unsigned layer_id, bool is_static = true);
+        bool is_layer_static(unsigned layer_id) const;
+
+        /// <summary>
+        /// Optional layers are decoration the game can do without, such as foliage. world::set_optional_layers_visible
+        /// hides them all at once, for example when application's dynamic quality reduces detail.
+        /// </summary>
+        void set_layer_optional(unsigned layer_id, bool is_optional = true);
+        bool is_layer_optional(unsigned layer_id) const;
+
+        /// <summary>
+        /// Hidden layers aren't drawn or baked into render caches. Change this through world so its caches are
+        /// redrawn, see world::set_optional_layers_visible.
+        /// </summary>
+        void set_layer_visible(unsigned layer_id, bool is_visible = true);
+        bool is_layer_visible(unsigned layer_id) const;
+
+        /// <summary>
+        /// Reset a tile to a non-empty tile without any images and return a view of it
+        /// </summary>
+        /// <returns>A view of the tile, or an invalid tile if x, y is outside of the map</returns>
+        tile set_tile(unsigned x, unsigned y, bool passable = true, bool enabled = true);
+
+        /// <returns>A view of the tile, or an invalid tile if x, y is outside of the map</returns>
+        tile get_tile(unsigned x, unsigned y);
+
+        /// <summary>
+        /// Same as get_tile, except the chunk isn't allocated if it hasn't been already
+        /// </summary>
+        /// <returns>A view of the tile, or an invalid tile if x, y is outside of the map or in an unallocated chunk</returns>
+        tile find_tile(unsigned x, unsigned y);
+
+        /// <returns>The width of the map in chunks, see tile_chunk::size</returns>
+        unsigned get_chunks_wide() const;
+
+        /// <returns>The height of the map in chunks, see tile_chunk::size</returns>
+        unsigned get_chunks_high() const;
+
+        /// <returns>How many chunks currently have storage allocated</returns>
+        size_t get_allocated_chunk_count() const;
+
+        /// <summary>
+        /// Get a chunk by chunk coordinates, allocating it if this is the first time it has been viewed
+        /// </summary>
+        /// <returns>The chunk, or nullptr if the coordinates are outside of the map</returns>
+        tile_chunk* get_chunk(unsigned chunk_x, unsigned chunk_y);
+
+        /// <summary>
+        /// Get a chunk by chunk coordinates without allocating it
+        /// </summary>
+        /// <returns>The chunk, or nullptr if it's outside of the map or has never been allocated</returns>
+        const tile_chunk* find_chunk(unsigned chunk_x, unsigned chunk_y) const;
+        tile_chunk* find_chunk(unsigned chunk_x, unsigned chunk_y);
+
+        /// <summary>
+        /// Allocate every chunk of the map, equivalent to dense storage
+        /// </summary>
+        void allocate_all_chunks();
+
+        /// <summary>
+        /// Take ownership of a chunk created outside of the map, such as one loaded from disk. Layers added to the
+        /// map since the chunk was created are added to it.
+        /// </summary>
+        /// <returns>False if the chunk is outside of the map or that chunk is already allocated</returns>
+        bool install_chunk(std::unique_ptr<tile_chunk> chunk);
+
+        /// <summary>
+        /// Remove a chunk from the map and give up ownership of it, the chunk becomes unallocated
+        /// </summary>
+        /// <returns>The chunk, or nullptr if it wasn't allocated</returns>
+        std::unique_ptr<tile_chunk> release_chunk(unsigned chunk_x, unsigned chunk_y);
+
+        /// <summary>
+        /// Call func(tile_chunk&amp;) for every allocated chunk, in row major chunk order
+        /// </summary>
+        template<class F> void for_each_chunk(F&& func);
+        template<class F> void for_each_chunk(F&& func) const;
+
+        /// <summary>
+        /// Call func(tile_chunk&amp;) for every chunk overlapping the tile rectangle [x, x + w) x [y, y + h), in row
+        /// major chunk order. Chunks are allocated when allocate is true, otherwise unallocated chunks are skipped.
+        /// </summary>
+        template<class F> void for_each_chunk_in(const SDL_Rect& tile_rect, bool allocate, F&& func);
+
+        /// <summary>
+        /// Close the edits made since the last call into a new version of the map. world::update calls it at the
+        /// start of every frame, so a version holds one frame of edits.
+        /// </summary>
+        /// <returns>The new version, or the current one if nothing changed</returns>
+        uint64_t commit_changes();
+
+        /// <returns>The version of the latest commit with changes</returns>
+        uint64_t get_version() const;
+
+        /// <summary>
+        /// The chunks and tiles changed by the commits after a version, for invalidating caches or replication
+        /// </summary>
+        /// <returns>False if the version is older than the journal's history, everything has to be treated as changed</returns>
+        bool get_changes_since(uint64_t version, tile_map_delta& delta) const;
+
+        tile_change_journal& get_journal();
+
+        /// <summary>
+        /// Serialize the current state of the tiles in a delta, in a compact form for sending to another map with
+        /// the same size and layers. Tiles are varint coded by their distance from the previous changed tile; whole
+        /// chunks are run length encoded.
+        /// </summary>
+        void encode_delta(const tile_map_delta& delta, std::vector<uint8_t>& data) const;
+
+        /// <summary>
+        /// Apply a delta from encode_delta. The edits are journaled like any other.
+        /// </summary>
+        /// <param name="version">Receives the version of the encoding map the delta brings this map up to</param>
+        /// <returns>False if the data is malformed or the layers don't match, the delta may be partly applied</returns>
+        bool apply_delta(const uint8_t* data, size_t size, uint64_t* version = nullptr);
     };
 
+    template<class F>
+    inline void tile_map::for_each_chunk(F&& func)
+    {
+        for (auto& chunk : chunks)
+        {
+            if (chunk) func(*chunk);
+        }
+    }
+
+    template<class F>
+    inline void tile_map::for_each_chunk(F&& func) const
+    {
+        for (const auto& chunk : chunks)
+        {
+            if (chunk) func(static_cast<const tile_chunk&>(*chunk));
+        }
+    }
+
+    template<class F>
+    inline void tile_map::for_each_chunk_in(const SDL_Rect& tile_rect, bool allocate, F&& func)
+    {
+        if (tile_rect.w <= 0 || tile_rect.h <= 0) return;
+
+        const long long first_x = std::max(0LL, static_cast<long long>(tile_rect.x) / tile_chunk::size);
+        const long long first_y = std::max(0LL, static_cast<long long>(tile_rect.y) / tile_chunk::size);
+        const long long last_x = std::min<long long>(chunks_wide - 1LL, (static_cast<long long>(tile_rect.x) + tile_rect.w - 1) / tile_chunk::size);
+        const long long last_y = std::min<long long>(chunks_high - 1LL, (static_cast<long long>(tile_rect.y) + tile_rect.h - 1) / tile_chunk::size);
+
+        for (long long chunk_y = first_y; chunk_y <= last_y; chunk_y++)
+        {
+            for (long long chunk_x = first_x; chunk_x <= last_x; chunk_x++)
+            {
+                tile_chunk* chunk = allocate
+                    ? get_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y))
+                    : find_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+
+                if (chunk) func(*chunk);
+            }
+        }
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "../tools/bitset.h"
+#include "tile_change_journal.h"
+
+namespace isometric {
+
+    /// <summary>
+    /// Compact storage type for image ids within a layer plane
+    /// </summary>
+    using tile_image_id = uint16_t;
+
+    /// <summary>
+    /// Stored in a layer plane when a tile has no image in that layer
+    /// </summary>
+    constexpr tile_image_id no_tile_image = 0xFFFF;
+
+    /// <summary>
+    /// Structure-of-arrays storage for a block of tiles. Every layer gets its own contiguous plane of image ids and
+    /// every tile flag gets its own packed bit plane, so the renderer can walk a row of a layer without touching
+    /// anything else.
+    /// </summary>
+    struct tile_planes
+    {
+        size_t tile_count = 0;
+        uint32_t revision = 0;  // Incremented on every change, used by caches to detect stale data
+
+        std::vector<std::vector<tile_image_id>> layers;  // [layer_id][tile_index]
+        tools::dynamic_bitset enabled;
+        tools::dynamic_bitset passable;
+        tools::dynamic_bitset occupied;                  // Inverse of tile::is_empty()
+
+        // Set while the planes belong to a tile_map, the changes since its journal's last commit:
+        tile_change_journal* journal = nullptr;
+        uint32_t chunk_index = 0;
+        tools::dynamic_bitset journal_tiles;
+        bool journal_pending = false;                   // Listed in the journal's open frame
+        bool journal_whole = false;
+
+        /// <summary>
+        /// Every edit of a tile goes through here, so caches see the new revision and the journal the tile
+        /// </summary>
+        void mark_changed(size_t index)
+        {
+            revision++;
+            if (!journal) return;
+
+            if (!journal_pending) journal->open_chunk(*this);
+            journal_tiles.set(index);
+        }
+
+        /// <summary>
+        /// For edits that may touch every tile, like a new layer or the chunk being replaced
+        /// </summary>
+        void mark_all_changed()
+        {
+            revision++;
+            if (!journal) return;
+
+            if (!journal_pending) journal->open_chunk(*this);
+            journal_whole = true;
+        }
+
+        void resize(size_t count, size_t layer_count)
+        {
+            tile_count = count;
+
+            enabled.resize(count, true);
+            passable.resize(count, true);
+            occupied.resize(count, false);
+
+            layers.resize(layer_count);
+            for (auto& layer : layers)
+            {
+                layer.resize(count, no_tile_image);
+            }
+        }
+
+        void add_layer()
+        {
+            layers.emplace_back(tile_count, no_tile_image);
+            mark_all_changed();
+        }
+
+        void reset_tile(size_t index, bool is_passable, bool is_enabled)
+        {
+            for (auto& layer : layers)
+            {
+                layer[index] = no_tile_image;
+            }
+
+            enabled.set(index, is_enabled);
+            passable.set(index, is_passable);
+            occupied.set(index);
+            mark_changed(index);
+        }
+
+        size_t get_byte_size() const
+        {
+            size_t bytes = enabled.get_byte_size() + passable.get_byte_size() + occupied.get_byte_size();
+            for (const auto& layer : layers)
+            {
+                bytes += layer.capacity() * sizeof(tile_image_id);
+            }
+
+            return bytes;
+        }
+    };
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <SDL.h>
+
+namespace isometric {
+
+    /// <summary>
+    /// The exact range of tiles whose images overlap a viewport. Rows are staggered, so even and odd rows each get
+    /// their own column range. Ranges are half open, [begin, end), and already clamped to the map.
+    /// </summary>
+    struct tile_span
+    {
+        int y_begin = 0;
+        int y_end = 0;
+        int x_begin[2] = { 0, 0 };  // [row parity], 0 = even rows, 1 = odd rows
+        int x_end[2] = { 0, 0 };    // [row parity]
+
+        bool is_empty() const
+        {
+            return y_begin >= y_end;
+        }
+
+        int row_begin(int tile_y) const
+        {
+            return x_begin[tile_y & 1];
+        }
+
+        int row_end(int tile_y) const
+        {
+            return x_end[tile_y & 1];
+        }
+
+        bool contains(const SDL_Point& tile_point) const
+        {
+            return
+                tile_point.y >= y_begin && tile_point.y < y_end &&
+                tile_point.x >= row_begin(tile_point.y) && tile_point.x < row_end(tile_point.y);
+        }
+
+        /// <returns>The number of tiles in the span</returns>
+        unsigned long long get_tile_count() const
+        {
+            unsigned long long count = 0;
+            for (int parity = 0; parity < 2; parity++)
+            {
+                // Rows in [y_begin, y_end) with this parity:
+                const int first_row = y_begin + ((y_begin & 1) != parity ? 1 : 0);
+                const int rows = first_row < y_end ? (y_end - first_row + 1) / 2 : 0;
+                const int columns = x_end[parity] > x_begin[parity] ? x_end[parity] - x_begin[parity] : 0;
+                count += static_cast<unsigned long long>(rows) * columns;
+            }
+            return count;
+        }
+    };
+
+}
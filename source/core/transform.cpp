@@ -1,8 +1,28 @@
 #include "transform.h"
 #include <cmath>
+#include <algorithm>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ISOMETRIC_TRANSFORM_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ISOMETRIC_TRANSFORM_SSE2 1
+#endif
 
 using namespace isometric;
 
+// The batch conversions load and store points as pairs of 32 bit lanes:
+static_assert(sizeof(SDL_Point) == 2 * sizeof(int) && sizeof(SDL_FPoint) == 2 * sizeof(float));
+
+// Runs a conversion with the map's tile geometry, constant for the standard tile size:
+template<class Conversion>
+static auto with_geometry(const tile_map& map, Conversion&& conversion)
+{
+    if (standard_iso_geometry::matches(map.get_tile_width(), map.get_tile_height())) return conversion(standard_iso_geometry());
+    return conversion(runtime_iso_geometry(map.get_tile_width(), map.get_tile_height()));
+}
+
 transform::transform(std::shared_ptr<camera> camera, std::shared_ptr<tile_map> map)
     : main_camera(camera), map(map)
 {
@@ -45,57 +65,56 @@ bool transform::has_sanity() const
     return sanity;
 }
 
-SDL_FPoint transform::world_tile_to_world_pixels(const SDL_Point& tile_point) const
+transform_snapshot transform::get_snapshot() const
 {
-    if (!has_sanity()) return SDL_FPoint();
-
-    float world_x =
-        // The x coordinate is the tile column position multiplied by the pixel width of a tile:
-        tile_point.x * map->get_tile_width() +
-        (
-            static_cast<int>(tile_point.y) % 2 == 0             // Is this an even tile?
-            ? -static_cast<int>(map->get_tile_width()) / 2.0f   // True:  Offset the tile half a tile to the left
-            : 0.0f                                              // False: Do not offset the tile
-            );
+    if (!main_camera || !map) return transform_snapshot();
+
+    transform_snapshot snapshot;
+    snapshot.tile_width = static_cast<float>(map->get_tile_width());
+    snapshot.half_tile_width = map->get_tile_width() / 2.0f;
+    snapshot.half_tile_height = map->get_tile_height() / 2.0f;
+    snapshot.view_origin_x = main_camera->get_current_x() * map->get_tile_width();
+    snapshot.view_origin_y = main_camera->get_current_y() * (map->get_tile_height() / 2.0f);
+    snapshot.zoom = main_camera->get_zoom();
+    snapshot.viewport_x = static_cast<float>(main_camera->get_viewport_x());
+    snapshot.viewport_y = static_cast<float>(main_camera->get_viewport_y());
+    return snapshot;
+}
 
-    // The y coordinates are multiplied by half the tile size because tiles in an isometric map are partially
-    // overlapping.
-    float world_y = tile_point.y * (map->get_tile_height() / 2.0f);
+float transform::get_zoom() const
+{
+    return main_camera ? main_camera->get_zoom() : 1.0f;
+}
 
-    // Shift the world up half a tile to cover empty spaces:
-    world_y -= map->get_tile_height() / 2.0f;
+SDL_FPoint transform::world_tile_to_world_pixels(const SDL_Point& tile_point) const
+{
+    if (!has_sanity()) return SDL_FPoint();
 
-    return SDL_FPoint{ world_x, world_y };
+    return with_geometry(*map, [&](const auto& geometry) { return geometry::world_tile_to_world_pixels(geometry, tile_point); });
 }
 
 SDL_Point transform::world_pixels_to_world_tile(const SDL_FPoint& point) const
 {
     if (!has_sanity()) return SDL_Point();
 
-    int y = static_cast<int>(point.y / (map->get_tile_height() / 2.0f));
-    int x = static_cast<int>(point.x / map->get_tile_width() +
-        y % 2 == 0
-        ? -static_cast<int>(map->get_tile_width()) / 2.0f
-        : 0.0f
-        );
-
-    // Increase precision of the tile point by doing a hit test of tiles in the general area:
-    SDL_Point tile_points[] = {
-        { x - 1, y - 1 },   // Top Left
-        { x + 1, y - 1 },   // Top Right
-        { x - 1, y + 1 },   // Bottom Left
-        { x + 1, y + 1 }    // Bottom Right
-    };
+    return with_geometry(*map, [&](const auto& geometry) { return geometry::world_pixels_to_world_tile(geometry, point); });
+}
 
-    for (const auto& tile_point : tile_points)
-    {
-        if (tile_hittest(tile_point, point))
-        {
-            return tile_point;
-        }
-    }
+SDL_FPoint transform::viewport_pixels_to_world_pixels(const SDL_FPoint& point) const
+{
+    if (!has_sanity()) return SDL_FPoint();
 
-    return SDL_Point{ x, y };
+    const float zoom = main_camera->get_zoom();
+
+    return SDL_FPoint{
+        (point.x - main_camera->get_viewport_x()) / zoom + main_camera->get_current_x() * map->get_tile_width(),
+        (point.y - main_camera->get_viewport_y()) / zoom + main_camera->get_current_y() * (map->get_tile_height() / 2.0f)
+    };
+}
+
+SDL_Point transform::viewport_pixels_to_world_tile(const SDL_FPoint& point) const
+{
+    return world_pixels_to_world_tile(viewport_pixels_to_world_pixels(point));
 }
 
 SDL_FPoint transform::world_tile_to_viewport_pixels(const SDL_Point& tile_point) const
@@ -109,6 +128,10 @@ SDL_FPoint transform::world_tile_to_viewport_pixels(const SDL_Point& tile_point)
     screen_point.x = screen_point.x - main_camera->get_current_x() * map->get_tile_width();
     screen_point.y = screen_point.y - main_camera->get_current_y() * (map->get_tile_height() / 2.0f);
 
+    // Scale the distance from the top left of the view by the camera's zoom:
+    screen_point.x *= main_camera->get_zoom();
+    screen_point.y *= main_camera->get_zoom();
+
     // Adjust the x, y based on the current camera viewport and not assume the world is drawn starting at 0, 0
     // pixels all of the time.
     screen_point.x += main_camera->get_viewport_x();
@@ -134,11 +157,67 @@ SDL_FPoint transform::world_pixels_to_viewport_pixels(const SDL_FPoint& point) c
         : 0.0f;
 
     return SDL_FPoint{
-        point.x - current_pixel_pos.x,
-        point.y - current_pixel_pos.y
+        (point.x - current_pixel_pos.x) * main_camera->get_zoom(),
+        (point.y - current_pixel_pos.y) * main_camera->get_zoom()
     };
 }
 
+tile_span transform::get_visible_tile_span() const
+{
+    if (!has_sanity()) return tile_span();
+
+    // The bounds divide by the tile size, which is a constant for the standard tile size:
+    return with_geometry(*map, [&](const auto& geometry)
+    {
+        const float tile_width = geometry.get_tile_width();
+        const float half_tile_height = geometry.get_half_tile_height();
+        const float image_width = static_cast<float>(std::max(map->get_tile_width(), map->get_max_image_width()));
+        const float overdraw_top = static_cast<float>(std::max(map->get_max_image_height(), map->get_tile_height()) - map->get_tile_height());
+
+        // The viewport in world pixels:
+        const float view_left = main_camera->get_current_x() * tile_width;
+        const float view_top = main_camera->get_current_y() * half_tile_height;
+        const float view_right = view_left + main_camera->get_width() / main_camera->get_zoom();
+        const float view_bottom = view_top + main_camera->get_height() / main_camera->get_zoom();
+
+        const int map_width = static_cast<int>(map->get_map_width());
+        const int map_height = static_cast<int>(map->get_map_height());
+
+        tile_span span;
+
+        // A row's images start at y * H/2 - H/2 - overdraw_top and all end at y * H/2 + H/2:
+        span.y_begin = static_cast<int>(std::floor(view_top / half_tile_height - 1.0f)) + 1;
+        span.y_end = static_cast<int>(std::ceil((view_bottom + overdraw_top) / half_tile_height + 1.0f));
+
+        // Even rows are shifted half a tile to the left, a column starts at x * W - shift and ends image_width later:
+        for (int parity = 0; parity < 2; parity++)
+        {
+            const float shift = parity == 0 ? geometry.get_half_tile_width() : 0.0f;
+
+            span.x_begin[parity] = std::max(0, static_cast<int>(std::floor((view_left + shift - image_width) / tile_width)) + 1);
+            span.x_end[parity] = std::min(map_width, static_cast<int>(std::ceil((view_right + shift) / tile_width)));
+        }
+
+        span.y_begin = std::max(0, span.y_begin);
+        span.y_end = std::min(map_height, span.y_end);
+
+        return span;
+    });
+}
+
+SDL_FPoint transform::get_max_camera_position() const
+{
+    if (!has_sanity()) return SDL_FPoint();
+
+    // The right edge of the map is the right edge of the even rows, which are shifted half a tile to the left,
+    // and the bottom edge is the bottom of the last row:
+    const float zoom = main_camera->get_zoom();
+    const float max_x = map->get_map_width() - 0.5f - main_camera->get_width() / zoom / map->get_tile_width();
+    const float max_y = map->get_map_height() - main_camera->get_height() / zoom / (map->get_tile_height() / 2.0f);
+
+    return SDL_FPoint{ std::max(0.0f, max_x), std::max(0.0f, max_y) };
+}
+
 bool transform::tile_hittest(const SDL_Point& tile_point, const SDL_FPoint& point) const
 {
     const SDL_FPoint tile_viewport_point = world_tile_to_viewport_pixels(tile_point);
@@ -149,30 +228,178 @@ bool transform::tile_hittest_by_viewport(const SDL_FPoint& tile_viewport_point,
 {
     if (!has_sanity()) return false;
 
-    SDL_FPoint translated_point = SDL_FPoint{
-        point.x - tile_viewport_point.x,
-        point.y - tile_viewport_point.y
+    // The diamond is measured unscaled, so undo the camera's zoom:
+    const float zoom = main_camera->get_zoom();
+    const SDL_FPoint offset{
+        (point.x - tile_viewport_point.x) / zoom,
+        (point.y - tile_viewport_point.y) / zoom
+    };
+
+    return with_geometry(*map, [&](const auto& geometry) { return geometry::tile_hittest(geometry, offset); });
+}
+
+// The snapshot's conversions do the same float operations in the same order as transform's, so the results are
+// identical whichever is used and whether or not a point goes through the vector path:
+
+SDL_FPoint transform_snapshot::world_tile_to_viewport_pixels(const SDL_Point& tile_point) const
+{
+    const float world_x = tile_point.x * tile_width + (tile_point.y % 2 == 0 ? -half_tile_width : 0.0f);
+    const float world_y = tile_point.y * half_tile_height - half_tile_height;
+
+    return SDL_FPoint{
+        (world_x - view_origin_x) * zoom + viewport_x,
+        (world_y - view_origin_y) * zoom + viewport_y
     };
+}
 
-    float row_width = 2.0f + translated_point.y * 4.0f;
+SDL_Point transform_snapshot::viewport_pixels_to_world_tile(const SDL_FPoint& point) const
+{
+    // See transform::world_pixels_to_world_tile:
+    const float u = ((point.x - viewport_x) / zoom + view_origin_x) / half_tile_width;
+    const float v = ((point.y - viewport_y) / zoom + view_origin_y) / half_tile_height;
 
-    if (translated_point.y < map->get_tile_height() / 2.0f)
-    { // Top portion of diamond
-// The width of the diamond pixels for each row +4 more than the previous one starting at 2
-        row_width = 2.0f + translated_point.y * 4.0f;
+    const int a = static_cast<int>(std::floor((u + v + 1.0f) / 2.0f));
+    const int b = static_cast<int>(std::floor((u - v + 1.0f) / 2.0f));
+
+    // The rotated back center is (a + b, a - b), its column is half of u rounded down:
+    return SDL_Point{ (a + b) >> 1, a - b };
+}
+
+void transform_snapshot::world_tiles_to_viewport_pixels(std::span<const SDL_Point> tile_points, std::span<SDL_FPoint> viewport_points) const
+{
+    const size_t count = std::min(tile_points.size(), viewport_points.size());
+    size_t i = 0;
+
+#if ISOMETRIC_TRANSFORM_SSE2
+    const __m128 width = _mm_set1_ps(tile_width);
+    const __m128 even_offset = _mm_set1_ps(-half_tile_width);
+    const __m128 height = _mm_set1_ps(half_tile_height);
+    const __m128 origin_x = _mm_set1_ps(view_origin_x);
+    const __m128 origin_y = _mm_set1_ps(view_origin_y);
+    const __m128 scale = _mm_set1_ps(zoom);
+    const __m128 offset_x = _mm_set1_ps(viewport_x);
+    const __m128 offset_y = _mm_set1_ps(viewport_y);
+    const __m128i one = _mm_set1_epi32(1);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // Two points per register, split into four x and four y:
+        const __m128 first = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&tile_points[i])));
+        const __m128 second = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&tile_points[i + 2])));
+        const __m128i xs = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i ys = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        const __m128 even = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(ys, one), _mm_setzero_si128()));
+        const __m128 world_x = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(xs), width), _mm_and_ps(even, even_offset));
+        const __m128 world_y = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(ys), height), height);
+
+        const __m128 screen_x = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(world_x, origin_x), scale), offset_x);
+        const __m128 screen_y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(world_y, origin_y), scale), offset_y);
+
+        _mm_storeu_ps(&viewport_points[i].x, _mm_unpacklo_ps(screen_x, screen_y));
+        _mm_storeu_ps(&viewport_points[i + 2].x, _mm_unpackhi_ps(screen_x, screen_y));
     }
-    else
-    { // Lower portion of diamond
-        row_width = 2.0f + ((map->get_tile_height() - translated_point.y) - 1) * 4.0f;
+#elif ISOMETRIC_TRANSFORM_NEON
+    const float32x4_t width = vdupq_n_f32(tile_width);
+    const uint32x4_t even_offset = vreinterpretq_u32_f32(vdupq_n_f32(-half_tile_width));
+    const float32x4_t height = vdupq_n_f32(half_tile_height);
+    const float32x4_t origin_x = vdupq_n_f32(view_origin_x);
+    const float32x4_t origin_y = vdupq_n_f32(view_origin_y);
+    const float32x4_t scale = vdupq_n_f32(zoom);
+    const float32x4_t offset_x = vdupq_n_f32(viewport_x);
+    const float32x4_t offset_y = vdupq_n_f32(viewport_y);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const int32x4x2_t points = vld2q_s32(&tile_points[i].x);
+
+        const uint32x4_t even = vceqq_s32(vandq_s32(points.val[1], vdupq_n_s32(1)), vdupq_n_s32(0));
+        const float32x4_t world_x = vaddq_f32(vmulq_f32(vcvtq_f32_s32(points.val[0]), width),
+            vreinterpretq_f32_u32(vandq_u32(even, even_offset)));
+        const float32x4_t world_y = vsubq_f32(vmulq_f32(vcvtq_f32_s32(points.val[1]), height), height);
+
+        float32x4x2_t screen;
+        screen.val[0] = vaddq_f32(vmulq_f32(vsubq_f32(world_x, origin_x), scale), offset_x);
+        screen.val[1] = vaddq_f32(vmulq_f32(vsubq_f32(world_y, origin_y), scale), offset_y);
+        vst2q_f32(&viewport_points[i].x, screen);
     }
+#endif
 
-    float row_start = map->get_tile_width() / 2.0f - row_width / 2.0f;
-    float row_end = row_start + row_width;
+    for (; i < count; i++) viewport_points[i] = world_tile_to_viewport_pixels(tile_points[i]);
+}
 
-    if (translated_point.x >= row_start - 1 && translated_point.x < row_end - 1)
+#if ISOMETRIC_TRANSFORM_SSE2
+// SSE2 has no floor, truncate and step down where that rounded towards zero from below:
+static __m128i floor_to_int(__m128 value)
+{
+    const __m128i truncated = _mm_cvttps_epi32(value);
+    const __m128 rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+    return _mm_add_epi32(truncated, _mm_castps_si128(rounded_up)); // The mask is -1 where it rounded up
+}
+#endif
+
+void transform_snapshot::viewport_pixels_to_world_tiles(std::span<const SDL_FPoint> viewport_points, std::span<SDL_Point> tile_points) const
+{
+    const size_t count = std::min(viewport_points.size(), tile_points.size());
+    size_t i = 0;
+
+#if ISOMETRIC_TRANSFORM_SSE2
+    const __m128 offset_x = _mm_set1_ps(viewport_x);
+    const __m128 offset_y = _mm_set1_ps(viewport_y);
+    const __m128 scale = _mm_set1_ps(zoom);
+    const __m128 origin_x = _mm_set1_ps(view_origin_x);
+    const __m128 origin_y = _mm_set1_ps(view_origin_y);
+    const __m128 width = _mm_set1_ps(half_tile_width);
+    const __m128 height = _mm_set1_ps(half_tile_height);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    for (; i + 4 <= count; i += 4)
     {
-        return true;
+        const __m128 first = _mm_loadu_ps(&viewport_points[i].x);
+        const __m128 second = _mm_loadu_ps(&viewport_points[i + 2].x);
+        const __m128 xs = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 ys = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m128 u = _mm_div_ps(_mm_add_ps(_mm_div_ps(_mm_sub_ps(xs, offset_x), scale), origin_x), width);
+        const __m128 v = _mm_div_ps(_mm_add_ps(_mm_div_ps(_mm_sub_ps(ys, offset_y), scale), origin_y), height);
+
+        const __m128i a = floor_to_int(_mm_div_ps(_mm_add_ps(_mm_add_ps(u, v), one), two));
+        const __m128i b = floor_to_int(_mm_div_ps(_mm_add_ps(_mm_sub_ps(u, v), one), two));
+
+        const __m128i tile_x = _mm_srai_epi32(_mm_add_epi32(a, b), 1);
+        const __m128i tile_y = _mm_sub_epi32(a, b);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&tile_points[i]), _mm_unpacklo_epi32(tile_x, tile_y));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&tile_points[i + 2]), _mm_unpackhi_epi32(tile_x, tile_y));
+    }
+#elif ISOMETRIC_TRANSFORM_NEON
+    const float32x4_t offset_x = vdupq_n_f32(viewport_x);
+    const float32x4_t offset_y = vdupq_n_f32(viewport_y);
+    const float32x4_t scale = vdupq_n_f32(zoom);
+    const float32x4_t origin_x = vdupq_n_f32(view_origin_x);
+    const float32x4_t origin_y = vdupq_n_f32(view_origin_y);
+    const float32x4_t width = vdupq_n_f32(half_tile_width);
+    const float32x4_t height = vdupq_n_f32(half_tile_height);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t two = vdupq_n_f32(2.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4x2_t points = vld2q_f32(&viewport_points[i].x);
+
+        const float32x4_t u = vdivq_f32(vaddq_f32(vdivq_f32(vsubq_f32(points.val[0], offset_x), scale), origin_x), width);
+        const float32x4_t v = vdivq_f32(vaddq_f32(vdivq_f32(vsubq_f32(points.val[1], offset_y), scale), origin_y), height);
+
+        const int32x4_t a = vcvtmq_s32_f32(vdivq_f32(vaddq_f32(vaddq_f32(u, v), one), two));
+        const int32x4_t b = vcvtmq_s32_f32(vdivq_f32(vaddq_f32(vsubq_f32(u, v), one), two));
+
+        int32x4x2_t tiles;
+        tiles.val[0] = vshrq_n_s32(vaddq_s32(a, b), 1);
+        tiles.val[1] = vsubq_s32(a, b);
+        vst2q_s32(&tile_points[i].x, tiles);
     }
+#endif
 
-    return false;
-}
\ No newline at end of file
+    for (; i < count; i++) tile_points[i] = viewport_pixels_to_world_tile(viewport_points[i]);
+}
@@ -1,9 +1,56 @@
 #pragma once
 #include "camera.h"
 #include "tile_map.h"
+#include "tile_span.h"
+#include "tile_geometry.h"
+#include <span>
 
 namespace isometric {
 
+    /// <summary>
+    /// The camera and map values the coordinate conversions need, copied once so that many points can be converted
+    /// without going through the camera and map for each one. Taken with transform::get_snapshot, usually once per
+    /// frame, it goes stale when the camera moves or zooms. Results match transform's own conversions.
+    /// </summary>
+    struct transform_snapshot
+    {
+        float tile_width = 0.0f;
+        float half_tile_width = 0.0f;
+        float half_tile_height = 0.0f;
+        float view_origin_x = 0.0f;     // The top left of the view in world pixels
+        float view_origin_y = 0.0f;
+        float zoom = 1.0f;
+        float viewport_x = 0.0f;
+        float viewport_y = 0.0f;
+
+        /// <returns>False for the snapshot of a transform without a camera or map</returns>
+        bool is_valid() const { return tile_width > 0.0f && half_tile_height > 0.0f; }
+
+        /// <summary>
+        /// See transform::world_tile_to_viewport_pixels
+        /// </summary>
+        SDL_FPoint world_tile_to_viewport_pixels(const SDL_Point& tile_point) const;
+
+        /// <summary>
+        /// See transform::viewport_pixels_to_world_tile
+        /// </summary>
+        SDL_Point viewport_pixels_to_world_tile(const SDL_FPoint& point) const;
+
+        /// <summary>
+        /// Convert a span of tile positions to viewport pixels, four at a time with SSE2 or NEON where available
+        /// </summary>
+        /// <param name="tile_points">The positions in tile coordinates</param>
+        /// <param name="viewport_points">Receives the converted positions, at least as many as tile_points</param>
+        void world_tiles_to_viewport_pixels(std::span<const SDL_Point> tile_points, std::span<SDL_FPoint> viewport_points) const;
+
+        /// <summary>
+        /// Find the tiles containing a span of viewport pixels, four at a time with SSE2 or NEON where available
+        /// </summary>
+        /// <param name="viewport_points">The pixel positions starting at the top left of the screen</param>
+        /// <param name="tile_points">Receives the tile positions, at least as many as viewport_points</param>
+        void viewport_pixels_to_world_tiles(std::span<const SDL_FPoint> viewport_points, std::span<SDL_Point> tile_points) const;
+    };
+
     class transform
     {
     private:
@@ -21,6 +68,12 @@ namespace isometric {
 
         bool has_sanity() const;
 
+        /// <returns>The camera and map values for batch conversions, invalid without a camera or map</returns>
+        transform_snapshot get_snapshot() const;
+
+        /// <returns>The main camera's zoom, screen pixels per world pixel, or 1 without a camera</returns>
+        float get_zoom() const;
+
         /// <summary>
         /// Converts a world tile position (in tile coordinates) to a world based pixel position. The pixel based 
         /// coordinates starts at 0, 0 relative to the top left of the whole map.
@@ -37,6 +90,22 @@ namespace isometric {
         /// <returns>The tile position of a tile starting at 0, 0 relative to the entire world</returns>
         SDL_Point world_pixels_to_world_tile(const SDL_FPoint& point) const;
 
+        /// <summary>
+        /// Converts a viewport (pixels) point into a world (pixels) point, the inverse of
+        /// world_tile_to_viewport_pixels for pixel positions.
+        /// </summary>
+        /// <param name="point">The pixel position starting at the top left of the screen</param>
+        /// <returns>The world position in pixel coordinates</returns>
+        SDL_FPoint viewport_pixels_to_world_pixels(const SDL_FPoint& point) const;
+
+        /// <summary>
+        /// Finds the tile whose diamond contains a viewport (pixels) point, such as the mouse cursor. This is a
+        /// constant time calculation and doesn't hit test any tiles.
+        /// </summary>
+        /// <param name="point">The pixel position starting at the top left of the screen</param>
+        /// <returns>The tile position, which may be outside of the map</returns>
+        SDL_Point viewport_pixels_to_world_tile(const SDL_FPoint& point) const;
+
         /// <summary>
         /// Converts a world tile position (in tile coordinates) to a viewport pixel position. This is where the tile
         /// should be rendered to the viewport based on the top left of what is visible on the screen.
@@ -60,6 +129,18 @@ namespace isometric {
         /// <returns>True if point is inside the tile</returns>
         bool tile_hittest(const SDL_Point& tile_point, const SDL_FPoint& point) const;
 
+        /// <summary>
+        /// Finds every tile whose image overlaps the camera's viewport, accounting for the stagger of odd rows and
+        /// for images taller or wider than a tile (see tile_map::get_max_image_width/height).
+        /// </summary>
+        /// <returns>The visible tiles clamped to the map, or an empty span if there is no camera or map</returns>
+        tile_span get_visible_tile_span() const;
+
+        /// <summary>
+        /// The largest camera position (in tile coordinates) that keeps the viewport covered by the map
+        /// </summary>
+        SDL_FPoint get_max_camera_position() const;
+
         /// <summary>
         /// Is an viewport point inside a tile from a viewport point
         /// </summary>
@@ -1,11 +1,18 @@
 #include <SDL.h>
 #include "world.h"
 #include "input.h"
+#include "../tools/stopwatch.h"
+#include "../tools/parallel.h"
+#include "../tools/profiler.h"
+#include "../tools/frame_arena.h"
+#include <algorithm>
 #include <iostream>
+#include <cstring>
 
 using namespace isometric;
 
 world::world(std::shared_ptr<tile_map> map, std::shared_ptr<camera> main_camera) :
+    objects(map ? map->get_map_width() : 0, map ? map->get_map_height() : 0),
     map(map),
     transform(main_camera, map)
 {
@@ -30,144 +37,880 @@ std::shared_ptr<camera> world::get_main_camera() const
     return nullptr;
 }
 
+void world::add_camera(std::shared_ptr<camera> camera)
+{
+    if (camera && std::find(cameras.begin(), cameras.end(), camera) == cameras.end()) cameras.push_back(camera);
+}
+
+void world::remove_camera(std::shared_ptr<camera> camera)
+{
+    std::erase(cameras, camera);
+}
+
+const std::vector<std::shared_ptr<camera>>& world::get_cameras() const
+{
+    return cameras;
+}
+
+void world::update_viewports()
+{
+    // Viewports are kept in the order of their cameras, reordered in place so an unchanged set allocates nothing:
+    size_t enabled = 0;
+    for (const auto& camera : cameras)
+    {
+        if (!camera->is_enabled()) continue;
+
+        auto existing = std::find_if(viewports.begin() + enabled, viewports.end(), [&](const viewport& view) { return view.view_camera == camera; });
+        if (existing == viewports.end()) viewports.emplace(viewports.begin() + enabled, camera, map);
+        else if (existing != viewports.begin() + enabled) std::iter_swap(existing, viewports.begin() + enabled);
+
+        enabled++;
+    }
+
+    viewports.erase(viewports.begin() + enabled, viewports.end());
+
+    for (size_t i = 0; i < viewports.size(); i++)
+    {
+        viewport& view = viewports[i];
+        view.view_transform.set_map(map);
+
+        // Cameras looking at the same tiles through the same size of viewport see the same span:
+        const camera& looking = *view.view_camera;
+        auto same_view = std::find_if(viewports.begin(), viewports.begin() + i, [&](const viewport& other)
+        {
+            const camera& seen = *other.view_camera;
+            return
+                seen.get_current_x() == looking.get_current_x() && seen.get_current_y() == looking.get_current_y() &&
+                seen.get_zoom() == looking.get_zoom() &&
+                seen.get_width() == looking.get_width() && seen.get_height() == looking.get_height();
+        });
+
+        view.visible_span = same_view != viewports.begin() + i
+            ? same_view->visible_span
+            : view.view_transform.get_visible_tile_span();
+    }
+}
+
 void world::update(double delta_time)
 {
+    ISOMETRIC_PROFILE_ZONE("world::update");
+
+    tools::stopwatch update_stopwatch;
+    update_stopwatch.start();
+
+    // Stats for this frame start here and are completed by render():
+    current_stats = render_stats();
+    current_stats.frame = ++frame_counter;
+
+    // The edits made since the last update become one version of the map, for whoever pulls deltas from it:
+    if (map) map->commit_changes();
+
+    // Every animated tile follows this one clock, nothing is updated per tile. Tiles that became animated, or
+    // stopped, move between the caches and the tile loop:
+    if (map)
+    {
+        map->set_animation_time(map->get_animation_time() + delta_time);
+
+        if (map->get_animation_set_revision() != cached_animation_set)
+        {
+            cached_animation_set = map->get_animation_set_revision();
+            redraw_cached_tiles();
+        }
+    }
+
+    // Everything below (picking, rendering and object culling) works from the same spans for this frame:
+    update_viewports();
     transform.set_camera(get_main_camera());
     transform.set_map(map);
+    visible_span = viewports.empty() ? tile_span() : viewports.front().visible_span;
+
+    // Request the chunks around every view before anything needs them, rendering never waits for a load:
+    if (streamer)
+    {
+        std::pmr::vector<chunk_streamer::view> streamed(tools::frame_arena::get());
+        for (const viewport& view : viewports)
+        {
+            const tile_span& span = view.visible_span;
+            if (span.is_empty()) continue;
+
+            const int x_begin = std::min(span.x_begin[0], span.x_begin[1]);
+            const int x_end = std::max(span.x_end[0], span.x_end[1]);
+
+            streamed.push_back(chunk_streamer::view{
+                SDL_Rect{ x_begin, span.y_begin, x_end - x_begin, span.y_end - span.y_begin },
+                view.view_camera->get_velocity() });
+        }
+
+        if (!streamed.empty()) streamer->update(streamed);
+    }
+
+    if (paths) paths->update();
+
+    // Set the currently selected tile based on the position of the mouse cursor, over the topmost viewport:
+    if (map)
+    {
+        const SDL_FPoint mouse = input::get_snapshot().mouse_position;
+
+        for (auto view = viewports.rbegin(); view != viewports.rend(); ++view)
+        {
+            const camera& camera = *view->view_camera;
+            const bool inside_viewport =
+                mouse.x >= camera.get_viewport_x() && mouse.x < camera.get_viewport_x() + camera.get_width() &&
+                mouse.y >= camera.get_viewport_y() && mouse.y < camera.get_viewport_y() + camera.get_height();
+
+            if (!inside_viewport) continue;
+
+            const SDL_Point tile_point = view->view_transform.viewport_pixels_to_world_tile(mouse);
+
+            // The span is clamped to the map, so this also rejects tiles outside of it:
+            if (view->visible_span.contains(tile_point))
+            {
+                set_selection(tile_point);
+            }
+            break;
+        }
+    }
+
+    if (frame_reuse_enabled)
+    {
+        for (viewport& view : viewports)
+        {
+            const uint64_t signature = get_view_signature(view);
+            if (signature != view.view_signature)
+            {
+                view.view_signature = signature;
+                view.frame_changed = true;
+            }
+        }
+    }
+
+    update_stopwatch.stop();
+    current_stats.update_ms = update_stopwatch.get_elapsed_ms();
 
     update_called = true;
 }
 
 void world::render(SDL_Renderer* renderer, double delta_time)
 {
+    ISOMETRIC_PROFILE_ZONE("world::render");
+
     if (!update_called)
     {
         std::cout << "WARN: Update wasn't called before the world was rendered! Transform may be invalid as a result." << std::endl;
     }
 
-    unsigned long long render_tile_count = 0;
-    unsigned long long iterated_tile_count = 0;
+    last_drawn_texture = nullptr;
+
+    if (viewports.empty()) return; // No point in rendering if there is no camera
+
+    // Objects drawn between rows are culled and put in row order once, for every viewport at the same time:
+    if (depth_sorting_enabled)
+    {
+        tools::stopwatch objects_stopwatch;
+        objects_stopwatch.start();
+        collect_depth_sorted_objects();
+        objects_stopwatch.stop();
+        current_stats.objects_ms += objects_stopwatch.get_elapsed_ms();
+    }
 
-    auto camera = get_main_camera();
-    if (!camera) return; // No point in rendering if there is no camera
+    last_frame_reused = true;
+    for (viewport& view : viewports) render_viewport(renderer, view, delta_time);
+
+    // Back to the main camera for whatever runs before the next update:
+    transform.set_camera(viewports.front().view_camera);
+    visible_span = viewports.front().visible_span;
+
+    last_stats = current_stats;
+    stats_history.push(current_stats);
+
+    // Signal update call checking, after rendering update() will need to be called again. This is primarily for 
+    // warning the developer about not calling update() before render()
+    update_called = false;
+}
 
+void world::render_viewport(SDL_Renderer* renderer, viewport& view, double delta_time)
+{
+    const camera& camera = *view.view_camera;
     SDL_Rect camera_viewport = {
-        static_cast<int>(camera->get_viewport_x()),
-        static_cast<int>(camera->get_viewport_y()),
-        static_cast<int>(camera->get_width()),
-        static_cast<int>(camera->get_height())
+        static_cast<int>(camera.get_viewport_x()),
+        static_cast<int>(camera.get_viewport_y()),
+        static_cast<int>(camera.get_width()),
+        static_cast<int>(camera.get_height())
     };
 
+    // Objects and pooled objects draw through the world's transform, it follows the viewport being drawn:
+    transform.set_camera(view.view_camera);
+    visible_span = view.visible_span;
+    current_stats.viewports_rendered++;
+
+    bool reused = false;
+
+    if (frame_reuse_enabled)
+    {
+        if (!view.frame_cache) view.frame_cache = std::make_unique<rendering::frame_cache>(renderer);
+
+        if (!view.frame_changed && view.frame_cache->is_valid())
+        {
+            view.frame_cache->draw(camera_viewport);
+            reused = true;
+
+            current_stats.frames_reused++;
+            current_stats.draw_calls++;
+        }
+        else if (view.frame_cache->begin_capture())
+        {
+            render_frame(renderer, view, camera_viewport, delta_time);
+            view.frame_cache->end_capture();
+            view.frame_cache->draw(camera_viewport);
+            current_stats.draw_calls++;
+            view.frame_changed = frame_incomplete;
+        }
+        else
+        {
+            render_frame(renderer, view, camera_viewport, delta_time);
+        }
+    }
+    else
+    {
+        render_frame(renderer, view, camera_viewport, delta_time);
+    }
+
+    last_frame_reused = last_frame_reused && reused;
+}
+
+void world::render_frame(SDL_Renderer* renderer, viewport& view, const SDL_Rect& camera_viewport, double delta_time)
+{
+    tools::stopwatch phase_stopwatch;
+    auto camera = view.view_camera;
+
     // Clip the viewport area so that the diamond edges of the tile map are instead straight lines:
     SDL_RenderSetClipRect(renderer, &camera_viewport);
 
-    unsigned max_tiles_horiz = static_cast<unsigned>(
-        /* Add the current camera position */           camera->get_current_x() +
-        /* Pixel width of the camera + 1 column */      static_cast<float>(camera->get_width() + map->get_tile_width()) /
-        /* Number of half-sized tiles that can fit */   (map->get_tile_width() / 2.0f) + 1);
+    // Zoomed far out, every layer of every chunk is drawn from imposters and the tile loop below is skipped:
+    phase_stopwatch.restart();
+    const float zoom = camera->get_zoom();
+    const SDL_FPoint view_origin{
+        camera->get_current_x() * map->get_tile_width(),
+        camera->get_current_y() * (map->get_tile_height() / 2.0f)
+    };
 
-    unsigned max_tiles_vert = static_cast<unsigned>(
-        /* Add the current camera position */           camera->get_current_y() +
-        /* Pixel height of the camera + 1 row */        static_cast<float>(camera->get_height() + map->get_tile_height()) /
-        /* Number of half-sized tiles that can fit */   (map->get_tile_height() / 2.0f) + 1);
+    const bool use_imposters = zoom < lod_zoom_threshold && ensure_chunk_cache(renderer);
+    frame_incomplete = false;
 
-    max_tiles_horiz = std::min(max_tiles_horiz, map->get_map_width());
-    max_tiles_vert = std::min(max_tiles_vert, map->get_map_height());
+    // Otherwise static layers are drawn from the scroll buffer or the chunk render cache when one is available, the
+    // tile loop below then only draws the non-static layers and the selection. The scroll buffer is drawn 1:1:
+    const bool use_scroll_buffer = !use_imposters && zoom == 1.0f && scroll_buffer_enabled && ensure_scroll_buffer(renderer, view);
+    const bool use_chunk_cache = !use_imposters && !use_scroll_buffer && chunk_cache_enabled && ensure_chunk_cache(renderer);
+    const bool static_layers_cached = use_scroll_buffer || use_chunk_cache;
 
-    for (float tile_y = camera->get_current_y(); tile_y < max_tiles_vert; tile_y++)
+    if (use_imposters)
     {
-        for (float tile_x = camera->get_current_x(); tile_x < max_tiles_horiz; tile_x++)
+        const size_t imposters_drawn = chunk_cache->render_imposters(view_origin, camera_viewport, zoom);
+        const size_t imposters_baked = chunk_cache->get_imposter_bake_count();
+        current_stats.imposters_drawn += imposters_drawn;
+        current_stats.imposters_baked += imposters_baked;
+        current_stats.draw_calls += imposters_drawn;
+        current_stats.texture_switches += imposters_drawn;
+
+        // Chunks waiting for their imposter are missing from this frame, it mustn't be reused:
+        frame_incomplete = imposters_baked >= chunk_cache->get_max_imposter_bakes_per_frame();
+    }
+    else if (use_scroll_buffer)
+    {
+        current_stats.draw_calls += view.scroll_buffer->render(view_origin, camera_viewport);
+        current_stats.scroll_tiles_drawn += view.scroll_buffer->get_tiles_drawn();
+    }
+    else if (use_chunk_cache)
+    {
+        const size_t chunks_drawn = chunk_cache->render(view_origin, camera_viewport, zoom);
+        current_stats.chunks_drawn += chunks_drawn;
+        current_stats.chunks_baked += chunk_cache->get_bake_count();
+        current_stats.draw_calls += chunks_drawn;
+        current_stats.texture_switches += chunks_drawn;
+    }
+    phase_stopwatch.stop();
+    current_stats.chunk_cache_ms += phase_stopwatch.get_elapsed_ms();
+
+    phase_stopwatch.restart();
+    view.animated_tiles_drawn = 0;
+
+    // Stage one, generate a draw list per band of rows. Bands only read the map, images and the frame's span and
+    // selection, so they can be generated on worker threads:
+    const int span_rows = visible_span.is_empty() || use_imposters ? 0 : visible_span.y_end - visible_span.y_begin;
+    const bool parallel = parallel_draw_lists_enabled && span_rows >= 2 * min_rows_per_band;
+    const int rows_per_band = parallel
+        ? std::max(min_rows_per_band, span_rows / static_cast<int>(tools::get_worker_count() * 2))
+        : std::max(span_rows, 1);
+    const size_t band_count = static_cast<size_t>((span_rows + rows_per_band - 1) / rows_per_band);
+
+    if (draw_lists.size() < band_count) draw_lists.resize(band_count);
+    frame_view = transform.get_snapshot();
+
+    auto build_band = [&](size_t band)
+    {
+        ISOMETRIC_PROFILE_ZONE("world::build_draw_list");
+
+        const int y_begin = visible_span.y_begin + static_cast<int>(band) * rows_per_band;
+        const int y_end = std::min(visible_span.y_end, y_begin + rows_per_band);
+        build_draw_list(y_begin, y_end, static_layers_cached, draw_lists[band]);
+    };
+
+    if (parallel) tools::parallel_for(band_count, build_band);
+    else
+    {
+        for (size_t band = 0; band < band_count; band++) build_band(band);
+    }
+
+    phase_stopwatch.stop();
+    current_stats.tiles_ms += phase_stopwatch.get_elapsed_ms();
+
+    // The depth sorted objects were collected by render() for every viewport, with several viewports only those
+    // standing around this one's span are drawn:
+    tools::stopwatch objects_stopwatch;
+    double objects_ms = 0;
+    size_t objects_rendered = 0;
+    size_t objects_considered = 0;  // Reached by this viewport's queries, the ones not rendered were culled
+
+    const bool filter_objects = viewports.size() > 1 && !visible_span.is_empty();
+    const float near_x_begin = std::min(visible_span.x_begin[0], visible_span.x_begin[1]) - object_cull_margin;
+    const float near_x_end = std::max(visible_span.x_end[0], visible_span.x_end[1]) + object_cull_margin;
+    const float near_y_begin = visible_span.y_begin - object_cull_margin;
+    const float near_y_end = visible_span.y_end + object_cull_margin;
+
+    auto is_in_view = [&](const game_object& obj)
+    {
+        if (!filter_objects) return true;
+
+        const SDL_FPoint position = obj.get_position();
+        return
+            position.x >= near_x_begin && position.x < near_x_end && position.y >= near_y_begin && position.y < near_y_end &&
+            obj.is_visible(visible_span);
+    };
+
+    // Stage two, on this thread, merge the bands in row order and submit them to the renderer. With depth sorting
+    // the objects standing on each row are drawn after its tiles, flushing what was batched before each group of
+    // objects, otherwise every object is drawn on top of the tiles:
+    phase_stopwatch.restart();
+    size_t next_object = 0;
+
+    auto render_objects_before_row = [&](float row)
+    {
+        if (next_object >= depth_sorted.size() || depth_sorted[next_object]->get_position().y >= row) return;
+
+        flush_tile_batch(renderer);
+        objects_stopwatch.restart();
+        while (next_object < depth_sorted.size() && depth_sorted[next_object]->get_position().y < row)
         {
-            iterated_tile_count++;
+            const auto& obj = depth_sorted[next_object++];
+            objects_considered++;
+            if (!is_in_view(*obj)) continue;
 
-            tile* current_tile = map->get_tile((unsigned)tile_x, (unsigned)tile_y);
-            SDL_Point tile_point{ static_cast<int>(tile_x), static_cast<int>(tile_y) };
-            std::shared_ptr<tile_image> current_image = nullptr;
-            bool is_selected = false;
+            obj->on_render(renderer, delta_time);
+            objects_rendered++;
+        }
+        objects_stopwatch.stop();
+        objects_ms += objects_stopwatch.get_elapsed_ms();
+    };
 
-            // Render image (if there is one) for every layer:
-            for (unsigned layer_id = 0; layer_id < map->get_layers().size(); layer_id++)
+    for (size_t band = 0; band < band_count; band++)
+    {
+        const band_draw_list& list = draw_lists[band];
+        const int y_begin = visible_span.y_begin + static_cast<int>(band) * rows_per_band;
+
+        current_stats.tiles_iterated += list.tiles_iterated;
+        current_stats.tiles_drawn += list.tiles_drawn;
+        current_stats.animated_tiles_drawn += list.animated_tiles_drawn;
+        view.animated_tiles_drawn += list.animated_tiles_drawn;
+
+        size_t draw_index = 0;
+        for (size_t row = 0; row < list.row_ends.size(); row++)
+        {
+            // Objects standing in front of the previous row are drawn before this row's tiles can cover them:
+            if (depth_sorting_enabled) render_objects_before_row(static_cast<float>(y_begin + static_cast<int>(row)));
+
+            for (; draw_index < list.row_ends[row]; draw_index++)
             {
-                if (current_tile && current_tile->has_image(layer_id))
-                {
-                    // If the tile isn't empty, get it's image:
-                    current_image = map->get_image(current_tile->get_image_id(layer_id));
-                }
-                else if ((!current_tile || !current_tile->has_image(layer_id)) && map->layer_has_default_images(layer_id))
-                {
-                    // If the tile is empty, attempt to get a default image for the tile and set it so that it's
-                    // remembered if this tile comes back into view later.
-                    current_image = map->get_image(map->get_random_layer_default_image(layer_id));
-                    current_tile->set_image_id(layer_id, current_image->get_image_id());
-                }
-                else
+                const tile_draw& draw = list.draws[draw_index];
+                draw_tile_image(renderer, *draw.image, draw.screen_pos, draw.alpha);
+            }
+        }
+    }
+
+    // Objects in front of the last row:
+    if (depth_sorting_enabled) render_objects_before_row(std::numeric_limits<float>::infinity());
+
+    flush_tile_batch(renderer);
+    phase_stopwatch.stop();
+    current_stats.submit_ms += phase_stopwatch.get_elapsed_ms() - objects_ms;
+
+    // Render the remaining game objects, only those in grid cells near the visible span are considered. With depth
+    // sorting only the objects without a position are left:
+    phase_stopwatch.restart();
+    objects.for_each_in_span(visible_span, object_cull_margin, [&](const std::shared_ptr<game_object>& obj)
+    {
+        if (depth_sorting_enabled && obj->has_position()) return;
+
+        objects_considered++;
+        if (obj->is_visible(visible_span))
+        {
+            obj->on_render(renderer, delta_time);
+            objects_rendered++;
+        }
+    });
+    current_stats.objects_rendered += objects_rendered;
+    current_stats.objects_culled += objects_considered - objects_rendered;
+
+    // Pooled objects are culled by their batch's renderer:
+    pooled_objects.render(renderer, transform, visible_span, delta_time);
+    phase_stopwatch.stop();
+    current_stats.objects_ms += objects_ms + phase_stopwatch.get_elapsed_ms();
+
+    // Reset clipping so that future rendering isn't affected:
+    SDL_RenderSetClipRect(renderer, nullptr);
+}
+
+void world::build_draw_list(int y_begin, int y_end, bool static_layers_cached, band_draw_list& list) const
+{
+    list.draws.clear();
+    list.row_ends.clear();
+    list.tiles_iterated = 0;
+    list.tiles_drawn = 0;
+    list.animated_tiles_drawn = 0;
+
+    const unsigned layer_count = static_cast<unsigned>(map->get_layers().size());
+    const tile_image* selection_image = map->get_selection_image();
+    const tile_image* placeholder_image = map->get_placeholder_image();
+
+    // Images taller than a tile can cover objects behind them, with depth sorting they aren't baked:
+    const bool draw_tall_static = static_layers_cached && depth_sorting_enabled;
+    const unsigned tile_height = map->get_tile_height();
+
+    for (int tile_y = y_begin; tile_y < y_end; tile_y++)
+    {
+        const int x_begin = visible_span.row_begin(tile_y);
+        const int x_end = visible_span.row_end(tile_y);
+
+        // Tiles are in tile coordinates, to render they're converted to pixel coordinates relative to the viewport
+        // (screen), the whole row at once:
+        list.row_tiles.clear();
+        for (int tile_x = x_begin; tile_x < x_end; tile_x++) list.row_tiles.push_back(SDL_Point{ tile_x, tile_y });
+        list.row_positions.resize(list.row_tiles.size());
+        frame_view.world_tiles_to_viewport_pixels(list.row_tiles, list.row_positions);
+
+        for (int tile_x = x_begin; tile_x < x_end; tile_x++)
+        {
+            list.tiles_iterated++;
+
+            tile current_tile = map->find_tile(static_cast<unsigned>(tile_x), static_cast<unsigned>(tile_y));
+            const SDL_FPoint screen_pos = list.row_positions[static_cast<size_t>(tile_x - x_begin)];
+            const bool is_selected = tile_x == selected_world_tile.x && tile_y == selected_world_tile.y;
+
+            // The tile's chunk isn't allocated, or hasn't been streamed in yet:
+            if (!current_tile)
+            {
+                if (placeholder_image)
                 {
-                    continue; // Tile is definitely empty
+                    list.draws.push_back(tile_draw{ placeholder_image, screen_pos, 255 });
+                    list.tiles_drawn++;
                 }
 
-                // Tiles are currently in tile coordinates, to render convert it to pixel coordinates relative
-                // to the viewport (screen):
-                SDL_FPoint screen_pos = transform.world_tile_to_viewport_pixels(tile_point);
+                if (is_selected && selection_image) list.draws.push_back(tile_draw{ selection_image, screen_pos, 90 });
+                continue;
+            }
+
+            // From the first animated layer up, a tile isn't baked into the caches and is drawn here every frame:
+            bool animated = false;
+
+            // Render image (if there is one) for every layer:
+            for (unsigned layer_id = 0; layer_id < layer_count; layer_id++)
+            {
+                // Empty tiles are skipped, default images are filled in by tile_map::generate_default_images:
+                if (!current_tile.has_image(layer_id) || !map->is_layer_visible(layer_id)) continue;
+
+                const unsigned image_id = current_tile.get_image_id(layer_id);
+                animated = animated || map->is_image_animated(image_id);
+
+                // Animations resolve to their frame here, at draw time, from the map's animation clock:
+                const tile_image* current_image = map->get_current_image(image_id);
+                const bool draw_layer = !static_layers_cached || !map->is_layer_static(layer_id) || animated ||
+                    (draw_tall_static && current_image && current_image->get_source_h() > tile_height);
 
-                if (current_image != nullptr && current_tile && current_tile->has_image(layer_id))
+                if (draw_layer && current_image != nullptr)
                 {
-                    SDL_RenderCopyF(
-                        renderer,
-                        current_image->get_texture(),
-                        current_image->get_source_rect(),   // Where the tile is in the source image
-                        current_image->get_dest_rect(
-                            screen_pos.x, screen_pos.y,     // Where to actually draw the tile on the screen
-                            map->get_tile_height()          // The tile height is used to bottom align tile images
-                        )
-                    );
+                    list.draws.push_back(tile_draw{ current_image, screen_pos, 255 });
 
                     // For metrics & logging, how many tiles have been rendered?
-                    render_tile_count++;
+                    list.tiles_drawn++;
+                    if (animated) list.animated_tiles_drawn++;
                 }
+            }
 
-                // Set the currently selected tile based on the position of the mouse cursor:
-                if (transform.tile_hittest_by_viewport(screen_pos, input::mouse_position()))
-                {
-                    set_selection(tile_point);
-                    is_selected = true;
-                }
+            // Render the selection tile over the selected tile, whichever of its layers are empty or hidden:
+            if (is_selected && selection_image)
+            {
+                // The selection tile image should be rendered as semi-transparent
+                list.draws.push_back(tile_draw{ selection_image, screen_pos, 90 });
+            }
+        }
 
-                // Render the selection tile if the current tile is selected and this is the first layer:
-                if (layer_id == 0 && is_selected && map->has_selection_image())
-                {
-                    auto selection_image = map->get_selection_image();
-
-                    // The selection tile image should be rendered as semi-transparent
-                    SDL_SetTextureAlphaMod(selection_image->get_texture(), 90);
-
-                    SDL_RenderCopyF(
-                        renderer,
-                        selection_image->get_texture(),
-                        selection_image->get_source_rect(),
-                        selection_image->get_dest_rect(
-                            screen_pos.x, screen_pos.y,
-                            map->get_tile_height()
-                        )
-                    );
-
-                    SDL_SetTextureAlphaMod(selection_image->get_texture(), 255);
-                }
+        list.row_ends.push_back(list.draws.size());
+    }
+}
+
+void world::collect_depth_sorted_objects()
+{
+    // Mark every object visible in any viewport for this frame, objects that weren't visible last frame are appended:
+    for (const viewport& view : viewports)
+    {
+        objects.for_each_in_span(view.visible_span, object_cull_margin, [&](const std::shared_ptr<game_object>& obj)
+        {
+            if (!obj->has_position() || obj->depth_frame == frame_counter || !obj->is_visible(view.visible_span)) return;
+
+            obj->depth_frame = frame_counter;
+            if (!obj->depth_listed)
+            {
+                obj->depth_listed = true;
+                depth_sorted.push_back(obj);
+            }
+        });
+    }
+
+    // Drop objects that are no longer visible, or were removed from the world:
+    std::erase_if(depth_sorted, [&](const std::shared_ptr<game_object>& obj)
+    {
+        const bool keep = obj->depth_frame == frame_counter && obj->has_position() && objects.contains(*obj);
+        if (!keep) obj->depth_listed = false;
+        return !keep;
+    });
+
+    // Objects barely move between frames, so the list is nearly sorted and an insertion sort is close to linear:
+    for (size_t i = 1; i < depth_sorted.size(); i++)
+    {
+        std::shared_ptr<game_object> obj = std::move(depth_sorted[i]);
+        const SDL_FPoint key = obj->get_position();
+
+        size_t j = i;
+        for (; j > 0; j--)
+        {
+            const SDL_FPoint& previous = depth_sorted[j - 1]->get_position();
+            if (previous.y < key.y || (previous.y == key.y && previous.x <= key.x)) break;
+
+            depth_sorted[j] = std::move(depth_sorted[j - 1]);
+        }
+
+        depth_sorted[j] = std::move(obj);
+    }
+}
+
+void world::flush_tile_batch(SDL_Renderer* renderer)
+{
+    if (!geometry_batching_enabled || tile_batch.get_quad_count() == 0) return;
+
+    tile_batch.flush(renderer);
+    current_stats.draw_calls += tile_batch.get_draw_calls();
+    current_stats.texture_switches += tile_batch.get_texture_switches();
+    current_stats.alpha_mod_changes += tile_batch.get_alpha_mod_changes();
+}
+
+void world::set_depth_sorting_enabled(bool enable)
+{
+    depth_sorting_enabled = enable;
+
+    // The chunk cache has to re-bake without (or with) the images that are now drawn tile by tile:
+    if (chunk_cache) chunk_cache->set_bake_tall_images(!enable);
+    for (viewport& view : viewports)
+    {
+        if (view.scroll_buffer) view.scroll_buffer->set_bake_tall_images(!enable);
+    }
+
+    if (!enable)
+    {
+        for (const auto& obj : depth_sorted) obj->depth_listed = false;
+        depth_sorted.clear();
+    }
+}
+
+bool world::is_depth_sorting_enabled() const
+{
+    return depth_sorting_enabled;
+}
+
+void world::set_lod_zoom_threshold(float zoom)
+{
+    lod_zoom_threshold = std::max(zoom, 0.0f);
+}
+
+float world::get_lod_zoom_threshold() const
+{
+    return lod_zoom_threshold;
+}
+
+void world::set_parallel_draw_lists_enabled(bool enable)
+{
+    parallel_draw_lists_enabled = enable;
+}
+
+bool world::is_parallel_draw_lists_enabled() const
+{
+    return parallel_draw_lists_enabled;
+}
+
+void world::draw_tile_image(SDL_Renderer* renderer, const tile_image& image, const SDL_FPoint& screen_pos, Uint8 alpha)
+{
+    // Images are bottom aligned to the tile by an offset precomputed when they were added to the map:
+    const SDL_FRect dest = image.get_dest_rect(screen_pos.x, screen_pos.y, transform.get_zoom());
+
+    if (geometry_batching_enabled)
+    {
+        tile_batch.add(image.get_texture(), image.get_source_rect(), dest, SDL_Color{ 255, 255, 255, alpha });
+    }
+    else
+    {
+        if (alpha != 255)
+        {
+            SDL_SetTextureAlphaMod(image.get_texture(), alpha);
+            current_stats.alpha_mod_changes++;
+        }
+
+        SDL_RenderCopyF(renderer, image.get_texture(), &image.get_source_rect(), &dest);
+        current_stats.draw_calls++;
+
+        if (image.get_texture() != last_drawn_texture)
+        {
+            if (last_drawn_texture) current_stats.texture_switches++;
+            last_drawn_texture = image.get_texture();
+        }
+
+        if (alpha != 255)
+        {
+            SDL_SetTextureAlphaMod(image.get_texture(), 255);
+            current_stats.alpha_mod_changes++;
+        }
+    }
+}
+
+void world::set_geometry_batching_enabled(bool enable)
+{
+    geometry_batching_enabled = enable;
+    tile_batch.clear();
+}
+
+bool world::is_geometry_batching_enabled() const
+{
+    return geometry_batching_enabled;
+}
+
+bool world::ensure_chunk_cache(SDL_Renderer* renderer)
+{
+    if (!chunk_cache)
+    {
+        chunk_cache = std::make_unique<rendering::chunk_render_cache>(renderer, map);
+        chunk_cache->set_bake_tall_images(!depth_sorting_enabled);
+    }
+
+    return chunk_cache->is_supported();
+}
+
+void world::set_chunk_cache_enabled(bool enable)
+{
+    chunk_cache_enabled = enable;
+    if (!enable) chunk_cache.reset();
+}
+
+bool world::is_chunk_cache_enabled() const
+{
+    return chunk_cache_enabled;
+}
+
+bool world::ensure_scroll_buffer(SDL_Renderer* renderer, viewport& view)
+{
+    // Every viewport scrolls on its own, so each has its own buffer:
+    if (!view.scroll_buffer)
+    {
+        view.scroll_buffer = std::make_unique<rendering::scroll_buffer>(renderer, map);
+        view.scroll_buffer->set_bake_tall_images(!depth_sorting_enabled);
+    }
+
+    return view.scroll_buffer->is_supported();
+}
+
+void world::set_scroll_buffer_enabled(bool enable)
+{
+    scroll_buffer_enabled = enable;
+    if (enable) return;
+
+    for (viewport& view : viewports) view.scroll_buffer.reset();
+}
+
+bool world::is_scroll_buffer_enabled() const
+{
+    return scroll_buffer_enabled;
+}
+
+void world::set_chunk_streamer(std::shared_ptr<chunk_streamer> streamer)
+{
+    this->streamer = streamer;
+}
+
+std::shared_ptr<chunk_streamer> world::get_chunk_streamer() const
+{
+    return streamer;
+}
+
+void world::set_path_finder(std::shared_ptr<path_finder> paths)
+{
+    this->paths = paths;
+}
+
+std::shared_ptr<path_finder> world::get_path_finder() const
+{
+    return paths;
+}
+
+void world::invalidate_render_caches()
+{
+    if (chunk_cache) chunk_cache->clear();
+    for (viewport& view : viewports)
+    {
+        if (view.scroll_buffer) view.scroll_buffer->clear();
+        if (view.frame_cache) view.frame_cache->clear();
+        view.frame_changed = true;
+    }
+}
+
+void world::refresh_texture(SDL_Texture* previous, SDL_Texture* texture)
+{
+    // Tiles are baked into the chunk and scroll caches, objects are only in the frame caches:
+    const bool used_by_tiles = map && map->retarget_texture(previous, texture) > 0;
+    if (used_by_tiles && chunk_cache) chunk_cache->invalidate_all();
+
+    // A replaced texture is destroyed, its address may come back as another texture of a different size:
+    const bool replaced = previous != texture;
+    if (replaced)
+    {
+        tile_batch.forget_textures();
+        if (chunk_cache) chunk_cache->forget_textures();
+    }
+
+    for (viewport& view : viewports)
+    {
+        if (replaced && view.scroll_buffer) view.scroll_buffer->forget_textures();
+        if (used_by_tiles && view.scroll_buffer) view.scroll_buffer->invalidate();
+        if (view.frame_cache) view.frame_cache->invalidate();
+        view.frame_changed = true;
+    }
+}
+
+void world::set_optional_layers_visible(bool visible)
+{
+    if (visible == optional_layers_visible) return;
+    optional_layers_visible = visible;
+
+    bool changed = false;
+    for (unsigned layer_id = 0; map && layer_id < map->get_layers().size(); layer_id++)
+    {
+        if (!map->is_layer_optional(layer_id)) continue;
+
+        map->set_layer_visible(layer_id, visible);
+        changed = true;
+    }
+
+    if (changed) redraw_cached_tiles();
+}
+
+void world::redraw_cached_tiles()
+{
+    // The textures are kept, only what's baked in them is redrawn:
+    if (chunk_cache) chunk_cache->invalidate_all();
+    for (viewport& view : viewports)
+    {
+        if (view.scroll_buffer) view.scroll_buffer->invalidate();
+        if (view.frame_cache) view.frame_cache->invalidate();
+        view.frame_changed = true;
+    }
+}
+
+bool world::are_optional_layers_visible() const
+{
+    return optional_layers_visible;
+}
+
+uint64_t world::get_view_signature(const viewport& view) const
+{
+    uint64_t signature = 0xcbf29ce484222325ULL;
+    auto combine = [&signature](uint64_t value) { signature = (signature ^ value) * 0x100000001b3ULL; };
+
+    const tile_span& visible_span = view.visible_span;
+    auto camera = view.view_camera;
+    if (camera)
+    {
+        for (float value : { camera->get_current_x(), camera->get_current_y(), camera->get_zoom() })
+        {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            combine(bits);
+        }
+
+        combine(camera->get_viewport_x());
+        combine(camera->get_viewport_y());
+        combine(camera->get_width());
+        combine(camera->get_height());
+    }
+
+    combine(static_cast<uint32_t>(selected_world_tile.x));
+    combine(static_cast<uint32_t>(selected_world_tile.y));
+    combine(objects.get_revision());
+    combine(pooled_objects.get_revision());
+
+    // Animations only change a frame that drew some of them:
+    if (map && view.animated_tiles_drawn > 0) combine(map->get_animation_revision());
+
+    // Every chunk overlapping the visible tiles, by revision and instance so streamed in chunks count as changes:
+    if (map && !visible_span.is_empty())
+    {
+        combine(map->get_image_count());
+
+        const int x_begin = std::min(visible_span.x_begin[0], visible_span.x_begin[1]);
+        const int x_end = std::max(visible_span.x_end[0], visible_span.x_end[1]);
+        constexpr int chunk_size = static_cast<int>(tile_chunk::size);
+
+        for (int chunk_y = visible_span.y_begin / chunk_size; chunk_y <= (visible_span.y_end - 1) / chunk_size; chunk_y++)
+        {
+            for (int chunk_x = x_begin / chunk_size; chunk_x <= (x_end - 1) / chunk_size; chunk_x++)
+            {
+                const tile_chunk* chunk = map->find_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+                combine(chunk ? chunk->get_instance_id() : 0);
+                combine(chunk ? chunk->get_planes().revision : 0);
             }
         }
     }
 
-    // Render game objects:
-    for (const auto& obj : objects)
+    return signature;
+}
+
+void world::set_frame_reuse_enabled(bool enable)
+{
+    frame_reuse_enabled = enable;
+    for (viewport& view : viewports)
     {
-        if (obj) obj->on_render(renderer, delta_time);
+        view.frame_changed = true;
+        if (!enable) view.frame_cache.reset();
     }
+}
 
-    // Reset clipping so that future rendering isn't affected:
-    SDL_RenderSetClipRect(renderer, nullptr);
+bool world::is_frame_reuse_enabled() const
+{
+    return frame_reuse_enabled;
+}
 
-    // Signal update call checking, after rendering update() will need to be called again. This is primarily for 
-    // warning the developer about not calling update() before render()
-    update_called = false;
+void world::mark_changed()
+{
+    for (viewport& view : viewports) view.frame_changed = true;
+}
+
+bool world::was_last_frame_reused() const
+{
+    return last_frame_reused;
 }
 
 void world::set_selection(const SDL_Point& tile_point)
@@ -193,45 +936,76 @@ void world::reset_selection()
     selected_world_tile.y = std::numeric_limits<int>::max();
 }
 
-unsigned world::get_max_horizontal_tiles() const
+const render_stats& world::get_render_stats() const
 {
-    auto camera = get_main_camera();
-    unsigned max_tiles_horiz = 0;
+    return last_stats;
+}
 
-    if (camera)
-    {
-        max_tiles_horiz = camera->get_width() / map->get_tile_width();
-    }
+const render_stats_history& world::get_render_stats_history() const
+{
+    return stats_history;
+}
 
-    return max_tiles_horiz;
+render_stats_history& world::get_render_stats_history()
+{
+    return stats_history;
 }
 
-unsigned world::get_max_vertical_tiles() const
+const tile_span& world::get_visible_tile_span() const
 {
-    auto camera = get_main_camera();
-    unsigned max_tiles_vert = 0;
+    return viewports.empty() ? visible_span : viewports.front().visible_span;
+}
 
-    if (camera)
+const tile_span& world::get_visible_tile_span(const camera& camera) const
+{
+    static const tile_span no_span;
+
+    for (const viewport& view : viewports)
     {
-        max_tiles_vert = static_cast<unsigned>(std::round(camera->get_height() / (map->get_tile_height() / 2.0f)));
+        if (view.view_camera.get() == &camera) return view.visible_span;
     }
 
-    return max_tiles_vert;
+    return no_span;
 }
 
 void isometric::world::add_object(std::shared_ptr<game_object> obj)
 {
-    if (obj)
+    if (obj && !objects.contains(*obj))
     {
-        obj->setup_transform(get_main_camera(), map);
-        objects.push_back(obj);
+        obj->set_transform(&transform);
+        objects.insert(obj);
     }
 }
 
 void isometric::world::remove_object(std::shared_ptr<game_object> obj)
 {
-    if (obj)
+    if (obj && objects.remove(*obj))
     {
-        objects.remove(obj);
+        obj->set_transform(nullptr);
     }
 }
+
+object_store& world::get_object_store()
+{
+    return pooled_objects;
+}
+
+const object_store& world::get_object_store() const
+{
+    return pooled_objects;
+}
+
+const object_grid& world::get_objects() const
+{
+    return objects;
+}
+
+void world::set_object_cull_margin(float tiles)
+{
+    object_cull_margin = std::max(0.0f, tiles);
+}
+
+float world::get_object_cull_margin() const
+{
+    return object_cull_margin;
+}
@@ -1,12 +1,20 @@
 #pragma once
 #include <vector>
-#include <list>
 #include <memory>
 #include <ranges>
 #include "transform.h"
 #include "camera.h"
 #include "tile_map.h"
 #include "game_object.h"
+#include "object_grid.h"
+#include "object_store.h"
+#include "render_stats.h"
+#include "chunk_streamer.h"
+#include "path_finder.h"
+#include "../rendering/chunk_render_cache.h"
+#include "../rendering/scroll_buffer.h"
+#include "../rendering/sprite_batch.h"
+#include "../rendering/frame_cache.h"
 
 namespace isometric {
 
@@ -14,18 +22,126 @@ namespace isometric {
     {
     private:
         std::vector<std::shared_ptr<camera>> cameras;
-        std::list<std::shared_ptr<game_object>> objects;
+        object_grid objects;
+        float object_cull_margin = 2.0f;    // by tiles, objects can draw outside of their tile
+        object_store pooled_objects;
         std::shared_ptr<tile_map> map;
-        transform transform;
         SDL_Point selected_world_tile;
 
+        // One enabled camera's share of a frame. Kept between frames, by camera, for its buffers:
+        struct viewport
+        {
+            std::shared_ptr<camera> view_camera;
+            isometric::transform view_transform;
+            tile_span visible_span;
+            std::unique_ptr<rendering::scroll_buffer> scroll_buffer = nullptr;
+            std::unique_ptr<rendering::frame_cache> frame_cache = nullptr;
+            bool frame_changed = true;      // Since its cached frame was captured
+            unsigned long long animated_tiles_drawn = 0;    // By the last frame that wasn't reused
+            uint64_t view_signature = 0;
+
+            viewport(std::shared_ptr<camera> view_camera, std::shared_ptr<tile_map> map)
+                : view_camera(view_camera), view_transform(view_camera, map) {}
+        };
+
+        std::vector<viewport> viewports;    // Every enabled camera in order, the main camera first
+
+        // The viewport being rendered, or the main camera's outside of render(). Objects draw through transform:
+        transform transform;
+        tile_span visible_span;
+
         bool update_called = false;
 
+        unsigned long long frame_counter = 0;
+        render_stats current_stats;     // Being collected for the frame in progress
+        render_stats last_stats;        // The last completed frame
+        render_stats_history stats_history;
+        SDL_Texture* last_drawn_texture = nullptr;
+
+        bool chunk_cache_enabled = false;
+        std::unique_ptr<rendering::chunk_render_cache> chunk_cache = nullptr;
+
+        float lod_zoom_threshold = 0.5f;    // See set_lod_zoom_threshold
+        bool frame_incomplete = false;      // Imposters were left to bake in a later frame
+
+        bool scroll_buffer_enabled = false;
+
+        bool geometry_batching_enabled = false;
+        rendering::sprite_batch tile_batch;
+
+        std::shared_ptr<chunk_streamer> streamer = nullptr;
+        std::shared_ptr<path_finder> paths = nullptr;
+
+        // A tile image to draw, generated by build_draw_list and submitted on the render thread:
+        struct tile_draw
+        {
+            const tile_image* image;
+            SDL_FPoint screen_pos;
+            Uint8 alpha;
+        };
+
+        struct band_draw_list
+        {
+            std::vector<tile_draw> draws;
+            std::vector<size_t> row_ends;   // End of each row's draws, so objects can be drawn between rows
+            std::vector<SDL_Point> row_tiles;           // Scratch, the tiles of the row being built
+            std::vector<SDL_FPoint> row_positions;      // Scratch, their viewport positions
+            unsigned long long tiles_iterated = 0;
+            unsigned long long tiles_drawn = 0;
+            unsigned long long animated_tiles_drawn = 0;
+        };
+
+        static constexpr int min_rows_per_band = 8;
+        bool parallel_draw_lists_enabled = false;
+        std::vector<band_draw_list> draw_lists; // Reused every frame, one per band of rows
+        transform_snapshot frame_view;          // The transform of the frame being rendered, for the draw lists
+
+        bool depth_sorting_enabled = false;
+        std::vector<std::shared_ptr<game_object>> depth_sorted;  // Positioned objects visible in any viewport by row, kept between frames
+
+        // Idle frame reuse, see set_frame_reuse_enabled:
+        bool frame_reuse_enabled = false;
+        bool last_frame_reused = false;
+
+        bool optional_layers_visible = true;
+        uint64_t cached_animation_set = 0;  // The map's animation set revision the caches were drawn with
+
+        void update_viewports();
+        void build_draw_list(int y_begin, int y_end, bool static_layers_cached, band_draw_list& list) const;
+        void render_viewport(SDL_Renderer* renderer, viewport& view, double delta_time);
+        void render_frame(SDL_Renderer* renderer, viewport& view, const SDL_Rect& camera_viewport, double delta_time);
+        uint64_t get_view_signature(const viewport& view) const;
+        void collect_depth_sorted_objects();
+        void flush_tile_batch(SDL_Renderer* renderer);
+        void redraw_cached_tiles();
+        bool ensure_chunk_cache(SDL_Renderer* renderer);
+        bool ensure_scroll_buffer(SDL_Renderer* renderer, viewport& view);
+        void draw_tile_image(SDL_Renderer* renderer, const tile_image& image, const SDL_FPoint& screen_pos, Uint8 alpha = 255);
+
     public:
         world(std::shared_ptr<tile_map> map, std::shared_ptr<camera> main_camera);
+
+        /// <returns>The first enabled camera, it drives picking when the mouse isn't over another camera</returns>
         std::shared_ptr<camera> get_main_camera() const;
 
+        /// <summary>
+        /// Render the world through another camera as well, for split screen or a minimap. Every enabled camera is
+        /// drawn into its own viewport, in the order they were added, so later cameras draw over earlier ones.
+        /// </summary>
+        void add_camera(std::shared_ptr<camera> camera);
+        void remove_camera(std::shared_ptr<camera> camera);
+        const std::vector<std::shared_ptr<camera>>& get_cameras() const;
+
+        /// <summary>
+        /// Update the frame's visible span of every enabled camera, then the streamer and selection from them
+        /// </summary>
         void update(double delta_time);
+
+        /// <summary>
+        /// Render every enabled camera. The chunk cache, imposters and the depth sorted objects are shared by all of
+        /// them, and cameras looking at the same tiles share their visible span, so each extra viewport only costs
+        /// the tiles and objects inside it.
+        /// </summary>
         void render(SDL_Renderer* renderer, double delta_time);
 
         void set_selection(const SDL_Point& tile_point);
@@ -33,9 +149,121 @@ namespace isometric {
         bool has_selection() const;
         void reset_selection();
 
-        unsigned get_max_horizontal_tiles() const;
-        unsigned get_max_vertical_tiles() const;
+        /// <summary>
+        /// When enabled, static layers are baked into one texture per chunk and only re-baked when a tile in
+        /// that chunk changes. Falls back to drawing every tile if the renderer doesn't support render targets.
+        /// </summary>
+        void set_chunk_cache_enabled(bool enable = true);
+        bool is_chunk_cache_enabled() const;
+
+        /// <summary>
+        /// When enabled, static layers are kept in a buffer a little larger than the viewport and only the strips
+        /// scrolled into view, or the area of chunks that changed, are drawn each frame. Takes the place of the
+        /// chunk cache while enabled, and falls back the same way if render targets aren't supported.
+        /// </summary>
+        void set_scroll_buffer_enabled(bool enable = true);
+        bool is_scroll_buffer_enabled() const;
+
+        /// <summary>
+        /// When enabled, visible tiles are collected into one vertex/index buffer per texture run and submitted
+        /// with SDL_RenderGeometry, rather than one SDL_RenderCopyF per tile.
+        /// </summary>
+        void set_geometry_batching_enabled(bool enable = true);
+        bool is_geometry_batching_enabled() const;
+
+        /// <summary>
+        /// When enabled, the visible span is split into bands of rows and each band's draw list is generated on a
+        /// worker thread. The bands are then merged in order and submitted on the calling thread, so the result is
+        /// identical to the serial path.
+        /// </summary>
+        void set_parallel_draw_lists_enabled(bool enable = true);
+        bool is_parallel_draw_lists_enabled() const;
+
+        /// <summary>
+        /// When enabled, objects are drawn between tile rows in the order of their row, so tiles in rows in front of
+        /// an object (like tall foliage) cover it. Images taller than a tile are then drawn tile by tile instead of
+        /// being baked into the chunk cache. Objects without a position are still drawn after every tile.
+        /// </summary>
+        void set_depth_sorting_enabled(bool enable = true);
+        bool is_depth_sorting_enabled() const;
+
+        /// <summary>
+        /// When the main camera is zoomed out below the threshold, chunks are drawn from the chunk cache's imposters
+        /// (see chunk_render_cache::render_imposters) instead of tile by tile, so the cost of a frame stays flat as
+        /// the visible area grows. Objects are still drawn, the selection isn't. 0 always draws tiles.
+        /// </summary>
+        void set_lod_zoom_threshold(float zoom);
+        float get_lod_zoom_threshold() const;
+
+        /// <summary>
+        /// When set, update() asks the streamer to load the chunks around the main camera and release the ones far
+        /// from it. Chunks that haven't loaded yet are drawn with the map's placeholder image, if it has one.
+        /// </summary>
+        void set_chunk_streamer(std::shared_ptr<chunk_streamer> streamer);
+        std::shared_ptr<chunk_streamer> get_chunk_streamer() const;
+
+        /// <summary>
+        /// When set, update() refreshes it after the streamer, so chunks that were installed or released this frame
+        /// are navigable or blocked before the queued path requests start
+        /// </summary>
+        void set_path_finder(std::shared_ptr<path_finder> paths);
+        std::shared_ptr<path_finder> get_path_finder() const;
+
+        /// <summary>
+        /// When enabled, update() notices whether anything the frame depends on changed: the camera, the visible
+        /// chunks, the selection, objects being added, moved or removed, or pooled objects being created or
+        /// destroyed. If nothing did, render() copies the last frame instead of drawing it again. Objects that
+        /// animate in place, or pooled objects edited through the object store, must call mark_changed().
+        /// </summary>
+        /// <remarks>
+        /// The cached frame includes the background the renderer was cleared to, so it replaces anything drawn
+        /// under the camera's viewport before the world.
+        /// </remarks>
+        void set_frame_reuse_enabled(bool enable = true);
+        bool is_frame_reuse_enabled() const;
+
+        /// <summary>
+        /// Force the next frame to be drawn rather than reused
+        /// </summary>
+        void mark_changed();
 
+        /// <returns>True if the last render() copied the cached frame of every viewport</returns>
+        bool was_last_frame_reused() const;
+
+        /// <summary>
+        /// Releases cached render target textures, call this when the renderer reports that its targets were lost
+        /// (SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET).
+        /// </summary>
+        void invalidate_render_caches();
+
+        /// <summary>
+        /// Redraw what uses a texture whose pixels changed, such as one updated by a hot reload, and follow it if it
+        /// was replaced. Only the cached chunks and frames are redrawn, their render targets are kept.
+        /// </summary>
+        /// <param name="previous">The texture before, the same as texture if it was updated in place</param>
+        void refresh_texture(SDL_Texture* previous, SDL_Texture* texture);
+
+        /// <summary>
+        /// Show or hide every layer the map marks optional (see tile_map::set_layer_optional), redrawing the caches
+        /// they're baked into. Hiding them is one way to apply application's dynamic quality reducing detail.
+        /// </summary>
+        void set_optional_layers_visible(bool visible = true);
+        bool are_optional_layers_visible() const;
+
+        /// <returns>Counters and timings for the last rendered frame</returns>
+        const render_stats& get_render_stats() const;
+
+        /// <returns>A rolling history of render_stats, one entry per rendered frame</returns>
+        const render_stats_history& get_render_stats_history() const;
+        render_stats_history& get_render_stats_history();
+
+        /// <returns>The tiles overlapping the main camera's viewport, computed once per frame by update()</returns>
+        const tile_span& get_visible_tile_span() const;
+
+        /// <returns>The tiles overlapping a camera's viewport, empty if it isn't one of the enabled cameras</returns>
+        const tile_span& get_visible_tile_span(const camera& camera) const;
+
+        /// <returns>The main camera's transform, or while rendering the transform of the viewport being drawn</returns>
         const isometric::transform& get_transform() const
         {
             return this->transform;
@@ -43,6 +271,20 @@ namespace isometric {
 
         void add_object(std::shared_ptr<game_object> obj);
         void remove_object(std::shared_ptr<game_object> obj);
+
+        /// <returns>Pooled objects stored by value and drawn in one pass per type, after the game objects</returns>
+        object_store& get_object_store();
+        const object_store& get_object_store() const;
+
+        /// <returns>The spatial index of every object in the world, for rectangle and radius queries</returns>
+        const object_grid& get_objects() const;
+
+        /// <summary>
+        /// How far, in tiles, outside of the visible tiles an object's position can be and still be rendered.
+        /// Raise this for objects that draw far from their position.
+        /// </summary>
+        void set_object_cull_margin(float tiles);
+        float get_object_cull_margin() const;
     };
 
 }
\ No newline at end of file
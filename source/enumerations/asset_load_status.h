@@ -0,0 +1,13 @@
+#pragma once
+
+namespace isometric {
+
+    enum class asset_load_status {
+        loading,    // Being read and decoded on a worker thread
+        uploading,  // Decoded, waiting for the render thread to create its texture
+        ready,
+        failed,
+        unloaded    // Was registered, but has since been unregistered
+    };
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace isometric {
+
+    /// <summary>
+    /// The per-frame hooks of a module, as flags
+    /// </summary>
+    enum class module_phase : unsigned {
+        none = 0,
+        update = 1 << 0,        // on_update
+        late_update = 1 << 1,   // on_late_update
+        fixed_update = 1 << 2,  // on_fixed_update
+        all = update | late_update | fixed_update
+    };
+
+    inline module_phase operator|(module_phase a, module_phase b)
+    {
+        return static_cast<module_phase>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+    }
+
+    inline module_phase operator&(module_phase a, module_phase b)
+    {
+        return static_cast<module_phase>(static_cast<unsigned>(a) & static_cast<unsigned>(b));
+    }
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace isometric {
+
+    enum class path_status {
+        queued,     // Waiting for path_finder::update to hand it to a worker
+        searching,
+        found,
+        not_found,  // Start or goal are blocked, or nothing connects them
+        cancelled
+    };
+
+}
@@ -1,5 +1,6 @@
 #include "camera_module.h"
 #include <algorithm>
+#include <cmath>
 
 using namespace isometric;
 using namespace isometric::game;
@@ -27,6 +28,32 @@ void camera_module::on_update(double delta_time)
 
     if (!main_camera) return;
 
+    const SDL_FPoint start_position{ main_camera->get_current_x(), main_camera->get_current_y() };
+
+    // Zoom around the center of the viewport, doubling or halving once a second:
+    const bool zoom_in = input::scancode_down(SDL_SCANCODE_PAGEUP);
+    const bool zoom_out = input::scancode_down(SDL_SCANCODE_PAGEDOWN);
+    if (zoom_in != zoom_out)
+    {
+        const float tile_width = static_cast<float>(map->get_tile_width());
+        const float half_tile_height = map->get_tile_height() / 2.0f;
+        const float old_zoom = main_camera->get_zoom();
+
+        main_camera->set_zoom(old_zoom * static_cast<float>(std::exp2(zoom_in ? delta_time : -delta_time)));
+
+        // The world pixels at the center move by half the change in the view's size:
+        const float new_zoom = main_camera->get_zoom();
+        const float shift_x = main_camera->get_width() / 2.0f * (1.0f / old_zoom - 1.0f / new_zoom);
+        const float shift_y = main_camera->get_height() / 2.0f * (1.0f / old_zoom - 1.0f / new_zoom);
+
+        const SDL_FPoint zoomed_max = world->get_transform().get_max_camera_position();
+        main_camera->set_current_pos(
+            std::min(main_camera->get_current_x() + shift_x / tile_width, zoomed_max.x),
+            std::min(main_camera->get_current_y() + shift_y / half_tile_height, zoomed_max.y));
+    }
+
+    const SDL_FPoint max_position = world->get_transform().get_max_camera_position();
+
     if (input::scancode_down(SDL_SCANCODE_LEFT))
     {
         main_camera->set_current_x(std::max(main_camera->get_current_x() - static_cast<float>(speed * delta_time), 0.0f));
@@ -34,7 +61,7 @@ void camera_module::on_update(double delta_time)
     }
     if (input::scancode_down(SDL_SCANCODE_RIGHT))
     {
-        main_camera->set_current_x(std::min(main_camera->get_current_x() + static_cast<float>(speed * delta_time), static_cast<float>((int)map->get_map_width() - (int)world->get_max_horizontal_tiles() - 1)));
+        main_camera->set_current_x(std::min(main_camera->get_current_x() + static_cast<float>(speed * delta_time), max_position.x));
         //main_camera->set_current_x(main_camera->get_current_x() + (speed * delta_time));
     }
     if (input::scancode_down(SDL_SCANCODE_UP))
@@ -44,17 +71,15 @@ void camera_module::on_update(double delta_time)
     }
     if (input::scancode_down(SDL_SCANCODE_DOWN))
     {
-        main_camera->set_current_y(std::min(main_camera->get_current_y() + static_cast<float>((speed * 2) * delta_time), static_cast<float>((int)map->get_map_height() - (int)world->get_max_vertical_tiles() - 1)));
+        main_camera->set_current_y(std::min(main_camera->get_current_y() + static_cast<float>((speed * 2) * delta_time), max_position.y));
         //main_camera->set_current_y(main_camera->get_current_y() + ((speed * 2) * delta_time));
     }
-}
-
-void camera_module::on_late_update(double delta_time)
-{
-
-}
-
-void camera_module::on_fixed_update(double fixed_delta_time)
-{
 
+    if (delta_time > 0)
+    {
+        main_camera->set_velocity(SDL_FPoint{
+            static_cast<float>((main_camera->get_current_x() - start_position.x) / delta_time),
+            static_cast<float>((main_camera->get_current_y() - start_position.y) / delta_time)
+        });
+    }
 }
\ No newline at end of file
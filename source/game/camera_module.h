@@ -17,8 +17,6 @@ namespace isometric::game {
         void on_unregister() override;
 
         void on_update(double delta_time) override;
-        void on_late_update(double delta_time) override;
-        void on_fixed_update(double fixed_delta_time) override;
     };
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "fps_display_module.h"
 #include <algorithm>
 #include <format>
+#include <iterator>
 
 using namespace isometric;
 using namespace isometric::game;
@@ -8,39 +9,103 @@ using namespace isometric::assets;
 using namespace isometric::tools;
 using namespace isometric::rendering;
 
+namespace {
+
+    constexpr const char* font_name = "fps_font";
+    constexpr const char* font_path = "content/roboto/RobotoMono-Bold.ttf";
+    const std::vector<int> font_point_sizes{ 16, 21, 32 };
+
+}
+
+void fps_display_module::setup(std::shared_ptr<isometric::world> world)
+{
+    this->world = world;
+}
+
+bool fps_display_module::is_showing_render_stats() const
+{
+    return show_render_stats;
+}
+
+void fps_display_module::set_show_render_stats(bool show)
+{
+    show_render_stats = show;
+}
+
+void fps_display_module::add_bundle_assets(asset_bundle_builder& builder)
+{
+    builder.add_font(font_name, font_path, font_point_sizes);
+}
+
 void fps_display_module::on_registered()
 {
     auto asset_mgr = application::get_app()->get_asset_manager();
-    auto fps_font = font::load("fps_font", "content/roboto/RobotoMono-Bold.ttf", std::vector<int>{ 16, 21, 32 });
+
+    // A font mounted from a bundle is used as it is, otherwise it's opened from its file:
+    font* fps_font = dynamic_cast<font*>(asset_mgr->find(font_name));
+    if (!fps_font)
+    {
+        auto loaded = font::load(font_name, font_path, font_point_sizes);
+        fps_font = loaded.get();
+        asset_mgr->register_asset(std::move(loaded));
+    }
 
     //std::vector<char> glyphs = { 'F', 'P', 'S', ':', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', ' ', '\t' };
 
+    // Glyphs are rendered as the HUD first needs them and kept in the glyph cache, so a warm start renders none:
+    bitmap_font_options font_options;
+    font_options.lazy = true;
+    font_options.font_path = fps_font->get_path();
+    font_options.point_size = 16;
+
     bitmap_font = std::make_unique<simple_bitmap_font>(
         application::get_app()->get_renderer(),
         fps_font->get_font(16),
-        0, 255
+        0, 255,
+        font_options
     );
 
-    asset_mgr->register_asset(std::move(fps_font));
+    fps_text = std::make_unique<bitmap_text_run>(*bitmap_font);
+    frame_text = std::make_unique<bitmap_text_run>(*bitmap_font);
+    tiles_text = std::make_unique<bitmap_text_run>(*bitmap_font);
+    cpu_text = std::make_unique<bitmap_text_run>(*bitmap_font);
+    memory_text = std::make_unique<bitmap_text_run>(*bitmap_font);
+
+    // A hot reload of the font renders the glyphs again, the text runs are laid out again with them:
+    reload_listener = asset_mgr->add_reload_listener([this](const asset_reload& reload)
+    {
+        const font* reloaded = reload.name == font_name ? dynamic_cast<const font*>(reload.reloaded) : nullptr;
+        if (!reloaded || !bitmap_font) return;
+
+        bitmap_font->set_font(reloaded->get_font(16));
+        for (bitmap_text_run* run : { fps_text.get(), frame_text.get(), tiles_text.get(), cpu_text.get(), memory_text.get() })
+        {
+            run->refresh();
+        }
+    });
 }
 
 void fps_display_module::on_unregister()
 {
+    fps_text.reset();
+    frame_text.reset();
+    tiles_text.reset();
+    cpu_text.reset();
+    memory_text.reset();
     if (bitmap_font) bitmap_font.reset();
 
     auto app = application::get_app();
     if (app)
     {
         auto asset_mgr = app->get_asset_manager();
-        if (asset_mgr) asset_mgr->unregister_asset("fps_font");
+        if (asset_mgr)
+        {
+            asset_mgr->remove_reload_listener(reload_listener);
+            asset_mgr->unregister_asset(font_name);
+        }
     }
 }
 
-void fps_display_module::on_update(double delta_time)
-{
-
-}
-
 void fps_display_module::on_late_update(double delta_time)
 {
     static double last_delta_time = delta_time;
@@ -53,11 +118,49 @@ void fps_display_module::on_late_update(double delta_time)
     static double elapsed_since_last_update = 0.0;
     elapsed_since_last_update += delta_time;
 
-    if (elapsed_since_last_update >= update_interval)
+    // The text only changes when the displayed values do, so it's formatted and laid out here rather than every
+    // frame:
+    if (elapsed_since_last_update >= update_interval || fps_text->get_text().empty())
     {
         elapsed_since_last_update = 0.0;
         current_framerate = framerate.get();
         last_delta_time = delta_time;
+        if (world) displayed_stats = world->get_render_stats_history().get_average();
+
+        text_buffer.clear();
+        std::format_to(std::back_inserter(text_buffer), "FPS: {:.1f} | DELTA: {:.2f}ms", current_framerate, last_delta_time * 1000.0);
+        fps_text->set_text(text_buffer);
+
+        // Percentiles over the framerate's window of recent frames, jank counts frames over the frame budget:
+        const frame_time_summary frames = framerate.get_window_summary();
+        text_buffer.clear();
+        std::format_to(std::back_inserter(text_buffer), "FRAME: P50 {:.2f} | P95 {:.2f} | P99 {:.2f} | MAX {:.2f}ms | JANK {}",
+            frames.p50_ms, frames.p95_ms, frames.p99_ms, frames.max_ms, frames.jank_frames);
+        frame_text->set_text(text_buffer);
+
+        text_buffer.clear();
+        std::format_to(std::back_inserter(text_buffer), "TILES: {} / {} | DRAWS: {} | SWITCHES: {} | ALPHA: {}",
+            displayed_stats.tiles_drawn, displayed_stats.tiles_iterated, displayed_stats.draw_calls,
+            displayed_stats.texture_switches, displayed_stats.alpha_mod_changes);
+        tiles_text->set_text(text_buffer);
+
+        text_buffer.clear();
+        std::format_to(std::back_inserter(text_buffer), "CPU: UPDATE {:.2f} | CHUNKS {:.2f} | TILES {:.2f} | SUBMIT {:.2f} | OBJECTS {:.2f}ms",
+            displayed_stats.update_ms, displayed_stats.chunk_cache_ms, displayed_stats.tiles_ms,
+            displayed_stats.submit_ms, displayed_stats.objects_ms);
+        cpu_text->set_text(text_buffer);
+
+        // The totals, and the first category over its budget if any is:
+        constexpr double bytes_per_mb = 1024.0 * 1024.0;
+        const auto memory = memory_tracker::get_report();
+        const auto over_budget = std::find_if(memory.begin(), memory.end(), [](const memory_report& entry) { return entry.is_over_budget(); });
+        text_buffer.clear();
+        std::format_to(std::back_inserter(text_buffer), "MEMORY: CPU {:.1f} | GPU {:.1f}MB | TILES {:.1f} | IMAGES {:.1f}MB{}{}",
+            memory_tracker::get_total_cpu_bytes() / bytes_per_mb, memory_tracker::get_total_gpu_bytes() / bytes_per_mb,
+            memory_tracker::tiles().get_cpu_bytes() / bytes_per_mb,
+            (memory_tracker::images().get_cpu_bytes() + memory_tracker::images().get_gpu_bytes()) / bytes_per_mb,
+            over_budget != memory.end() ? " | OVER BUDGET: " : "", over_budget != memory.end() ? over_budget->name : "");
+        memory_text->set_text(text_buffer);
     }
 
     constexpr int margin = 6;
@@ -66,13 +169,28 @@ void fps_display_module::on_late_update(double delta_time)
     viewport.w -= margin * 2;
     viewport.h -= margin * 2;
 
-    // Render using bitmap font:
+    // Render using bitmap font, recorded into the render queue so every line goes out in one batch:
+    auto& queue = graphics->get_render_queue();
     bitmap_font->set_color(0xFFFFFFFF);
-    bitmap_font->draw(
-        std::format("FPS: {:.1f} | DELTA: {:.2f}ms", current_framerate, last_delta_time * 1000.0),
-        viewport,
-        position
-    );
+    queue.text(*bitmap_font, *fps_text, viewport, position);
+
+    const int line_height = fps_text->get_size().y;
+    SDL_Rect stats_viewport = viewport;
+
+    stats_viewport.y += line_height;
+    queue.text(*bitmap_font, *frame_text, stats_viewport, position);
+
+    if (show_render_stats && world)
+    {
+        stats_viewport.y += line_height;
+        queue.text(*bitmap_font, *tiles_text, stats_viewport, position);
+
+        stats_viewport.y += line_height;
+        queue.text(*bitmap_font, *cpu_text, stats_viewport, position);
+
+        stats_viewport.y += line_height;
+        queue.text(*bitmap_font, *memory_text, stats_viewport, position);
+    }
 
     // Render using what graphics uses (SDL_ttf):
     /*
@@ -86,11 +204,6 @@ void fps_display_module::on_late_update(double delta_time)
     */
 }
 
-void fps_display_module::on_fixed_update(double fixed_delta_time)
-{
-
-}
-
 double fps_display_module::get_update_interval() const
 {
     return update_interval;
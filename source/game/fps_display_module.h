@@ -1,6 +1,7 @@
 #pragma once
 #include <isometric.h>
 #include <memory>
+#include <string>
 
 namespace isometric::game {
 
@@ -10,14 +11,36 @@ namespace isometric::game {
         double update_interval = 0.5f;
         content_align position = content_align::top_right;
         std::unique_ptr<isometric::rendering::simple_bitmap_font> bitmap_font;
+        std::unique_ptr<isometric::rendering::bitmap_text_run> fps_text;
+        std::unique_ptr<isometric::rendering::bitmap_text_run> frame_text;
+        std::unique_ptr<isometric::rendering::bitmap_text_run> tiles_text;
+        std::unique_ptr<isometric::rendering::bitmap_text_run> cpu_text;
+        std::unique_ptr<isometric::rendering::bitmap_text_run> memory_text;
+        std::string text_buffer;               // Reused when the text runs are refreshed
+        std::shared_ptr<isometric::world> world = nullptr;
+        bool show_render_stats = true;
+        size_t reload_listener = 0;
+        isometric::render_stats displayed_stats;
+
+    public:
+        /// <summary>
+        /// Optionally give the module a world so its render_stats can be shown under the framerate
+        /// </summary>
+        void setup(std::shared_ptr<isometric::world> world);
+
+        bool is_showing_render_stats() const;
+        void set_show_render_stats(bool show = true);
+
+        /// <summary>
+        /// Add the font the module draws with to a bundle being built
+        /// </summary>
+        static void add_bundle_assets(isometric::assets::asset_bundle_builder& builder);
 
     protected:
         void on_registered() override;
         void on_unregister() override;
 
-        void on_update(double delta_time) override;
         void on_late_update(double delta_time) override;
-        void on_fixed_update(double fixed_delta_time) override;
 
         double get_update_interval() const;
         void set_update_interval(double interval);
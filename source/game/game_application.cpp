@@ -1,8 +1,27 @@
 #include "game_application.h"
+#include <filesystem>
 
 using namespace isometric::game;
 using namespace isometric::assets;
 
+namespace {
+
+    constexpr const char* bundle_path = "content/content.bundle";
+    constexpr const char* grasslands_path = "content/grassland_tiles.png";
+
+}
+
+bool game_application::build_bundle(const std::string& path)
+{
+    asset_bundle_builder builder;
+    if (!builder.add_image("grasslands", grasslands_path)) return false;
+
+    isometric::game::fps_display_module::add_bundle_assets(builder);
+    builder.add_glyph_atlases(application_setup().glyph_cache_directory);
+
+    return builder.write(path);
+}
+
 bool game_application::on_start()
 {
     main_camera = isometric::camera::create(
@@ -26,6 +45,16 @@ bool game_application::on_start()
         map,
         main_camera
         );
+    world->set_chunk_cache_enabled(true);
+    world->set_scroll_buffer_enabled(true);
+    world->set_geometry_batching_enabled(true);
+    world->set_parallel_draw_lists_enabled(true);
+    world->set_depth_sorting_enabled(true);
+
+    get_asset_manager()->add_reload_listener([this](const asset_reload& reload)
+    {
+        if (world && reload.texture) world->refresh_texture(reload.previous_texture, reload.texture);
+    });
 
     this->camera_module = module::create<isometric::game::camera_module>(true);
     this->camera_module->setup(map, world);
@@ -37,6 +66,7 @@ bool game_application::on_start()
     register_module(this->player_module);
 
     this->fps_display_module = module::create<isometric::game::fps_display_module>(true);
+    this->fps_display_module->setup(this->world);
     register_module(this->fps_display_module);
 
     return application::on_start();
@@ -44,10 +74,17 @@ bool game_application::on_start()
 
 bool isometric::game::game_application::load_map()
 {
-    constexpr unsigned tile_width = 64;
-    constexpr unsigned tile_height = 32;
+    // The standard size takes transform's constant geometry path:
+    constexpr unsigned tile_width = standard_iso_geometry::width;
+    constexpr unsigned tile_height = standard_iso_geometry::height;
+
+    // A bundle built with --build-bundle is uploaded without decoding anything, the loose files are the fallback:
+    if (std::filesystem::exists(bundle_path)) get_asset_manager()->mount_bundle(bundle_path);
 
-    grasslands_image = image::load("grasslands", "content/grassland_tiles.png");
+    // Registered so it's hot reloaded, the tile images below follow its texture through world::refresh_texture:
+    if (!get_asset_manager()->find("grasslands")) get_asset_manager()->register_asset(image::load("grasslands", grasslands_path));
+    grasslands_image = get_asset_manager()->get_handle<image>("grasslands");
+    if (!grasslands_image.get()) return false;
 
     map = isometric::tile_map::create(
         1024,           // entire map width in tiles
@@ -66,7 +103,7 @@ bool isometric::game::game_application::load_map()
     );
     map->set_selection_image(0);
 
-    map->add_layer("grass");
+    unsigned grass_layer_id = map->add_layer("grass");
     unsigned grass_source_x = 0;
     for (unsigned i = 1, grass_source_x = 0; i < 16; i++, grass_source_x += 64)
     {
@@ -82,7 +119,9 @@ bool isometric::game::game_application::load_map()
         map->add_layer_default_image("grass", i);
     }
 
+    // Foliage is the first thing left out when dynamic quality reduces detail:
     unsigned foliage_layer_id = map->add_layer("foliage");
+    map->set_layer_optional(foliage_layer_id);
     auto bush1_tile_image = isometric::tile_image::create(
         "bush1", 99,
         grasslands_image->get_texture(),
@@ -92,8 +131,35 @@ bool isometric::game::game_application::load_map()
 
     map->add_image(bush1_tile_image);
 
-    map->set_tile(0, 0, isometric::tile())->set_image_id(foliage_layer_id, 99);
-    map->set_tile(9, 9, isometric::tile())->set_image_id(foliage_layer_id, 99);
+    // Generate the whole map up front, the same seed always produces the same map:
+    constexpr uint64_t map_seed = 0x15014E7;
+    auto terrain = isometric::terrain_generator::create(map_seed);
+
+    std::vector<unsigned> lush_grass;
+    std::vector<unsigned> dry_grass;
+    for (unsigned i = 1; i < 16; i++) (i < 8 ? lush_grass : dry_grass).push_back(i);
+
+    isometric::terrain_biome thicket;
+    thicket.name = "thicket";
+    thicket.min_elevation = 0.4f;
+    thicket.layers.push_back({ grass_layer_id, lush_grass });
+    thicket.layers.push_back({ foliage_layer_id, { 99 }, 0.6f, true });
+    terrain->add_biome(thicket);
+
+    isometric::terrain_biome meadow;
+    meadow.name = "meadow";
+    meadow.min_moisture = 0.0f;
+    meadow.layers.push_back({ grass_layer_id, lush_grass });
+    meadow.layers.push_back({ foliage_layer_id, { 99 }, 0.03f, true });
+    terrain->add_biome(meadow);
+
+    isometric::terrain_biome grassland;
+    grassland.name = "grassland";
+    grassland.layers.push_back({ grass_layer_id, dry_grass });
+    grassland.layers.push_back({ foliage_layer_id, { 99 }, 0.01f, true });
+    terrain->add_biome(grassland);
+
+    terrain->generate(*map);
 
     return true;
 }
@@ -102,8 +168,10 @@ void isometric::game::game_application::on_update(double delta_time)
 {
     auto renderer = application::get_app()->get_graphics()->get_renderer();
 
+    world->set_optional_layers_visible(!get_quality().is_detail_reduced());
     world->update(delta_time);
     world->render(renderer, delta_time);
+    if (!world->was_last_frame_reused()) request_redraw();
 
     return application::on_update(delta_time);
 }
@@ -112,3 +180,16 @@ void isometric::game::game_application::on_fixed_update(double fixed_delta_time)
 {
 
 }
+
+bool isometric::game::game_application::on_event(const SDL_Event& e)
+{
+    switch (e.type)
+    {
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+        if (world) world->invalidate_render_caches();
+        break;
+    }
+
+    return application::on_event(e);
+}
@@ -9,8 +9,7 @@ namespace isometric::game {
     class game_application : public isometric::application
     {
     private:
-        // TODO: Convert this to unique_ptr and move to asset management
-        std::shared_ptr<isometric::assets::image> grasslands_image = nullptr;
+        isometric::assets::asset_handle<isometric::assets::image> grasslands_image;
         std::shared_ptr<camera> main_camera = nullptr;
         std::shared_ptr<tile_map> map = nullptr;
         std::shared_ptr<world> world = nullptr;
@@ -21,10 +20,18 @@ namespace isometric::game {
 
         bool load_map();
 
+    public:
+        /// <summary>
+        /// Pack the images and fonts the game loads, with the glyph atlases saved by previous runs, into a bundle
+        /// that on_start mounts instead of reading the loose files
+        /// </summary>
+        static bool build_bundle(const std::string& path);
+
     protected:
         bool on_start() override;
         void on_update(double delta_time) override;
         void on_fixed_update(double fixed_delta_time) override;
+        bool on_event(const SDL_Event& e) override;
     };
 
 }
\ No newline at end of file
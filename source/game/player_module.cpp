@@ -34,19 +34,22 @@ void player_module::on_update(double delta_time)
 {
     constexpr double speed = 50.0; // Pixels per second of movement
 
-    if (input::keycode_down(SDLK_a))
+    // By scancode, so the keys keep their position on other keyboard layouts:
+    const input_snapshot& keys = input::get_snapshot();
+
+    if (keys.scancode_down(SDL_SCANCODE_A))
     {
         location.x -= static_cast<float>(speed * delta_time);
     }
-    if (input::keycode_down(SDLK_d))
+    if (keys.scancode_down(SDL_SCANCODE_D))
     {
         location.x += static_cast<float>(speed * delta_time);
     }
-    if (input::keycode_down(SDLK_w))
+    if (keys.scancode_down(SDL_SCANCODE_W))
     {
         location.y -= static_cast<float>(speed * delta_time);
     }
-    if (input::keycode_down(SDLK_s))
+    if (keys.scancode_down(SDL_SCANCODE_S))
     {
         location.y += static_cast<float>(speed * delta_time);
     }
@@ -73,14 +76,10 @@ void player_module::on_late_update(double delta_time)
     SDL_FRect player_rect{
         player_in_viewport.x,
         player_in_viewport.y,
-        player_size, player_size
+        player_size * transform.get_zoom(), player_size * transform.get_zoom()
     };
 
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRectF(renderer, &player_rect);
-}
-
-void player_module::on_fixed_update(double fixed_delta_time)
-{
-
+    // Recorded rather than drawn, so it's submitted with the rest of the frame's overlays:
+    graphics->get_render_queue().fill(player_rect, SDL_Color{ 255, 255, 255, 255 }, rendering::render_queue::overlay_layer,
+        rendering::render_queue::to_depth(player_in_world.y));
 }
\ No newline at end of file
@@ -16,7 +16,6 @@ namespace isometric::game {
 
         void on_update(double delta_time) override;
         void on_late_update(double delta_time) override;
-        void on_fixed_update(double fixed_delta_time) override;
 
     public:
         void setup(std::shared_ptr<tile_map> map, std::shared_ptr<isometric::world> world);
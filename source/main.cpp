@@ -1,4 +1,6 @@
 #include <memory>
+#include <string>
+#include <cstdlib>
 #include "./game/game_application.h"
 
 using namespace isometric;
@@ -15,6 +17,35 @@ int main(int argc, char* argv[])
         setup.verbose_logging = true;
         setup.vertical_sync = false;
         setup.broadcast_fps = true;
+#ifdef _DEBUG
+        setup.hot_reload_assets = true;
+#endif
+
+        // Automated performance runs, for example: --headless --frames 2000 --frame-times frame_times.csv
+        // or a recorded session, played back the same way on every build: --headless --replay session.irec
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--headless") setup.headless = true;
+            else if (arg == "--frames" && has_value) setup.exit_after_frames = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--seconds" && has_value) setup.exit_after_seconds = std::strtod(argv[++i], nullptr);
+            else if (arg == "--frame-times" && has_value) setup.frame_times_path = argv[++i];
+            else if (arg == "--trace" && has_value) setup.profile_trace_path = argv[++i];
+            else if (arg == "--hot-reload") setup.hot_reload_assets = true;
+            else if (arg == "--fps" && has_value) setup.target_frame_rate = std::strtod(argv[++i], nullptr);
+            else if (arg == "--dynamic-quality") setup.dynamic_quality = true;
+            else if (arg == "--record" && has_value) setup.record_input_path = argv[++i];
+            else if (arg == "--replay" && has_value) setup.replay_input_path = argv[++i];
+            else if (arg == "--seed" && has_value) setup.random_seed = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--build-bundle" && has_value)
+            {
+                // Offline: pack the content into a bundle for faster startups, then exit without running
+                return game_application::build_bundle(argv[++i]) ? 0 : -1;
+            }
+            else SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Ignoring unknown argument [%s]", arg.c_str());
+        }
 
         auto app = application::create<game_application>(setup);
 
@@ -0,0 +1,579 @@
+#include "chunk_render_cache.h"
+#include "../tools/memory_tracker.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+using namespace isometric;
+using namespace isometric::rendering;
+
+namespace {
+
+    SDL_Texture* create_target(SDL_Renderer* renderer, int width, int height)
+    {
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        tools::memory_tracker::render_targets().add_texture(texture);
+        return texture;
+    }
+
+    void destroy_target(SDL_Texture* texture)
+    {
+        if (!texture) return;
+
+        tools::memory_tracker::render_targets().remove_texture(texture);
+        SDL_DestroyTexture(texture);
+    }
+
+}
+
+chunk_render_cache::chunk_render_cache(SDL_Renderer* renderer, std::shared_ptr<tile_map> map)
+    : renderer(renderer), map(map)
+{
+    SDL_RendererInfo info{};
+    if (!renderer || !map || SDL_GetRendererInfo(renderer, &info) < 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Chunk render cache disabled, unable to query the renderer: %s", SDL_GetError());
+        return;
+    }
+
+    update_geometry();
+
+    supported = (info.flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+    if (!supported)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Chunk render cache disabled, renderer [%s] doesn't support render targets", info.name);
+    }
+    else if (
+        (info.max_texture_width > 0 && texture_width > info.max_texture_width) ||
+        (info.max_texture_height > 0 && texture_height > info.max_texture_height))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Chunk render cache disabled, chunk textures (%d x %d) exceed the renderer's maximum texture size (%d x %d)",
+            texture_width, texture_height, info.max_texture_width, info.max_texture_height);
+        supported = false;
+    }
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Chunk render cache constructed, [ %d x %d ] chunk textures", texture_width, texture_height);
+}
+
+chunk_render_cache::~chunk_render_cache()
+{
+    clear();
+}
+
+bool chunk_render_cache::is_supported() const
+{
+    return supported;
+}
+
+void chunk_render_cache::update_geometry()
+{
+    const int tile_width = static_cast<int>(map->get_tile_width());
+    const int tile_height = static_cast<int>(map->get_tile_height());
+    const int overdraw_right = std::max(0, static_cast<int>(map->get_max_image_width()) - tile_width);
+
+    overdraw_top = static_cast<unsigned>(std::max(0, static_cast<int>(map->get_max_image_height()) - tile_height));
+
+    // Odd rows are shifted half a tile to the right and every row overlaps the previous one by half a tile:
+    texture_width = tile_chunk::size * tile_width + tile_width / 2 + overdraw_right;
+    texture_height = tile_chunk::size * (tile_height / 2) + tile_height / 2 + static_cast<int>(overdraw_top);
+}
+
+SDL_Point chunk_render_cache::get_texture_size() const
+{
+    return SDL_Point{ texture_width, texture_height };
+}
+
+SDL_FPoint chunk_render_cache::get_chunk_origin(unsigned chunk_x, unsigned chunk_y) const
+{
+    const float tile_width = static_cast<float>(map->get_tile_width());
+    const float half_tile_height = map->get_tile_height() / 2.0f;
+
+    return SDL_FPoint{
+        chunk_x * tile_chunk::size * tile_width - tile_width / 2.0f,
+        chunk_y * tile_chunk::size * half_tile_height - half_tile_height - overdraw_top
+    };
+}
+
+size_t chunk_render_cache::render(const SDL_FPoint& view_origin, const SDL_Rect& viewport, float zoom)
+{
+    if (!supported) return 0;
+
+    current_frame++;
+    bake_count = 0;
+
+    // Images may have been added to the map since the textures were created:
+    const int old_width = texture_width, old_height = texture_height;
+    update_geometry();
+    if (old_width != texture_width || old_height != texture_height) clear();
+
+    const float chunk_pixel_width = static_cast<float>(tile_chunk::size * map->get_tile_width());
+    const float chunk_pixel_height = tile_chunk::size * (map->get_tile_height() / 2.0f);
+    const float half_tile_width = map->get_tile_width() / 2.0f;
+    const float half_tile_height = map->get_tile_height() / 2.0f;
+    const float view_width = viewport.w / zoom;
+    const float view_height = viewport.h / zoom;
+
+    const long long first_x = std::max(0LL, static_cast<long long>(std::floor((view_origin.x + half_tile_width - texture_width) / chunk_pixel_width)));
+    const long long last_x = std::min(map->get_chunks_wide() - 1LL, static_cast<long long>(std::floor((view_origin.x + view_width + half_tile_width) / chunk_pixel_width)));
+    const long long first_y = std::max(0LL, static_cast<long long>(std::floor((view_origin.y + half_tile_height + overdraw_top - texture_height) / chunk_pixel_height)));
+    const long long last_y = std::min(map->get_chunks_high() - 1LL, static_cast<long long>(std::floor((view_origin.y + view_height + half_tile_height + overdraw_top) / chunk_pixel_height)));
+
+    size_t drawn = 0;
+
+    for (long long chunk_y = first_y; chunk_y <= last_y; chunk_y++)
+    {
+        for (long long chunk_x = first_x; chunk_x <= last_x; chunk_x++)
+        {
+            // Unallocated chunks have nothing to draw, finding rather than getting them keeps render read-only:
+            tile_chunk* chunk = map->find_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+            if (!chunk) continue;
+
+            size_t chunk_index = static_cast<size_t>(chunk_x + chunk_y * map->get_chunks_wide());
+            cache_entry& entry = entries[chunk_index];
+            entry.last_used_frame = current_frame;
+
+            if (!entry.baked || entry.baked_revision != chunk->get_planes().revision || entry.baked_instance != chunk->get_instance_id())
+            {
+                if (!bake(*chunk, entry)) continue;
+            }
+
+            SDL_FPoint origin = get_chunk_origin(chunk->get_chunk_x(), chunk->get_chunk_y());
+            SDL_FRect dest{
+                (origin.x - view_origin.x) * zoom + viewport.x,
+                (origin.y - view_origin.y) * zoom + viewport.y,
+                texture_width * zoom,
+                texture_height * zoom
+            };
+
+            SDL_RenderCopyF(renderer, entry.texture, nullptr, &dest);
+            drawn++;
+        }
+    }
+
+    evict();
+
+    return drawn;
+}
+
+bool chunk_render_cache::bake(tile_chunk& chunk, cache_entry& entry)
+{
+    if (!entry.texture)
+    {
+        entry.texture = create_target(renderer, texture_width, texture_height);
+        if (!entry.texture)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create chunk texture for chunk [ %u, %u ]: %s",
+                chunk.get_chunk_x(), chunk.get_chunk_y(), SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(entry.texture, SDL_BLENDMODE_BLEND);
+    }
+
+    // Remember the renderer state that baking will change:
+    SDL_Texture* previous_target = SDL_GetRenderTarget(renderer);
+    SDL_FPoint previous_scale{ 1.0f, 1.0f };
+    SDL_RenderGetScale(renderer, &previous_scale.x, &previous_scale.y);
+    SDL_Rect previous_clip{};
+    SDL_RenderGetClipRect(renderer, &previous_clip);
+    SDL_Color previous_color{};
+    SDL_GetRenderDrawColor(renderer, &previous_color.r, &previous_color.g, &previous_color.b, &previous_color.a);
+
+    SDL_SetRenderTarget(renderer, entry.texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    add_chunk_tiles(chunk, 1.0f, false);
+    bake_batch.flush(renderer);
+
+    // Setting a texture target resets the scale, graphics' scaled frame needs it back before the clip rectangle:
+    SDL_SetRenderTarget(renderer, previous_target);
+    SDL_RenderSetScale(renderer, previous_scale.x, previous_scale.y);
+    SDL_RenderSetClipRect(renderer, previous_clip.w > 0 && previous_clip.h > 0 ? &previous_clip : nullptr);
+    SDL_SetRenderDrawColor(renderer, previous_color.r, previous_color.g, previous_color.b, previous_color.a);
+
+    entry.baked = true;
+    entry.baked_revision = chunk.get_planes().revision;
+    entry.baked_instance = chunk.get_instance_id();
+    bake_count++;
+
+    return true;
+}
+
+void chunk_render_cache::add_chunk_tiles(tile_chunk& chunk, float scale, bool every_layer)
+{
+    const SDL_FPoint origin = get_chunk_origin(chunk.get_chunk_x(), chunk.get_chunk_y());
+    const unsigned tile_width = map->get_tile_width();
+    const unsigned tile_height = map->get_tile_height();
+    const unsigned layer_count = static_cast<unsigned>(map->get_layers().size());
+
+    for (unsigned local_y = 0; local_y < tile_chunk::size; local_y++)
+    {
+        const unsigned tile_y = chunk.get_tile_y() + local_y;
+        if (tile_y >= map->get_map_height()) break;
+
+        for (unsigned local_x = 0; local_x < tile_chunk::size; local_x++)
+        {
+            const unsigned tile_x = chunk.get_tile_x() + local_x;
+            if (tile_x >= map->get_map_width()) break;
+
+            tile current_tile = chunk.get_tile(local_x, local_y);
+
+            // Same placement as transform::world_tile_to_world_pixels, relative to the chunk's texture:
+            const float x = (tile_x * static_cast<float>(tile_width) - (tile_y % 2 == 0 ? tile_width / 2.0f : 0.0f) - origin.x) * scale;
+            const float y = (tile_y * (tile_height / 2.0f) - tile_height / 2.0f - origin.y) * scale;
+
+            for (unsigned layer_id = 0; layer_id < layer_count; layer_id++)
+            {
+                if (!map->is_layer_visible(layer_id) || !current_tile.has_image(layer_id)) continue;
+
+                // World draws an animated tile from that layer up every frame, imposters keep a still of it:
+                const unsigned image_id = current_tile.get_image_id(layer_id);
+                if (!every_layer && map->is_image_animated(image_id)) break;
+                if (!every_layer && !map->is_layer_static(layer_id)) continue;
+
+                const tile_image* image = map->get_image(image_id);
+                if (!image || !image->has_texture()) continue;
+                if (!every_layer && !bake_tall_images && image->get_source_h() > tile_height) continue;
+
+                bake_batch.add(image->get_texture(), image->get_source_rect(), image->get_dest_rect(x, y, scale));
+            }
+        }
+    }
+}
+
+unsigned chunk_render_cache::get_lod_level(float zoom)
+{
+    if (zoom <= 0.0f) return max_lod_level;
+
+    const int level = static_cast<int>(std::floor(std::log2(1.0f / zoom)));
+    return static_cast<unsigned>(std::clamp(level, 1, static_cast<int>(max_lod_level)));
+}
+
+SDL_Point chunk_render_cache::get_level_size(unsigned level) const
+{
+    SDL_Point size{ texture_width, texture_height };
+    for (unsigned i = 0; i < level; i++)
+    {
+        size.x = (size.x + 1) / 2;
+        size.y = (size.y + 1) / 2;
+    }
+
+    return size;
+}
+
+SDL_Texture* chunk_render_cache::get_scratch_level(unsigned level)
+{
+    if (scratch_levels.size() < level) scratch_levels.resize(level, nullptr);
+
+    SDL_Texture*& texture = scratch_levels[level - 1];
+    if (!texture)
+    {
+        const SDL_Point size = get_level_size(level);
+        texture = create_target(renderer, size.x, size.y);
+        if (!texture)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the level %u imposter scratch texture: %s", level, SDL_GetError());
+            return nullptr;
+        }
+
+        // Copied over the next level as is, alpha included:
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+        SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+#endif
+    }
+
+    return texture;
+}
+
+size_t chunk_render_cache::render_imposters(const SDL_FPoint& view_origin, const SDL_Rect& viewport, float zoom)
+{
+    if (!supported || zoom <= 0.0f) return 0;
+
+    current_frame++;
+    bake_count = 0;
+    imposter_bake_count = 0;
+
+    const int old_width = texture_width, old_height = texture_height;
+    update_geometry();
+    if (old_width != texture_width || old_height != texture_height) clear();
+
+    const unsigned level = get_lod_level(zoom);
+
+    const float chunk_pixel_width = static_cast<float>(tile_chunk::size * map->get_tile_width());
+    const float chunk_pixel_height = tile_chunk::size * (map->get_tile_height() / 2.0f);
+    const float half_tile_width = map->get_tile_width() / 2.0f;
+    const float half_tile_height = map->get_tile_height() / 2.0f;
+    const float view_width = viewport.w / zoom;
+    const float view_height = viewport.h / zoom;
+
+    const long long first_x = std::max(0LL, static_cast<long long>(std::floor((view_origin.x + half_tile_width - texture_width) / chunk_pixel_width)));
+    const long long last_x = std::min(map->get_chunks_wide() - 1LL, static_cast<long long>(std::floor((view_origin.x + view_width + half_tile_width) / chunk_pixel_width)));
+    const long long first_y = std::max(0LL, static_cast<long long>(std::floor((view_origin.y + half_tile_height + overdraw_top - texture_height) / chunk_pixel_height)));
+    const long long last_y = std::min(map->get_chunks_high() - 1LL, static_cast<long long>(std::floor((view_origin.y + view_height + half_tile_height + overdraw_top) / chunk_pixel_height)));
+
+    size_t drawn = 0;
+
+    for (long long chunk_y = first_y; chunk_y <= last_y; chunk_y++)
+    {
+        for (long long chunk_x = first_x; chunk_x <= last_x; chunk_x++)
+        {
+            tile_chunk* chunk = map->find_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+            if (!chunk) continue;
+
+            size_t chunk_index = static_cast<size_t>(chunk_x + chunk_y * map->get_chunks_wide());
+            imposter_entry& entry = imposters[chunk_index];
+            entry.last_used_frame = current_frame;
+
+            const bool stale = !entry.baked || entry.level != level ||
+                entry.baked_revision != chunk->get_planes().revision || entry.baked_instance != chunk->get_instance_id();
+
+            if (stale && imposter_bake_count < max_imposter_bakes) bake_imposter(*chunk, entry, level);
+            if (!entry.texture) continue;
+
+            // A level covers 2^level world pixels per texel, whichever level the imposter currently is:
+            const float texel_scale = static_cast<float>(1u << entry.level) * zoom;
+            const SDL_FPoint origin = get_chunk_origin(chunk->get_chunk_x(), chunk->get_chunk_y());
+            SDL_FRect dest{
+                (origin.x - view_origin.x) * zoom + viewport.x,
+                (origin.y - view_origin.y) * zoom + viewport.y,
+                entry.size.x * texel_scale,
+                entry.size.y * texel_scale
+            };
+
+            SDL_RenderCopyF(renderer, entry.texture, nullptr, &dest);
+            drawn++;
+        }
+    }
+
+    evict();
+    evict_imposters();
+
+    return drawn;
+}
+
+bool chunk_render_cache::bake_imposter(tile_chunk& chunk, imposter_entry& entry, unsigned level)
+{
+    const SDL_Point size = get_level_size(level);
+
+    if (entry.texture && entry.level != level)
+    {
+        destroy_target(entry.texture);
+        entry.texture = nullptr;
+    }
+
+    if (!entry.texture)
+    {
+        entry.texture = create_target(renderer, size.x, size.y);
+        if (!entry.texture)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the level %u imposter for chunk [ %u, %u ]: %s",
+                level, chunk.get_chunk_x(), chunk.get_chunk_y(), SDL_GetError());
+            entry.baked = false;
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(entry.texture, SDL_BLENDMODE_BLEND);
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+        SDL_SetTextureScaleMode(entry.texture, SDL_ScaleModeLinear);
+#endif
+        entry.level = level;
+        entry.size = size;
+    }
+
+    // Every level below the requested one goes through a shared scratch texture:
+    for (unsigned current = 1; current < level; current++)
+    {
+        if (!get_scratch_level(current)) return false;
+    }
+
+    SDL_Texture* previous_target = SDL_GetRenderTarget(renderer);
+    SDL_FPoint previous_scale{ 1.0f, 1.0f };
+    SDL_RenderGetScale(renderer, &previous_scale.x, &previous_scale.y);
+    SDL_Rect previous_clip{};
+    SDL_RenderGetClipRect(renderer, &previous_clip);
+    SDL_Color previous_color{};
+    SDL_GetRenderDrawColor(renderer, &previous_color.r, &previous_color.g, &previous_color.b, &previous_color.a);
+
+    // Level 1 is drawn from the tiles, at half size:
+    SDL_SetRenderTarget(renderer, level == 1 ? entry.texture : scratch_levels[0]);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    add_chunk_tiles(chunk, 0.5f, true);
+    bake_batch.flush(renderer);
+
+    // Every further level is the previous one at half size:
+    for (unsigned current = 2; current <= level; current++)
+    {
+        const SDL_Point previous_size = get_level_size(current - 1);
+        const SDL_FRect dest{ 0.0f, 0.0f, previous_size.x / 2.0f, previous_size.y / 2.0f };
+
+        SDL_SetRenderTarget(renderer, current == level ? entry.texture : scratch_levels[current - 1]);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopyF(renderer, scratch_levels[current - 2], nullptr, &dest);
+    }
+
+    // Setting a texture target resets the scale, graphics' scaled frame needs it back before the clip rectangle:
+    SDL_SetRenderTarget(renderer, previous_target);
+    SDL_RenderSetScale(renderer, previous_scale.x, previous_scale.y);
+    SDL_RenderSetClipRect(renderer, previous_clip.w > 0 && previous_clip.h > 0 ? &previous_clip : nullptr);
+    SDL_SetRenderDrawColor(renderer, previous_color.r, previous_color.g, previous_color.b, previous_color.a);
+
+    entry.baked = true;
+    entry.baked_revision = chunk.get_planes().revision;
+    entry.baked_instance = chunk.get_instance_id();
+    imposter_bake_count++;
+
+    return true;
+}
+
+void chunk_render_cache::evict_imposters()
+{
+    if (imposters.size() <= max_imposters) return;
+
+    std::vector<std::pair<unsigned long long, size_t>> candidates; // last used frame, chunk index
+    for (const auto& [chunk_index, entry] : imposters)
+    {
+        if (entry.last_used_frame != current_frame) candidates.emplace_back(entry.last_used_frame, chunk_index);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates)
+    {
+        if (imposters.size() <= max_imposters) break;
+
+        auto& entry = imposters[candidate.second];
+        destroy_target(entry.texture);
+        imposters.erase(candidate.second);
+    }
+}
+
+void chunk_render_cache::evict()
+{
+    if (entries.size() <= max_textures) return;
+
+    std::vector<std::pair<unsigned long long, size_t>> candidates; // last used frame, chunk index
+    for (const auto& [chunk_index, entry] : entries)
+    {
+        if (entry.last_used_frame != current_frame) candidates.emplace_back(entry.last_used_frame, chunk_index);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates)
+    {
+        if (entries.size() <= max_textures) break;
+
+        auto& entry = entries[candidate.second];
+        destroy_target(entry.texture);
+        entries.erase(candidate.second);
+    }
+}
+
+void chunk_render_cache::invalidate(unsigned chunk_x, unsigned chunk_y)
+{
+    const size_t chunk_index = chunk_x + static_cast<size_t>(chunk_y) * map->get_chunks_wide();
+
+    auto iter = entries.find(chunk_index);
+    if (iter != entries.end()) iter->second.baked = false;
+
+    auto imposter = imposters.find(chunk_index);
+    if (imposter != imposters.end()) imposter->second.baked = false;
+}
+
+void chunk_render_cache::invalidate_all()
+{
+    for (auto& pair : entries)
+    {
+        pair.second.baked = false;
+    }
+
+    for (auto& pair : imposters)
+    {
+        pair.second.baked = false;
+    }
+}
+
+void chunk_render_cache::clear()
+{
+    for (auto& pair : entries)
+    {
+        destroy_target(pair.second.texture);
+    }
+
+    entries.clear();
+
+    for (auto& pair : imposters)
+    {
+        destroy_target(pair.second.texture);
+    }
+
+    imposters.clear();
+
+    for (SDL_Texture* texture : scratch_levels)
+    {
+        destroy_target(texture);
+    }
+
+    scratch_levels.clear();
+}
+
+void chunk_render_cache::set_max_textures(size_t count)
+{
+    max_textures = std::max<size_t>(count, 1);
+}
+
+size_t chunk_render_cache::get_max_textures() const
+{
+    return max_textures;
+}
+
+void chunk_render_cache::set_bake_tall_images(bool bake)
+{
+    if (bake_tall_images == bake) return;
+
+    // Imposters always have every image, only the full size textures need re-baking:
+    bake_tall_images = bake;
+    for (auto& pair : entries)
+    {
+        pair.second.baked = false;
+    }
+}
+
+bool chunk_render_cache::is_baking_tall_images() const
+{
+    return bake_tall_images;
+}
+
+size_t chunk_render_cache::get_bake_count() const
+{
+    return bake_count;
+}
+
+size_t chunk_render_cache::get_imposter_bake_count() const
+{
+    return imposter_bake_count;
+}
+
+void chunk_render_cache::set_max_imposters(size_t count)
+{
+    max_imposters = std::max<size_t>(count, 1);
+}
+
+size_t chunk_render_cache::get_max_imposters() const
+{
+    return max_imposters;
+}
+
+void chunk_render_cache::set_max_imposter_bakes_per_frame(size_t count)
+{
+    max_imposter_bakes = std::max<size_t>(count, 1);
+}
+
+size_t chunk_render_cache::get_max_imposter_bakes_per_frame() const
+{
+    return max_imposter_bakes;
+}
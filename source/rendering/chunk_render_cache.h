@@ -0,0 +1,163 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "../core/tile_map.h"
+#include "sprite_batch.h"
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Bakes the static layers of each tile_chunk into its own render target texture so a frame only needs to copy
+    /// a handful of chunk textures instead of every tile. A chunk is re-baked when the revision of its planes
+    /// changes, which happens whenever one of its tiles is set or has an image changed.
+    /// </summary>
+    /// <remarks>
+    /// For views zoomed far out the cache also keeps imposters: a chunk's every layer drawn at half size and then
+    /// halved again per level, like a mip chain. One imposter of the level the view needs is kept per chunk, so
+    /// drawing a zoomed out view costs one small copy per chunk however many tiles it covers.
+    /// </remarks>
+    class chunk_render_cache
+    {
+    private:
+        struct cache_entry
+        {
+            SDL_Texture* texture = nullptr;
+            uint32_t baked_revision = 0;
+            uint64_t baked_instance = 0;
+            bool baked = false;
+            unsigned long long last_used_frame = 0;
+        };
+
+        struct imposter_entry
+        {
+            SDL_Texture* texture = nullptr;
+            unsigned level = 0;         // 1 is half size, every level halves again
+            SDL_Point size{ 0, 0 };
+            uint32_t baked_revision = 0;
+            uint64_t baked_instance = 0;
+            bool baked = false;
+            unsigned long long last_used_frame = 0;
+        };
+
+        SDL_Renderer* renderer = nullptr;
+        std::shared_ptr<tile_map> map = nullptr;
+        std::unordered_map<size_t, cache_entry> entries; // by chunk index, chunk_x + chunk_y * chunks_wide
+
+        bool supported = false;
+        size_t max_textures = 64;
+        unsigned long long current_frame = 0;
+        size_t bake_count = 0;
+        bool bake_tall_images = true;
+        sprite_batch bake_batch;
+
+        std::unordered_map<size_t, imposter_entry> imposters;   // by chunk index, like entries
+        std::vector<SDL_Texture*> scratch_levels;               // Intermediate levels, by level - 1
+        size_t max_imposters = 1024;
+        size_t max_imposter_bakes = 16;
+        size_t imposter_bake_count = 0;
+
+        // Chunk texture geometry, in pixels:
+        int texture_width = 0;
+        int texture_height = 0;
+        unsigned overdraw_top = 0;  // Space above the first row for images taller than a tile
+
+    public:
+        static constexpr unsigned max_lod_level = 6;
+
+        chunk_render_cache(SDL_Renderer* renderer, std::shared_ptr<tile_map> map);
+        ~chunk_render_cache();
+
+        chunk_render_cache(const chunk_render_cache&) = delete;
+        chunk_render_cache& operator=(const chunk_render_cache&) = delete;
+
+        /// <returns>False if the renderer can't render to textures or the chunk textures are too large for it</returns>
+        bool is_supported() const;
+
+        /// <summary>
+        /// Draws the cached static layers of every chunk overlapping the view, baking chunks that are missing or
+        /// out of date first.
+        /// </summary>
+        /// <param name="view_origin">The world pixel position drawn at the top left of the viewport</param>
+        /// <param name="viewport">The viewport rectangle in screen pixels</param>
+        /// <param name="zoom">Screen pixels per world pixel, the chunk textures are scaled by it</param>
+        /// <returns>The number of chunk textures drawn</returns>
+        size_t render(const SDL_FPoint& view_origin, const SDL_Rect& viewport, float zoom = 1.0f);
+
+        /// <summary>
+        /// Draws every layer of every chunk overlapping the view from imposters of the level suited to the zoom,
+        /// see get_lod_level. At most get_max_imposter_bakes_per_frame imposters are baked per call, chunks still
+        /// waiting are drawn from an imposter of another level if they have one and left out if they don't.
+        /// </summary>
+        /// <returns>The number of imposters drawn</returns>
+        size_t render_imposters(const SDL_FPoint& view_origin, const SDL_Rect& viewport, float zoom);
+
+        /// <returns>The imposter level drawn at a zoom, between 1 and max_lod_level</returns>
+        static unsigned get_lod_level(float zoom);
+
+        /// <summary>
+        /// Force a chunk to be re-baked the next time it is drawn
+        /// </summary>
+        void invalidate(unsigned chunk_x, unsigned chunk_y);
+        void invalidate_all();
+
+        /// <summary>
+        /// Forget the texture sizes cached for drawing, required if a texture is destroyed and its address could be reused
+        /// </summary>
+        void forget_textures() { bake_batch.forget_textures(); }
+
+        /// <summary>
+        /// Release every cached texture
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// The maximum number of chunk textures kept alive, least recently drawn chunks are released first
+        /// </summary>
+        void set_max_textures(size_t count);
+        size_t get_max_textures() const;
+
+        /// <summary>
+        /// When disabled, images taller than a tile are left out of the baked chunks so they can be drawn tile by
+        /// tile in depth order with objects. Changing this re-bakes every chunk.
+        /// </summary>
+        void set_bake_tall_images(bool bake);
+        bool is_baking_tall_images() const;
+
+        /// <returns>How many chunks were baked during the last call to render()</returns>
+        size_t get_bake_count() const;
+
+        /// <returns>How many imposters were baked during the last call to render_imposters()</returns>
+        size_t get_imposter_bake_count() const;
+
+        /// <summary>
+        /// The maximum number of imposters kept alive, least recently drawn chunks are released first
+        /// </summary>
+        void set_max_imposters(size_t count);
+        size_t get_max_imposters() const;
+
+        /// <summary>
+        /// Limits how many imposters are baked per frame, so zooming out over a large area spreads the work out
+        /// </summary>
+        void set_max_imposter_bakes_per_frame(size_t count);
+        size_t get_max_imposter_bakes_per_frame() const;
+
+        /// <returns>The texture size used for each chunk, in pixels</returns>
+        SDL_Point get_texture_size() const;
+
+        /// <returns>The world pixel position of the top left of a chunk's texture</returns>
+        SDL_FPoint get_chunk_origin(unsigned chunk_x, unsigned chunk_y) const;
+
+    private:
+        void update_geometry();
+        bool bake(tile_chunk& chunk, cache_entry& entry);
+        void add_chunk_tiles(tile_chunk& chunk, float scale, bool every_layer);
+        bool bake_imposter(tile_chunk& chunk, imposter_entry& entry, unsigned level);
+        SDL_Point get_level_size(unsigned level) const;
+        SDL_Texture* get_scratch_level(unsigned level);
+        void evict();
+        void evict_imposters();
+    };
+
+}
@@ -0,0 +1,118 @@
+#include "frame_cache.h"
+#include "../tools/memory_tracker.h"
+
+using namespace isometric::rendering;
+
+frame_cache::frame_cache(SDL_Renderer* renderer) : renderer(renderer)
+{
+    SDL_RendererInfo info{};
+    if (!renderer || SDL_GetRendererInfo(renderer, &info) < 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Frame cache disabled, unable to query the renderer: %s", SDL_GetError());
+        return;
+    }
+
+    supported = (info.flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+    if (!supported)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Frame cache disabled, renderer [%s] doesn't support render targets", info.name);
+    }
+}
+
+frame_cache::~frame_cache()
+{
+    clear();
+}
+
+bool frame_cache::is_supported() const
+{
+    return supported;
+}
+
+bool frame_cache::is_valid() const
+{
+    if (!valid) return false;
+
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    return width == texture_size.x && height == texture_size.y;
+}
+
+bool frame_cache::begin_capture()
+{
+    if (!supported || capturing) return false;
+
+    int width = 0, height = 0;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) < 0 || width <= 0 || height <= 0) return false;
+
+    if (texture && (width != texture_size.x || height != texture_size.y)) clear();
+
+    if (!texture)
+    {
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        tools::memory_tracker::render_targets().add_texture(texture);
+        if (!texture)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create frame cache texture: %s", SDL_GetError());
+            return false;
+        }
+
+        // The cached frame replaces what's under it, it was cleared to the background when it was captured:
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        texture_size = SDL_Point{ width, height };
+    }
+
+    // The output may be a scaled target, the frame is captured at its resolution and drawn through the same scale:
+    previous_target = SDL_GetRenderTarget(renderer);
+    SDL_RenderGetScale(renderer, &scale.x, &scale.y);
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_RenderSetScale(renderer, scale.x, scale.y);
+    SDL_RenderClear(renderer);
+
+    capturing = true;
+    valid = false;
+    return true;
+}
+
+void frame_cache::end_capture()
+{
+    if (!capturing) return;
+
+    SDL_SetRenderTarget(renderer, previous_target);
+    SDL_RenderSetScale(renderer, scale.x, scale.y);
+    previous_target = nullptr;
+
+    capturing = false;
+    valid = true;
+}
+
+void frame_cache::draw(const SDL_Rect& area) const
+{
+    if (!texture) return;
+
+    const SDL_Rect source{
+        static_cast<int>(area.x * scale.x), static_cast<int>(area.y * scale.y),
+        static_cast<int>(area.w * scale.x), static_cast<int>(area.h * scale.y)
+    };
+    SDL_RenderCopy(renderer, texture, &source, &area);
+}
+
+void frame_cache::invalidate()
+{
+    valid = false;
+}
+
+void frame_cache::clear()
+{
+    if (capturing) end_capture();
+
+    if (texture)
+    {
+        tools::memory_tracker::render_targets().remove_texture(texture);
+        SDL_DestroyTexture(texture);
+    }
+
+    texture = nullptr;
+    texture_size = SDL_Point{ 0, 0 };
+    valid = false;
+}
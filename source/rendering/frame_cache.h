@@ -0,0 +1,60 @@
+#pragma once
+#include <SDL.h>
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Keeps a copy of a rendered frame in a render target texture the size of the renderer's output, so a frame
+    /// where nothing changed can be drawn with one copy instead of being rendered again.
+    /// </summary>
+    class frame_cache
+    {
+    private:
+        SDL_Renderer* renderer = nullptr;
+        SDL_Texture* texture = nullptr;
+        SDL_Point texture_size{ 0, 0 };
+        SDL_Texture* previous_target = nullptr;
+        SDL_FPoint scale{ 1.0f, 1.0f };     // Of the target the frame was captured from, see graphics::set_render_scale
+
+        bool supported = false;
+        bool capturing = false;
+        bool valid = false;
+
+    public:
+        explicit frame_cache(SDL_Renderer* renderer);
+        ~frame_cache();
+
+        frame_cache(const frame_cache&) = delete;
+        frame_cache& operator=(const frame_cache&) = delete;
+
+        /// <returns>False if the renderer can't render to textures</returns>
+        bool is_supported() const;
+
+        /// <returns>True if the cache holds a complete frame of the current output size</returns>
+        bool is_valid() const;
+
+        /// <summary>
+        /// Redirect rendering into the cache, cleared to the renderer's current draw color. Everything drawn until
+        /// end_capture becomes the cached frame.
+        /// </summary>
+        /// <returns>False if the cache texture couldn't be created, rendering then goes where it did before</returns>
+        bool begin_capture();
+        void end_capture();
+
+        /// <summary>
+        /// Copy an area of the cached frame to the same place on the current render target, replacing what's there
+        /// </summary>
+        void draw(const SDL_Rect& area) const;
+
+        /// <summary>
+        /// Mark the cached frame out of date, the texture is kept for the next capture
+        /// </summary>
+        void invalidate();
+
+        /// <summary>
+        /// Release the cache texture, call this when the renderer's targets were lost
+        /// </summary>
+        void clear();
+    };
+
+}
@@ -0,0 +1,355 @@
+#include "glyph_atlas_cache.h"
+#include <bit>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+using namespace isometric::rendering;
+
+static_assert(std::endian::native == std::endian::little, "Glyph atlases are read in place and require a little endian host");
+static_assert(sizeof(cached_glyph) == 20);
+
+namespace {
+
+    constexpr uint32_t file_magic = 0x43414749; // "IGAC"
+    constexpr uint32_t file_version = 1;
+    constexpr int max_page_size = 4096;
+    constexpr uint32_t max_pages = 64;
+
+    struct file_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t file_hash;
+        int32_t point_size;
+        uint32_t style;
+        int32_t line_height;
+        uint32_t glyph_count;
+        uint32_t page_count;
+        uint32_t reserved;
+    };
+
+    struct page_record
+    {
+        int32_t width;
+        int32_t height;
+        int32_t cursor_x;
+        int32_t cursor_y;
+        int32_t row_height;
+    };
+
+    static_assert(sizeof(file_header) == 40);
+    static_assert(sizeof(page_record) == 20);
+
+    constexpr uint64_t fnv_offset_basis = 0xcbf29ce484222325ULL;
+
+    std::string cache_directory;
+
+    struct bundled_atlas
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        std::shared_ptr<const void> owner;
+    };
+
+    // Filled when bundles are mounted, read when fonts are created, both usually on the render thread:
+    std::mutex bundled_mutex;
+    std::unordered_map<std::string, bundled_atlas> bundled_atlases;
+    std::unordered_map<std::string, uint64_t> known_hashes;
+
+    /// <summary>
+    /// Reads an atlas from a file or from memory the same way
+    /// </summary>
+    class atlas_reader
+    {
+    private:
+        std::ifstream file;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+        bool failed = false;
+
+    public:
+        explicit atlas_reader(const std::string& path) : file(path, std::ios::binary) { failed = !file; }
+        atlas_reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        bool read(void* destination, size_t bytes)
+        {
+            if (failed) return false;
+
+            if (data)
+            {
+                failed = bytes > size - offset;
+                if (!failed) std::memcpy(destination, data + offset, bytes);
+                offset += failed ? 0 : bytes;
+            }
+            else
+            {
+                file.read(static_cast<char*>(destination), static_cast<std::streamsize>(bytes));
+                failed = !file;
+            }
+
+            return !failed;
+        }
+
+        bool is_open() const { return data || file.is_open(); }
+        explicit operator bool() const { return !failed; }
+    };
+
+    uint64_t fnv1a(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    bool read_atlas(atlas_reader& reader, const glyph_atlas_key& key, const std::string& path,
+        std::vector<cached_glyph>& glyphs, std::vector<glyph_atlas_page>& pages);
+
+    void free_pages(std::vector<glyph_atlas_page>& pages)
+    {
+        for (auto& page : pages) SDL_FreeSurface(page.surface);
+        pages.clear();
+    }
+
+    bool is_inside(const SDL_Rect& rect, const SDL_Surface* surface)
+    {
+        return rect.x >= 0 && rect.y >= 0 && rect.w >= 0 && rect.h >= 0 &&
+            rect.x + rect.w <= surface->w && rect.y + rect.h <= surface->h;
+    }
+
+}
+
+void glyph_atlas_cache::set_directory(const std::string& directory)
+{
+    cache_directory = directory;
+}
+
+const std::string& glyph_atlas_cache::get_directory()
+{
+    return cache_directory;
+}
+
+bool glyph_atlas_cache::is_enabled()
+{
+    std::lock_guard<std::mutex> lock(bundled_mutex);
+    return !cache_directory.empty() || !bundled_atlases.empty();
+}
+
+uint64_t glyph_atlas_cache::hash_file(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(bundled_mutex);
+        const auto found = known_hashes.find(path);
+        if (found != known_hashes.end()) return found->second;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return 0;
+
+    uint64_t hash = fnv_offset_basis;
+    char buffer[64 * 1024];
+
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        hash = fnv1a(buffer, static_cast<size_t>(file.gcount()), hash);
+    }
+
+    return file.bad() ? 0 : hash;
+}
+
+uint64_t glyph_atlas_cache::hash_bytes(const void* data, size_t size)
+{
+    return fnv1a(data, size, fnv_offset_basis);
+}
+
+void glyph_atlas_cache::set_file_hash(const std::string& path, uint64_t file_hash)
+{
+    std::lock_guard<std::mutex> lock(bundled_mutex);
+    known_hashes[path] = file_hash;
+}
+
+void glyph_atlas_cache::add_bundled_atlas(const std::string& file_name, const uint8_t* data, size_t size, std::shared_ptr<const void> owner)
+{
+    std::lock_guard<std::mutex> lock(bundled_mutex);
+    bundled_atlases[file_name] = bundled_atlas{ data, size, std::move(owner) };
+}
+
+glyph_atlas_key glyph_atlas_cache::make_key(const std::string& font_path, TTF_Font* font, int point_size)
+{
+    glyph_atlas_key key;
+    if (!font || font_path.empty()) return key;
+
+    key.file_hash = hash_file(font_path);
+    key.point_size = point_size;
+    key.style = static_cast<uint32_t>(TTF_GetFontStyle(font)) |
+        (static_cast<uint32_t>(TTF_GetFontOutline(font)) << 8) |
+        (static_cast<uint32_t>(TTF_GetFontHinting(font)) << 24);
+    key.line_height = TTF_FontHeight(font);
+    return key;
+}
+
+std::string glyph_atlas_cache::get_path(const glyph_atlas_key& key)
+{
+    return (std::filesystem::path(cache_directory) / get_file_name(key)).string();
+}
+
+std::string glyph_atlas_cache::get_file_name(const glyph_atlas_key& key)
+{
+    return std::format("{:016x}_{}_{:x}.glyphs", key.file_hash, key.point_size, key.style);
+}
+
+bool glyph_atlas_cache::load(const glyph_atlas_key& key, std::vector<cached_glyph>& glyphs, std::vector<glyph_atlas_page>& pages)
+{
+    if (!key.is_valid()) return false;
+
+    const std::string file_name = get_file_name(key);
+    {
+        std::lock_guard<std::mutex> lock(bundled_mutex);
+        const auto found = bundled_atlases.find(file_name);
+        if (found != bundled_atlases.end())
+        {
+            atlas_reader reader(found->second.data, found->second.size);
+            if (read_atlas(reader, key, file_name, glyphs, pages)) return true;
+        }
+    }
+
+    if (cache_directory.empty()) return false;
+
+    const std::string path = get_path(key);
+    atlas_reader reader(path);
+    if (!reader.is_open()) return false; // Never saved
+
+    return read_atlas(reader, key, path, glyphs, pages);
+}
+
+bool glyph_atlas_cache::save(const glyph_atlas_key& key, const std::vector<cached_glyph>& glyphs, const std::vector<glyph_atlas_page>& pages)
+{
+    if (cache_directory.empty() || !key.is_valid() || glyphs.size() > 256 || pages.size() > max_pages) return false;
+
+    for (const auto& page : pages)
+    {
+        if (!page.surface || page.surface->format->format != SDL_PIXELFORMAT_RGBA32) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory, error);
+
+    // Write to a temporary file first so a crash mid-write never leaves a truncated atlas behind:
+    const std::string path = get_path(key);
+    const std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create glyph atlas '%s'", temporary_path.c_str());
+            return false;
+        }
+
+        const file_header header{
+            file_magic, file_version, key.file_hash, key.point_size, key.style, key.line_height,
+            static_cast<uint32_t>(glyphs.size()), static_cast<uint32_t>(pages.size()), 0
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(glyphs.data()), static_cast<std::streamsize>(glyphs.size() * sizeof(cached_glyph)));
+
+        for (const auto& page : pages)
+        {
+            const page_record record{ page.surface->w, page.surface->h, page.cursor_x, page.cursor_y, page.row_height };
+            file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+
+            const std::streamsize row_bytes = static_cast<std::streamsize>(page.surface->w) * 4;
+            for (int y = 0; y < page.surface->h; y++)
+            {
+                file.write(static_cast<const char*>(page.surface->pixels) + static_cast<size_t>(y) * page.surface->pitch, row_bytes);
+            }
+        }
+
+        if (!file)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write glyph atlas '%s'", temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace glyph atlas '%s': %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+namespace {
+
+    bool read_atlas(atlas_reader& reader, const glyph_atlas_key& key, const std::string& path,
+        std::vector<cached_glyph>& glyphs, std::vector<glyph_atlas_page>& pages)
+    {
+        file_header header{};
+        reader.read(&header, sizeof(header));
+
+        if (!reader || header.magic != file_magic || header.version != file_version ||
+            header.file_hash != key.file_hash || header.point_size != key.point_size ||
+            header.style != key.style || header.line_height != key.line_height ||
+            header.glyph_count > 256 || header.page_count > max_pages)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Glyph atlas '%s' doesn't match its font, the glyphs are rendered again", path.c_str());
+            return false;
+        }
+
+        std::vector<cached_glyph> loaded_glyphs(header.glyph_count);
+        reader.read(loaded_glyphs.data(), loaded_glyphs.size() * sizeof(cached_glyph));
+
+        std::vector<glyph_atlas_page> loaded_pages;
+        for (uint32_t page_index = 0; reader && page_index < header.page_count; page_index++)
+        {
+            page_record record{};
+            reader.read(&record, sizeof(record));
+            if (!reader || record.width <= 0 || record.height <= 0 || record.width > max_page_size || record.height > max_page_size) break;
+
+            SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, record.width, record.height, 32, SDL_PIXELFORMAT_RGBA32);
+            if (!surface) break;
+
+            loaded_pages.push_back(glyph_atlas_page{ surface, record.cursor_x, record.cursor_y, record.row_height });
+
+            // Rows are read one at a time since the surface's pitch may be padded:
+            const size_t row_bytes = static_cast<size_t>(record.width) * 4;
+            for (int y = 0; reader && y < record.height; y++)
+            {
+                reader.read(static_cast<uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch, row_bytes);
+            }
+        }
+
+        bool valid = reader && loaded_pages.size() == header.page_count;
+        for (const cached_glyph& glyph : loaded_glyphs)
+        {
+            if (!valid) break;
+            valid = !glyph.present || (glyph.page < loaded_pages.size() && is_inside(glyph.srcrect, loaded_pages[glyph.page].surface));
+        }
+
+        if (!valid)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Glyph atlas '%s' is truncated or damaged, the glyphs are rendered again", path.c_str());
+            free_pages(loaded_pages);
+            return false;
+        }
+
+        glyphs = std::move(loaded_glyphs);
+        pages = std::move(loaded_pages);
+        return true;
+    }
+
+}
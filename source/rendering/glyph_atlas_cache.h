@@ -0,0 +1,105 @@
+#pragma once
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// What a glyph atlas was rendered from, an atlas is only reused when all of it matches
+    /// </summary>
+    struct glyph_atlas_key
+    {
+        uint64_t file_hash = 0;     // Of the font file's contents, 0 when it couldn't be read
+        int32_t point_size = 0;
+        uint32_t style = 0;         // TTF style, outline and hinting, they change how glyphs are rendered
+        int32_t line_height = 0;    // TTF_FontHeight, catches a point size that doesn't match the font
+
+        bool is_valid() const { return file_hash != 0 && point_size > 0; }
+    };
+
+    /// <summary>
+    /// One glyph of an atlas. Characters the font doesn't have are stored too, so they aren't tried again.
+    /// </summary>
+    struct cached_glyph
+    {
+        uint8_t character = 0;
+        uint8_t present = 0;
+        uint16_t page = 0;
+        SDL_Rect srcrect{ 0, 0, 0, 0 };
+    };
+
+    /// <summary>
+    /// One page of an atlas and where the next glyph is packed on it. Pixels are SDL_PIXELFORMAT_RGBA32.
+    /// </summary>
+    struct glyph_atlas_page
+    {
+        SDL_Surface* surface = nullptr;
+        int cursor_x = 0;
+        int cursor_y = 0;
+        int row_height = 0;
+    };
+
+    /// <summary>
+    /// Glyph atlases saved to disk with their glyph rectangles, so a font that was rendered on a previous run is
+    /// loaded as pixels rather than rendered again with FreeType. Files are named by the font file's hash and the
+    /// point size, a font that changes on disk gets a new file.
+    /// </summary>
+    /// <remarks>
+    /// An asset_bundle adds the atlases packed into it with add_bundled_atlas, they're found before the directory
+    /// is looked in. Atlases are only ever saved to the directory.
+    /// </remarks>
+    class glyph_atlas_cache
+    {
+    private:
+        glyph_atlas_cache() {} // Force as a static class
+
+    public:
+        /// <summary>
+        /// Where atlases are saved, an empty directory disables the cache
+        /// </summary>
+        static void set_directory(const std::string& directory);
+        static const std::string& get_directory();
+
+        /// <returns>True if atlases can be loaded, from the directory or a bundle</returns>
+        static bool is_enabled();
+
+        /// <returns>The FNV-1a hash of a file's contents, 0 if it couldn't be read</returns>
+        static uint64_t hash_file(const std::string& path);
+        static uint64_t hash_bytes(const void* data, size_t size);
+
+        /// <summary>
+        /// Use a known hash for a file instead of reading it, for fonts packed into a bundle that may not be on disk
+        /// </summary>
+        static void set_file_hash(const std::string& path, uint64_t file_hash);
+
+        /// <summary>
+        /// Make an atlas file held in memory, such as one packed into an asset_bundle, available to load
+        /// </summary>
+        /// <param name="file_name">The name get_file_name gives the atlas's key</param>
+        /// <param name="owner">Kept alive for as long as the atlas can be loaded from data</param>
+        static void add_bundled_atlas(const std::string& file_name, const uint8_t* data, size_t size, std::shared_ptr<const void> owner);
+
+        /// <returns>The key for glyphs of font, opened from font_path at point_size</returns>
+        static glyph_atlas_key make_key(const std::string& font_path, TTF_Font* font, int point_size);
+
+        /// <returns>The file an atlas with this key is saved to</returns>
+        static std::string get_path(const glyph_atlas_key& key);
+        static std::string get_file_name(const glyph_atlas_key& key);
+
+        /// <summary>
+        /// Read the atlas saved with this key. The caller owns the surfaces of the pages on success.
+        /// </summary>
+        /// <returns>False if there's no cache or bundled atlas with the key, or it couldn't be read</returns>
+        static bool load(const glyph_atlas_key& key, std::vector<cached_glyph>& glyphs, std::vector<glyph_atlas_page>& pages);
+
+        /// <summary>
+        /// Write an atlas, replacing the one saved with the same key. Every page needs its surface.
+        /// </summary>
+        static bool save(const glyph_atlas_key& key, const std::vector<cached_glyph>& glyphs, const std::vector<glyph_atlas_page>& pages);
+    };
+
+}
@@ -1,10 +1,13 @@
 #include "graphics.h"
 #include "../application/application.h"
+#include "../tools/profiler.h"
+#include "../tools/memory_tracker.h"
 #include <algorithm>
+#include <cmath>
 
 using namespace isometric::rendering;
 
-graphics::graphics(SDL_Renderer* renderer) : renderer(renderer)
+graphics::graphics(SDL_Renderer* renderer) : renderer(renderer), text_cache(renderer)
 {
     pixel_format = SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888);
     asset_manager = application::get_app()->get_asset_manager();
@@ -12,6 +15,7 @@ graphics::graphics(SDL_Renderer* renderer) : renderer(renderer)
 
 graphics::~graphics()
 {
+    release_scene_target();
     if (pixel_format) SDL_FreeFormat(pixel_format);
 }
 
@@ -27,10 +31,91 @@ bool graphics::has_sanity() const
     return sanity;
 }
 
-void graphics::present() const
+void graphics::set_render_scale(float scale)
+{
+    render_scale = std::clamp(scale, 0.1f, 1.0f);
+}
+
+void graphics::begin_frame()
+{
+    if (!has_sanity()) return;
+
+    scene_active = false;
+    SDL_GetRendererOutputSize(renderer, &output_size.x, &output_size.y);
+
+    if (render_scale >= 1.0f)
+    {
+        release_scene_target();
+        return;
+    }
+
+    if (!ensure_scene_target()) return;
+
+    // Drawing in output coordinates lands in the smaller target through the scale:
+    SDL_SetRenderTarget(renderer, scene_target);
+    SDL_RenderSetScale(renderer,
+        static_cast<float>(scene_size.x) / output_size.x,
+        static_cast<float>(scene_size.y) / output_size.y);
+    scene_active = true;
+}
+
+bool graphics::ensure_scene_target()
+{
+    if (output_size.x <= 0 || output_size.y <= 0) return false;
+
+    const SDL_Point size{
+        std::max(1, static_cast<int>(std::lround(output_size.x * render_scale))),
+        std::max(1, static_cast<int>(std::lround(output_size.y * render_scale)))
+    };
+
+    if (scene_target && size.x == scene_size.x && size.y == scene_size.y) return true;
+    release_scene_target();
+
+    scene_target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, size.x, size.y);
+    if (!scene_target)
+    {
+        // Without render targets frames are drawn at the full resolution, which is still correct:
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to create a %d x %d scaled render target: %s", size.x, size.y, SDL_GetError());
+        render_scale = 1.0f;
+        return false;
+    }
+
+    tools::memory_tracker::render_targets().add_texture(scene_target);
+    SDL_SetTextureBlendMode(scene_target, SDL_BLENDMODE_NONE);
+    SDL_SetTextureScaleMode(scene_target, SDL_ScaleModeLinear);
+    scene_size = size;
+    return true;
+}
+
+void graphics::release_scene_target()
+{
+    if (!scene_target) return;
+
+    if (scene_active && renderer) SDL_SetRenderTarget(renderer, nullptr);
+    scene_active = false;
+
+    tools::memory_tracker::render_targets().remove_texture(scene_target);
+    SDL_DestroyTexture(scene_target);
+    scene_target = nullptr;
+    scene_size = SDL_Point{ 0, 0 };
+}
+
+void graphics::present()
 {
     if (!has_sanity()) return;
 
+    ISOMETRIC_PROFILE_ZONE("present");
+
+    queue.flush(renderer);
+
+    if (scene_active)
+    {
+        // The output's own scale was never changed, only the scene target's:
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_RenderCopy(renderer, scene_target, nullptr, nullptr);
+        scene_active = false;
+    }
+
     SDL_RenderPresent(renderer);
 }
 
@@ -98,21 +183,28 @@ void graphics::clear(uint32_t color)
     SDL_RenderClear(renderer);
 }
 
+const isometric::assets::font* graphics::find_font(const std::string& font_name) const
+{
+    auto& asset = (*this->asset_manager)[font_name];
+    return asset ? dynamic_cast<const isometric::assets::font*>(asset.get()) : nullptr;
+}
+
 SDL_FRect graphics::size_text(
     const std::string& font_name, int point_size,
     const std::string& text,
     const SDL_FPoint& point
 )
 {
-    auto& asset = (*this->asset_manager)[font_name];
-    if (!asset) return { 0 };
-
-    auto font = dynamic_cast<const isometric::assets::font*>(asset.get());
-
-    int width = 0, height = 0;
-    TTF_SizeUTF8(font->get_font(), text.c_str(), &width, &height);
+    return size_text(find_font(font_name), point_size, text, point);
+}
 
-    return SDL_FRect{ point.x, point.y, static_cast<float>(width), static_cast<float>(height) };
+SDL_FRect graphics::size_text(
+    const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+    const std::string& text,
+    const SDL_FPoint& point
+)
+{
+    return size_text(font.get(), point_size, text, point);
 }
 
 void graphics::draw_text(
@@ -122,27 +214,72 @@ void graphics::draw_text(
     content_align align
 )
 {
-    auto& asset = (*this->asset_manager)[font_name];
-    if (!asset) return;
+    draw_text(find_font(font_name), point_size, text, point, align);
+}
 
-    auto font = dynamic_cast<const isometric::assets::font*>(asset.get());
+void graphics::draw_text(
+    const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+    const std::string& text,
+    const SDL_Point& point,
+    content_align align
+)
+{
+    draw_text(font.get(), point_size, text, point, align);
+}
 
-    SDL_Texture* texture = nullptr;
-    SDL_Surface* font_surface = nullptr;
+void graphics::draw_text(
+    const std::string& font_name, int point_size,
+    const std::string& text,
+    const SDL_Rect& destination,
+    content_align align,
+    bool wrap
+)
+{
+    draw_text(find_font(font_name), point_size, text, destination, align, wrap);
+}
 
-    font_surface = TTF_RenderUTF8_Blended(font->get_font(point_size), text.c_str(), get_sdl_color());
+void graphics::draw_text(
+    const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+    const std::string& text,
+    const SDL_Rect& destination,
+    content_align align,
+    bool wrap
+)
+{
+    draw_text(font.get(), point_size, text, destination, align, wrap);
+}
 
-    int text_width = font_surface->w;
-    int text_height = font_surface->h;
+SDL_FRect graphics::size_text(
+    const isometric::assets::font* font, int point_size,
+    const std::string& text,
+    const SDL_FPoint& point
+)
+{
+    if (!font) return { 0 };
 
-    if (font_surface)
-    {
-        texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-        SDL_FreeSurface(font_surface);
-    }
+    int width = 0, height = 0;
+    TTF_SizeUTF8(font->get_font(), text.c_str(), &width, &height);
+
+    return SDL_FRect{ point.x, point.y, static_cast<float>(width), static_cast<float>(height) };
+}
+
+void graphics::draw_text(
+    const isometric::assets::font* font, int point_size,
+    const std::string& text,
+    const SDL_Point& point,
+    content_align align
+)
+{
+    if (!font) return;
 
+    // The color is part of the cached texture, text drawn in another color is cached separately:
+    auto cached = text_cache.get(font->get_font(point_size), point_size, text, 0, get_sdl_color());
+    SDL_Texture* texture = cached.texture;
     if (!texture) return;
 
+    int text_width = cached.width;
+    int text_height = cached.height;
+
     SDL_Rect dest = SDL_Rect{ point.x, point.y, text_width, text_height };
 
     // Horizontal Alignment:
@@ -175,46 +312,30 @@ void graphics::draw_text(
         break;
     }
 
+    SDL_SetTextureColorMod(texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(texture, 255);
+
     SDL_RenderCopy(renderer, texture, NULL, &dest);
-    SDL_DestroyTexture(texture);
 }
 
 void graphics::draw_text(
-    const std::string& font_name, int point_size,
+    const isometric::assets::font* font, int point_size,
     const std::string& text,
     const SDL_Rect& destination,
     content_align align,
     bool wrap
 )
 {
-    auto& asset = (*this->asset_manager)[font_name];
-    if (!asset) return;
-
-    auto font = dynamic_cast<const isometric::assets::font*>(asset.get());
-
-    SDL_Texture* texture = nullptr;
-    SDL_Surface* font_surface = nullptr;
-
-    if (wrap)
-    {
-        font_surface = TTF_RenderUTF8_Blended_Wrapped(font->get_font(point_size), text.c_str(), SDL_Color{ 255, 255, 255, 255 }, destination.w);
-    }
-    else
-    {
-        font_surface = TTF_RenderUTF8_Blended(font->get_font(point_size), text.c_str(), SDL_Color{ 255, 255, 255, 255 });
-    }
-
-    int text_width = font_surface->w;
-    int text_height = font_surface->h;
-
-    if (font_surface)
-    {
-        texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-        SDL_FreeSurface(font_surface);
-    }
+    if (!font) return;
 
+    // Rendered in white and tinted below, so one cached texture serves every color:
+    auto cached = text_cache.get(font->get_font(point_size), point_size, text, wrap ? std::max(destination.w, 1) : 0, SDL_Color{ 255, 255, 255, 255 });
+    SDL_Texture* texture = cached.texture;
     if (!texture) return;
 
+    int text_width = cached.width;
+    int text_height = cached.height;
+
     SDL_Rect real_dest = SDL_Rect{ destination.x, destination.y, text_width, text_height };
 
     // Horizontal Alignment:
@@ -252,5 +373,4 @@ void graphics::draw_text(
     SDL_SetTextureAlphaMod(texture, sdl_color.a);
 
     SDL_RenderCopy(renderer, texture, NULL, &real_dest);
-    SDL_DestroyTexture(texture);
 }
\ No newline at end of file
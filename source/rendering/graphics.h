@@ -3,6 +3,8 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include "../assets/asset_management.h"
+#include "text_texture_cache.h"
+#include "render_queue.h"
 #include "../enumerations/content_align.h"
 
 namespace isometric::rendering {
@@ -16,15 +18,52 @@ namespace isometric::rendering {
         SDL_Renderer* renderer = nullptr;
         SDL_PixelFormat* pixel_format = nullptr;
         std::shared_ptr<isometric::assets::asset_management> asset_manager = nullptr;
+        text_texture_cache text_cache;
+        render_queue queue;
+
+        // The frame is drawn into this when the render scale is below 1, then stretched over the output by present:
+        SDL_Texture* scene_target = nullptr;
+        SDL_Point scene_size{ 0, 0 };
+        SDL_Point output_size{ 0, 0 };
+        float render_scale = 1.0f;
+        bool scene_active = false;
 
         graphics(SDL_Renderer* renderer);
-        void present() const;
+        void begin_frame();
+        void present();
         bool has_sanity() const;
+        bool ensure_scene_target();
+        void release_scene_target();
 
     public:
         virtual ~graphics();
         SDL_Renderer* get_renderer() { return renderer; }
 
+        /// <summary>
+        /// The textures kept by draw_text, see text_texture_cache
+        /// </summary>
+        text_texture_cache& get_text_cache() { return text_cache; }
+
+        /// <summary>
+        /// The queue subsystems record sprites, fills and text into, flushed before every present
+        /// </summary>
+        render_queue& get_render_queue() { return queue; }
+
+        /// <summary>
+        /// Draw frames at a fraction of the output's resolution, into a render target that's stretched over the
+        /// output when the frame is presented. Everything is still drawn in output coordinates, through the
+        /// renderer's scale, so only the number of pixels filled changes. Takes effect from the next frame.
+        /// </summary>
+        /// <param name="scale">Up to 1 for the full resolution, which draws to the output directly</param>
+        void set_render_scale(float scale);
+        float get_render_scale() const { return render_scale; }
+
+        /// <returns>True if the frame in progress is being drawn into the scaled render target</returns>
+        bool is_render_scaled() const { return scene_active; }
+
+        /// <returns>The size of the output this frame is drawn to, in output coordinates</returns>
+        SDL_Point get_output_size() const { return output_size; }
+
         void set_color(uint32_t color);
         uint32_t get_color() const;
         SDL_Color get_sdl_color() const;
@@ -38,6 +77,12 @@ namespace isometric::rendering {
             const SDL_FPoint& point = SDL_FPoint{ 0,0 }
         );
 
+        SDL_FRect size_text(
+            const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+            const std::string& text,
+            const SDL_FPoint& point = SDL_FPoint{ 0,0 }
+        );
+
         void draw_text(
             const std::string& font_name, int point_size,
             const std::string& text,
@@ -45,6 +90,13 @@ namespace isometric::rendering {
             content_align align = content_align::top_left
         );
 
+        void draw_text(
+            const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+            const std::string& text,
+            const SDL_Point& point,
+            content_align align = content_align::top_left
+        );
+
         void draw_text(
             const std::string& font_name, int point_size,
             const std::string& text,
@@ -52,6 +104,41 @@ namespace isometric::rendering {
             content_align align = content_align::top_left,
             bool wrap = false
         );
+
+        void draw_text(
+            const isometric::assets::asset_handle<isometric::assets::font>& font, int point_size,
+            const std::string& text,
+            const SDL_Rect& destination,
+            content_align align = content_align::top_left,
+            bool wrap = false
+        );
+
+    private:
+        /// <summary>
+        /// Look a font up by name, the handle overloads skip this and the cast
+        /// </summary>
+        const isometric::assets::font* find_font(const std::string& font_name) const;
+
+        SDL_FRect size_text(
+            const isometric::assets::font* font, int point_size,
+            const std::string& text,
+            const SDL_FPoint& point
+        );
+
+        void draw_text(
+            const isometric::assets::font* font, int point_size,
+            const std::string& text,
+            const SDL_Point& point,
+            content_align align
+        );
+
+        void draw_text(
+            const isometric::assets::font* font, int point_size,
+            const std::string& text,
+            const SDL_Rect& destination,
+            content_align align,
+            bool wrap
+        );
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "render_queue.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+using namespace isometric;
+using namespace isometric::rendering;
+
+// Bits of the sort key, from most to least significant:
+static constexpr int layer_shift = 56;  // 8 bits
+static constexpr int depth_shift = 24;  // 32 bits
+static constexpr uint64_t state_mask = (1ULL << depth_shift) - 1;
+
+size_t render_queue::state_hash::operator()(const state& key) const
+{
+    return std::hash<SDL_Texture*>{}(key.texture) ^ (static_cast<size_t>(key.blend) << 1);
+}
+
+uint32_t render_queue::to_depth(float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    // Flip negative floats entirely and set the sign bit of positive ones, so the bits order like the values:
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void render_queue::sprite(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect,
+    const SDL_Color& color, uint8_t layer, uint32_t depth, SDL_BlendMode blend)
+{
+    if (!texture) return;
+    record(texture, srcrect, dstrect, color, layer, depth, blend);
+}
+
+void render_queue::fill(const SDL_FRect& dstrect, const SDL_Color& color, uint8_t layer, uint32_t depth, SDL_BlendMode blend)
+{
+    record(nullptr, SDL_Rect{ 0, 0, 0, 0 }, dstrect, color, layer, depth, blend);
+}
+
+void render_queue::text(const simple_bitmap_font& font, std::string_view text, const SDL_Rect& dstrect,
+    content_align align, uint8_t layer, uint32_t depth)
+{
+    const SDL_Point size = font.layout(text, layout_quads);
+    record_glyphs(layout_quads, size, dstrect, align, font.get_color(), layer, depth);
+}
+
+void render_queue::text(const simple_bitmap_font& font, const bitmap_text_run& run, const SDL_Rect& dstrect,
+    content_align align, uint8_t layer, uint32_t depth)
+{
+    record_glyphs(run.get_quads(), run.get_size(), dstrect, align, font.get_color(), layer, depth);
+}
+
+void render_queue::record_glyphs(const std::vector<glyph_quad>& quads, const SDL_Point& size, const SDL_Rect& dstrect,
+    content_align align, const SDL_Color& color, uint8_t layer, uint32_t depth)
+{
+    const SDL_Point origin = simple_bitmap_font::align_origin(size, dstrect, align);
+
+    for (const auto& quad : quads)
+    {
+        record(quad.texture, quad.srcrect, SDL_FRect{
+            static_cast<float>(origin.x + quad.dstrect.x), static_cast<float>(origin.y + quad.dstrect.y),
+            static_cast<float>(quad.dstrect.w), static_cast<float>(quad.dstrect.h)
+        }, color, layer, depth, SDL_BLENDMODE_BLEND);
+    }
+}
+
+void render_queue::record(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect, const SDL_Color& color,
+    uint8_t layer, uint32_t depth, SDL_BlendMode blend)
+{
+    auto [iter, inserted] = state_ids.try_emplace(state{ texture, blend }, static_cast<uint32_t>(state_ids.size()));
+    const uint64_t state_id = std::min<uint64_t>(iter->second, state_mask);
+
+    const uint64_t key = (static_cast<uint64_t>(layer) << layer_shift) | (static_cast<uint64_t>(depth) << depth_shift) | state_id;
+    commands.push_back(command{ key, texture, srcrect, dstrect, color, blend });
+}
+
+size_t render_queue::flush(SDL_Renderer* renderer)
+{
+    draw_calls = 0;
+    state_changes = 0;
+
+    if (commands.empty() || !renderer)
+    {
+        clear();
+        return 0;
+    }
+
+    if (sorting_enabled)
+    {
+        std::stable_sort(commands.begin(), commands.end(), [](const command& a, const command& b) { return a.key < b.key; });
+    }
+
+    texture_blend_modes.clear();
+    batch.forget_textures();
+
+    SDL_BlendMode previous_draw_blend = SDL_BLENDMODE_NONE;
+    SDL_GetRenderDrawBlendMode(renderer, &previous_draw_blend);
+    SDL_BlendMode draw_blend = previous_draw_blend;
+
+    for (const auto& current : commands)
+    {
+        // Blend modes can't change inside a batch run, so a change submits what's been batched first:
+        if (current.texture)
+        {
+            auto [iter, inserted] = texture_blend_modes.try_emplace(current.texture, SDL_BLENDMODE_NONE);
+            if (inserted) SDL_GetTextureBlendMode(current.texture, &iter->second);
+
+            if (iter->second != current.blend)
+            {
+                submit_batch(renderer);
+                SDL_SetTextureBlendMode(current.texture, current.blend);
+                iter->second = current.blend;
+                state_changes++;
+            }
+
+            batch.add(current.texture, current.srcrect, current.dstrect, current.color);
+        }
+        else
+        {
+            if (draw_blend != current.blend)
+            {
+                submit_batch(renderer);
+                SDL_SetRenderDrawBlendMode(renderer, current.blend);
+                draw_blend = current.blend;
+                state_changes++;
+            }
+
+            batch.add_fill(current.dstrect, current.color);
+        }
+    }
+
+    submit_batch(renderer);
+
+    if (draw_blend != previous_draw_blend) SDL_SetRenderDrawBlendMode(renderer, previous_draw_blend);
+
+    clear();
+    return draw_calls;
+}
+
+void render_queue::submit_batch(SDL_Renderer* renderer)
+{
+    if (batch.get_quad_count() == 0) return;
+    draw_calls += batch.flush(renderer);
+}
+
+void render_queue::clear()
+{
+    commands.clear();
+    state_ids.clear();
+    batch.clear();
+}
+
+void render_queue::set_sorting_enabled(bool enable)
+{
+    sorting_enabled = enable;
+}
+
+bool render_queue::is_sorting_enabled() const
+{
+    return sorting_enabled;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include "sprite_batch.h"
+#include "simple_bitmap_font.h"
+#include "../enumerations/content_align.h"
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Records sprites, fills and text from any subsystem and submits them together. Each command has a sort key of
+    /// layer, depth and render state (texture and blend mode), so flush() can put commands in drawing order and,
+    /// within the same layer and depth, group those sharing a state into one sprite_batch run.
+    /// </summary>
+    /// <remarks>
+    /// Commands with equal keys keep the order they were recorded in. Texture state is queried again every flush,
+    /// so textures can be destroyed between frames without telling the queue. graphics owns the application's queue and
+    /// flushes it before presenting, so anything recorded during a frame is drawn on top of what was rendered
+    /// directly that frame.
+    /// </remarks>
+    class render_queue
+    {
+    public:
+        // Suggested layers, lower layers are drawn first:
+        static constexpr uint8_t world_layer = 0;
+        static constexpr uint8_t overlay_layer = 128;
+        static constexpr uint8_t ui_layer = 192;
+
+    private:
+        struct command
+        {
+            uint64_t key;
+            SDL_Texture* texture;   // nullptr for fills
+            SDL_Rect srcrect;
+            SDL_FRect dstrect;
+            SDL_Color color;
+            SDL_BlendMode blend;
+        };
+
+        struct state
+        {
+            SDL_Texture* texture;
+            SDL_BlendMode blend;
+
+            bool operator==(const state& other) const = default;
+        };
+
+        struct state_hash
+        {
+            size_t operator()(const state& key) const;
+        };
+
+        std::vector<command> commands;
+        std::vector<glyph_quad> layout_quads;
+        std::unordered_map<state, uint32_t, state_hash> state_ids;   // Assigned in first use order each frame
+        std::unordered_map<SDL_Texture*, SDL_BlendMode> texture_blend_modes;  // Queried once per flush
+        sprite_batch batch;
+
+        bool sorting_enabled = true;
+        size_t draw_calls = 0;
+        size_t state_changes = 0;
+
+    public:
+        /// <summary>
+        /// Order floats as depths, so depth can be a y coordinate in pixels or tiles. Negative values are allowed.
+        /// </summary>
+        static uint32_t to_depth(float value);
+
+        void sprite(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect,
+            const SDL_Color& color = SDL_Color{ 255, 255, 255, 255 },
+            uint8_t layer = world_layer, uint32_t depth = 0, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+
+        void fill(const SDL_FRect& dstrect, const SDL_Color& color,
+            uint8_t layer = world_layer, uint32_t depth = 0, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+
+        /// <summary>
+        /// Record text in the font's current color, aligned in dstrect like simple_bitmap_font::draw. Text from
+        /// the queue isn't clipped to dstrect.
+        /// </summary>
+        void text(const simple_bitmap_font& font, std::string_view text, const SDL_Rect& dstrect,
+            content_align align = content_align::top_left, uint8_t layer = ui_layer, uint32_t depth = 0);
+
+        void text(const simple_bitmap_font& font, const bitmap_text_run& run, const SDL_Rect& dstrect,
+            content_align align = content_align::top_left, uint8_t layer = ui_layer, uint32_t depth = 0);
+
+        /// <summary>
+        /// Sort the recorded commands, submit them and clear the queue
+        /// </summary>
+        /// <returns>The number of draw calls made</returns>
+        size_t flush(SDL_Renderer* renderer);
+
+        /// <summary>
+        /// Discard recorded commands without drawing them
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Without sorting commands are drawn in the order they were recorded
+        /// </summary>
+        void set_sorting_enabled(bool enable);
+        bool is_sorting_enabled() const;
+
+        size_t get_command_count() const { return commands.size(); }
+
+        /// <returns>Draw calls made by the last flush()</returns>
+        size_t get_draw_calls() const { return draw_calls; }
+
+        /// <returns>Blend mode changes made by the last flush()</returns>
+        size_t get_state_changes() const { return state_changes; }
+
+    private:
+        void record(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect, const SDL_Color& color,
+            uint8_t layer, uint32_t depth, SDL_BlendMode blend);
+
+        void record_glyphs(const std::vector<glyph_quad>& quads, const SDL_Point& size, const SDL_Rect& dstrect,
+            content_align align, const SDL_Color& color, uint8_t layer, uint32_t depth);
+
+        void submit_batch(SDL_Renderer* renderer);
+    };
+
+}
@@ -0,0 +1,360 @@
+#include "scroll_buffer.h"
+#include "../tools/memory_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace isometric;
+using namespace isometric::rendering;
+
+namespace {
+
+    /// <returns>value modulo divisor, always in [0, divisor)</returns>
+    int wrap(int value, int divisor)
+    {
+        const int result = value % divisor;
+        return result < 0 ? result + divisor : result;
+    }
+
+    /// <summary>
+    /// Split a world rectangle at the buffer's seams into at most four pieces, each paired with where it starts in
+    /// the buffer. The rectangle must be no larger than the buffer.
+    /// </summary>
+    /// <returns>The number of pieces written</returns>
+    int split_at_seams(const SDL_Rect& world_rect, int width, int height, SDL_Rect(&pieces)[4], SDL_Point(&origins)[4])
+    {
+        const int buffer_x = wrap(world_rect.x, width);
+        const int buffer_y = wrap(world_rect.y, height);
+        const int first_w = std::min(world_rect.w, width - buffer_x);
+        const int first_h = std::min(world_rect.h, height - buffer_y);
+
+        int count = 0;
+        for (int row = 0; row < 2; row++)
+        {
+            const int piece_h = row == 0 ? first_h : world_rect.h - first_h;
+            if (piece_h <= 0) continue;
+
+            for (int column = 0; column < 2; column++)
+            {
+                const int piece_w = column == 0 ? first_w : world_rect.w - first_w;
+                if (piece_w <= 0) continue;
+
+                pieces[count] = SDL_Rect{
+                    world_rect.x + (column == 0 ? 0 : first_w),
+                    world_rect.y + (row == 0 ? 0 : first_h),
+                    piece_w,
+                    piece_h
+                };
+                origins[count] = SDL_Point{ column == 0 ? buffer_x : 0, row == 0 ? buffer_y : 0 };
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+}
+
+scroll_buffer::scroll_buffer(SDL_Renderer* renderer, std::shared_ptr<tile_map> map)
+    : renderer(renderer), map(map)
+{
+    SDL_RendererInfo info{};
+    if (!renderer || !map || SDL_GetRendererInfo(renderer, &info) < 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Scroll buffer disabled, unable to query the renderer: %s", SDL_GetError());
+        return;
+    }
+
+    supported = (info.flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+    if (!supported)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Scroll buffer disabled, renderer [%s] doesn't support render targets", info.name);
+    }
+}
+
+scroll_buffer::~scroll_buffer()
+{
+    clear();
+}
+
+bool scroll_buffer::is_supported() const
+{
+    return supported;
+}
+
+bool scroll_buffer::ensure_texture(const SDL_Rect& viewport)
+{
+    // A two tile margin keeps the one pixel of sub-pixel overhang, and a frame's worth of scrolling, inside the buffer:
+    const int wanted_width = viewport.w + 2 * static_cast<int>(map->get_tile_width());
+    const int wanted_height = viewport.h + 2 * static_cast<int>(map->get_tile_height());
+
+    if (texture && width == wanted_width && height == wanted_height) return true;
+
+    clear();
+
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, wanted_width, wanted_height);
+    tools::memory_tracker::render_targets().add_texture(texture);
+    if (!texture)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the scroll buffer (%d x %d): %s", wanted_width, wanted_height, SDL_GetError());
+        supported = false;
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    width = wanted_width;
+    height = wanted_height;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Scroll buffer created, [ %d x %d ]", width, height);
+
+    return true;
+}
+
+SDL_Rect scroll_buffer::get_chunk_bounds(unsigned chunk_x, unsigned chunk_y) const
+{
+    // The same area a chunk_render_cache texture covers:
+    const int tile_width = static_cast<int>(map->get_tile_width());
+    const int half_tile_height = static_cast<int>(map->get_tile_height() / 2);
+    const int overdraw_right = std::max(0, static_cast<int>(map->get_max_image_width()) - tile_width);
+    const int overdraw_top = std::max(0, static_cast<int>(map->get_max_image_height()) - static_cast<int>(map->get_tile_height()));
+    const int size = static_cast<int>(tile_chunk::size);
+
+    return SDL_Rect{
+        static_cast<int>(chunk_x) * size * tile_width - tile_width / 2,
+        static_cast<int>(chunk_y) * size * half_tile_height - half_tile_height - overdraw_top,
+        size * tile_width + tile_width / 2 + overdraw_right,
+        size * half_tile_height + half_tile_height + overdraw_top
+    };
+}
+
+void scroll_buffer::invalidate_changed_chunks(const SDL_Rect& view, std::vector<SDL_Rect>& dirty)
+{
+    const int chunk_pixel_width = static_cast<int>(tile_chunk::size * map->get_tile_width());
+    const int chunk_pixel_height = static_cast<int>(tile_chunk::size * (map->get_tile_height() / 2));
+    const int margin_x = static_cast<int>(map->get_max_image_width()) + static_cast<int>(map->get_tile_width());
+    const int margin_y = static_cast<int>(map->get_max_image_height()) + static_cast<int>(map->get_tile_height());
+
+    const long long first_x = std::max(0LL, static_cast<long long>(std::floor((view.x - margin_x) / static_cast<double>(chunk_pixel_width))));
+    const long long last_x = std::min(map->get_chunks_wide() - 1LL, static_cast<long long>(std::floor((view.x + view.w + margin_x) / static_cast<double>(chunk_pixel_width))));
+    const long long first_y = std::max(0LL, static_cast<long long>(std::floor((view.y - margin_y) / static_cast<double>(chunk_pixel_height))));
+    const long long last_y = std::min(map->get_chunks_high() - 1LL, static_cast<long long>(std::floor((view.y + view.h + margin_y) / static_cast<double>(chunk_pixel_height))));
+
+    // Forget chunks that have scrolled out, their area will be drawn fresh if they come back:
+    std::erase_if(chunk_states, [&](const auto& pair) {
+        const long long chunk_x = static_cast<long long>(pair.first % map->get_chunks_wide());
+        const long long chunk_y = static_cast<long long>(pair.first / map->get_chunks_wide());
+        return chunk_x < first_x || chunk_x > last_x || chunk_y < first_y || chunk_y > last_y;
+    });
+
+    for (long long chunk_y = first_y; chunk_y <= last_y; chunk_y++)
+    {
+        for (long long chunk_x = first_x; chunk_x <= last_x; chunk_x++)
+        {
+            const tile_chunk* chunk = map->find_chunk(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+            const chunk_state state = chunk
+                ? chunk_state{ chunk->get_planes().revision, chunk->get_instance_id() }
+                : chunk_state{ 0, 0 };
+
+            const size_t chunk_index = static_cast<size_t>(chunk_x + chunk_y * map->get_chunks_wide());
+            auto [iter, inserted] = chunk_states.try_emplace(chunk_index, state);
+            if (inserted || iter->second == state) continue;
+
+            iter->second = state;
+
+            const SDL_Rect bounds = get_chunk_bounds(static_cast<unsigned>(chunk_x), static_cast<unsigned>(chunk_y));
+            SDL_Rect area{};
+            if (SDL_IntersectRect(&bounds, &view, &area)) dirty.push_back(area);
+        }
+    }
+}
+
+size_t scroll_buffer::render(const SDL_FPoint& view_origin, const SDL_Rect& viewport)
+{
+    tiles_drawn = 0;
+    draw_calls = 0;
+
+    if (!supported || viewport.w <= 0 || viewport.h <= 0) return 0;
+    if (!ensure_texture(viewport)) return 0;
+
+    // The whole pixels under the viewport, one extra to cover a fractional view origin:
+    const SDL_Rect view{
+        static_cast<int>(std::floor(view_origin.x)),
+        static_cast<int>(std::floor(view_origin.y)),
+        viewport.w + 1,
+        viewport.h + 1
+    };
+
+    std::vector<SDL_Rect> dirty;
+    SDL_Rect kept{};
+
+    if (!valid || !SDL_IntersectRect(&view, &valid_rect, &kept))
+    {
+        chunk_states.clear();
+        dirty.push_back(view);
+    }
+    else
+    {
+        // The strips of the view the buffer doesn't hold yet, top and bottom full width, then left and right:
+        if (kept.y > view.y) dirty.push_back(SDL_Rect{ view.x, view.y, view.w, kept.y - view.y });
+        if (kept.y + kept.h < view.y + view.h) dirty.push_back(SDL_Rect{ view.x, kept.y + kept.h, view.w, view.y + view.h - kept.y - kept.h });
+        if (kept.x > view.x) dirty.push_back(SDL_Rect{ view.x, kept.y, kept.x - view.x, kept.h });
+        if (kept.x + kept.w < view.x + view.w) dirty.push_back(SDL_Rect{ kept.x + kept.w, kept.y, view.x + view.w - kept.x - kept.w, kept.h });
+    }
+
+    invalidate_changed_chunks(view, dirty);
+
+    for (const auto& rect : dirty) redraw(rect);
+
+    valid = true;
+    valid_rect = view;
+
+    // Copy the view out of the buffer:
+    SDL_Rect pieces[4];
+    SDL_Point origins[4];
+    const int piece_count = split_at_seams(view, width, height, pieces, origins);
+
+    for (int i = 0; i < piece_count; i++)
+    {
+        const SDL_Rect source{ origins[i].x, origins[i].y, pieces[i].w, pieces[i].h };
+        const SDL_FRect dest{
+            pieces[i].x - view_origin.x + viewport.x,
+            pieces[i].y - view_origin.y + viewport.y,
+            static_cast<float>(pieces[i].w),
+            static_cast<float>(pieces[i].h)
+        };
+
+        SDL_RenderCopyF(renderer, texture, &source, &dest);
+        draw_calls++;
+    }
+
+    return draw_calls;
+}
+
+void scroll_buffer::redraw(const SDL_Rect& world_rect)
+{
+    if (world_rect.w <= 0 || world_rect.h <= 0) return;
+
+    // Remember the renderer state that drawing into the buffer will change:
+    SDL_Texture* previous_target = SDL_GetRenderTarget(renderer);
+    SDL_FPoint previous_scale{ 1.0f, 1.0f };
+    SDL_RenderGetScale(renderer, &previous_scale.x, &previous_scale.y);
+    SDL_Rect previous_clip{};
+    SDL_RenderGetClipRect(renderer, &previous_clip);
+    SDL_Color previous_color{};
+    SDL_GetRenderDrawColor(renderer, &previous_color.r, &previous_color.g, &previous_color.b, &previous_color.a);
+    SDL_BlendMode previous_blend = SDL_BLENDMODE_NONE;
+    SDL_GetRenderDrawBlendMode(renderer, &previous_blend);
+
+    SDL_SetRenderTarget(renderer, texture);
+
+    SDL_Rect pieces[4];
+    SDL_Point origins[4];
+    const int piece_count = split_at_seams(world_rect, width, height, pieces, origins);
+
+    for (int i = 0; i < piece_count; i++) redraw_piece(pieces[i], origins[i]);
+
+    // Setting a texture target resets the scale, graphics' scaled frame needs it back before the clip rectangle:
+    SDL_SetRenderTarget(renderer, previous_target);
+    SDL_RenderSetScale(renderer, previous_scale.x, previous_scale.y);
+    SDL_RenderSetClipRect(renderer, previous_clip.w > 0 && previous_clip.h > 0 ? &previous_clip : nullptr);
+    SDL_SetRenderDrawColor(renderer, previous_color.r, previous_color.g, previous_color.b, previous_color.a);
+    SDL_SetRenderDrawBlendMode(renderer, previous_blend);
+}
+
+void scroll_buffer::redraw_piece(const SDL_Rect& world_rect, const SDL_Point& buffer_origin)
+{
+    const SDL_Rect clip{ buffer_origin.x, buffer_origin.y, world_rect.w, world_rect.h };
+    SDL_RenderSetClipRect(renderer, &clip);
+
+    // Clearing only clears the clip rectangle, but a fill without blending is explicit about it:
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderFillRect(renderer, &clip);
+    draw_calls++;
+
+    const int tile_width = static_cast<int>(map->get_tile_width());
+    const unsigned tile_height = map->get_tile_height();
+    const int half_tile_height = static_cast<int>(tile_height / 2);
+    const int overdraw_top = std::max(0, static_cast<int>(map->get_max_image_height()) - static_cast<int>(tile_height));
+    const int max_image_width = std::max(tile_width, static_cast<int>(map->get_max_image_width()));
+    const unsigned layer_count = static_cast<unsigned>(map->get_layers().size());
+
+    // Every tile whose images can overlap the piece, tall images reach up to overdraw_top above their tile:
+    const int first_y = std::max(0, world_rect.y / half_tile_height - 1);
+    const int last_y = std::min(static_cast<int>(map->get_map_height()) - 1,
+        (world_rect.y + world_rect.h + half_tile_height + overdraw_top) / half_tile_height + 1);
+    const int first_x = std::max(0, static_cast<int>(std::floor((world_rect.x - max_image_width) / static_cast<double>(tile_width))));
+    const int last_x = std::min(static_cast<int>(map->get_map_width()) - 1,
+        (world_rect.x + world_rect.w + tile_width / 2) / tile_width + 1);
+
+    // Tiles are placed in world pixels, this moves them to the piece's place in the buffer:
+    const float offset_x = static_cast<float>(buffer_origin.x - world_rect.x);
+    const float offset_y = static_cast<float>(buffer_origin.y - world_rect.y);
+
+    for (int tile_y = first_y; tile_y <= last_y; tile_y++)
+    {
+        for (int tile_x = first_x; tile_x <= last_x; tile_x++)
+        {
+            tile_chunk* chunk = map->find_chunk(tile_x / tile_chunk::size, tile_y / tile_chunk::size);
+            if (!chunk) continue;
+
+            tile current_tile = chunk->get_tile(tile_x % tile_chunk::size, tile_y % tile_chunk::size);
+
+            // Same placement as transform::world_tile_to_world_pixels:
+            const float x = tile_x * static_cast<float>(tile_width) - (tile_y % 2 == 0 ? tile_width / 2.0f : 0.0f) + offset_x;
+            const float y = tile_y * (tile_height / 2.0f) - tile_height / 2.0f + offset_y;
+
+            for (unsigned layer_id = 0; layer_id < layer_count; layer_id++)
+            {
+                if (!map->is_layer_visible(layer_id) || !current_tile.has_image(layer_id)) continue;
+
+                // World draws an animated tile from that layer up every frame:
+                const unsigned image_id = current_tile.get_image_id(layer_id);
+                if (map->is_image_animated(image_id)) break;
+                if (!map->is_layer_static(layer_id)) continue;
+
+                const tile_image* image = map->get_image(image_id);
+                if (!image || !image->has_texture()) continue;
+                if (!bake_tall_images && image->get_source_h() > tile_height) continue;
+
+                batch.add(image->get_texture(), image->get_source_rect(), image->get_dest_rect(x, y));
+                tiles_drawn++;
+            }
+        }
+    }
+
+    batch.flush(renderer);
+    draw_calls += batch.get_draw_calls();
+}
+
+void scroll_buffer::invalidate()
+{
+    valid = false;
+}
+
+void scroll_buffer::clear()
+{
+    if (texture)
+    {
+        tools::memory_tracker::render_targets().remove_texture(texture);
+        SDL_DestroyTexture(texture);
+    }
+
+    texture = nullptr;
+    width = 0;
+    height = 0;
+    valid = false;
+    chunk_states.clear();
+}
+
+void scroll_buffer::set_bake_tall_images(bool bake)
+{
+    if (bake_tall_images == bake) return;
+
+    bake_tall_images = bake;
+    invalidate();
+}
+
+size_t scroll_buffer::get_tiles_drawn() const
+{
+    return tiles_drawn;
+}
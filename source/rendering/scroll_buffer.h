@@ -0,0 +1,96 @@
+#pragma once
+#include <SDL.h>
+#include <memory>
+#include <unordered_map>
+#include "../core/tile_map.h"
+#include "sprite_batch.h"
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Keeps the static layers around the view in a render target slightly larger than the viewport, addressed
+    /// toroidally: world pixel (x, y) lives at (x mod width, y mod height). When the camera moves only the newly
+    /// exposed strips are drawn, and the view is copied out of the buffer in at most four pieces, so continuous
+    /// scrolling costs a strip of tiles per frame instead of every tile on screen.
+    /// </summary>
+    /// <remarks>
+    /// Chunks whose planes change, or that are streamed in or out, have their area redrawn. Strips are drawn
+    /// clipped, so every tile overlapping them is drawn again in row order and the result is identical to drawing
+    /// the whole view.
+    /// </remarks>
+    class scroll_buffer
+    {
+    private:
+        struct chunk_state
+        {
+            uint32_t revision;
+            uint64_t instance;  // 0 when the chunk isn't allocated
+
+            bool operator==(const chunk_state& other) const = default;
+        };
+
+        SDL_Renderer* renderer = nullptr;
+        std::shared_ptr<tile_map> map = nullptr;
+        SDL_Texture* texture = nullptr;
+        int width = 0;
+        int height = 0;
+
+        bool supported = false;
+        bool valid = false;
+        bool bake_tall_images = true;
+        SDL_Rect valid_rect{ 0 };   // The world pixels held by the buffer
+        std::unordered_map<size_t, chunk_state> chunk_states;  // Every chunk overlapping valid_rect, by chunk index
+        sprite_batch batch;
+
+        size_t tiles_drawn = 0;
+        size_t draw_calls = 0;
+
+        bool ensure_texture(const SDL_Rect& viewport);
+        SDL_Rect get_chunk_bounds(unsigned chunk_x, unsigned chunk_y) const;
+        void invalidate_changed_chunks(const SDL_Rect& view, std::vector<SDL_Rect>& dirty);
+        void redraw(const SDL_Rect& world_rect);
+        void redraw_piece(const SDL_Rect& world_rect, const SDL_Point& buffer_origin);
+
+    public:
+        scroll_buffer(SDL_Renderer* renderer, std::shared_ptr<tile_map> map);
+        ~scroll_buffer();
+
+        scroll_buffer(const scroll_buffer&) = delete;
+        scroll_buffer& operator=(const scroll_buffer&) = delete;
+
+        /// <returns>False if the renderer can't render to textures</returns>
+        bool is_supported() const;
+
+        /// <summary>
+        /// Bring the buffer up to date for the view and draw the static layers under it
+        /// </summary>
+        /// <param name="view_origin">The world pixel position drawn at the top left of the viewport</param>
+        /// <param name="viewport">The viewport rectangle in screen pixels</param>
+        /// <returns>The number of draw calls made, including redrawing exposed strips</returns>
+        size_t render(const SDL_FPoint& view_origin, const SDL_Rect& viewport);
+
+        /// <summary>
+        /// Redraw everything on the next render
+        /// </summary>
+        void invalidate();
+
+        /// <summary>
+        /// Forget the texture sizes cached for drawing, required if a texture is destroyed and its address could be reused
+        /// </summary>
+        void forget_textures() { batch.forget_textures(); }
+
+        /// <summary>
+        /// Release the buffer texture, call this when the renderer's targets were lost
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Same as chunk_render_cache::set_bake_tall_images
+        /// </summary>
+        void set_bake_tall_images(bool bake);
+
+        /// <returns>Tiles drawn into the buffer by the last render</returns>
+        size_t get_tiles_drawn() const;
+    };
+
+}
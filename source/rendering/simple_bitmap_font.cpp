@@ -1,16 +1,16 @@
 #include "simple_bitmap_font.h"
+#include "../tools/memory_tracker.h"
 #include <SDL_ttf.h>
 #include <vector>
 #include <tuple>
+#include <cmath>
+#include <algorithm>
 
 using namespace isometric::rendering;
 
-static void generate_glyph_surfaces(TTF_Font* font, const std::vector<char>& glyphs, bitmap_font_info& font_info);
-static void generate_glyph_srcrects(bitmap_font_info& font_info);
-static void generate_glyph_textures(SDL_Renderer* renderer, bitmap_font_info& font_info, bool free_glyph_surfaces = true);
-
-simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, unsigned char start_glyph, unsigned char end_glyph)
-    : renderer(renderer), sdl_font(font)
+simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, unsigned char start_glyph, unsigned char end_glyph,
+    const bitmap_font_options& options)
+    : renderer(renderer), sdl_font(font), options(options)
 {
     size_t num_glyphs = (static_cast<size_t>(end_glyph) - start_glyph) + 1; // end_glyph is inclusive so + 1
     std::vector<char> glyphs(num_glyphs);
@@ -24,14 +24,16 @@ simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, u
     create(glyphs);
 }
 
-simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const char* glyphs, size_t glyphs_size)
-    : simple_bitmap_font(renderer, font, std::vector<char>(glyphs, glyphs + glyphs_size))
+simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const char* glyphs, size_t glyphs_size,
+    const bitmap_font_options& options)
+    : simple_bitmap_font(renderer, font, std::vector<char>(glyphs, glyphs + glyphs_size), options)
 {
 
 }
 
-simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const std::vector<char>& glyphs)
-    : renderer(renderer), sdl_font(font)
+simple_bitmap_font::simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const std::vector<char>& glyphs,
+    const bitmap_font_options& options)
+    : renderer(renderer), sdl_font(font), options(options)
 {
     create(glyphs);
 }
@@ -85,135 +87,165 @@ const SDL_Color& simple_bitmap_font::get_color() const
     return current_color;
 }
 
-void simple_bitmap_font::draw(
-    const std::string& text,
-    const SDL_Point& point,
-    content_align align
-) const
+const glyph_info* simple_bitmap_font::find_glyph(char character) const
 {
-    SDL_Rect dstrect = { point.x, point.y, 0, 0 };
+    const unsigned char index = static_cast<unsigned char>(character);
+    if (!glyph_mask[index]) return nullptr;
 
-    if (align != content_align::top_left)
-    {
-        auto measured_rect = measure(text, SDL_Point{ dstrect.x, dstrect.y });
+    const glyph_info& glyph = font_info.glyphs[index];
+    if (glyph.present) return &glyph;
 
-        // The alignment has to be handled here since it works differntly than when using the dstrect version of this
-        // function.
+    // Eager fonts rendered their whole glyph set when they were created:
+    return options.lazy && !rendered[index] ? render_glyph(character, true) : nullptr;
+}
 
-        // Horizontal Alignment:
-        switch (align)
-        {
-        case content_align::top_center:
-        case content_align::middle_center:
-        case content_align::bottom_center:
-            dstrect.x -= static_cast<int>(std::round(measured_rect.w / 2.0));
-            break;
-        case content_align::top_right:
-        case content_align::middle_right:
-        case content_align::bottom_right:
-            dstrect.x -= measured_rect.w;
-            break;
-        }
+SDL_Point simple_bitmap_font::layout(std::string_view text, std::vector<glyph_quad>& quads) const
+{
+    quads.clear();
+    int x = 0, height = 0;
 
-        // Vertical Alignment:
-        switch (align)
+    for (char character : text)
+    {
+        const glyph_info* glyph = find_glyph(character);
+        if (!glyph) continue;
+
+        if (glyph->texture_index < font_info.textures.size())
         {
-        case content_align::middle_left:
-        case content_align::middle_center:
-        case content_align::middle_right:
-            dstrect.y -= static_cast<int>(std::round(measured_rect.h / 2.0));
-            break;
-        case content_align::bottom_left:
-        case content_align::bottom_center:
-        case content_align::bottom_right:
-            dstrect.y -= measured_rect.h;
-            break;
+            SDL_Texture* texture = std::get<0>(font_info.textures[glyph->texture_index]);
+            if (texture)
+            {
+                quads.push_back(glyph_quad{ texture, glyph->srcrect, SDL_Rect{ x, 0, glyph->srcrect.w, glyph->srcrect.h } });
+            }
         }
+
+        x += glyph->srcrect.w;
+        if (glyph->srcrect.h > height) height = glyph->srcrect.h;
     }
 
-    draw(text, dstrect, content_align::top_left, true);
+    return SDL_Point{ x, height };
+}
+
+void simple_bitmap_font::draw(
+    std::string_view text,
+    const SDL_Point& point,
+    content_align align
+) const
+{
+    // A zero sized rect aligns the text around the point, e.g. right aligned text ends at it:
+    const SDL_Point size = layout(text, layout_quads);
+    submit(layout_quads, size, SDL_Rect{ point.x, point.y, 0, 0 }, align, true);
+}
+
+void simple_bitmap_font::draw(
+    std::string_view text,
+    const SDL_Rect& dstrect,
+    content_align align,
+    bool no_clip
+) const
+{
+    const SDL_Point size = layout(text, layout_quads);
+    submit(layout_quads, size, dstrect, align, no_clip);
+}
+
+void simple_bitmap_font::draw(
+    const bitmap_text_run& run,
+    const SDL_Point& point,
+    content_align align
+) const
+{
+    submit(run.get_quads(), run.get_size(), SDL_Rect{ point.x, point.y, 0, 0 }, align, true);
 }
 
 void simple_bitmap_font::draw(
-    const std::string& text,
+    const bitmap_text_run& run,
     const SDL_Rect& dstrect,
     content_align align,
     bool no_clip
 ) const
 {
-    for (const auto& texture_info : font_info.textures)
+    submit(run.get_quads(), run.get_size(), dstrect, align, no_clip);
+}
+
+SDL_Point simple_bitmap_font::align_origin(const SDL_Point& size, const SDL_Rect& dstrect, content_align align)
+{
+    SDL_Point origin{ dstrect.x, dstrect.y };
+
+    // Horizontal Alignment:
+    switch (align)
     {
-        SDL_Texture* texture = std::get<0>(texture_info);
-        SDL_SetTextureColorMod(texture, current_color.r, current_color.g, current_color.b);
-        SDL_SetTextureAlphaMod(texture, current_color.a);
+    case content_align::top_center:
+    case content_align::middle_center:
+    case content_align::bottom_center:
+        origin.x += static_cast<int>(std::round(dstrect.w / 2.0 - size.x / 2.0));
+        break;
+    case content_align::top_right:
+    case content_align::middle_right:
+    case content_align::bottom_right:
+        origin.x += dstrect.w - size.x;
+        break;
     }
 
-    // To keep up with the current glyph drawing position:
-    SDL_Rect glyph_dstrect{ dstrect.x, dstrect.y };
-
-    if (align != content_align::top_left)
+    // Vertical Alignment:
+    switch (align)
     {
-        auto measured_rect = measure(text, SDL_Point{ dstrect.x, dstrect.y });
+    case content_align::middle_left:
+    case content_align::middle_center:
+    case content_align::middle_right:
+        origin.y += static_cast<int>(std::round(dstrect.h / 2.0 - size.y / 2.0));
+        break;
+    case content_align::bottom_left:
+    case content_align::bottom_center:
+    case content_align::bottom_right:
+        origin.y += dstrect.h - size.y;
+        break;
+    }
 
-        // Horizontal Alignment:
-        switch (align)
-        {
-        case content_align::top_center:
-        case content_align::middle_center:
-        case content_align::bottom_center:
-            glyph_dstrect.x += static_cast<int>(std::round(dstrect.w / 2.0 - measured_rect.w / 2.0));
-            break;
-        case content_align::top_right:
-        case content_align::middle_right:
-        case content_align::bottom_right:
-            glyph_dstrect.x += dstrect.w - measured_rect.w;
-            break;
-        }
+    return origin;
+}
 
-        // Vertical Alignment:
-        switch (align)
-        {
-        case content_align::middle_left:
-        case content_align::middle_center:
-        case content_align::middle_right:
-            glyph_dstrect.y += static_cast<int>(std::round(dstrect.h / 2.0 - measured_rect.h / 2.0));
-            break;
-        case content_align::bottom_left:
-        case content_align::bottom_center:
-        case content_align::bottom_right:
-            glyph_dstrect.y += dstrect.h - measured_rect.h;
-            break;
-        }
-    }
+void simple_bitmap_font::submit(
+    const std::vector<glyph_quad>& quads,
+    const SDL_Point& size,
+    const SDL_Rect& dstrect,
+    content_align align,
+    bool no_clip
+) const
+{
+    // To keep up with the text's drawing position:
+    const SDL_Point origin = align_origin(size, dstrect, align);
 
     // Text rendering:
-    for (char character : text)
+    for (const auto& quad : quads)
     {
-        if (!font_info.glyphs.contains(character)) continue;
-
-        const auto& info = font_info.glyphs.at(character);
-        glyph_dstrect = { glyph_dstrect.x, glyph_dstrect.y, info.srcrect.w, info.srcrect.h };
+        const SDL_Rect glyph_dstrect{ origin.x + quad.dstrect.x, origin.y + quad.dstrect.y, quad.dstrect.w, quad.dstrect.h };
 
         if (!no_clip && !SDL_HasIntersection(&glyph_dstrect, &dstrect))
         {
             break;
         }
 
-        if (info.texture_index < font_info.textures.size())
-        {
-            SDL_Texture* texture = std::get<0>(font_info.textures[info.texture_index]);
-            if (texture)
-            {
-                SDL_RenderCopy(renderer, texture, &info.srcrect, &glyph_dstrect);
-            }
-        }
-
-        glyph_dstrect.x += info.srcrect.w;
+        batch.add(quad.texture, quad.srcrect, SDL_FRect{
+            static_cast<float>(glyph_dstrect.x), static_cast<float>(glyph_dstrect.y),
+            static_cast<float>(glyph_dstrect.w), static_cast<float>(glyph_dstrect.h)
+        }, current_color);
     }
+
+    if (batch_depth == 0) batch.flush(renderer);
+}
+
+void simple_bitmap_font::begin_batch() const
+{
+    batch_depth++;
+}
+
+void simple_bitmap_font::end_batch() const
+{
+    if (batch_depth == 0) return;
+    if (--batch_depth == 0) batch.flush(renderer);
 }
 
 SDL_Rect simple_bitmap_font::measure(
-    const std::string& text,
+    std::string_view text,
     const SDL_Point& point
 ) const
 {
@@ -221,13 +253,12 @@ SDL_Rect simple_bitmap_font::measure(
 
     for (char character : text)
     {
-        if (font_info.glyphs.contains(character))
+        if (const glyph_info* glyph = find_glyph(character))
         {
-            const auto& info = font_info.glyphs.at(character);
-            width += info.srcrect.w;
-            if (info.srcrect.h > height)
+            width += glyph->srcrect.w;
+            if (glyph->srcrect.h > height)
             {
-                height = info.srcrect.h;
+                height = glyph->srcrect.h;
             }
         }
     }
@@ -235,27 +266,107 @@ SDL_Rect simple_bitmap_font::measure(
     return SDL_Rect{ point.x, point.y, width, height };
 }
 
+bitmap_text_run::bitmap_text_run(const simple_bitmap_font& font)
+    : font(&font)
+{
+
+}
+
+bool bitmap_text_run::set_text(std::string_view new_text)
+{
+    if (new_text == text) return false;
+
+    text.assign(new_text);
+    size = font->layout(text, quads);
+    return true;
+}
+
+void bitmap_text_run::refresh()
+{
+    size = font->layout(text, quads);
+}
+
+const std::string& bitmap_text_run::get_text() const
+{
+    return text;
+}
+
+const SDL_Point& bitmap_text_run::get_size() const
+{
+    return size;
+}
+
+const std::vector<glyph_quad>& bitmap_text_run::get_quads() const
+{
+    return quads;
+}
+
+const simple_bitmap_font* bitmap_text_run::get_font() const
+{
+    return font;
+}
+
+void simple_bitmap_font::set_font(TTF_Font* font)
+{
+    if (!font || font == sdl_font) return;
+
+    // destroy() closes the old font if this owns it, the new one is owned the same way:
+    destroy();
+    sdl_font = font;
+
+    const std::vector<char> glyphs = std::move(glyph_set);
+    create(glyphs);
+}
+
 void simple_bitmap_font::create(const std::vector<char>& glyphs)
 {
-    generate_glyph_surfaces(sdl_font, glyphs, font_info);
-    generate_glyph_srcrects(font_info);
-    generate_glyph_textures(renderer, font_info, true);
+    glyph_set = glyphs;
+    glyph_mask.reset();
+    for (char character : glyphs) glyph_mask.set(static_cast<unsigned char>(character));
+
+    load_glyph_cache();
+
+    if (!options.lazy)
+    {
+        for (char character : glyphs)
+        {
+            if (!rendered[static_cast<unsigned char>(character)]) render_glyph(character, false);
+        }
+    }
+
+    upload_pages();
+
+    // Nothing is added to an eager font after this, so its atlas can be saved and its surfaces freed right away:
+    if (!options.lazy)
+    {
+        save_glyph_cache();
+        free_page_surfaces();
+    }
 }
 
 void simple_bitmap_font::destroy()
 {
+    save_glyph_cache();
+    free_page_surfaces();
+    pages.clear();
+
     for (auto& texture_info : font_info.textures)
     {
         auto& texture = std::get<0>(texture_info);
         if (texture)
         {
+            tools::memory_tracker::glyph_atlases().remove_texture(texture);
             SDL_DestroyTexture(texture);
             texture = nullptr;
         }
     }
 
     font_info.textures.clear();
-    font_info.glyphs.clear();
+    font_info.glyphs = {};
+    rendered.reset();
+    cache_key = glyph_atlas_key{};
+    batch.clear();
+    batch.forget_textures();
 
     if (destroy_font && this->sdl_font)
     {
@@ -264,155 +375,194 @@ void simple_bitmap_font::destroy()
     }
 }
 
-static void generate_glyph_surfaces(
-    TTF_Font* font,
-    const std::vector<char>& glyphs,
-    bitmap_font_info& font_info
-)
+void simple_bitmap_font::load_glyph_cache()
 {
-    if (!font || glyphs.empty()) return;
-    font_info.glyphs.clear();
+    if (options.font_path.empty() || !glyph_atlas_cache::is_enabled()) return;
+
+    // Hashed again on every create, a hot reload of the font's file gets a new key:
+    cache_key = glyph_atlas_cache::make_key(options.font_path, sdl_font, options.point_size);
 
-    for (char character : glyphs)
+    std::vector<cached_glyph> cached_glyphs;
+    std::vector<glyph_atlas_page> cached_pages;
+    if (!glyph_atlas_cache::load(cache_key, cached_glyphs, cached_pages)) return;
+
+    const size_t first_page = pages.size();
+    for (const auto& page : cached_pages)
     {
-        SDL_Surface* surface = TTF_RenderGlyph_Blended(font, character, SDL_Color{ 255, 255, 255, 255 });
-        if (surface)
+        tools::memory_tracker::glyph_atlases().add_surface(page.surface);
+        pages.push_back(page);
+        font_info.textures.push_back(
+            std::make_tuple<SDL_Texture*, SDL_Rect>(nullptr, SDL_Rect{ 0, 0, page.surface->w, page.surface->h })
+        );
+    }
+
+    for (const cached_glyph& cached : cached_glyphs)
+    {
+        rendered.set(cached.character);
+        if (cached.present)
         {
-            font_info.glyphs[character] = glyph_info{
-                surface,
-                SDL_Rect{ 0, 0, surface->w, surface->h },
-                0
-            };
+            font_info.glyphs[cached.character] = glyph_info{ cached.srcrect, first_page + cached.page, true };
         }
     }
 }
 
-static void generate_glyph_srcrects(
-    bitmap_font_info& font_info
-)
+bool simple_bitmap_font::save_glyph_cache() const
 {
-    if (!font_info.textures.empty() || font_info.glyphs.empty()) return;
+    if (!cache_dirty || !cache_key.is_valid()) return false;
+
+    std::vector<cached_glyph> cached_glyphs;
+    for (size_t index = 0; index < rendered.size(); index++)
+    {
+        if (!rendered[index]) continue;
+
+        const glyph_info& glyph = font_info.glyphs[index];
+        cached_glyphs.push_back(cached_glyph{
+            static_cast<uint8_t>(index),
+            static_cast<uint8_t>(glyph.present ? 1 : 0),
+            static_cast<uint16_t>(glyph.present ? glyph.texture_index : 0),
+            glyph.present ? glyph.srcrect : SDL_Rect{ 0, 0, 0, 0 }
+        });
+    }
 
-    constexpr int max_texture_width = 2048, max_texture_height = 2048;
-    int texture_width = 0, texture_height = 0;
-    size_t texture_index = 0;
-    int x = 0, y = 0, row_height = 0;
+    // Not retried on failure, the atlas is simply rendered again next time:
+    cache_dirty = false;
+    return glyph_atlas_cache::save(cache_key, cached_glyphs, pages);
+}
 
-    for (auto& pair : font_info.glyphs)
+const glyph_info* simple_bitmap_font::render_glyph(char character, bool upload) const
+{
+    const unsigned char index = static_cast<unsigned char>(character);
+    rendered.set(index);
+    if (cache_key.is_valid()) cache_dirty = true;
+
+    SDL_Surface* surface = sdl_font ? TTF_RenderGlyph_Blended(sdl_font, character, SDL_Color{ 255, 255, 255, 255 }) : nullptr;
+    if (!surface) return nullptr;
+    rendered_glyphs++;
+
+    size_t page_index = 0;
+    SDL_Rect dstrect{};
+    if (!pack_glyph(surface->w, surface->h, page_index, dstrect))
     {
-        char character = pair.first;
-        glyph_info& glyph = pair.second;
+        SDL_FreeSurface(surface);
+        return nullptr;
+    }
 
-        // The current row's height should be the tallest glyph:
-        if (glyph.surface->h > row_height)
-            row_height = glyph.surface->h;
+    // Disable blending for the glyph surface because if blending is enabled, black will bleed through the
+    // anti-aliasing even though it's 0,0,0,0
+    SDL_Surface* page = pages[page_index].surface;
+    SDL_Rect blit_rect = dstrect;
+    SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(surface, nullptr, page, &blit_rect);
+    SDL_FreeSurface(surface);
 
-        // If the farthest x-extent has been reached, start a new row:
-        if (x + glyph.surface->w >= max_texture_width)
+    glyph_info& glyph = font_info.glyphs[index];
+    glyph = glyph_info{ dstrect, page_index, true };
+
+    if (upload)
+    {
+        // Only the glyph's rectangle of an existing texture is updated, a page that was just added is uploaded whole:
+        SDL_Texture* texture = std::get<0>(font_info.textures[page_index]);
+        if (!texture)
         {
-            x = 0;
-            y += row_height;
-            row_height = glyph.surface->h;
+            upload_pages();
         }
-
-        // If the farthest y-extent has been reached, configure the texture's dimensions and move onto the next 
-        // texture:
-        if (y + glyph.surface->h >= max_texture_height)
+        else if (dstrect.w > 0 && dstrect.h > 0)
         {
-            font_info.textures.push_back(
-                std::make_tuple<SDL_Texture*, SDL_Rect>(
-                    nullptr,
-                    SDL_Rect{ 0, 0, texture_width, texture_height }
-                )
-            );
-
-            texture_index++;
-            texture_width = texture_height = x = y = 0;
+            const Uint8* pixels = static_cast<const Uint8*>(page->pixels) + dstrect.y * page->pitch + dstrect.x * 4;
+            SDL_UpdateTexture(texture, &dstrect, pixels, page->pitch);
         }
+    }
 
-        // Set the glyph's source rectangle:
-        glyph.srcrect = SDL_Rect{ x, y, glyph.surface->w, glyph.surface->h };
-        glyph.texture_index = texture_index;
+    return &glyph;
+}
+
+bool simple_bitmap_font::pack_glyph(int width, int height, size_t& page_index, SDL_Rect& rect) const
+{
+    // Glyphs are packed in rows as tall as their tallest glyph, left to right:
+    if (!pages.empty() && pages.back().surface)
+    {
+        glyph_atlas_page& page = pages.back();
 
-        // Increment the x coord:
-        x += glyph.surface->w;
+        if (page.cursor_x + width > page.surface->w)
+        {
+            page.cursor_x = 0;
+            page.cursor_y += page.row_height;
+            page.row_height = 0;
+        }
 
-        // Use the greatest x or y to update the texture_width and texture_height:
-        if (x > texture_width) texture_width = x; // Not adding the glyph width since it was done above
-        if (y + row_height > texture_height) texture_height = y + row_height;
+        if (page.cursor_x + width <= page.surface->w && page.cursor_y + height <= page.surface->h)
+        {
+            page_index = pages.size() - 1;
+            rect = SDL_Rect{ page.cursor_x, page.cursor_y, width, height };
+            page.cursor_x += width;
+            page.row_height = std::max(page.row_height, height);
+            return true;
+        }
     }
 
-    // The last texture's dimension needs to be setup after the loop:
-    if (texture_width > 0 && texture_height > 0)
+    // The last page is full, or gone because its surface was freed:
+    const SDL_Point size = get_page_size(width, height);
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size.x, size.y, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface)
     {
-        font_info.textures.push_back(
-            std::make_tuple<SDL_Texture*, SDL_Rect>(
-                nullptr,
-                SDL_Rect{ 0, 0, texture_width, texture_height }
-            )
-        );
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create a %dx%d glyph atlas page: %s", size.x, size.y, SDL_GetError());
+        return false;
     }
+
+    tools::memory_tracker::glyph_atlases().add_surface(surface);
+    pages.push_back(glyph_atlas_page{ surface, width, 0, height });
+    font_info.textures.push_back(std::make_tuple<SDL_Texture*, SDL_Rect>(nullptr, SDL_Rect{ 0, 0, size.x, size.y }));
+
+    page_index = pages.size() - 1;
+    rect = SDL_Rect{ 0, 0, width, height };
+    return true;
 }
 
-static void generate_glyph_textures(
-    SDL_Renderer* renderer,
-    bitmap_font_info& font_info,
-    bool free_glyph_surfaces
-)
+SDL_Point simple_bitmap_font::get_page_size(int glyph_width, int glyph_height) const
 {
-    std::vector<SDL_Surface*> atlas_surfaces;
-    for (auto& texture_info : font_info.textures)
-    {
-        const SDL_Rect& dimensions = std::get<1>(texture_info);
-
-        SDL_Surface* atlas_surface = SDL_CreateRGBSurface(0, dimensions.w, dimensions.h, 32,
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-            0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff
-#else
-            0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000
-#endif
-        );
-
-        atlas_surfaces.push_back(atlas_surface);
-    }
+    // About the line height squared per glyph is enough for the whole set, most fonts fit on one page:
+    const int line_height = sdl_font ? std::max(TTF_FontHeight(sdl_font), 1) : 16;
+    const double area = static_cast<double>(std::max<size_t>(glyph_set.size(), 1)) * line_height * line_height * 0.6;
+    const int side = (static_cast<int>(std::ceil(std::sqrt(area))) + 63) & ~63;
+
+    return SDL_Point{
+        std::min(std::max({ side, glyph_width, 64 }), max_texture_width),
+        std::min(std::max({ side, glyph_height, 64 }), max_texture_height)
+    };
+}
 
-    for (auto& pair : font_info.glyphs)
+void simple_bitmap_font::upload_pages() const
+{
+    for (size_t page_index = 0; page_index < pages.size(); page_index++)
     {
-        char character = pair.first;
-        glyph_info& glyph = pair.second;
-        const size_t texture_index = glyph.texture_index;
-
-        // This is the dstrect in this context, since the destination 
-        // surface will be the source in the future
-        SDL_Rect dstrect = glyph.srcrect;
-        SDL_Rect srcrect = SDL_Rect{ 0, 0, dstrect.w, dstrect.h };
-        SDL_Surface* dst = atlas_surfaces[texture_index];
-        if (dst && glyph.surface)
+        auto& texture = std::get<0>(font_info.textures[page_index]);
+        SDL_Surface* surface = pages[page_index].surface;
+        if (texture || !surface) continue;
+
+        // A static texture in the surface's format, so single glyphs can be updated in it later:
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+        if (!texture)
         {
-            // Disable blending for the glyph surface because if blending is enabled, black will bleed through the 
-            // anti-aliasing even though it's 0,0,0,0
-            SDL_SetSurfaceBlendMode(glyph.surface, SDL_BLENDMODE_NONE);
-            SDL_BlitSurface(glyph.surface, &srcrect, dst, &dstrect);
-            if (free_glyph_surfaces)
-            {
-                SDL_FreeSurface(glyph.surface);
-                glyph.surface = nullptr;
-            }
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create a glyph atlas texture: %s", SDL_GetError());
+            continue;
         }
+
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_UpdateTexture(texture, nullptr, surface->pixels, surface->pitch);
+        tools::memory_tracker::glyph_atlases().add_texture(texture);
+        // For testing, output the glyph atlas as an image file. Don't forget to #include <SDL_image.h>
+        // IMG_SavePNG(surface, std::format("./simple_font.{}.png", page_index).c_str());
     }
+}
 
-    for (size_t texture_index = 0; texture_index < font_info.textures.size(); texture_index++)
+void simple_bitmap_font::free_page_surfaces() const
+{
+    for (auto& page : pages)
     {
-        auto& texture = std::get<0>(font_info.textures[texture_index]);
-        auto& surface = atlas_surfaces[texture_index];
+        if (!page.surface) continue;
 
-        if (surface)
-        {
-            texture = SDL_CreateTextureFromSurface(renderer, surface);
-            // For testing, output the glyph atlas as an image file. Don't forget to #include <SDL_image.h>
-            // IMG_SavePNG(surface, std::format("./simple_font.{}.png", texture_index).c_str());
-            SDL_FreeSurface(surface);
-            surface = nullptr;
-        }
+        tools::memory_tracker::glyph_atlases().remove_surface(page.surface);
+        SDL_FreeSurface(page.surface);
+        page.surface = nullptr;
     }
-}
\ No newline at end of file
+}
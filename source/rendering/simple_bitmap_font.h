@@ -1,24 +1,96 @@
 #pragma once
 #include <SDL.h>
 #include <SDL_ttf.h>
-#include <unordered_map>
+#include <array>
+#include <bitset>
+#include <string>
+#include <string_view>
 #include <vector>
+#include "sprite_batch.h"
+#include "glyph_atlas_cache.h"
 #include "../enumerations/content_align.h"
 
 namespace isometric::rendering {
 
     struct glyph_info
     {
-        SDL_Surface* surface; // Only used for generation
         SDL_Rect srcrect;
         size_t texture_index;
+        bool present;
+    };
+
+    /// <summary>
+    /// How a simple_bitmap_font renders its glyphs
+    /// </summary>
+    struct bitmap_font_options
+    {
+        bool lazy = false;          // Render each glyph the first time it's laid out, not the whole glyph set up front
+        std::string font_path;      // The font's file, keys the atlas in the glyph_atlas_cache, empty to not cache it
+        int point_size = 0;         // The font's point size, also part of the cache key
     };
 
     struct bitmap_font_info {
         std::vector<std::tuple<SDL_Texture*, SDL_Rect>> textures;
-        std::unordered_map<char, glyph_info> glyphs;
+        std::array<glyph_info, 256> glyphs{}; // Indexed by the glyph's unsigned char value
+    };
+
+    /// <summary>
+    /// One glyph of a laid out string, relative to the string's top left corner
+    /// </summary>
+    struct glyph_quad
+    {
+        SDL_Texture* texture;
+        SDL_Rect srcrect;
+        SDL_Rect dstrect;
     };
 
+    class simple_bitmap_font;
+
+    /// <summary>
+    /// A string laid out once with a simple_bitmap_font and drawn many times. The layout is only rebuilt when
+    /// set_text is given a different string, so text that changes rarely (labels, counters refreshed a few times a
+    /// second) costs nothing but its quads each frame.
+    /// </summary>
+    class bitmap_text_run
+    {
+    private:
+        const simple_bitmap_font* font = nullptr;
+        std::string text;
+        std::vector<glyph_quad> quads;
+        SDL_Point size{ 0, 0 };
+
+    public:
+        explicit bitmap_text_run(const simple_bitmap_font& font);
+
+        /// <returns>True if the text changed and was laid out again</returns>
+        bool set_text(std::string_view text);
+
+        /// <summary>
+        /// Lay the same text out again, after the font's glyphs were rendered again by set_font
+        /// </summary>
+        void refresh();
+        const std::string& get_text() const;
+
+        /// <returns>The width and height of the laid out text</returns>
+        const SDL_Point& get_size() const;
+        const std::vector<glyph_quad>& get_quads() const;
+        const simple_bitmap_font* get_font() const;
+    };
+
+    /// <summary>
+    /// Draws text from glyph atlases rendered once with SDL_ttf. Glyphs are queued into a sprite_batch, so a string
+    /// is one draw call per atlas, and the color is applied per vertex rather than with texture color mods.
+    /// </summary>
+    /// <remarks>
+    /// Between begin_batch and end_batch every draw is queued and submitted together, which lets a whole overlay of
+    /// text go out in one draw call.
+    ///
+    /// Glyphs are packed into atlas pages sized for the glyph set, another page is added when one fills up. With
+    /// bitmap_font_options::lazy a glyph is only rendered and uploaded the first time layout, measure or
+    /// find_glyph asks for it, so those must be called from the thread that owns the renderer. With a font_path
+    /// the atlas is read from the glyph_atlas_cache when it was saved by a previous run, and saved again once
+    /// glyphs were added to it, a warm start renders nothing with FreeType.
+    /// </remarks>
     class simple_bitmap_font
     {
     private:
@@ -28,14 +100,31 @@ namespace isometric::rendering {
         SDL_Renderer* renderer = nullptr;
         TTF_Font* sdl_font = nullptr;
         bool destroy_font = false;
+        std::vector<char> glyph_set;    // Kept for set_font
+        std::bitset<256> glyph_mask;    // glyph_set as a lookup
+        bitmap_font_options options;
+        glyph_atlas_key cache_key;
+
+        // Glyphs are added by the const lookups when they're rendered lazily:
+        mutable bitmap_font_info font_info;
+        mutable std::vector<glyph_atlas_page> pages;    // Parallel to font_info.textures, surfaces are kept while glyphs can be added
+        mutable std::bitset<256> rendered;              // Glyphs rendered or loaded, including ones the font doesn't have
+        mutable bool cache_dirty = false;
+        mutable size_t rendered_glyphs = 0;
 
-        bitmap_font_info font_info;
         SDL_Color current_color = SDL_Color{ 255, 255, 255, 255 };
 
+        mutable sprite_batch batch;
+        mutable std::vector<glyph_quad> layout_quads;   // Reused by the string overloads of draw
+        mutable int batch_depth = 0;
+
     public:
-        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, unsigned char start_glyph, unsigned char end_glyph);
-        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const char* glyphs, size_t glyphs_size);
-        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const std::vector<char>& glyphs);
+        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, unsigned char start_glyph, unsigned char end_glyph,
+            const bitmap_font_options& options = {});
+        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const char* glyphs, size_t glyphs_size,
+            const bitmap_font_options& options = {});
+        simple_bitmap_font(SDL_Renderer* renderer, TTF_Font* font, const std::vector<char>& glyphs,
+            const bitmap_font_options& options = {});
         virtual ~simple_bitmap_font();
 
         uint32_t set_color(uint32_t color);
@@ -44,27 +133,104 @@ namespace isometric::rendering {
         const SDL_Color& get_color() const;
 
         void draw(
-            const std::string& text,
+            std::string_view text,
             const SDL_Point& point,
             content_align align = content_align::top_left
         ) const;
 
         void draw(
-            const std::string& text,
+            std::string_view text,
+            const SDL_Rect& dstrect,
+            content_align align = content_align::top_left,
+            bool no_clip = true
+        ) const;
+
+        void draw(
+            const bitmap_text_run& run,
+            const SDL_Point& point,
+            content_align align = content_align::top_left
+        ) const;
+
+        void draw(
+            const bitmap_text_run& run,
             const SDL_Rect& dstrect,
             content_align align = content_align::top_left,
             bool no_clip = true
         ) const;
 
         SDL_Rect measure(
-            const std::string& text,
+            std::string_view text,
             const SDL_Point& point = SDL_Point{ 0, 0 }
         ) const;
 
+        /// <summary>
+        /// Render the glyph atlases again from another font, such as a hot reload of the same one. The object stays
+        /// the same, text runs laid out with it need refresh() to pick up the new glyphs.
+        /// </summary>
+        void set_font(TTF_Font* font);
+
+        /// <summary>
+        /// Lay out text relative to its top left corner, replacing the contents of quads
+        /// </summary>
+        /// <returns>The width and height of the text</returns>
+        SDL_Point layout(std::string_view text, std::vector<glyph_quad>& quads) const;
+
+        /// <summary>
+        /// Queue every draw until the matching end_batch. Calls may be nested, only the outermost end_batch submits.
+        /// </summary>
+        void begin_batch() const;
+        void end_batch() const;
+
+        /// <returns>Where text of a laid out size starts when aligned in dstrect, see draw</returns>
+        static SDL_Point align_origin(const SDL_Point& size, const SDL_Rect& dstrect, content_align align);
+
+        /// <returns>The glyph for a character, or nullptr if the font doesn't have it</returns>
+        const glyph_info* find_glyph(char character) const;
+
+        /// <summary>
+        /// Save the atlas to the glyph_atlas_cache now if glyphs were added to it, otherwise that's done when the
+        /// font is destroyed or given another with set_font
+        /// </summary>
+        bool save_glyph_cache() const;
+
+        /// <returns>How many glyphs were rendered with SDL_ttf, those loaded from the cache aren't counted</returns>
+        size_t get_rendered_glyph_count() const { return rendered_glyphs; }
+
     private:
         void create(const std::vector<char>& glyphs);
 
         void destroy();
+
+        /// <summary>
+        /// Add the pages and glyphs of the cached atlas, if one was saved for this font
+        /// </summary>
+        void load_glyph_cache();
+
+        /// <summary>
+        /// Render a glyph into the last page, or a new one if it's full. With upload its texture is updated too,
+        /// otherwise upload_pages must be called before the glyph is drawn.
+        /// </summary>
+        const glyph_info* render_glyph(char character, bool upload) const;
+
+        /// <summary>
+        /// Find room for a glyph, adding a page when the last one is full
+        /// </summary>
+        bool pack_glyph(int width, int height, size_t& page_index, SDL_Rect& rect) const;
+
+        /// <returns>The size of a new page, enough for the whole glyph set at the font's height</returns>
+        SDL_Point get_page_size(int glyph_width, int glyph_height) const;
+
+        /// <summary>
+        /// Create the textures of pages that don't have one yet
+        /// </summary>
+        void upload_pages() const;
+
+        /// <summary>
+        /// Free the pages' surfaces once no more glyphs will be added
+        /// </summary>
+        void free_page_surfaces() const;
+
+        void submit(const std::vector<glyph_quad>& quads, const SDL_Point& size, const SDL_Rect& dstrect,
+            content_align align, bool no_clip) const;
     };
 }
-
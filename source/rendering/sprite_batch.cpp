@@ -0,0 +1,155 @@
+#include "sprite_batch.h"
+
+using namespace isometric::rendering;
+
+void sprite_batch::add(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect, const SDL_Color& color)
+{
+    if (!texture) return;
+
+    if (runs.empty() || runs.back().texture != texture)
+    {
+        runs.push_back(run{ texture, quads.size(), 0 });
+    }
+
+    quads.push_back(quad{ srcrect, dstrect, color });
+    runs.back().quad_count++;
+}
+
+void sprite_batch::add_fill(const SDL_FRect& dstrect, const SDL_Color& color)
+{
+    // Fills are runs without a texture:
+    if (runs.empty() || runs.back().texture != nullptr)
+    {
+        runs.push_back(run{ nullptr, quads.size(), 0 });
+    }
+
+    quads.push_back(quad{ SDL_Rect{ 0, 0, 0, 0 }, dstrect, color });
+    runs.back().quad_count++;
+}
+
+size_t sprite_batch::flush(SDL_Renderer* renderer)
+{
+    draw_calls = 0;
+    alpha_mod_changes = 0;
+    texture_switches = runs.empty() ? 0 : runs.size() - 1;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    for (const auto& current_run : runs)
+    {
+        const SDL_FPoint texture_size = current_run.texture ? get_texture_size(current_run.texture) : SDL_FPoint{ 0, 0 };
+        const float u_scale = texture_size.x > 0 ? 1.0f / texture_size.x : 0.0f;
+        const float v_scale = texture_size.y > 0 ? 1.0f / texture_size.y : 0.0f;
+
+        vertices.clear();
+        indices.clear();
+
+        for (size_t i = current_run.first_quad; i < current_run.first_quad + current_run.quad_count; i++)
+        {
+            const quad& q = quads[i];
+            const int first_vertex = static_cast<int>(vertices.size());
+
+            const float u0 = q.srcrect.x * u_scale, u1 = (q.srcrect.x + q.srcrect.w) * u_scale;
+            const float v0 = q.srcrect.y * v_scale, v1 = (q.srcrect.y + q.srcrect.h) * v_scale;
+            const float x0 = q.dstrect.x, x1 = q.dstrect.x + q.dstrect.w;
+            const float y0 = q.dstrect.y, y1 = q.dstrect.y + q.dstrect.h;
+
+            vertices.push_back(SDL_Vertex{ SDL_FPoint{ x0, y0 }, q.color, SDL_FPoint{ u0, v0 } });
+            vertices.push_back(SDL_Vertex{ SDL_FPoint{ x1, y0 }, q.color, SDL_FPoint{ u1, v0 } });
+            vertices.push_back(SDL_Vertex{ SDL_FPoint{ x1, y1 }, q.color, SDL_FPoint{ u1, v1 } });
+            vertices.push_back(SDL_Vertex{ SDL_FPoint{ x0, y1 }, q.color, SDL_FPoint{ u0, v1 } });
+
+            indices.push_back(first_vertex + 0);
+            indices.push_back(first_vertex + 1);
+            indices.push_back(first_vertex + 2);
+            indices.push_back(first_vertex + 0);
+            indices.push_back(first_vertex + 2);
+            indices.push_back(first_vertex + 3);
+        }
+
+        SDL_RenderGeometry(
+            renderer, current_run.texture,
+            vertices.data(), static_cast<int>(vertices.size()),
+            indices.data(), static_cast<int>(indices.size())
+        );
+
+        draw_calls++;
+    }
+#else
+    for (const auto& current_run : runs)
+    {
+        if (!current_run.texture)
+        {
+            SDL_Color previous_color{};
+            SDL_GetRenderDrawColor(renderer, &previous_color.r, &previous_color.g, &previous_color.b, &previous_color.a);
+
+            for (size_t i = current_run.first_quad; i < current_run.first_quad + current_run.quad_count; i++)
+            {
+                const quad& q = quads[i];
+                SDL_SetRenderDrawColor(renderer, q.color.r, q.color.g, q.color.b, q.color.a);
+                SDL_RenderFillRectF(renderer, &q.dstrect);
+                draw_calls++;
+            }
+
+            SDL_SetRenderDrawColor(renderer, previous_color.r, previous_color.g, previous_color.b, previous_color.a);
+            continue;
+        }
+
+        Uint8 current_alpha = 255;
+        SDL_Color current_color{ 255, 255, 255, 255 };
+
+        for (size_t i = current_run.first_quad; i < current_run.first_quad + current_run.quad_count; i++)
+        {
+            const quad& q = quads[i];
+
+            if (q.color.r != current_color.r || q.color.g != current_color.g || q.color.b != current_color.b)
+            {
+                SDL_SetTextureColorMod(current_run.texture, q.color.r, q.color.g, q.color.b);
+            }
+            if (q.color.a != current_alpha)
+            {
+                SDL_SetTextureAlphaMod(current_run.texture, q.color.a);
+                current_alpha = q.color.a;
+                alpha_mod_changes++;
+            }
+            current_color = q.color;
+
+            SDL_RenderCopyF(renderer, current_run.texture, &q.srcrect, &q.dstrect);
+            draw_calls++;
+        }
+
+        // Leave the texture as it was found:
+        if (current_color.r != 255 || current_color.g != 255 || current_color.b != 255)
+            SDL_SetTextureColorMod(current_run.texture, 255, 255, 255);
+        if (current_alpha != 255)
+        {
+            SDL_SetTextureAlphaMod(current_run.texture, 255);
+            alpha_mod_changes++;
+        }
+    }
+#endif
+
+    clear();
+    return draw_calls;
+}
+
+void sprite_batch::clear()
+{
+    quads.clear();
+    runs.clear();
+}
+
+void sprite_batch::forget_textures()
+{
+    texture_sizes.clear();
+}
+
+const SDL_FPoint& sprite_batch::get_texture_size(SDL_Texture* texture)
+{
+    auto iter = texture_sizes.find(texture);
+    if (iter != texture_sizes.end()) return iter->second;
+
+    int width = 0, height = 0;
+    SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+
+    return texture_sizes[texture] = SDL_FPoint{ static_cast<float>(width), static_cast<float>(height) };
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <SDL.h>
+#include <vector>
+#include <unordered_map>
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Collects textured quads and submits each consecutive run of quads sharing a texture with a single
+    /// SDL_RenderGeometry call. Submission order is preserved, so a run is only broken when the texture changes.
+    /// Buffers are reused between frames and don't allocate once they've grown to the size of a typical frame.
+    /// </summary>
+    /// <remarks>
+    /// SDL_RenderGeometry requires SDL 2.0.18. When building against an older SDL, flush() falls back to one
+    /// SDL_RenderCopyF per quad.
+    /// </remarks>
+    class sprite_batch
+    {
+    private:
+        struct quad
+        {
+            SDL_Rect srcrect;
+            SDL_FRect dstrect;
+            SDL_Color color;
+        };
+
+        struct run
+        {
+            SDL_Texture* texture;
+            size_t first_quad;
+            size_t quad_count;
+        };
+
+        std::vector<quad> quads;
+        std::vector<run> runs;
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+        std::unordered_map<SDL_Texture*, SDL_FPoint> texture_sizes;
+
+        size_t draw_calls = 0;
+        size_t texture_switches = 0;
+        size_t alpha_mod_changes = 0;
+
+    public:
+        /// <summary>
+        /// Queue a textured quad, color is multiplied with the texture like SDL_SetTextureColorMod/AlphaMod.
+        /// </summary>
+        void add(SDL_Texture* texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect,
+            const SDL_Color& color = SDL_Color{ 255, 255, 255, 255 });
+
+        /// <summary>
+        /// Queue a solid rectangle, drawn with the renderer's draw blend mode. Consecutive fills share a run.
+        /// </summary>
+        void add_fill(const SDL_FRect& dstrect, const SDL_Color& color);
+
+        /// <summary>
+        /// Submit every queued quad to the renderer and clear the queue
+        /// </summary>
+        /// <returns>The number of draw calls made</returns>
+        size_t flush(SDL_Renderer* renderer);
+
+        /// <summary>
+        /// Discard queued quads without drawing them
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Forget cached texture sizes, required if a texture is destroyed and its address could be reused
+        /// </summary>
+        void forget_textures();
+
+        size_t get_quad_count() const { return quads.size(); }
+        size_t get_run_count() const { return runs.size(); }
+
+        /// <returns>Draw calls made by the last flush()</returns>
+        size_t get_draw_calls() const { return draw_calls; }
+
+        /// <returns>Texture changes between runs during the last flush()</returns>
+        size_t get_texture_switches() const { return texture_switches; }
+
+        /// <returns>SDL_SetTextureAlphaMod calls made by the last flush(), always 0 with SDL_RenderGeometry</returns>
+        size_t get_alpha_mod_changes() const { return alpha_mod_changes; }
+
+    private:
+        const SDL_FPoint& get_texture_size(SDL_Texture* texture);
+    };
+
+}
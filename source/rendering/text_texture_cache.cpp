@@ -0,0 +1,169 @@
+#include "text_texture_cache.h"
+#include "../tools/memory_tracker.h"
+#include <functional>
+
+using namespace isometric::rendering;
+
+static uint32_t pack_color(const SDL_Color& color)
+{
+    return (static_cast<uint32_t>(color.r) << 24) | (color.g << 16) | (color.b << 8) | color.a;
+}
+
+size_t text_texture_cache::key_hash::operator()(const key_view& key) const
+{
+    size_t hash = std::hash<std::string_view>{}(key.text);
+
+    // Combine the rest of the key the same way boost::hash_combine does:
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(std::hash<TTF_Font*>{}(key.font));
+    combine(std::hash<int>{}(key.point_size));
+    combine(std::hash<int>{}(key.wrap_width));
+    combine(std::hash<uint32_t>{}(key.color));
+
+    return hash;
+}
+
+bool text_texture_cache::key_equal::operator()(const key_view& a, const key_view& b) const
+{
+    return a.font == b.font && a.point_size == b.point_size && a.wrap_width == b.wrap_width &&
+        a.color == b.color && a.text == b.text;
+}
+
+text_texture_cache::text_texture_cache(SDL_Renderer* renderer) : renderer(renderer)
+{
+
+}
+
+text_texture_cache::~text_texture_cache()
+{
+    clear();
+}
+
+text_texture_cache::text_texture text_texture_cache::get(TTF_Font* font, int point_size, std::string_view text, int wrap_width, const SDL_Color& color)
+{
+    if (!font || !renderer) return text_texture{};
+
+    const key_view key{ font, point_size, text, wrap_width, pack_color(color) };
+
+    auto iter = lookup.find(key);
+    if (iter != lookup.end())
+    {
+        hits++;
+        entries.splice(entries.begin(), entries, iter->second);
+        return iter->second->texture;
+    }
+
+    misses++;
+
+    // SDL_ttf needs a null terminated string:
+    std::string owned_text(text);
+
+    SDL_Surface* surface = wrap_width > 0
+        ? TTF_RenderUTF8_Blended_Wrapped(font, owned_text.c_str(), color, static_cast<uint32_t>(wrap_width))
+        : TTF_RenderUTF8_Blended(font, owned_text.c_str(), color);
+
+    if (!surface) return text_texture{};
+
+    text_texture rendered{ SDL_CreateTextureFromSurface(renderer, surface), surface->w, surface->h };
+    SDL_FreeSurface(surface);
+
+    if (!rendered.texture)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unable to create a text texture: %s", SDL_GetError());
+        return text_texture{};
+    }
+
+    const size_t bytes = static_cast<size_t>(rendered.width) * rendered.height * 4;
+    entries.push_front(entry{ font, point_size, std::move(owned_text), wrap_width, key.color, rendered, bytes });
+    lookup.emplace(entries.front().get_key(), entries.begin());
+    memory_used += bytes;
+    tools::memory_tracker::text_textures().add(0, bytes);
+
+    evict();
+
+    return rendered;
+}
+
+void text_texture_cache::evict()
+{
+    // Never the front, it's the texture that was just asked for:
+    while (memory_used > memory_budget && entries.size() > 1)
+    {
+        entry& oldest = entries.back();
+
+        lookup.erase(oldest.get_key());
+        if (oldest.texture.texture) SDL_DestroyTexture(oldest.texture.texture);
+        memory_used -= oldest.bytes;
+        tools::memory_tracker::text_textures().remove(0, oldest.bytes);
+
+        entries.pop_back();
+    }
+}
+
+void text_texture_cache::clear()
+{
+    lookup.clear();
+
+    for (auto& cached : entries)
+    {
+        if (cached.texture.texture) SDL_DestroyTexture(cached.texture.texture);
+        tools::memory_tracker::text_textures().remove(0, cached.bytes);
+    }
+
+    entries.clear();
+    memory_used = 0;
+}
+
+void text_texture_cache::forget_font(TTF_Font* font)
+{
+    for (auto iter = entries.begin(); iter != entries.end();)
+    {
+        if (iter->font != font)
+        {
+            ++iter;
+            continue;
+        }
+
+        lookup.erase(iter->get_key());
+        if (iter->texture.texture) SDL_DestroyTexture(iter->texture.texture);
+        memory_used -= iter->bytes;
+        tools::memory_tracker::text_textures().remove(0, iter->bytes);
+        iter = entries.erase(iter);
+    }
+}
+
+void text_texture_cache::set_memory_budget(size_t bytes)
+{
+    memory_budget = bytes;
+    evict();
+}
+
+size_t text_texture_cache::get_memory_budget() const
+{
+    return memory_budget;
+}
+
+size_t text_texture_cache::get_memory_used() const
+{
+    return memory_used;
+}
+
+size_t text_texture_cache::get_texture_count() const
+{
+    return entries.size();
+}
+
+size_t text_texture_cache::get_hits() const
+{
+    return hits;
+}
+
+size_t text_texture_cache::get_misses() const
+{
+    return misses;
+}
+
+void text_texture_cache::reset_counters()
+{
+    hits = misses = 0;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+#include <string_view>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+namespace isometric::rendering {
+
+    /// <summary>
+    /// Keeps the textures graphics::draw_text rasterizes so text drawn again with the same font, point size, wrap
+    /// width and color is a texture copy instead of a rasterize and upload. Textures are released least recently
+    /// used first once their estimated memory exceeds the budget.
+    /// </summary>
+    /// <remarks>
+    /// Entries are keyed by the TTF_Font pointer, so clear() should be called when a font is closed, otherwise a
+    /// new font opened at the same address could be drawn with the old font's textures.
+    /// </remarks>
+    class text_texture_cache
+    {
+    public:
+        struct text_texture
+        {
+            SDL_Texture* texture = nullptr;
+            int width = 0;
+            int height = 0;
+        };
+
+    private:
+        struct key_view
+        {
+            TTF_Font* font;
+            int point_size;
+            std::string_view text;
+            int wrap_width;         // 0 when not wrapped
+            uint32_t color;
+        };
+
+        struct entry
+        {
+            TTF_Font* font;
+            int point_size;
+            std::string text;
+            int wrap_width;
+            uint32_t color;
+            text_texture texture;
+            size_t bytes;
+
+            key_view get_key() const { return key_view{ font, point_size, text, wrap_width, color }; }
+        };
+
+        struct key_hash
+        {
+            size_t operator()(const key_view& key) const;
+        };
+
+        struct key_equal
+        {
+            bool operator()(const key_view& a, const key_view& b) const;
+        };
+
+        SDL_Renderer* renderer = nullptr;
+        std::list<entry> entries;   // Most recently used first
+        std::unordered_map<key_view, std::list<entry>::iterator, key_hash, key_equal> lookup;   // Views into entries
+
+        size_t memory_budget = 32 * 1024 * 1024;
+        size_t memory_used = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+
+    public:
+        explicit text_texture_cache(SDL_Renderer* renderer);
+        ~text_texture_cache();
+
+        text_texture_cache(const text_texture_cache&) = delete;
+        text_texture_cache& operator=(const text_texture_cache&) = delete;
+
+        /// <summary>
+        /// Find the texture for a string, rasterizing and caching it if it isn't cached yet
+        /// </summary>
+        /// <param name="point_size">Part of the key only, font is already the font at that size</param>
+        /// <param name="wrap_width">Wrap the text to this many pixels, 0 to not wrap</param>
+        /// <param name="color">The color the text is rasterized with</param>
+        /// <returns>The texture, with a null texture if the text couldn't be rendered. Valid until the next get.</returns>
+        text_texture get(TTF_Font* font, int point_size, std::string_view text, int wrap_width, const SDL_Color& color);
+
+        /// <summary>
+        /// Release every cached texture, hit and miss counts are kept
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Release the textures rasterized with a font, before it's closed, such as by a hot reload
+        /// </summary>
+        void forget_font(TTF_Font* font);
+
+        /// <summary>
+        /// The estimated texture memory, 4 bytes per pixel, kept before least recently used textures are released.
+        /// The texture just drawn is always kept, even when it's larger than the budget by itself.
+        /// </summary>
+        void set_memory_budget(size_t bytes);
+        size_t get_memory_budget() const;
+        size_t get_memory_used() const;
+
+        size_t get_texture_count() const;
+        size_t get_hits() const;
+        size_t get_misses() const;
+        void reset_counters();
+
+    private:
+        void evict();
+    };
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// A resizable, tightly packed set of bits. Unlike std::vector&lt;bool&gt; the underlying words are exposed so
+    /// that whole ranges can be scanned or copied 64 bits at a time.
+    /// </summary>
+    class dynamic_bitset
+    {
+    public:
+        using word_type = uint64_t;
+        static constexpr size_t bits_per_word = sizeof(word_type) * 8;
+
+    private:
+        std::vector<word_type> words;
+        size_t bit_count = 0;
+
+    public:
+        dynamic_bitset() {}
+        dynamic_bitset(size_t size, bool value = false) { resize(size, value); }
+
+        /// <summary>
+        /// Resize the bitset, new bits are initialized to value
+        /// </summary>
+        void resize(size_t size, bool value = false)
+        {
+            const size_t old_size = bit_count;
+            words.resize((size + bits_per_word - 1) / bits_per_word, 0);
+            bit_count = size;
+
+            if (value)
+            {
+                for (size_t i = old_size; i < size; i++) set(i);
+            }
+            else
+            {
+                // Clear any stale bits past the old end so that they don't become visible after growing:
+                for (size_t i = old_size; i < size && i % bits_per_word != 0; i++) reset(i);
+            }
+        }
+
+        void fill(bool value)
+        {
+            std::fill(words.begin(), words.end(), value ? ~word_type(0) : word_type(0));
+        }
+
+        size_t size() const { return bit_count; }
+
+        bool test(size_t index) const
+        {
+            return (words[index / bits_per_word] >> (index % bits_per_word)) & 1;
+        }
+
+        void set(size_t index)
+        {
+            words[index / bits_per_word] |= word_type(1) << (index % bits_per_word);
+        }
+
+        void set(size_t index, bool value)
+        {
+            if (value) set(index);
+            else reset(index);
+        }
+
+        void reset(size_t index)
+        {
+            words[index / bits_per_word] &= ~(word_type(1) << (index % bits_per_word));
+        }
+
+        bool operator[](size_t index) const { return test(index); }
+
+        std::vector<word_type>& get_words() { return words; }
+        const std::vector<word_type>& get_words() const { return words; }
+
+        /// <returns>The number of bytes used by the packed words</returns>
+        size_t get_byte_size() const { return words.size() * sizeof(word_type); }
+    };
+
+}
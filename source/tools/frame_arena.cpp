@@ -0,0 +1,148 @@
+#include "frame_arena.h"
+#include "memory_tracker.h"
+#include <atomic>
+#include <algorithm>
+
+using namespace isometric::tools;
+
+namespace {
+
+    std::atomic<unsigned long long> current_frame = 0;
+
+    struct thread_arenas
+    {
+        linear_arena buffers[2];
+        unsigned long long frame = 0;
+    };
+
+    // Created on a thread's first allocation, freed when the thread exits:
+    linear_arena& get_current_arena()
+    {
+        thread_local thread_arenas arenas;
+
+        const unsigned long long frame = current_frame.load(std::memory_order_relaxed);
+        linear_arena& arena = arenas.buffers[frame & 1];
+
+        if (arenas.frame != frame)
+        {
+            // When the thread skipped a frame or more the other buffer is older still, so it's free to reset too,
+            // but leaving it be costs nothing:
+            arenas.frame = frame;
+            arena.reset();
+        }
+
+        return arena;
+    }
+
+    size_t align_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+}
+
+linear_arena::linear_arena(size_t initial_size)
+    : initial_size(std::max<size_t>(initial_size, 64))
+{
+
+}
+
+linear_arena::~linear_arena()
+{
+    for (const block& added : blocks) memory_tracker::frame_arenas().remove(added.size);
+}
+
+void* linear_arena::do_allocate(size_t bytes, size_t alignment)
+{
+    if (current < blocks.size())
+    {
+        block& active = blocks[current];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(active.data.get());
+        const size_t aligned = align_up(base + offset, alignment) - base;
+
+        if (aligned + bytes <= active.size)
+        {
+            used_bytes += aligned + bytes - offset;
+            peak_bytes = std::max(peak_bytes, used_bytes);
+            offset = aligned + bytes;
+            return active.data.get() + aligned;
+        }
+    }
+
+    return allocate_block(bytes, alignment);
+}
+
+void* linear_arena::allocate_block(size_t bytes, size_t alignment)
+{
+    // Blocks start aligned for any standard type, so only over-aligned requests need room to align in:
+    const size_t needed = bytes + (alignment > alignof(std::max_align_t) ? alignment : 0);
+
+    // Blocks left over from before the last reset have room already:
+    while (current + 1 < blocks.size())
+    {
+        current++;
+        offset = 0;
+        if (blocks[current].size >= needed) return do_allocate(bytes, alignment);
+    }
+
+    const size_t previous_size = blocks.empty() ? initial_size : blocks.back().size * 2;
+    block added;
+    added.size = std::max(previous_size, align_up(needed, 64));
+    added.data = std::make_unique_for_overwrite<std::byte[]>(added.size);
+    blocks.push_back(std::move(added));
+    block_allocations++;
+    memory_tracker::frame_arenas().add(blocks.back().size);
+
+    current = blocks.size() - 1;
+    offset = 0;
+    return do_allocate(bytes, alignment);
+}
+
+void linear_arena::reset()
+{
+    // Merge the blocks a busy frame needed into one, so the next frame like it fits without allocating:
+    if (blocks.size() > 1)
+    {
+        const size_t capacity = get_capacity();
+        for (const block& added : blocks) memory_tracker::frame_arenas().remove(added.size);
+        blocks.clear();
+
+        block merged;
+        merged.size = capacity;
+        merged.data = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        blocks.push_back(std::move(merged));
+        block_allocations++;
+        memory_tracker::frame_arenas().add(capacity);
+    }
+
+    current = 0;
+    offset = 0;
+    used_bytes = 0;
+}
+
+size_t linear_arena::get_capacity() const
+{
+    size_t capacity = 0;
+    for (const block& added : blocks) capacity += added.size;
+    return capacity;
+}
+
+void frame_arena::next_frame()
+{
+    current_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned long long frame_arena::get_frame()
+{
+    return current_frame.load(std::memory_order_relaxed);
+}
+
+std::pmr::memory_resource* frame_arena::get()
+{
+    return &get_current_arena();
+}
+
+const linear_arena& frame_arena::get_thread_arena()
+{
+    return get_current_arena();
+}
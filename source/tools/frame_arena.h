@@ -0,0 +1,94 @@
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// A linear (bump) allocator exposed as a std::pmr::memory_resource. Allocating advances an offset within the
+    /// current block and deallocating does nothing, everything is given back at once by reset(). When a block runs
+    /// out another is added, and the next reset() merges them into one block, so a steady workload stops
+    /// allocating after its first few resets. Not thread safe, every thread needs its own.
+    /// </summary>
+    class linear_arena : public std::pmr::memory_resource
+    {
+    private:
+        struct block
+        {
+            std::unique_ptr<std::byte[]> data;
+            size_t size = 0;
+        };
+
+        std::vector<block> blocks;
+        size_t current = 0;         // The block being allocated from
+        size_t offset = 0;          // Within the current block
+        size_t used_bytes = 0;      // Since the last reset, including alignment padding
+        size_t peak_bytes = 0;
+        size_t block_allocations = 0;
+        size_t initial_size = 0;
+
+        void* allocate_block(size_t bytes, size_t alignment);
+
+    public:
+        explicit linear_arena(size_t initial_size = 64 * 1024);
+        ~linear_arena();
+
+        linear_arena(const linear_arena&) = delete;
+        linear_arena& operator=(const linear_arena&) = delete;
+
+        /// <summary>
+        /// Give back everything allocated since the last reset, memory handed out before it must no longer be used
+        /// </summary>
+        void reset();
+
+        size_t get_used_bytes() const { return used_bytes; }
+        size_t get_peak_bytes() const { return peak_bytes; }
+
+        /// <returns>The bytes reserved by every block</returns>
+        size_t get_capacity() const;
+
+        /// <returns>How many blocks were allocated from the heap since creation</returns>
+        size_t get_block_allocations() const { return block_allocations; }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    /// <summary>
+    /// Memory for data that only lives for a frame: draw lists, query results and formatted text. Use it through
+    /// std::pmr containers, for example std::pmr::vector&lt;int&gt; values(frame_arena::get()).
+    /// </summary>
+    /// <remarks>
+    /// Every thread allocates from its own pair of linear_arenas, so allocating takes no lock. The pair is double
+    /// buffered: the first allocation a thread makes in a new frame resets the arena it last used two frames ago
+    /// and switches to it. Memory from frame_arena is therefore valid until the end of the frame after the one it
+    /// was allocated in, long enough for a job or a fixed update that runs across the frame boundary, but nothing
+    /// that's kept longer may use it.
+    /// </remarks>
+    class frame_arena
+    {
+    private:
+        frame_arena() {} // Force as a static class
+
+    public:
+        /// <summary>
+        /// Start a new frame, application::main_loop calls this at the start of every frame. The threads' arenas
+        /// are reset by the threads themselves, on their next allocation.
+        /// </summary>
+        static void next_frame();
+
+        /// <returns>The frame started by the last next_frame()</returns>
+        static unsigned long long get_frame();
+
+        /// <returns>The calling thread's arena for the current frame</returns>
+        static std::pmr::memory_resource* get();
+
+        /// <returns>The calling thread's arena for the current frame, for its statistics</returns>
+        static const linear_arena& get_thread_arena();
+    };
+
+}
@@ -0,0 +1,74 @@
+#include "frame_limiter.h"
+#include <algorithm>
+#include <thread>
+
+using namespace isometric::tools;
+
+void frame_limiter::set_target_frame_rate(double frames_per_second)
+{
+    interval_ticks = frames_per_second > 0.0
+        ? static_cast<Uint64>(static_cast<double>(SDL_GetPerformanceFrequency()) / frames_per_second)
+        : 0;
+
+    reset();
+}
+
+double frame_limiter::get_target_frame_rate() const
+{
+    return interval_ticks > 0 ? static_cast<double>(SDL_GetPerformanceFrequency()) / interval_ticks : 0.0;
+}
+
+double frame_limiter::get_spin_ms() const
+{
+    return std::clamp(oversleep_ms + min_spin_ms, min_spin_ms, max_spin_ms);
+}
+
+double frame_limiter::wait()
+{
+    last_wait_ms = 0.0;
+    if (!is_enabled()) return 0.0;
+
+    const double ticks_per_ms = static_cast<double>(SDL_GetPerformanceFrequency()) / 1000.0;
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    if (next_deadline == 0)
+    {
+        next_deadline = start + interval_ticks;
+        return 0.0;
+    }
+
+    if (start >= next_deadline)
+    {
+        missed_deadlines++;
+
+        // Late by less than an interval, the schedule is kept and the next frame has the rest of its interval:
+        next_deadline = start - next_deadline < interval_ticks ? next_deadline + interval_ticks : start + interval_ticks;
+        return 0.0;
+    }
+
+    // Sleep while there's more time left than a sleep might overshoot by:
+    for (;;)
+    {
+        const Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= next_deadline) break;
+
+        const double remaining_ms = (next_deadline - now) / ticks_per_ms;
+        const double sleep_ms = remaining_ms - get_spin_ms();
+        if (sleep_ms < 1.0) break;
+
+        const Uint32 requested_ms = static_cast<Uint32>(sleep_ms);
+        SDL_Delay(requested_ms);
+
+        // Lateness is learned quickly and forgotten slowly, one late wake up costs more than a little spinning:
+        const double overslept_ms = (SDL_GetPerformanceCounter() - now) / ticks_per_ms - requested_ms;
+        oversleep_ms = std::max(std::max(overslept_ms, 0.0), oversleep_ms * 0.98);
+    }
+
+    // Spin out the rest, yielding so another thread ready on this core can still run:
+    while (SDL_GetPerformanceCounter() < next_deadline) std::this_thread::yield();
+
+    next_deadline += interval_ticks;
+
+    last_wait_ms = (SDL_GetPerformanceCounter() - start) / ticks_per_ms;
+    return last_wait_ms;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <SDL.h>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Holds the main loop to a target frame rate. Frames are paced against a schedule of deadlines one interval
+    /// apart rather than from the end of each frame, so a short frame doesn't shorten the next interval and the
+    /// rate doesn't drift. Waiting sleeps for most of the remaining time and spins for the rest, since a sleep can
+    /// wake late by a scheduler tick or more; how late sleeps actually wake is measured and sets how long to spin.
+    /// </summary>
+    class frame_limiter
+    {
+    private:
+        static constexpr double min_spin_ms = 0.25;
+        static constexpr double max_spin_ms = 4.0;
+
+        Uint64 interval_ticks = 0;      // 0 to not limit
+        Uint64 next_deadline = 0;       // 0 until the first wait
+        double oversleep_ms = 1.0;      // Worst recent lateness of SDL_Delay, decays slowly
+        double last_wait_ms = 0.0;
+        unsigned long long missed_deadlines = 0;
+
+    public:
+        /// <param name="frames_per_second">0 to not limit</param>
+        void set_target_frame_rate(double frames_per_second);
+        double get_target_frame_rate() const;
+        bool is_enabled() const { return interval_ticks > 0; }
+
+        /// <summary>
+        /// Start a new schedule from the next wait, after a pause or a change in rate
+        /// </summary>
+        void reset() { next_deadline = 0; }
+
+        /// <summary>
+        /// Wait until the current frame's deadline and schedule the next one. A frame that's later than a whole
+        /// interval starts a new schedule instead of rushing the following frames to catch up.
+        /// </summary>
+        /// <returns>Milliseconds waited</returns>
+        double wait();
+
+        double get_last_wait_ms() const { return last_wait_ms; }
+
+        /// <returns>How long each wait spins at the end, after sleeping</returns>
+        double get_spin_ms() const;
+
+        /// <returns>Frames that finished after their deadline</returns>
+        unsigned long long get_missed_deadlines() const { return missed_deadlines; }
+    };
+
+}
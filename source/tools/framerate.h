@@ -1,108 +1,311 @@
 #pragma once
 #include <vector>
-#include <numeric>
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 namespace isometric::tools {
 
-    class framerate {
+    /// <summary>
+    /// Counts frame times in fixed buckets of bucket_ms up to bucket_count * bucket_ms, longer frames share one
+    /// overflow bucket. Adding and removing are O(1) and percentiles scan the fixed number of buckets.
+    /// </summary>
+    class frame_time_histogram
+    {
+    public:
+        static constexpr double bucket_ms = 0.1;
+        static constexpr size_t bucket_count = 1000;    // Up to 100 ms, plus the overflow bucket
+
     private:
-        double current = 0.0;
-        double minimum = 0.0;
-        double maximum = 0.0;
-        double overall_average = 0.0;
+        std::array<uint32_t, bucket_count + 1> buckets{};
+        uint64_t count = 0;
 
-        size_t max_history = 1000;
-        size_t history_cursor = 0;
-        std::vector<double> history;
+        static size_t get_bucket(double frame_ms)
+        {
+            if (!(frame_ms > 0.0)) return 0;
+            return std::min(static_cast<size_t>(frame_ms / bucket_ms), bucket_count);
+        }
 
     public:
+        void add(double frame_ms)
+        {
+            buckets[get_bucket(frame_ms)]++;
+            count++;
+        }
 
         /// <summary>
-        /// Set the current framerate so that it can be used in calculations
+        /// Remove a frame time that was added before
         /// </summary>
-        /// <param name="fps">Current frames per second</param>
-        void set(double fps)
+        void remove(double frame_ms)
+        {
+            uint32_t& bucket = buckets[get_bucket(frame_ms)];
+            if (bucket == 0) return;
+
+            bucket--;
+            count--;
+        }
+
+        void clear()
         {
-            current = fps;
+            buckets.fill(0);
+            count = 0;
+        }
 
-            // If the current framerate is greater or equalt to 5 and less than the minimum, set it, unless
-            // the minimum is still below 5, then it should be equivalent to current until it gets higher.
-            // 
-            // This is to prevent the minimum framerate always being super low, as that's expected when the engine
-            // is starting up or shutting down.
-            if (minimum < 5.0 || (current >= 5.0 && current < minimum)) minimum = current;
+        uint64_t size() const { return count; }
 
-            // Set the maximum framerate, unless the application is still considered starting up (that is before
-            // the framerate history has had a chance to fill up).
-            if (current > maximum && history.size() >= max_history) maximum = current;
+        /// <param name="fraction">0.5 for the median, 0.99 for the 99th percentile</param>
+        /// <param name="overflow_ms">Returned when the percentile falls in the overflow bucket</param>
+        /// <returns>The middle of the bucket holding the percentile, or 0 without frames</returns>
+        double get_percentile(double fraction, double overflow_ms) const
+        {
+            if (count == 0) return 0.0;
+
+            const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * count)), 1, count);
+            uint64_t seen = 0;
 
-            // Used to calculate the current average (not the overall average). Do this by keeping a history of past 
-            // framerates.
-            if (history.size() != max_history)
+            for (size_t i = 0; i < bucket_count; i++)
             {
-                history.resize(max_history, 0.0);
+                seen += buckets[i];
+                if (seen >= rank) return (static_cast<double>(i) + 0.5) * bucket_ms;
             }
 
-            history[history_cursor] = current;
+            return overflow_ms;
+        }
+    };
+
+    /// <summary>
+    /// Frame time statistics over a span of frames, in milliseconds
+    /// </summary>
+    struct frame_time_summary
+    {
+        uint64_t frames = 0;
+        double average_ms = 0.0;
+        double p50_ms = 0.0;
+        double p95_ms = 0.0;
+        double p99_ms = 0.0;
+        double max_ms = 0.0;
+        uint64_t jank_frames = 0;   // Frames that took longer than the frame budget
+    };
+
+    /// <summary>
+    /// Tracks frame times over a sliding window of recent frames and over every recorded frame. Recording a frame
+    /// and every query are O(1), percentiles come from fixed bucket histograms so they're accurate to
+    /// frame_time_histogram::bucket_ms.
+    /// </summary>
+    class framerate {
+    private:
+        double current_ms = 0.0;
+        double frame_budget_ms = 1000.0 / 60.0;
+
+        // The last window_size frames, window is a ring indexed by frame number:
+        size_t window_size = 1000;
+        std::vector<float> window;
+        uint64_t recorded = 0;                  // Frames ever recorded, the next one is written to recorded % window_size
+        double window_sum_ms = 0.0;
+        uint64_t window_jank = 0;
+        frame_time_histogram window_histogram;
+
+        // Frame numbers in the window whose times decrease from front to back, so the front is always the window's
+        // longest frame. A ring of window_size entries:
+        std::vector<uint64_t> window_max_queue;
+        uint64_t max_queue_front = 0;
+        uint64_t max_queue_back = 0;
+
+        // Every frame:
+        double overall_sum_ms = 0.0;
+        double overall_min_ms = 0.0;
+        double overall_max_ms = 0.0;
+        uint64_t overall_jank = 0;
+        frame_time_histogram overall_histogram;
+
+        void reset_window()
+        {
+            window.assign(window_size, 0.0F);
+            window_max_queue.assign(window_size, 0);
+            max_queue_front = 0;
+            max_queue_back = 0;
+            window_sum_ms = 0.0;
+            window_jank = 0;
+            window_histogram.clear();
+            recorded = 0;
+        }
+
+        uint64_t get_window_frames() const
+        {
+            return std::min<uint64_t>(recorded, window_size);
+        }
+
+        double get_window_max_ms() const
+        {
+            if (max_queue_back == max_queue_front) return 0.0;
+            return window[window_max_queue[max_queue_front % window_size] % window_size];
+        }
+
+        frame_time_summary summarize(const frame_time_histogram& histogram, uint64_t frames, double sum_ms, double max_ms, uint64_t jank) const
+        {
+            frame_time_summary summary;
+            if (frames == 0) return summary;
+
+            summary.frames = frames;
+            summary.average_ms = sum_ms / static_cast<double>(frames);
+            summary.p50_ms = std::min(histogram.get_percentile(0.50, max_ms), max_ms);
+            summary.p95_ms = std::min(histogram.get_percentile(0.95, max_ms), max_ms);
+            summary.p99_ms = std::min(histogram.get_percentile(0.99, max_ms), max_ms);
+            summary.max_ms = max_ms;
+            summary.jank_frames = jank;
+            return summary;
+        }
+
+    public:
+
+        /// <summary>
+        /// Record the time a frame took
+        /// </summary>
+        /// <param name="frame_ms">The duration of the frame in milliseconds</param>
+        void add_frame_time(double frame_ms)
+        {
+            if (window.size() != window_size) reset_window();
+
+            // Stored as it's kept in the window, so removing it later subtracts exactly what was added:
+            const float time = static_cast<float>(std::max(frame_ms, 0.0));
+            const uint64_t frame = recorded++;
+            float& slot = window[frame % window_size];
 
-            // Increment the history cursor if it's within range:
-            history_cursor =
-                history_cursor < max_history - 1
-                ? history_cursor + 1
-                : 0;
+            if (frame >= window_size)
+            {
+                // The frame leaving the window:
+                window_sum_ms -= slot;
+                window_histogram.remove(slot);
+                if (slot > frame_budget_ms) window_jank--;
+
+                if (max_queue_back != max_queue_front && window_max_queue[max_queue_front % window_size] + window_size <= frame)
+                {
+                    max_queue_front++;
+                }
+            }
 
-            // Keep a caluclation of the overall average framerate. Ignore any values below 5 in the calculation.
-            if (overall_average <= 0.1 || current <= 5.0) overall_average = current;
-            else
+            slot = time;
+            window_sum_ms += time;
+            window_histogram.add(time);
+            if (time > frame_budget_ms) window_jank++;
+
+            while (max_queue_back != max_queue_front && window[window_max_queue[(max_queue_back - 1) % window_size] % window_size] <= time)
             {
-                overall_average = (overall_average + current) / 2.0;
+                max_queue_back--;
             }
+
+            window_max_queue[max_queue_back % window_size] = frame;
+            max_queue_back++;
+
+            if (overall_histogram.size() == 0 || time < overall_min_ms) overall_min_ms = time;
+            overall_max_ms = std::max(overall_max_ms, static_cast<double>(time));
+            overall_sum_ms += time;
+            overall_histogram.add(time);
+            if (time > frame_budget_ms) overall_jank++;
+
+            current_ms = time;
+        }
+
+        /// <summary>
+        /// Record a frame by its framerate
+        /// </summary>
+        /// <param name="fps">Current frames per second</param>
+        void set(double fps)
+        {
+            if (fps > 0.0) add_frame_time(1000.0 / fps);
         }
 
         /// <summary>
-        /// Set the current framerate by calculating it with delta time.
+        /// Record a frame by its delta time
         /// </summary>
         /// <param name="delta_time">The duration in seconds for a single frame</param>
         void set_from_delta(double delta_time)
         {
-            set(calculate(delta_time));
+            add_frame_time(delta_time * 1000.0);
+        }
+
+        /// <summary>
+        /// Frames longer than the budget count as jank. Defaults to a 60 Hz frame.
+        /// </summary>
+        void set_frame_budget_ms(double budget_ms)
+        {
+            frame_budget_ms = budget_ms;
+
+            // The window's count is kept incrementally against the budget, so recount it:
+            window_jank = 0;
+            const uint64_t frames = get_window_frames();
+            for (uint64_t i = 0; i < frames; i++) if (window[(recorded - 1 - i) % window_size] > frame_budget_ms) window_jank++;
+        }
+
+        double get_frame_budget_ms() const { return frame_budget_ms; }
+
+        /// <summary>
+        /// Change how many recent frames the window statistics cover, which forgets the frames in the window
+        /// </summary>
+        void set_window_size(size_t frames)
+        {
+            window_size = std::max<size_t>(frames, 1);
+            reset_window();
+        }
+
+        size_t get_window_size() const { return window_size; }
+
+        /// <returns>The duration of the last frame in milliseconds</returns>
+        double get_frame_time_ms() const
+        {
+            return current_ms;
+        }
+
+        /// <returns>The frame time statistics of the last get_window_size() frames</returns>
+        frame_time_summary get_window_summary() const
+        {
+            return summarize(window_histogram, get_window_frames(), window_sum_ms, get_window_max_ms(), window_jank);
+        }
+
+        /// <returns>The frame time statistics of every frame recorded</returns>
+        frame_time_summary get_overall_summary() const
+        {
+            return summarize(overall_histogram, overall_histogram.size(), overall_sum_ms, overall_max_ms, overall_jank);
+        }
+
+        /// <returns>The number of frames recorded that took longer than the frame budget</returns>
+        uint64_t get_jank_count() const
+        {
+            return overall_jank;
         }
 
         /// <returns>The curent frames per second</returns>
         double get() const
         {
-            return current;
+            return calculate(current_ms / 1000.0);
         }
 
-        /// <returns>The lowest frames per second for the duration of this framerate object</returns>
+        /// <returns>The frames per second of the longest frame recorded</returns>
         double get_minimum() const
         {
-            return minimum;
+            return calculate(overall_max_ms / 1000.0);
         }
 
-        /// <returns>The highest frames per second for the duration of this framerate object</returns>
+        /// <returns>The frames per second of the shortest frame recorded</returns>
         double get_maximum() const
         {
-            return maximum;
+            return calculate(overall_min_ms / 1000.0);
         }
 
-        /// <returns>The average frames per second using a history of framerates for a finite amount of frames</returns>
+        /// <returns>The average frames per second over the last get_window_size() frames</returns>
         double get_average() const
         {
-            if (history.size() < 2) return current;
-
-            return std::accumulate(
-                history.begin(),
-                history.end(),
-                0.0 //initial value of the sum
-            ) / history.size();
+            const uint64_t frames = get_window_frames();
+            return frames > 0 ? calculate(window_sum_ms / 1000.0 / static_cast<double>(frames)) : 0.0;
         }
 
-        /// <returns>The overall average frames per second for the duration of this framerate object</returns>
+        /// <returns>The average frames per second over every frame recorded</returns>
         double get_overall_average() const
         {
-            return overall_average;
+            const uint64_t frames = overall_histogram.size();
+            return frames > 0 ? calculate(overall_sum_ms / 1000.0 / static_cast<double>(frames)) : 0.0;
         }
 
         /// <summary>
@@ -116,9 +319,9 @@ namespace isometric::tools {
             return 1.0 / delta_time;
         }
 
-        operator double() const { return current; }
-        operator float() const { return static_cast<float>(current); }
-        operator unsigned() const { return static_cast<unsigned>(current); }
+        operator double() const { return get(); }
+        operator float() const { return static_cast<float>(get()); }
+        operator unsigned() const { return static_cast<unsigned>(get()); }
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,235 @@
+#include "job_system.h"
+#include "profiler.h"
+#include <SDL.h>
+#include <string>
+#include <chrono>
+#include <iterator>
+
+using namespace isometric::tools;
+
+job_system* job_system::current = nullptr;
+
+// The queue owned by the worker running on this thread, or the shared queue for every other thread:
+static thread_local size_t this_thread_queue = 0;
+static thread_local bool this_thread_is_worker = false;
+
+job_system::job_system(unsigned worker_count)
+{
+    if (worker_count == 0)
+    {
+        worker_count = std::max(1U, std::thread::hardware_concurrency()) - 1U;
+    }
+
+    // Jobs nobody waits on, like asset loads, only ever finish on a worker:
+    worker_count = std::max(1U, worker_count);
+
+    // Index 0 is the shared queue for non-worker threads, workers own 1..worker_count:
+    for (unsigned i = 0; i <= worker_count; i++)
+    {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    for (unsigned i = 1; i <= worker_count; i++)
+    {
+        workers.emplace_back(&job_system::worker_main, this, static_cast<size_t>(i));
+    }
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Job system started with %u worker threads", worker_count);
+}
+
+job_system::~job_system()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (current == this) current = nullptr;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Job system stopped");
+}
+
+unsigned job_system::get_worker_count() const
+{
+    return static_cast<unsigned>(workers.size());
+}
+
+void job_system::run(job_group& group, std::function<void()> func)
+{
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Workers push to their own queue so nested jobs stay local, other threads spread jobs over every queue:
+    size_t queue_index = this_thread_is_worker
+        ? this_thread_queue
+        : submit_cursor.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock(queues[queue_index]->mutex);
+        queues[queue_index]->jobs.push_back(job{ std::move(func), &group });
+    }
+
+    notify_queued();
+}
+
+void job_system::run_background(job_group& group, std::function<void()> func)
+{
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(background.mutex);
+        background.jobs.push_back(job{ std::move(func), &group });
+    }
+
+    notify_queued();
+}
+
+void job_system::notify_queued()
+{
+    queued_count.fetch_add(1, std::memory_order_release);
+
+    {
+        // Taking the lock orders this notify after a worker's check of queued_count, so the wake isn't lost:
+        std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake.notify_one();
+}
+
+void job_system::wait(job_group& group)
+{
+    constexpr int spins_before_sleeping = 64;   // Most jobs waited on in a frame are short, sleeping costs more
+
+    const size_t preferred_queue = this_thread_is_worker ? this_thread_queue : 0;
+    int spins = 0;
+
+    while (!group.is_done())
+    {
+        // Helping with other jobs could run something slow, or blocking, on a thread that only wanted this group:
+        if (try_run_one(preferred_queue, &group))
+        {
+            spins = 0;
+            continue;
+        }
+
+        // The remaining jobs are running on other threads, or are background jobs left to the workers:
+        if (++spins < spins_before_sleeping)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Jobs running now may still queue more jobs for the group, the timeout picks those up to help with:
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done.wait_for(lock, std::chrono::milliseconds(1), [&group]() { return group.is_done(); });
+        spins = 0;
+    }
+}
+
+void job_system::worker_main(size_t worker_index)
+{
+    this_thread_queue = worker_index;
+    this_thread_is_worker = true;
+    ISOMETRIC_PROFILE_THREAD("worker " + std::to_string(worker_index));
+
+    while (true)
+    {
+        if (try_run_one(worker_index, nullptr)) continue;
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        wake.wait(lock, [this]() { return stopping || queued_count.load(std::memory_order_acquire) > 0; });
+
+        if (stopping && queued_count.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+bool job_system::try_run_one(size_t preferred_queue, const job_group* only_group)
+{
+    job j;
+
+    // Newest job of our own queue first, it's most likely to still be in cache:
+    if (try_pop(*queues[preferred_queue], false, only_group, j))
+    {
+        execute(j);
+        return true;
+    }
+
+    // Then steal the oldest job from the other queues:
+    for (size_t offset = 1; offset < queues.size(); offset++)
+    {
+        if (try_pop(*queues[(preferred_queue + offset) % queues.size()], true, only_group, j))
+        {
+            execute(j);
+            return true;
+        }
+    }
+
+    // Background jobs last, and only on workers that aren't waiting on a group of their own:
+    if (!only_group && try_pop(background, true, nullptr, j))
+    {
+        execute(j);
+        return true;
+    }
+
+    return false;
+}
+
+bool job_system::try_pop(worker_queue& queue, bool steal, const job_group* only_group, job& out)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.jobs.empty()) return false;
+
+    if (only_group)
+    {
+        // Same order as below, but skipping the jobs of other groups:
+        auto matches = [only_group](const job& j) { return j.group == only_group; };
+
+        auto found = queue.jobs.end();
+        if (steal)
+        {
+            found = std::find_if(queue.jobs.begin(), queue.jobs.end(), matches);
+        }
+        else
+        {
+            auto reverse_found = std::find_if(queue.jobs.rbegin(), queue.jobs.rend(), matches);
+            if (reverse_found != queue.jobs.rend()) found = std::prev(reverse_found.base());
+        }
+
+        if (found == queue.jobs.end()) return false;
+
+        out = std::move(*found);
+        queue.jobs.erase(found);
+    }
+    else if (steal)
+    {
+        out = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+    }
+    else
+    {
+        out = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+    }
+
+    queued_count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void job_system::execute(job& j)
+{
+    j.func();
+
+    // The group may be gone as soon as a waiter sees it done, only the job system is touched after this:
+    if (j.group->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    {
+        // Taking the lock orders this notify after a waiter's check of the group, so the wake isn't lost:
+        std::lock_guard<std::mutex> lock(done_mutex);
+    }
+    done.notify_all();
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Tracks a set of jobs so they can be waited on together. A group must outlive the jobs added to it.
+    /// </summary>
+    class job_group
+    {
+        friend class job_system;
+    private:
+        std::atomic<size_t> pending = 0;
+
+    public:
+        job_group() {}
+        job_group(const job_group&) = delete;
+        job_group& operator=(const job_group&) = delete;
+
+        /// <returns>True once every job added to this group has finished</returns>
+        bool is_done() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+    /// <summary>
+    /// A work-stealing thread pool. Every worker owns a queue, takes its newest job first and steals the oldest
+    /// job of another worker when it runs out. Threads waiting on a group run that group's queued jobs instead of
+    /// blocking, so jobs may add and wait on their own jobs. Background jobs, such as file I/O and decoding, have
+    /// a queue of their own that only workers take from, once they have nothing else to do.
+    /// </summary>
+    /// <remarks>
+    /// SDL rendering isn't thread safe, jobs must not call into the SDL_Renderer.
+    /// </remarks>
+    class job_system
+    {
+    private:
+        struct job
+        {
+            std::function<void()> func;
+            job_group* group = nullptr;
+        };
+
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<job> jobs;
+        };
+
+        static job_system* current; // Set by the application, used by tools::parallel_for
+
+        std::vector<std::unique_ptr<worker_queue>> queues; // One per worker plus one for non-worker threads
+        worker_queue background;                            // See run_background, never helped with by waiters
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queued_count = 0;
+        std::atomic<size_t> submit_cursor = 0;
+        std::atomic<bool> stopping = false;
+
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+
+        std::mutex done_mutex;
+        std::condition_variable done;   // A group finished, see wait
+
+    public:
+        /// <param name="worker_count">Worker threads to start, 0 to use one less than the hardware threads. At least one is always started.</param>
+        explicit job_system(unsigned worker_count = 0);
+        ~job_system();
+
+        job_system(const job_system&) = delete;
+        job_system& operator=(const job_system&) = delete;
+
+        /// <returns>The number of worker threads, excluding threads that help out while waiting</returns>
+        unsigned get_worker_count() const;
+
+        /// <summary>
+        /// Queue a job, it may start immediately on a worker
+        /// </summary>
+        void run(job_group& group, std::function<void()> func);
+
+        /// <summary>
+        /// Queue a job that may block, like reading a file. Only workers run it, so a thread waiting on other work,
+        /// such as rendering, never ends up running it. Waiting on the group blocks until a worker is done with it.
+        /// </summary>
+        void run_background(job_group& group, std::function<void()> func);
+
+        /// <summary>
+        /// Run the group's queued jobs on the calling thread until every job in the group has finished. Once none
+        /// are left to run, it spins briefly and then sleeps until the jobs running on other threads are done.
+        /// </summary>
+        void wait(job_group& group);
+
+        /// <summary>
+        /// Call func(index) for every index in [0, count) across the workers and the calling thread, in blocks of
+        /// grain_size indices. Returns once every index has been processed.
+        /// </summary>
+        template<class F> void parallel_for(size_t count, F&& func, size_t grain_size = 1);
+
+        /// <returns>The job system used by tools::parallel_for, or nullptr if none has been set</returns>
+        static job_system* get_current() { return current; }
+        static void set_current(job_system* jobs) { current = jobs; }
+
+    private:
+        void worker_main(size_t worker_index);
+        void notify_queued();
+
+        /// <param name="only_group">Only run a job of this group, nullptr for any job including background ones</param>
+        bool try_run_one(size_t preferred_queue, const job_group* only_group);
+        bool try_pop(worker_queue& queue, bool steal, const job_group* only_group, job& out);
+        void execute(job& j);
+    };
+
+    template<class F>
+    inline void job_system::parallel_for(size_t count, F&& func, size_t grain_size)
+    {
+        if (count == 0) return;
+
+        grain_size = std::max<size_t>(grain_size, 1);
+        const size_t block_count = (count + grain_size - 1) / grain_size;
+
+        job_group group;
+        for (size_t block = 0; block < block_count; block++)
+        {
+            run(group, [&func, block, grain_size, count]()
+            {
+                const size_t end = std::min(count, (block + 1) * grain_size);
+                for (size_t index = block * grain_size; index < end; index++)
+                {
+                    func(index);
+                }
+            });
+        }
+
+        wait(group);
+    }
+
+}
@@ -0,0 +1,120 @@
+#include "memory_mapped_file.h"
+#include <SDL.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace isometric::tools;
+
+memory_mapped_file::~memory_mapped_file()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool memory_mapped_file::open(const std::string& path, bool sequential)
+{
+    close();
+
+    const DWORD access_hint = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, access_hint, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create a file mapping for '%s' (error %lu)", path.c_str(), GetLastError());
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map a view of '%s' (error %lu)", path.c_str(), GetLastError());
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    return true;
+}
+
+void memory_mapped_file::close()
+{
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+
+    data = nullptr;
+    size = 0;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+
+#else
+
+bool memory_mapped_file::open(const std::string& path, bool sequential)
+{
+    close();
+
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat file_stat {};
+    if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (view == MAP_FAILED)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map '%s'", path.c_str());
+        ::close(descriptor);
+        return false;
+    }
+
+    // Start reading the whole file in the background, instead of a page at a time as it's touched:
+    if (sequential) madvise(view, static_cast<size_t>(file_stat.st_size), MADV_WILLNEED);
+
+    file_descriptor = descriptor;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(file_stat.st_size);
+
+    return true;
+}
+
+void memory_mapped_file::close()
+{
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    if (file_descriptor >= 0) ::close(file_descriptor);
+
+    data = nullptr;
+    size = 0;
+    file_descriptor = -1;
+}
+
+#endif
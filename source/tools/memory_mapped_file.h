@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// A read-only view of a whole file mapped into memory. Pages are read by the OS on first access, so opening a
+    /// large file is cheap and only the parts that are used are ever read from disk.
+    /// </summary>
+    class memory_mapped_file
+    {
+    private:
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+
+#ifdef _WIN32
+        void* file_handle = nullptr;
+        void* mapping_handle = nullptr;
+#else
+        int file_descriptor = -1;
+#endif
+
+    public:
+        memory_mapped_file() {}
+        ~memory_mapped_file();
+
+        memory_mapped_file(const memory_mapped_file&) = delete;
+        memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+
+        /// <summary>
+        /// Map a file, closing any file that is already open
+        /// </summary>
+        /// <param name="sequential">The file will be read front to back once, so the OS reads ahead of the reader</param>
+        /// <returns>False if the file doesn't exist or couldn't be mapped</returns>
+        bool open(const std::string& path, bool sequential = false);
+        void close();
+
+        bool is_open() const { return data != nullptr; }
+
+        const uint8_t* get_data() const { return data; }
+        size_t get_size() const { return size; }
+    };
+
+}
@@ -0,0 +1,227 @@
+#include "memory_tracker.h"
+#include <memory>
+#include <mutex>
+
+using namespace isometric::tools;
+
+namespace {
+
+    constexpr double bytes_per_mb = 1024.0 * 1024.0;
+
+    // Categories are never destroyed, so references to them stay valid while more are added:
+    struct category_registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<memory_category>> categories;
+    };
+
+    category_registry& get_registry()
+    {
+        // Never destroyed either, so whatever static destructors free can still be uncounted:
+        static category_registry* registry = new category_registry();
+        return *registry;
+    }
+
+    void raise_peak(std::atomic<size_t>& peak, size_t value)
+    {
+        size_t current = peak.load(std::memory_order_relaxed);
+        while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+}
+
+void memory_category::grow(std::atomic<size_t>& bytes, std::atomic<size_t>& peak, const std::atomic<size_t>& budget,
+    size_t added, const char* kind)
+{
+    if (added == 0) return;
+
+    const size_t after = bytes.fetch_add(added, std::memory_order_relaxed) + added;
+    raise_peak(peak, after);
+
+    // Only the allocation that crosses the budget warns, so a category staying over it doesn't flood the log:
+    const size_t limit = budget.load(std::memory_order_relaxed);
+    if (limit > 0 && after > limit && after - added <= limit)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Memory category [%s] is over its %s budget: %.2f MB of %.2f MB",
+            name.c_str(), kind, after / bytes_per_mb, limit / bytes_per_mb);
+    }
+}
+
+void memory_category::add(size_t cpu_bytes, size_t gpu_bytes)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    grow(this->cpu_bytes, peak_cpu_bytes, cpu_budget, cpu_bytes, "CPU");
+    grow(this->gpu_bytes, peak_gpu_bytes, gpu_budget, gpu_bytes, "GPU");
+}
+
+void memory_category::remove(size_t cpu_bytes, size_t gpu_bytes)
+{
+    allocations.fetch_sub(1, std::memory_order_relaxed);
+    this->cpu_bytes.fetch_sub(cpu_bytes, std::memory_order_relaxed);
+    this->gpu_bytes.fetch_sub(gpu_bytes, std::memory_order_relaxed);
+}
+
+void memory_category::add_texture(SDL_Texture* texture)
+{
+    if (texture) add(0, memory_tracker::get_texture_bytes(texture));
+}
+
+void memory_category::remove_texture(SDL_Texture* texture)
+{
+    if (texture) remove(0, memory_tracker::get_texture_bytes(texture));
+}
+
+void memory_category::add_surface(SDL_Surface* surface)
+{
+    if (surface) add(static_cast<size_t>(surface->pitch) * surface->h);
+}
+
+void memory_category::remove_surface(SDL_Surface* surface)
+{
+    if (surface) remove(static_cast<size_t>(surface->pitch) * surface->h);
+}
+
+void memory_category::set_budget(size_t cpu_bytes, size_t gpu_bytes)
+{
+    cpu_budget.store(cpu_bytes, std::memory_order_relaxed);
+    gpu_budget.store(gpu_bytes, std::memory_order_relaxed);
+
+    if ((cpu_bytes > 0 && get_cpu_bytes() > cpu_bytes) || (gpu_bytes > 0 && get_gpu_bytes() > gpu_bytes))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Memory category [%s] is already over its new budget", name.c_str());
+    }
+}
+
+memory_category& memory_tracker::get_category(std::string_view name)
+{
+    category_registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (const auto& category : registry.categories)
+    {
+        if (category->name == name) return *category;
+    }
+
+    registry.categories.push_back(std::unique_ptr<memory_category>(new memory_category(std::string(name))));
+    return *registry.categories.back();
+}
+
+memory_category& memory_tracker::tiles()
+{
+    static memory_category& category = get_category("tiles");
+    return category;
+}
+
+memory_category& memory_tracker::images()
+{
+    static memory_category& category = get_category("images");
+    return category;
+}
+
+memory_category& memory_tracker::fonts()
+{
+    static memory_category& category = get_category("fonts");
+    return category;
+}
+
+memory_category& memory_tracker::glyph_atlases()
+{
+    static memory_category& category = get_category("glyph atlases");
+    return category;
+}
+
+memory_category& memory_tracker::text_textures()
+{
+    static memory_category& category = get_category("text textures");
+    return category;
+}
+
+memory_category& memory_tracker::render_targets()
+{
+    static memory_category& category = get_category("render targets");
+    return category;
+}
+
+memory_category& memory_tracker::frame_arenas()
+{
+    static memory_category& category = get_category("frame arena");
+    return category;
+}
+
+void memory_tracker::set_budget(const memory_budget& budget)
+{
+    get_category(budget.category).set_budget(budget.cpu_bytes, budget.gpu_bytes);
+}
+
+std::vector<memory_report> memory_tracker::get_report()
+{
+    category_registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::vector<memory_report> report;
+    report.reserve(registry.categories.size());
+
+    for (const auto& category : registry.categories)
+    {
+        memory_report& entry = report.emplace_back();
+        entry.name = category->name;
+        entry.cpu_bytes = category->get_cpu_bytes();
+        entry.gpu_bytes = category->get_gpu_bytes();
+        entry.peak_cpu_bytes = category->peak_cpu_bytes.load(std::memory_order_relaxed);
+        entry.peak_gpu_bytes = category->peak_gpu_bytes.load(std::memory_order_relaxed);
+        entry.allocations = category->get_allocations();
+        entry.cpu_budget = category->cpu_budget.load(std::memory_order_relaxed);
+        entry.gpu_budget = category->gpu_budget.load(std::memory_order_relaxed);
+    }
+
+    return report;
+}
+
+size_t memory_tracker::get_total_cpu_bytes()
+{
+    category_registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    size_t total = 0;
+    for (const auto& category : registry.categories) total += category->get_cpu_bytes();
+    return total;
+}
+
+size_t memory_tracker::get_total_gpu_bytes()
+{
+    category_registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    size_t total = 0;
+    for (const auto& category : registry.categories) total += category->get_gpu_bytes();
+    return total;
+}
+
+void memory_tracker::log_report()
+{
+    const std::vector<memory_report> report = get_report();
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Memory: %.2f MB CPU, %.2f MB GPU over %zu categories",
+        get_total_cpu_bytes() / bytes_per_mb, get_total_gpu_bytes() / bytes_per_mb, report.size());
+
+    for (const memory_report& entry : report)
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+            "  %-16s CPU %9.2f MB (peak %9.2f) | GPU %9.2f MB (peak %9.2f) | %zu allocations%s",
+            entry.name.c_str(),
+            entry.cpu_bytes / bytes_per_mb, entry.peak_cpu_bytes / bytes_per_mb,
+            entry.gpu_bytes / bytes_per_mb, entry.peak_gpu_bytes / bytes_per_mb,
+            entry.allocations, entry.is_over_budget() ? " | OVER BUDGET" : "");
+    }
+}
+
+size_t memory_tracker::get_texture_bytes(SDL_Texture* texture)
+{
+    Uint32 format = 0;
+    int width = 0, height = 0;
+    if (!texture || SDL_QueryTexture(texture, &format, nullptr, &width, &height) != 0) return 0;
+
+    // Planar YUV formats report 0 bytes per pixel, for them this is an overestimate:
+    const int bytes_per_pixel = SDL_BYTESPERPIXEL(format) > 0 ? SDL_BYTESPERPIXEL(format) : 4;
+    return static_cast<size_t>(width) * height * bytes_per_pixel;
+}
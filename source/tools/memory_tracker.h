@@ -0,0 +1,140 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// A budget for one memory_category, 0 for no limit
+    /// </summary>
+    struct memory_budget
+    {
+        std::string category;
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+    };
+
+    /// <summary>
+    /// A copy of one memory_category's counters at the time of memory_tracker::get_report
+    /// </summary>
+    struct memory_report
+    {
+        std::string name;
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+        size_t peak_cpu_bytes = 0;
+        size_t peak_gpu_bytes = 0;
+        size_t allocations = 0;     // Live allocations, a count that only grows over a long session is a leak
+        size_t cpu_budget = 0;
+        size_t gpu_budget = 0;
+
+        bool is_over_budget() const
+        {
+            return (cpu_budget > 0 && cpu_bytes > cpu_budget) || (gpu_budget > 0 && gpu_bytes > gpu_budget);
+        }
+    };
+
+    /// <summary>
+    /// The memory one subsystem holds: CPU bytes and the estimated VRAM of its textures. The subsystem adds what it
+    /// allocates and removes what it frees, the counters are atomic so any thread may do either.
+    /// </summary>
+    class memory_category
+    {
+        friend class memory_tracker;
+    private:
+        std::string name;
+        std::atomic<size_t> cpu_bytes = 0;
+        std::atomic<size_t> gpu_bytes = 0;
+        std::atomic<size_t> peak_cpu_bytes = 0;
+        std::atomic<size_t> peak_gpu_bytes = 0;
+        std::atomic<size_t> allocations = 0;
+        std::atomic<size_t> cpu_budget = 0;
+        std::atomic<size_t> gpu_budget = 0;
+
+        explicit memory_category(const std::string& name) : name(name) {}
+
+        void grow(std::atomic<size_t>& bytes, std::atomic<size_t>& peak, const std::atomic<size_t>& budget,
+            size_t added, const char* kind);
+
+    public:
+        memory_category(const memory_category&) = delete;
+        memory_category& operator=(const memory_category&) = delete;
+
+        /// <summary>
+        /// Count one allocation, a warning is logged when it takes the category over its budget
+        /// </summary>
+        void add(size_t cpu_bytes, size_t gpu_bytes = 0);
+
+        /// <summary>
+        /// Uncount one allocation, with the same sizes it was added with
+        /// </summary>
+        void remove(size_t cpu_bytes, size_t gpu_bytes = 0);
+
+        /// <summary>
+        /// Count a texture by its size and pixel format, call before it's destroyed to remove it
+        /// </summary>
+        void add_texture(SDL_Texture* texture);
+        void remove_texture(SDL_Texture* texture);
+
+        /// <summary>
+        /// Count a surface's pixels, call before it's freed to remove it
+        /// </summary>
+        void add_surface(SDL_Surface* surface);
+        void remove_surface(SDL_Surface* surface);
+
+        void set_budget(size_t cpu_bytes, size_t gpu_bytes);
+
+        const std::string& get_name() const { return name; }
+        size_t get_cpu_bytes() const { return cpu_bytes.load(std::memory_order_relaxed); }
+        size_t get_gpu_bytes() const { return gpu_bytes.load(std::memory_order_relaxed); }
+        size_t get_allocations() const { return allocations.load(std::memory_order_relaxed); }
+    };
+
+    /// <summary>
+    /// Accounts for where memory goes, by subsystem. Every category reports the CPU bytes and estimated VRAM it
+    /// holds, the totals can be queried at runtime, written to the log or shown on the HUD, and budgets log a
+    /// warning the moment a category exceeds them.
+    /// </summary>
+    /// <remarks>
+    /// VRAM is estimated as width * height * bytes per pixel, drivers may pad or compress textures. Categories live
+    /// as long as the program, so subsystems look theirs up once and keep the reference.
+    /// </remarks>
+    class memory_tracker
+    {
+    private:
+        memory_tracker() {} // Force as a static class
+
+    public:
+        /// <returns>The category with this name, created the first time it's asked for</returns>
+        static memory_category& get_category(std::string_view name);
+
+        // The engine's own categories:
+        static memory_category& tiles();            // tile_chunk planes
+        static memory_category& images();           // image and image_atlas surfaces and textures
+        static memory_category& fonts();            // TTF_Font per point size, estimated by the font file's size
+        static memory_category& glyph_atlases();    // simple_bitmap_font textures
+        static memory_category& text_textures();    // text_texture_cache
+        static memory_category& render_targets();   // Chunk, scroll and frame caches
+        static memory_category& frame_arenas();     // Blocks of every thread's frame_arena
+
+        static void set_budget(const memory_budget& budget);
+
+        /// <returns>Every category in the order they were created</returns>
+        static std::vector<memory_report> get_report();
+
+        static size_t get_total_cpu_bytes();
+        static size_t get_total_gpu_bytes();
+
+        /// <summary>
+        /// Write every category, its peaks and its budget to the log
+        /// </summary>
+        static void log_report();
+
+        /// <returns>The bytes of a texture by its size and pixel format</returns>
+        static size_t get_texture_bytes(SDL_Texture* texture);
+    };
+
+}
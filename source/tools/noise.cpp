@@ -0,0 +1,290 @@
+#include "noise.h"
+#include "random.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ISOMETRIC_NOISE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ISOMETRIC_NOISE_SSE2 1
+#endif
+
+using namespace isometric::tools;
+
+namespace {
+
+    // Lattice hash constants, the coordinates are multiplied by the first two and the mix uses the last two:
+    constexpr uint32_t hash_x = 0x27D4EB2D;
+    constexpr uint32_t hash_y = 0x165667B1;
+    constexpr uint32_t hash_mix_a = 0x2C1B3C6D;
+    constexpr uint32_t hash_mix_b = 0x297A2D39;
+
+    constexpr float gradient_scale = 1.0f / 16384.0f;    // Scaled so the noise spans about [-1, 1]
+    constexpr unsigned lanes = 4;
+
+    // One octave of one row, every block of four tiles is computed the same way:
+    struct octave_row
+    {
+        uint32_t seed;
+        float frequency;
+        float offset_x;
+        float offset_y;
+        int y;
+        float amplitude;
+        bool accumulate;
+    };
+
+#if ISOMETRIC_NOISE_SSE2
+    // SSE2 has no 32 bit multiply, multiply the even and odd lanes as 64 bit and keep the low halves:
+    __m128i multiply_low(__m128i a, __m128i b)
+    {
+        const __m128i even = _mm_mul_epu32(a, b);
+        const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // SSE2 has no floor, truncate and step down where that rounded towards zero from below:
+    __m128i floor_to_int(__m128 value)
+    {
+        const __m128i truncated = _mm_cvttps_epi32(value);
+        const __m128 rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+        return _mm_add_epi32(truncated, _mm_castps_si128(rounded_up)); // The mask is -1 where it rounded up
+    }
+
+    // The dot product of the corner's gradient with the offset to the corner:
+    __m128 corner(__m128i x_hash, __m128i y_hash, __m128i seed, __m128 dx, __m128 dy)
+    {
+        __m128i h = _mm_xor_si128(_mm_xor_si128(x_hash, y_hash), seed);
+        h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+        h = multiply_low(h, _mm_set1_epi32(static_cast<int>(hash_mix_a)));
+        h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+        h = multiply_low(h, _mm_set1_epi32(static_cast<int>(hash_mix_b)));
+        h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+
+        const __m128i half = _mm_set1_epi32(32768);
+        const __m128 scale = _mm_set1_ps(gradient_scale);
+        const __m128 gx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(h, _mm_set1_epi32(0xFFFF)), half)), scale);
+        const __m128 gy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(h, 16), half)), scale);
+        return _mm_add_ps(_mm_mul_ps(gx, dx), _mm_mul_ps(gy, dy));
+    }
+
+    __m128 fade(__m128 t)
+    {
+        const __m128 poly = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+        return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), poly);
+    }
+
+    __m128 lerp(__m128 a, __m128 b, __m128 t)
+    {
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+    }
+
+    void gradient_block(float* values, int x, const octave_row& row)
+    {
+        const __m128 frequency = _mm_set1_ps(row.frequency);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i seed = _mm_set1_epi32(static_cast<int>(row.seed));
+
+        const __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+        const __m128 px = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(xs), frequency), _mm_set1_ps(row.offset_x));
+        const __m128 py = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_set1_epi32(row.y)), frequency), _mm_set1_ps(row.offset_y));
+
+        const __m128i ix = floor_to_int(px);
+        const __m128i iy = floor_to_int(py);
+        const __m128 fx = _mm_sub_ps(px, _mm_cvtepi32_ps(ix));
+        const __m128 fy = _mm_sub_ps(py, _mm_cvtepi32_ps(iy));
+        const __m128 fx1 = _mm_sub_ps(fx, one);
+        const __m128 fy1 = _mm_sub_ps(fy, one);
+
+        // (ix + 1) * hash_x wraps the same as ix * hash_x + hash_x, so the next corner is one add away:
+        const __m128i x0 = multiply_low(ix, _mm_set1_epi32(static_cast<int>(hash_x)));
+        const __m128i y0 = multiply_low(iy, _mm_set1_epi32(static_cast<int>(hash_y)));
+        const __m128i x1 = _mm_add_epi32(x0, _mm_set1_epi32(static_cast<int>(hash_x)));
+        const __m128i y1 = _mm_add_epi32(y0, _mm_set1_epi32(static_cast<int>(hash_y)));
+
+        const __m128 u = fade(fx);
+        const __m128 top = lerp(corner(x0, y0, seed, fx, fy), corner(x1, y0, seed, fx1, fy), u);
+        const __m128 bottom = lerp(corner(x0, y1, seed, fx, fy1), corner(x1, y1, seed, fx1, fy1), u);
+        const __m128 value = _mm_mul_ps(lerp(top, bottom, fade(fy)), _mm_set1_ps(row.amplitude));
+
+        _mm_storeu_ps(values, row.accumulate ? _mm_add_ps(_mm_loadu_ps(values), value) : value);
+    }
+#elif ISOMETRIC_NOISE_NEON
+    float32x4_t corner(uint32x4_t x_hash, uint32x4_t y_hash, uint32x4_t seed, float32x4_t dx, float32x4_t dy)
+    {
+        uint32x4_t h = veorq_u32(veorq_u32(x_hash, y_hash), seed);
+        h = veorq_u32(h, vshrq_n_u32(h, 15));
+        h = vmulq_u32(h, vdupq_n_u32(hash_mix_a));
+        h = veorq_u32(h, vshrq_n_u32(h, 12));
+        h = vmulq_u32(h, vdupq_n_u32(hash_mix_b));
+        h = veorq_u32(h, vshrq_n_u32(h, 15));
+
+        const int32x4_t half = vdupq_n_s32(32768);
+        const float32x4_t scale = vdupq_n_f32(gradient_scale);
+        const float32x4_t gx = vmulq_f32(vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vandq_u32(h, vdupq_n_u32(0xFFFF))), half)), scale);
+        const float32x4_t gy = vmulq_f32(vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(h, 16)), half)), scale);
+
+        // Separate multiplies and adds rather than fused ones, to round exactly like the SSE2 path:
+        return vaddq_f32(vmulq_f32(gx, dx), vmulq_f32(gy, dy));
+    }
+
+    float32x4_t fade(float32x4_t t)
+    {
+        const float32x4_t poly = vaddq_f32(vmulq_f32(t, vsubq_f32(vmulq_f32(t, vdupq_n_f32(6.0f)), vdupq_n_f32(15.0f))), vdupq_n_f32(10.0f));
+        return vmulq_f32(vmulq_f32(vmulq_f32(t, t), t), poly);
+    }
+
+    float32x4_t lerp(float32x4_t a, float32x4_t b, float32x4_t t)
+    {
+        return vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), t));
+    }
+
+    void gradient_block(float* values, int x, const octave_row& row)
+    {
+        static const int32_t lane_offsets[lanes] = { 0, 1, 2, 3 };
+
+        const float32x4_t frequency = vdupq_n_f32(row.frequency);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const uint32x4_t seed = vdupq_n_u32(row.seed);
+
+        const int32x4_t xs = vaddq_s32(vdupq_n_s32(x), vld1q_s32(lane_offsets));
+        const float32x4_t px = vaddq_f32(vmulq_f32(vcvtq_f32_s32(xs), frequency), vdupq_n_f32(row.offset_x));
+        const float32x4_t py = vaddq_f32(vmulq_f32(vcvtq_f32_s32(vdupq_n_s32(row.y)), frequency), vdupq_n_f32(row.offset_y));
+
+        const int32x4_t ix = vcvtmq_s32_f32(px);
+        const int32x4_t iy = vcvtmq_s32_f32(py);
+        const float32x4_t fx = vsubq_f32(px, vcvtq_f32_s32(ix));
+        const float32x4_t fy = vsubq_f32(py, vcvtq_f32_s32(iy));
+        const float32x4_t fx1 = vsubq_f32(fx, one);
+        const float32x4_t fy1 = vsubq_f32(fy, one);
+
+        const uint32x4_t x0 = vmulq_u32(vreinterpretq_u32_s32(ix), vdupq_n_u32(hash_x));
+        const uint32x4_t y0 = vmulq_u32(vreinterpretq_u32_s32(iy), vdupq_n_u32(hash_y));
+        const uint32x4_t x1 = vaddq_u32(x0, vdupq_n_u32(hash_x));
+        const uint32x4_t y1 = vaddq_u32(y0, vdupq_n_u32(hash_y));
+
+        const float32x4_t u = fade(fx);
+        const float32x4_t top = lerp(corner(x0, y0, seed, fx, fy), corner(x1, y0, seed, fx1, fy), u);
+        const float32x4_t bottom = lerp(corner(x0, y1, seed, fx, fy1), corner(x1, y1, seed, fx1, fy1), u);
+        const float32x4_t value = vmulq_f32(lerp(top, bottom, fade(fy)), vdupq_n_f32(row.amplitude));
+
+        vst1q_f32(values, row.accumulate ? vaddq_f32(vld1q_f32(values), value) : value);
+    }
+#else
+    float corner(uint32_t x_hash, uint32_t y_hash, uint32_t seed, float dx, float dy)
+    {
+        uint32_t h = x_hash ^ y_hash ^ seed;
+        h ^= h >> 15;
+        h *= hash_mix_a;
+        h ^= h >> 12;
+        h *= hash_mix_b;
+        h ^= h >> 15;
+
+        const float gx = static_cast<float>(static_cast<int32_t>(h & 0xFFFF) - 32768) * gradient_scale;
+        const float gy = static_cast<float>(static_cast<int32_t>(h >> 16) - 32768) * gradient_scale;
+        return gx * dx + gy * dy;
+    }
+
+    float fade(float t)
+    {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    float lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    void gradient_block(float* values, int x, const octave_row& row)
+    {
+        const float py = static_cast<float>(row.y) * row.frequency + row.offset_y;
+        const float fy_floor = std::floor(py);
+        const float fy = py - fy_floor;
+        const uint32_t y0 = static_cast<uint32_t>(static_cast<int32_t>(fy_floor)) * hash_y;
+        const uint32_t y1 = y0 + hash_y;
+
+        for (unsigned lane = 0; lane < lanes; lane++)
+        {
+            const float px = static_cast<float>(x + static_cast<int>(lane)) * row.frequency + row.offset_x;
+            const float fx_floor = std::floor(px);
+            const float fx = px - fx_floor;
+            const uint32_t x0 = static_cast<uint32_t>(static_cast<int32_t>(fx_floor)) * hash_x;
+            const uint32_t x1 = x0 + hash_x;
+
+            const float u = fade(fx);
+            const float top = lerp(corner(x0, y0, row.seed, fx, fy), corner(x1, y0, row.seed, fx - 1.0f, fy), u);
+            const float bottom = lerp(corner(x0, y1, row.seed, fx, fy - 1.0f), corner(x1, y1, row.seed, fx - 1.0f, fy - 1.0f), u);
+            const float value = lerp(top, bottom, fade(fy)) * row.amplitude;
+
+            values[lane] = row.accumulate ? values[lane] + value : value;
+        }
+    }
+#endif
+
+    void octave(std::span<float> values, int x_begin, const octave_row& row)
+    {
+        const size_t full = values.size() / lanes * lanes;
+        for (size_t i = 0; i < full; i += lanes)
+        {
+            gradient_block(values.data() + i, x_begin + static_cast<int>(i), row);
+        }
+
+        // The last few tiles are computed as a whole block too, so a tile gives the same value wherever it is in a row:
+        if (full < values.size())
+        {
+            float block[lanes] = {};
+            std::copy(values.begin() + full, values.end(), block);
+            gradient_block(block, x_begin + static_cast<int>(full), row);
+            std::copy_n(block, values.size() - full, values.begin() + full);
+        }
+    }
+
+    uint32_t get_octave_seed(uint64_t seed, unsigned octave)
+    {
+        return static_cast<uint32_t>(random::hash(seed, octave) >> 32);
+    }
+
+}
+
+void noise::gradient_row(std::span<float> values, uint64_t seed, float frequency, int x_begin, int y)
+{
+    octave(values, x_begin, octave_row{ get_octave_seed(seed, 0), frequency, 0.0f, 0.0f, y, 1.0f, false });
+}
+
+void noise::fractal_row(std::span<float> values, uint64_t seed, const fractal_noise& settings, int x_begin, int y)
+{
+    if (settings.octaves == 0)
+    {
+        std::fill(values.begin(), values.end(), 0.0f);
+        return;
+    }
+
+    float frequency = settings.frequency;
+    float amplitude = 1.0f;
+    float total_amplitude = 0.0f;
+
+    for (unsigned i = 0; i < settings.octaves; i++)
+    {
+        // Offset every octave so their lattices don't all line up at the origin, where gradient noise is zero:
+        octave_row row{ get_octave_seed(seed, i), frequency,
+            random::hash_float(seed, i, 1) * 256.0f, random::hash_float(seed, i, 2) * 256.0f,
+            y, amplitude, i > 0 };
+        octave(values, x_begin, row);
+
+        total_amplitude += amplitude;
+        frequency *= settings.lacunarity;
+        amplitude *= settings.gain;
+    }
+
+    const float normalize = 1.0f / total_amplitude;
+    for (float& value : values) value *= normalize;
+}
+
+float noise::fractal(uint64_t seed, const fractal_noise& settings, int x, int y)
+{
+    float value = 0.0f;
+    fractal_row(std::span<float>(&value, 1), seed, settings, x, y);
+    return value;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <span>
+#include <cstdint>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Settings for fractal noise, octaves of gradient noise summed with ever higher frequency and lower amplitude
+    /// </summary>
+    struct fractal_noise
+    {
+        float frequency = 1.0f / 64.0f;     // Of the first octave, in cycles per tile
+        unsigned octaves = 4;
+        float lacunarity = 2.0f;            // Frequency multiplier from one octave to the next
+        float gain = 0.5f;                  // Amplitude multiplier from one octave to the next
+    };
+
+    class noise
+    {
+    private:
+        noise() {} // Force as a static class
+
+    public:
+        /// <summary>
+        /// 2D gradient noise for a row of tiles, values[i] is the noise at (x_begin + i, y) in tile units times
+        /// frequency. The row is computed four tiles at a time with SSE2 or NEON, and a single tile goes through the
+        /// same code as a row does, so values only depend on the seed and the position.
+        /// </summary>
+        /// <param name="values">Receives values roughly within [-1, 1]</param>
+        static void gradient_row(std::span<float> values, uint64_t seed, float frequency, int x_begin, int y);
+
+        /// <summary>
+        /// Fractal noise for a row of tiles, every octave is gradient_row with its own seed and offset
+        /// </summary>
+        /// <param name="values">Receives values roughly within [-1, 1]</param>
+        static void fractal_row(std::span<float> values, uint64_t seed, const fractal_noise& settings, int x_begin, int y);
+
+        /// <returns>fractal_row for a single tile</returns>
+        static float fractal(uint64_t seed, const fractal_noise& settings, int x, int y);
+    };
+
+}
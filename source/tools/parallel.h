@@ -0,0 +1,71 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include "job_system.h"
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Number of threads parallel_for uses, at least one
+    /// </summary>
+    inline unsigned get_worker_count()
+    {
+        // The calling thread helps out, so it counts as a worker:
+        if (job_system::get_current()) return job_system::get_current()->get_worker_count() + 1;
+
+        return std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    /// <summary>
+    /// Call func(index) for every index in [0, count), spread across worker threads. Indices are handed out in
+    /// blocks of grain_size so threads don't contend on the counter. Returns once every index has been processed.
+    /// Runs on the current job_system when there is one, otherwise threads are started for this call.
+    /// </summary>
+    /// <remarks>func is called concurrently and must only write to data that belongs to its own index</remarks>
+    template<class F>
+    void parallel_for(size_t count, F&& func, size_t grain_size = 1)
+    {
+        if (count == 0) return;
+
+        if (job_system* jobs = job_system::get_current())
+        {
+            jobs->parallel_for(count, func, grain_size);
+            return;
+        }
+
+        grain_size = std::max<size_t>(grain_size, 1);
+        const size_t block_count = (count + grain_size - 1) / grain_size;
+        const unsigned thread_count = static_cast<unsigned>(std::min<size_t>(get_worker_count(), block_count));
+
+        std::atomic<size_t> next_block = 0;
+        auto worker = [&]()
+        {
+            for (size_t block = next_block++; block < block_count; block = next_block++)
+            {
+                const size_t end = std::min(count, (block + 1) * grain_size);
+                for (size_t index = block * grain_size; index < end; index++)
+                {
+                    func(index);
+                }
+            }
+        };
+
+        // The calling thread works too, so only thread_count - 1 threads are started:
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (unsigned i = 1; i < thread_count; i++)
+        {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+}
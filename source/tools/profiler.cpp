@@ -0,0 +1,232 @@
+#include "profiler.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_set>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+
+using namespace isometric::tools;
+
+namespace {
+
+    // Written by one thread and read by write_chrome_trace, so every field is atomic:
+    struct zone_slot
+    {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<Uint64> start = 0;
+        std::atomic<Uint64> end = 0;
+    };
+
+    struct thread_buffer
+    {
+        size_t thread_index = 0;
+        std::string name;                   // Guarded by the registry's mutex
+        std::unique_ptr<zone_slot[]> zones = std::make_unique<zone_slot[]>(profiler::zones_per_thread);
+        std::atomic<uint64_t> head = 0;     // Zones ever recorded, the next one goes to head % zones_per_thread
+        std::atomic<uint64_t> cleared = 0;  // Zones before this were forgotten by clear
+    };
+
+    struct registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<thread_buffer>> threads; // Kept after their threads exit for the trace
+        std::unordered_set<std::string> names;
+    };
+
+    std::atomic<bool> enabled = true;
+
+    registry& get_registry()
+    {
+        static registry instance;
+        return instance;
+    }
+
+    thread_buffer& get_thread_buffer()
+    {
+        thread_local std::shared_ptr<thread_buffer> buffer = []() {
+            auto new_buffer = std::make_shared<thread_buffer>();
+
+            registry& reg = get_registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            new_buffer->thread_index = reg.threads.size();
+            reg.threads.push_back(new_buffer);
+            return new_buffer;
+        }();
+
+        return *buffer;
+    }
+
+    void write_json_string(std::ofstream& file, const char* text)
+    {
+        file << '"';
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\') file << '\\' << *c;
+            else if (static_cast<unsigned char>(*c) >= 0x20) file << *c;
+        }
+        file << '"';
+    }
+
+    struct zone_copy
+    {
+        const char* name;
+        Uint64 start;
+        Uint64 end;
+    };
+
+    // The zones of one thread that weren't overwritten while they were copied:
+    std::vector<zone_copy> copy_zones(const thread_buffer& buffer)
+    {
+        const uint64_t head = buffer.head.load(std::memory_order_acquire);
+        const uint64_t first = std::max(buffer.cleared.load(std::memory_order_relaxed),
+            head > profiler::zones_per_thread ? head - profiler::zones_per_thread : 0);
+
+        std::vector<zone_copy> zones;
+        zones.reserve(static_cast<size_t>(head - first));
+
+        for (uint64_t i = first; i < head; i++)
+        {
+            const zone_slot& slot = buffer.zones[i % profiler::zones_per_thread];
+            zones.push_back(zone_copy{
+                slot.name.load(std::memory_order_relaxed),
+                slot.start.load(std::memory_order_relaxed),
+                slot.end.load(std::memory_order_relaxed) });
+        }
+
+        // Any slot the writer reached since the first load, including the one it may be writing now, can hold a
+        // newer zone than the one it was copied for:
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t reached = buffer.head.load(std::memory_order_relaxed) + 1;
+        if (reached > profiler::zones_per_thread && reached - profiler::zones_per_thread > first)
+        {
+            const uint64_t overwritten = std::min(head, reached - profiler::zones_per_thread) - first;
+            zones.erase(zones.begin(), zones.begin() + static_cast<ptrdiff_t>(overwritten));
+        }
+
+        return zones;
+    }
+
+}
+
+void profiler::set_enabled(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool profiler::is_enabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void profiler::set_thread_name(const std::string& name)
+{
+    thread_buffer& buffer = get_thread_buffer();
+
+    std::lock_guard<std::mutex> lock(get_registry().mutex);
+    buffer.name = name;
+}
+
+const char* profiler::intern(std::string_view name)
+{
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // Nodes of an unordered_set never move, so the string's buffer stays valid:
+    return reg.names.emplace(name).first->c_str();
+}
+
+void profiler::record(const char* name, Uint64 start, Uint64 end)
+{
+    if (!enabled.load(std::memory_order_relaxed)) return;
+
+    thread_buffer& buffer = get_thread_buffer();
+    const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+
+    zone_slot& slot = buffer.zones[index % zones_per_thread];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+void profiler::clear()
+{
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    for (const auto& buffer : reg.threads)
+    {
+        buffer->cleared.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+bool profiler::write_chrome_trace(const std::string& path)
+{
+    std::vector<std::shared_ptr<thread_buffer>> threads;
+    std::vector<std::string> thread_names;
+    {
+        registry& reg = get_registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        threads = reg.threads;
+        for (const auto& buffer : threads) thread_names.push_back(buffer->name);
+    }
+
+    std::vector<std::vector<zone_copy>> zones;
+    zones.reserve(threads.size());
+    for (const auto& buffer : threads) zones.push_back(copy_zones(*buffer));
+
+    // Timestamps start at the earliest zone, so the trace opens at its first event:
+    Uint64 origin = std::numeric_limits<Uint64>::max();
+    size_t zone_count = 0;
+    for (const auto& thread_zones : zones)
+    {
+        for (const auto& zone : thread_zones) origin = std::min(origin, zone.start);
+        zone_count += thread_zones.size();
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write the profiler trace to [%s]", path.c_str());
+        return false;
+    }
+
+    const double ticks_per_us = static_cast<double>(SDL_GetPerformanceFrequency()) / 1000000.0;
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first_event = true;
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        const std::string name = thread_names[t].empty() ? "thread " + std::to_string(threads[t]->thread_index) : thread_names[t];
+
+        if (!first_event) file << ",\n";
+        first_event = false;
+
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threads[t]->thread_index << ",\"args\":{\"name\":";
+        write_json_string(file, name.c_str());
+        file << "}}";
+
+        for (const auto& zone : zones[t])
+        {
+            file << ",\n{\"name\":";
+            write_json_string(file, zone.name ? zone.name : "");
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threads[t]->thread_index
+                << ",\"ts\":" << static_cast<double>(zone.start - origin) / ticks_per_us
+                << ",\"dur\":" << static_cast<double>(zone.end - zone.start) / ticks_per_us << '}';
+        }
+    }
+
+    file << "\n]}\n";
+
+    SDL_Log("Wrote %llu profiler zones from %llu threads to [%s]", static_cast<unsigned long long>(zone_count),
+        static_cast<unsigned long long>(threads.size()), path.c_str());
+
+    return static_cast<bool>(file);
+}
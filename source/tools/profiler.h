@@ -0,0 +1,93 @@
+#pragma once
+#include <SDL.h>
+#include <string>
+#include <string_view>
+
+// Zones are compiled into debug builds, define ISOMETRIC_PROFILING as 1 to profile a release build or as 0 to
+// leave them out of a debug build:
+#ifndef ISOMETRIC_PROFILING
+#ifdef _DEBUG
+#define ISOMETRIC_PROFILING 1
+#else
+#define ISOMETRIC_PROFILING 0
+#endif
+#endif
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Records named zones of time per thread and writes them as a Chrome trace (chrome://tracing or Perfetto).
+    /// Every thread records into its own fixed size ring buffer, so recording never locks or allocates after a
+    /// thread's first zone, and the oldest zones are overwritten once a buffer is full.
+    /// </summary>
+    /// <remarks>
+    /// Use ISOMETRIC_PROFILE_ZONE and ISOMETRIC_PROFILE_THREAD rather than profile_zone and set_thread_name, so they
+    /// compile away when profiling is off.
+    /// </remarks>
+    class profiler
+    {
+    public:
+        static constexpr size_t zones_per_thread = 1 << 15;
+
+        /// <summary>
+        /// Turn recording on or off at runtime, zones ending while it's off aren't recorded. On by default.
+        /// </summary>
+        static void set_enabled(bool enable);
+        static bool is_enabled();
+
+        /// <summary>
+        /// Name the calling thread in the trace, threads without a name are shown by their index
+        /// </summary>
+        static void set_thread_name(const std::string& name);
+
+        /// <returns>A copy of the name that lives as long as the program, for zones named at runtime</returns>
+        static const char* intern(std::string_view name);
+
+        /// <summary>
+        /// Record a zone on the calling thread, the name must outlive the profiler (a literal or interned)
+        /// </summary>
+        /// <param name="start">Start of the zone from SDL_GetPerformanceCounter</param>
+        /// <param name="end">End of the zone from SDL_GetPerformanceCounter</param>
+        static void record(const char* name, Uint64 start, Uint64 end);
+
+        /// <summary>
+        /// Forget every recorded zone. Threads recording while this runs may keep a few of their zones.
+        /// </summary>
+        static void clear();
+
+        /// <summary>
+        /// Write the zones still held by every thread's buffer as Chrome trace event JSON. Safe to call while other
+        /// threads record, zones they overwrite during the write are left out.
+        /// </summary>
+        /// <returns>False if the file couldn't be written</returns>
+        static bool write_chrome_trace(const std::string& path);
+    };
+
+    /// <summary>
+    /// Records the time from its construction to its destruction as a zone of the calling thread
+    /// </summary>
+    class profile_zone
+    {
+    private:
+        const char* name;
+        Uint64 start;
+
+    public:
+        explicit profile_zone(const char* name) : name(name), start(SDL_GetPerformanceCounter()) {}
+        ~profile_zone() { profiler::record(name, start, SDL_GetPerformanceCounter()); }
+
+        profile_zone(const profile_zone&) = delete;
+        profile_zone& operator=(const profile_zone&) = delete;
+    };
+
+}
+
+#if ISOMETRIC_PROFILING
+#define ISOMETRIC_PROFILE_CONCAT_INNER(a, b) a##b
+#define ISOMETRIC_PROFILE_CONCAT(a, b) ISOMETRIC_PROFILE_CONCAT_INNER(a, b)
+#define ISOMETRIC_PROFILE_ZONE(name) ::isometric::tools::profile_zone ISOMETRIC_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define ISOMETRIC_PROFILE_THREAD(name) ::isometric::tools::profiler::set_thread_name(name)
+#else
+#define ISOMETRIC_PROFILE_ZONE(name) ((void)0)
+#define ISOMETRIC_PROFILE_THREAD(name) ((void)0)
+#endif
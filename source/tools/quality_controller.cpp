@@ -0,0 +1,89 @@
+#include "quality_controller.h"
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace isometric::tools;
+
+namespace {
+
+    constexpr double average_weight = 0.1;  // Of the newest frame, about the last 10 frames dominate
+
+}
+
+void quality_controller::set_enabled(bool enable)
+{
+    enabled = enable;
+    if (!enabled) change_level(0);
+}
+
+void quality_controller::set_budget_ms(double budget)
+{
+    if (budget > 0.0) budget_ms = budget;
+}
+
+void quality_controller::set_min_render_scale(float scale)
+{
+    min_render_scale = std::clamp(scale, scale_step, 1.0f);
+    change_level(std::min(level, get_max_level()));
+}
+
+int quality_controller::get_max_level() const
+{
+    return 1 + static_cast<int>(std::floor((1.0f - min_render_scale) / scale_step + 0.001f));
+}
+
+void quality_controller::set_level(int to)
+{
+    change_level(std::clamp(to, 0, get_max_level()));
+}
+
+float quality_controller::get_render_scale() const
+{
+    return level <= 1 ? 1.0f : std::max(min_render_scale, 1.0f - scale_step * (level - 1));
+}
+
+void quality_controller::change_level(int to)
+{
+    over_seconds = 0.0;
+    under_seconds = 0.0;
+    cooldown_seconds = change_cooldown_seconds;
+
+    if (to == level) return;
+
+    SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, "Quality level %d to %d, frames average %.02f ms of a %.02f ms budget",
+        level, to, average_ms, budget_ms);
+
+    level = to;
+    changes++;
+}
+
+bool quality_controller::add_frame(double work_ms, double delta_time)
+{
+    if (!enabled) return false;
+
+    average_ms = average_ms > 0.0 ? average_ms + (work_ms - average_ms) * average_weight : work_ms;
+
+    if (cooldown_seconds > 0.0)
+    {
+        cooldown_seconds -= delta_time;
+        return false;
+    }
+
+    over_seconds = average_ms > budget_ms ? over_seconds + delta_time : 0.0;
+    under_seconds = average_ms < budget_ms * raise_below_budget ? under_seconds + delta_time : 0.0;
+
+    if (over_seconds >= lower_after_seconds && level < get_max_level())
+    {
+        change_level(level + 1);
+        return true;
+    }
+
+    if (under_seconds >= raise_after_seconds && level > 0)
+    {
+        change_level(level - 1);
+        return true;
+    }
+
+    return false;
+}
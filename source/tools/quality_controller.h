@@ -0,0 +1,73 @@
+#pragma once
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Picks a quality level from how long frames take against a budget. Level 0 is full quality. The first level
+    /// down reduces detail, which the game applies by leaving out what it considers optional, and every level after
+    /// that lowers the render scale by scale_step until min_render_scale.
+    /// </summary>
+    /// <remarks>
+    /// Frame times are smoothed, and a level only changes once they've stayed over (or well under) the budget for a
+    /// while, with a cooldown after each change so its effect is measured before the next. The gap between the
+    /// two thresholds keeps the level from flipping back and forth around the budget.
+    /// </remarks>
+    class quality_controller
+    {
+    public:
+        static constexpr float scale_step = 0.125f;
+
+    private:
+        double budget_ms = 1000.0 / 60.0;
+        float min_render_scale = 0.5f;
+        bool enabled = false;
+
+        int level = 0;
+        double average_ms = 0.0;    // Exponential moving average of the frames' work
+        double over_seconds = 0.0;  // How long the average has been over the budget
+        double under_seconds = 0.0; // How long the average has been well under the budget
+        double cooldown_seconds = 0.0;
+        unsigned long long changes = 0;
+
+        void change_level(int to);
+
+    public:
+        static constexpr double lower_after_seconds = 0.25;
+        static constexpr double raise_after_seconds = 2.0;
+        static constexpr double change_cooldown_seconds = 1.0;
+        static constexpr double raise_below_budget = 0.7;   // Of the budget, the average must be under this to raise
+
+        void set_enabled(bool enable = true);
+        bool is_enabled() const { return enabled; }
+
+        /// <summary>
+        /// The time a frame's work should fit in, application uses its target frame rate or frame_budget_ms
+        /// </summary>
+        void set_budget_ms(double budget);
+        double get_budget_ms() const { return budget_ms; }
+
+        void set_min_render_scale(float scale);
+        float get_min_render_scale() const { return min_render_scale; }
+
+        /// <summary>
+        /// Count a frame. Only the time spent working should be given, not time spent waiting on a frame limiter
+        /// or a vertical sync, otherwise a frame that's on time looks like it's over budget.
+        /// </summary>
+        /// <returns>True if the level changed</returns>
+        bool add_frame(double work_ms, double delta_time);
+
+        int get_level() const { return level; }
+        int get_max_level() const;
+        void set_level(int level);
+
+        /// <returns>True from level 1, where optional detail is left out</returns>
+        bool is_detail_reduced() const { return level > 0; }
+
+        /// <returns>The fraction of the output resolution to render at, 1 until detail has been reduced</returns>
+        float get_render_scale() const;
+
+        double get_average_ms() const { return average_ms; }
+        unsigned long long get_change_count() const { return changes; }
+    };
+
+}
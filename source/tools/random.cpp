@@ -1,19 +1,95 @@
 #include "random.h"
-#include <time.h>
+#include <random>
+#include <atomic>
 
 using namespace isometric::tools;
 
-std::random_device random::rd;
-std::mt19937 random::gen(rd());
+// splitmix64 finalizer, see https://prng.di.unimi.it/splitmix64.c
+static uint64_t mix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static std::atomic<uint64_t> base_seed = 0;
+static std::atomic<uint64_t> seed_revision = 0;    // 0 until set_seed, then threads seed from the random device
+static std::atomic<uint64_t> thread_count = 0;
+
+random_generator random_generator::create_stream(uint64_t seed, uint64_t stream)
+{
+    return random_generator(random::hash(seed, stream));
+}
+
+void random_generator::set_seed(uint64_t seed)
+{
+    // Consecutive splitmix64 outputs are distinct, so the state is never all zero, the one state xoshiro can't leave:
+    for (uint64_t& word : state)
+    {
+        word = mix(seed);
+        seed += 0x9E3779B97F4A7C15ULL;
+    }
+}
+
+random_generator& random::get_generator()
+{
+    struct thread_generator
+    {
+        random_generator generator;
+        uint64_t thread_index = thread_count++;
+        uint64_t revision = 0;
+
+        thread_generator()
+        {
+            std::random_device device;
+            generator.set_seed((static_cast<uint64_t>(device()) << 32) ^ device() ^ thread_index);
+        }
+    };
+
+    thread_local thread_generator current;
+
+    const uint64_t revision = seed_revision.load(std::memory_order_acquire);
+    if (current.revision != revision)
+    {
+        current.revision = revision;
+        current.generator.set_seed(hash(base_seed.load(std::memory_order_relaxed), current.thread_index));
+    }
 
-int random::range(int min_inclusive, int max_inclusive)
+    return current.generator;
+}
+
+void random::set_seed(uint64_t seed)
+{
+    base_seed.store(seed, std::memory_order_relaxed);
+    seed_revision.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t random::hash(uint64_t seed, uint64_t x, uint64_t y, uint64_t z)
+{
+    return mix(mix(mix(mix(seed) ^ x) ^ y) ^ z);
+}
+
+unsigned random::hash_index(unsigned count, uint64_t seed, uint64_t x, uint64_t y, uint64_t z)
 {
-    std::uniform_int_distribution<int> dis(min_inclusive, max_inclusive);
-    return dis(gen);
+    if (count == 0) return 0;
+
+    // Multiply-shift maps the top 32 bits into range without the bias of a modulo:
+    return static_cast<unsigned>(((hash(seed, x, y, z) >> 32) * count) >> 32);
 }
 
-unsigned random::range(unsigned min_inclusive, unsigned max_inclusive)
+float random::hash_float(uint64_t seed, uint64_t x, uint64_t y, uint64_t z)
 {
-    std::uniform_int_distribution<unsigned> dis(min_inclusive, max_inclusive);
-    return dis(gen);
-}
\ No newline at end of file
+    return static_cast<float>(hash(seed, x, y, z) >> 40) * 0x1.0p-24F;
+}
+
+void random::hash_row(std::span<uint64_t> values, uint64_t seed, uint64_t x_begin, uint64_t y, uint64_t z)
+{
+    // The seed's share of the hash is the same along the row:
+    const uint64_t seeded = mix(seed);
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = mix(mix(mix(seeded ^ (x_begin + i)) ^ y) ^ z);
+    }
+}
@@ -1,19 +1,171 @@
 #pragma once
-#include <random>
+#include <cstdint>
+#include <span>
 
 namespace isometric::tools {
 
-    class random
+    /// <summary>
+    /// A small, fast xoshiro256** generator (https://prng.di.unimi.it). The same seed gives the same sequence on
+    /// every platform. An instance isn't thread safe, give every thread or stream of work its own.
+    /// </summary>
+    class random_generator
     {
     private:
-        static std::random_device rd;
-        static std::mt19937 gen;
+        uint64_t state[4]{};
+
+        static uint64_t rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    public:
+        explicit random_generator(uint64_t seed = 0) { set_seed(seed); }
+
+        /// <summary>
+        /// An independent stream of a seed, so parallel work can draw in any order and still be reproducible
+        /// </summary>
+        static random_generator create_stream(uint64_t seed, uint64_t stream);
+
+        /// <summary>
+        /// Restart the sequence, the state is expanded from the seed with splitmix64
+        /// </summary>
+        void set_seed(uint64_t seed);
+
+        uint64_t next()
+        {
+            const uint64_t result = rotl(state[1] * 5, 7) * 9;
+            const uint64_t shifted = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= shifted;
+            state[3] = rotl(state[3], 45);
+
+            return result;
+        }
+
+        uint32_t next_u32() { return static_cast<uint32_t>(next() >> 32); }
+
+        /// <returns>A value in [0, count) without modulo bias, or 0 when count is 0</returns>
+        uint32_t below(uint32_t count)
+        {
+            // Lemire's multiply-shift, rejecting the few low products that would bias the result:
+            uint64_t product = static_cast<uint64_t>(next_u32()) * count;
+            uint32_t low = static_cast<uint32_t>(product);
+
+            if (low < count)
+            {
+                const uint32_t threshold = (0U - count) % count;
+                while (low < threshold)
+                {
+                    product = static_cast<uint64_t>(next_u32()) * count;
+                    low = static_cast<uint32_t>(product);
+                }
+            }
+
+            return static_cast<uint32_t>(product >> 32);
+        }
+
+        /// <returns>A value in [min_inclusive, max_inclusive], or min_inclusive if the range is empty</returns>
+        int range(int min_inclusive, int max_inclusive)
+        {
+            if (max_inclusive <= min_inclusive) return min_inclusive;
+
+            const uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(max_inclusive) - min_inclusive) + 1;
+            const uint32_t offset = span > UINT32_MAX ? next_u32() : below(static_cast<uint32_t>(span));
+            return static_cast<int>(static_cast<int64_t>(min_inclusive) + offset);
+        }
+
+        /// <returns>A value in [min_inclusive, max_inclusive], or min_inclusive if the range is empty</returns>
+        unsigned range(unsigned min_inclusive, unsigned max_inclusive)
+        {
+            if (max_inclusive <= min_inclusive) return min_inclusive;
+
+            const uint64_t span = static_cast<uint64_t>(max_inclusive - min_inclusive) + 1;
+            return min_inclusive + (span > UINT32_MAX ? next_u32() : below(static_cast<uint32_t>(span)));
+        }
+
+        /// <returns>A value in [0, 1)</returns>
+        float next_float() { return static_cast<float>(next() >> 40) * 0x1.0p-24F; }
 
+        /// <returns>A value in [0, 1)</returns>
+        double next_double() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+        /// <returns>True with the given probability</returns>
+        bool chance(double probability) { return next_double() < probability; }
+
+        void fill(std::span<uint64_t> values)
+        {
+            for (uint64_t& value : values) value = next();
+        }
+
+        void fill(std::span<uint32_t> values)
+        {
+            for (uint32_t& value : values) value = next_u32();
+        }
+
+        /// <summary>
+        /// Fill with values in [0, 1)
+        /// </summary>
+        void fill(std::span<float> values)
+        {
+            for (float& value : values) value = next_float();
+        }
+
+        /// <summary>
+        /// Fill with values in [min_inclusive, max_inclusive]
+        /// </summary>
+        void fill_range(std::span<int> values, int min_inclusive, int max_inclusive)
+        {
+            for (int& value : values) value = range(min_inclusive, max_inclusive);
+        }
+
+        /// <summary>
+        /// Fill with values in [0, count)
+        /// </summary>
+        void fill_below(std::span<uint32_t> values, uint32_t count)
+        {
+            for (uint32_t& value : values) value = below(count);
+        }
+    };
+
+    class random
+    {
+    private:
         random() {} // Force as a static class
 
     public:
-        static int range(int min_inclusive, int max_inclusive);
-        static unsigned range(unsigned min_inclusive, unsigned max_inclusive);
+        /// <summary>
+        /// The calling thread's generator. Every thread gets its own, seeded from the seed given to set_seed (or the
+        /// random device until then) and the order threads first asked for one.
+        /// </summary>
+        static random_generator& get_generator();
+
+        /// <summary>
+        /// Reseed every thread's generator, each picks the seed up on its next draw. Work spread over the job
+        /// system should use random_generator::create_stream instead to be reproducible, as the order threads
+        /// first draw in isn't.
+        /// </summary>
+        static void set_seed(uint64_t seed);
+
+        static int range(int min_inclusive, int max_inclusive) { return get_generator().range(min_inclusive, max_inclusive); }
+        static unsigned range(unsigned min_inclusive, unsigned max_inclusive) { return get_generator().range(min_inclusive, max_inclusive); }
+
+        /// <summary>
+        /// A stateless, well mixed hash of a seed and a coordinate. The same inputs always give the same result on
+        /// every platform and thread, unlike range() which draws from a generator.
+        /// </summary>
+        static uint64_t hash(uint64_t seed, uint64_t x, uint64_t y = 0, uint64_t z = 0);
+
+        /// <returns>hash(seed, x, y, z) reduced to [0, count), or 0 when count is 0</returns>
+        static unsigned hash_index(unsigned count, uint64_t seed, uint64_t x, uint64_t y = 0, uint64_t z = 0);
+
+        /// <returns>hash(seed, x, y, z) as a value in [0, 1)</returns>
+        static float hash_float(uint64_t seed, uint64_t x, uint64_t y = 0, uint64_t z = 0);
+
+        /// <summary>
+        /// Fill values with hash(seed, x_begin + i, y, z), for a row of coordinate keyed content at once
+        /// </summary>
+        static void hash_row(std::span<uint64_t> values, uint64_t seed, uint64_t x_begin, uint64_t y = 0, uint64_t z = 0);
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// A control word with the high bit set is followed by one value repeated (control & 0x7FFF) + 1 times,
+    /// otherwise it's followed by control + 1 literal values
+    /// </summary>
+    inline void run_length_encode(const uint16_t* values, size_t count, std::vector<uint16_t>& encoded)
+    {
+        constexpr size_t max_run = 0x8000;
+        constexpr size_t min_run = 3;   // Shorter runs are cheaper as literals
+
+        auto run_length = [&](size_t start)
+        {
+            size_t length = 1;
+            while (start + length < count && length < max_run && values[start + length] == values[start]) length++;
+            return length;
+        };
+
+        size_t i = 0;
+        while (i < count)
+        {
+            const size_t run = run_length(i);
+            if (run >= min_run)
+            {
+                encoded.push_back(static_cast<uint16_t>(0x8000 | (run - 1)));
+                encoded.push_back(values[i]);
+                i += run;
+                continue;
+            }
+
+            size_t literal_end = i + 1;
+            while (literal_end < count && literal_end - i < max_run && run_length(literal_end) < min_run) literal_end++;
+
+            encoded.push_back(static_cast<uint16_t>(literal_end - i - 1));
+            encoded.insert(encoded.end(), values + i, values + literal_end);
+            i = literal_end;
+        }
+    }
+
+    inline bool run_length_decode(const uint8_t* source, size_t source_size, uint16_t* values, size_t count)
+    {
+        const size_t source_count = source_size / sizeof(uint16_t);
+        auto read = [&](size_t index)
+        {
+            uint16_t value;
+            std::memcpy(&value, source + index * sizeof(uint16_t), sizeof(uint16_t));
+            return value;
+        };
+
+        size_t in = 0, out = 0;
+        while (in < source_count && out < count)
+        {
+            const uint16_t control = read(in++);
+            const size_t length = (control & 0x7FFF) + 1;
+
+            if (out + length > count) return false;
+
+            if (control & 0x8000)
+            {
+                if (in >= source_count) return false;
+                std::fill(values + out, values + out + length, read(in++));
+            }
+            else
+            {
+                if (in + length > source_count) return false;
+                std::memcpy(values + out, source + in * sizeof(uint16_t), length * sizeof(uint16_t));
+                in += length;
+            }
+
+            out += length;
+        }
+
+        return out == count;
+    }
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Refers to a value in a slot_map. A handle stays valid until its value is removed, after which it never
+    /// refers to anything again, even once the slot is reused.
+    /// </summary>
+    struct slot_handle
+    {
+        static constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index = invalid_index;
+        uint32_t generation = 0;
+
+        bool is_valid() const { return index != invalid_index; }
+
+        bool operator==(const slot_handle& other) const = default;
+    };
+
+    /// <summary>
+    /// Stores values contiguously and hands out stable handles to them. Insert, remove and lookup are O(1). Removal
+    /// moves the last value into the hole, so the values stay packed for iteration but their order isn't kept.
+    /// </summary>
+    template<class T>
+    class slot_map
+    {
+    private:
+        struct slot
+        {
+            uint32_t dense_index = 0;
+            uint32_t generation = 0;    // Odd while the slot is in use
+        };
+
+        std::vector<T> values;
+        std::vector<uint32_t> value_slots;  // The slot of every value, parallel to values
+        std::vector<slot> slots;
+        std::vector<uint32_t> free_slots;
+
+    public:
+        template<class... Args>
+        slot_handle emplace(Args&&... args)
+        {
+            uint32_t slot_index;
+            if (!free_slots.empty())
+            {
+                slot_index = free_slots.back();
+                free_slots.pop_back();
+            }
+            else
+            {
+                slot_index = static_cast<uint32_t>(slots.size());
+                slots.emplace_back();
+            }
+
+            slot& current = slots[slot_index];
+            current.dense_index = static_cast<uint32_t>(values.size());
+            current.generation++;
+
+            values.emplace_back(std::forward<Args>(args)...);
+            value_slots.push_back(slot_index);
+
+            return slot_handle{ slot_index, current.generation };
+        }
+
+        slot_handle insert(T value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /// <returns>False if the handle doesn't refer to a value</returns>
+        bool remove(const slot_handle& handle)
+        {
+            if (!contains(handle)) return false;
+
+            slot& removed = slots[handle.index];
+            const uint32_t last = static_cast<uint32_t>(values.size() - 1);
+
+            if (removed.dense_index != last)
+            {
+                values[removed.dense_index] = std::move(values[last]);
+                value_slots[removed.dense_index] = value_slots[last];
+                slots[value_slots[last]].dense_index = removed.dense_index;
+            }
+
+            values.pop_back();
+            value_slots.pop_back();
+
+            removed.generation++;
+            free_slots.push_back(handle.index);
+
+            return true;
+        }
+
+        bool contains(const slot_handle& handle) const
+        {
+            return handle.index < slots.size() && slots[handle.index].generation == handle.generation && (handle.generation & 1);
+        }
+
+        /// <returns>The value, or nullptr if the handle doesn't refer to one. Invalidated by emplace and remove.</returns>
+        T* get(const slot_handle& handle)
+        {
+            return contains(handle) ? &values[slots[handle.index].dense_index] : nullptr;
+        }
+
+        const T* get(const slot_handle& handle) const
+        {
+            return contains(handle) ? &values[slots[handle.index].dense_index] : nullptr;
+        }
+
+        /// <returns>The handle of the value at a position in get_values()</returns>
+        slot_handle get_handle(size_t dense_index) const
+        {
+            const uint32_t slot_index = value_slots[dense_index];
+            return slot_handle{ slot_index, slots[slot_index].generation };
+        }
+
+        /// <returns>Every value, packed and in no particular order</returns>
+        std::span<T> get_values() { return values; }
+        std::span<const T> get_values() const { return values; }
+
+        size_t size() const { return values.size(); }
+        bool empty() const { return values.empty(); }
+
+        void reserve(size_t count)
+        {
+            values.reserve(count);
+            value_slots.reserve(count);
+            slots.reserve(count);
+        }
+
+        void clear()
+        {
+            for (uint32_t slot_index : value_slots)
+            {
+                slots[slot_index].generation++;
+                free_slots.push_back(slot_index);
+            }
+
+            values.clear();
+            value_slots.clear();
+        }
+    };
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace isometric::tools {
+
+    /// <summary>
+    /// Hands snapshots of T from one writer thread to one reader thread without locks. The writer fills
+    /// get_write_buffer() and publishes it, the reader picks up the newest published snapshot with acquire().
+    /// Neither side ever blocks or sees a snapshot that is still being written.
+    /// </summary>
+    /// <remarks>
+    /// The reader also keeps the snapshot before the current one so it can interpolate between the two.
+    /// </remarks>
+    template<class T>
+    class triple_buffer
+    {
+    private:
+        static constexpr uint8_t fresh_bit = 0x4;   // Set on the middle index when it holds an unread snapshot
+        static constexpr uint8_t index_mask = 0x3;
+
+        T buffers[3]{};
+        T previous{};
+        uint8_t write_index = 0;
+        uint8_t read_index = 1;
+        std::atomic<uint8_t> middle = 2;
+
+    public:
+        /// <summary>
+        /// Writer thread only, the buffer to fill before publish()
+        /// </summary>
+        T& get_write_buffer()
+        {
+            return buffers[write_index];
+        }
+
+        /// <summary>
+        /// Writer thread only, make the write buffer the newest snapshot
+        /// </summary>
+        void publish()
+        {
+            const uint8_t published = write_index;
+            const uint8_t old_middle = middle.exchange(published | fresh_bit, std::memory_order_acq_rel);
+            write_index = old_middle & index_mask;
+
+            // Start from the published state so writers that only change part of T don't lose the rest. Only the
+            // writer ever writes to buffers, so reading the published one here is safe:
+            buffers[write_index] = buffers[published];
+        }
+
+        /// <summary>
+        /// Reader thread only, switch to the newest published snapshot if there is one
+        /// </summary>
+        /// <returns>True if a new snapshot was picked up</returns>
+        bool acquire()
+        {
+            if ((middle.load(std::memory_order_acquire) & fresh_bit) == 0) return false;
+
+            previous = buffers[read_index];
+            const uint8_t old_middle = middle.exchange(read_index, std::memory_order_acq_rel);
+            read_index = old_middle & index_mask;
+            return true;
+        }
+
+        /// <summary>
+        /// Reader thread only, the snapshot picked up by the last acquire()
+        /// </summary>
+        const T& get_current() const
+        {
+            return buffers[read_index];
+        }
+
+        /// <summary>
+        /// Reader thread only, the snapshot before get_current()
+        /// </summary>
+        const T& get_previous() const
+        {
+            return previous;
+        }
+    };
+
+}